@@ -0,0 +1,1171 @@
+// benchmarks/db_bench.cpp
+// Benchmark driver for the DB and the components under it
+//
+// Usage: db_bench --benchmarks=fillrandom,readrandom --num=1000000 --threads=4
+// Run with --help for the full list of benchmarks and flags.
+
+#include "util/types.h"
+#include "util/histogram.h"
+#include "util/statistics.h"
+#include "benchmarks/ycsb.h"
+#include "db/db.h"
+#include "db/filename.h"
+#include "db/memtable_manager.h"
+#include "db/trace_replayer.h"
+#include "sstable/sstable_writer.h"
+#include "wal/wal_manager.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lsm;
+
+namespace {
+
+// ============================================================================
+// Flags
+// ============================================================================
+
+struct Flags {
+    // Comma-separated benchmarks, run in order
+    std::string benchmarks =
+        "fillseq,fillrandom,overwrite,readrandom,readseq,readreverse,readwhilewriting";
+    int64_t num = 1000000;          // Keys written by fill benchmarks
+    int64_t reads = -1;             // Ops per read benchmark (-1 = num)
+    int threads = 1;                // Concurrent threads per benchmark
+    int duration = 0;               // Seconds per benchmark (0 = run num ops)
+    int key_size = 16;
+    int value_size = 100;
+    double write_ratio = 0.5;       // Share of writes in mixedworkload
+    uint64_t seed = 301;
+    bool histogram = true;          // Per-op latency histograms
+    bool statistics = false;        // Print DB statistics and lsm.stats after each benchmark
+    bool sync = false;              // WriteOptions::sync on every write
+    std::string wal_sync_policy = "none";  // none, per_write, batched, periodic
+    bool use_existing_db = false;
+    std::string db = "/tmp/lsm_bench_db";
+    int64_t write_buffer_size = 64 << 20;
+    int64_t cache_size = 8 << 20;   // Block cache bytes (0 = none)
+    int block_size = 4096;
+    int bloom_bits = 10;            // 0 = no bloom filter
+    int max_open_files = 1000;
+    int64_t wal_size_mb = 64;       // WAL replayed by the recovery benchmark
+    std::string workload = "a";     // YCSB preset (a-f) or workload file
+    std::string trace_file;         // DB benchmarks record to it; replay reads it
+    int64_t trace_sampling = 1;     // Record one in this many ops
+    double trace_replay_speed = 1;  // Multiple of the recorded rate (0 = unpaced)
+};
+
+Flags FLAGS;
+
+// Shared by every DB the benchmarks open when --statistics is set
+std::shared_ptr<Statistics> dbstats;
+
+// Flags given on the command line; they override workload file settings
+std::set<std::string> given_flags;
+
+// Workload run by ycsbload/ycsbrun, from --workload and the flags above
+ycsb::WorkloadSpec WORKLOAD;
+
+struct FlagInfo {
+    const char* name;
+    const char* help;
+    std::function<bool(const std::string&)> set;
+};
+
+bool ParseInt(const std::string& s, int64_t* v) {
+    char* end = nullptr;
+    *v = std::strtoll(s.c_str(), &end, 10);
+    return !s.empty() && *end == '\0';
+}
+
+template <typename T>
+std::function<bool(const std::string&)> IntFlag(T* target) {
+    return [target](const std::string& s) {
+        int64_t v;
+        if (!ParseInt(s, &v)) return false;
+        *target = static_cast<T>(v);
+        return true;
+    };
+}
+
+std::function<bool(const std::string&)> BoolFlag(bool* target) {
+    return [target](const std::string& s) {
+        if (s == "1" || s == "true") *target = true;
+        else if (s == "0" || s == "false") *target = false;
+        else return false;
+        return true;
+    };
+}
+
+std::function<bool(const std::string&)> StringFlag(std::string* target) {
+    return [target](const std::string& s) {
+        *target = s;
+        return true;
+    };
+}
+
+std::vector<FlagInfo> AllFlags() {
+    return {
+        {"benchmarks", "comma-separated list of benchmarks to run", StringFlag(&FLAGS.benchmarks)},
+        {"num", "number of keys written", IntFlag(&FLAGS.num)},
+        {"reads", "ops per read benchmark (-1 = num)", IntFlag(&FLAGS.reads)},
+        {"threads", "concurrent threads", IntFlag(&FLAGS.threads)},
+        {"duration", "seconds per benchmark instead of a fixed op count", IntFlag(&FLAGS.duration)},
+        {"key_size", "key size in bytes", IntFlag(&FLAGS.key_size)},
+        {"value_size", "value size in bytes", IntFlag(&FLAGS.value_size)},
+        {"write_ratio", "share of writes in mixedworkload (0-1)",
+         [](const std::string& s) {
+             char* end = nullptr;
+             FLAGS.write_ratio = std::strtod(s.c_str(), &end);
+             return *end == '\0' && FLAGS.write_ratio >= 0 && FLAGS.write_ratio <= 1;
+         }},
+        {"seed", "random seed", IntFlag(&FLAGS.seed)},
+        {"histogram", "print latency histograms (0/1)", BoolFlag(&FLAGS.histogram)},
+        {"statistics", "print DB statistics after each benchmark (0/1)",
+         BoolFlag(&FLAGS.statistics)},
+        {"sync", "sync every write (0/1)", BoolFlag(&FLAGS.sync)},
+        {"wal_sync_policy", "none, per_write, batched or periodic",
+         StringFlag(&FLAGS.wal_sync_policy)},
+        {"use_existing_db", "keep the database between runs (0/1)",
+         BoolFlag(&FLAGS.use_existing_db)},
+        {"db", "database directory", StringFlag(&FLAGS.db)},
+        {"write_buffer_size", "memtable size in bytes", IntFlag(&FLAGS.write_buffer_size)},
+        {"cache_size", "block cache bytes (0 = none)", IntFlag(&FLAGS.cache_size)},
+        {"block_size", "SSTable block size", IntFlag(&FLAGS.block_size)},
+        {"bloom_bits", "bloom filter bits per key (0 = none)", IntFlag(&FLAGS.bloom_bits)},
+        {"max_open_files", "table cache size", IntFlag(&FLAGS.max_open_files)},
+        {"wal_size_mb", "WAL size replayed by the recovery benchmark",
+         IntFlag(&FLAGS.wal_size_mb)},
+        {"workload", "YCSB preset a-f or workload file for ycsbload/ycsbrun",
+         StringFlag(&FLAGS.workload)},
+        {"trace_file", "record each DB benchmark to this file (the last one wins); "
+         "replay reads it", StringFlag(&FLAGS.trace_file)},
+        {"trace_sampling", "record one in this many ops", IntFlag(&FLAGS.trace_sampling)},
+        {"trace_replay_speed", "replay at this multiple of the recorded rate (0 = unpaced)",
+         [](const std::string& s) {
+             char* end = nullptr;
+             FLAGS.trace_replay_speed = std::strtod(s.c_str(), &end);
+             return *end == '\0' && FLAGS.trace_replay_speed >= 0;
+         }},
+    };
+}
+
+const char* kBenchmarkHelp =
+    "Benchmarks:\n"
+    "  fillseq           write num keys in sequential order\n"
+    "  fillrandom        write num keys in random order\n"
+    "  overwrite         overwrite num random existing keys\n"
+    "  fillsync          write num/1000 random keys with sync on\n"
+    "  readseq           scan the database forward\n"
+    "  readreverse       scan the database backward\n"
+    "  readrandom        read random existing keys\n"
+    "  readmissing       read random absent keys\n"
+    "  seekrandom        seek an iterator to random keys\n"
+    "  deleterandom      delete random keys\n"
+    "  readwhilewriting  readrandom on every thread plus one writer\n"
+    "  mixedworkload     random reads and writes, write_ratio writes\n"
+    "  memtablefill      random inserts into a MemTableManager only\n"
+    "  walappend         WALManager appends only\n"
+    "  sstablebuild      build one SSTable of num sorted keys per thread\n"
+    "  recovery          reopen after writing wal_size_mb of WAL\n"
+    "  compact           compact the whole key range\n"
+    "  ycsbload          insert the workload's record_count keys\n"
+    "  ycsbrun           run the workload's operation mix with per-op latencies\n"
+    "  replay            replay --trace_file on --threads threads with per-op latencies\n";
+
+bool ParseFlags(int argc, char** argv) {
+    std::vector<FlagInfo> flags = AllFlags();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: db_bench [--flag=value]...\n\nFlags:\n";
+            for (const auto& f : flags) {
+                std::printf("  --%-20s %s\n", f.name, f.help);
+            }
+            std::cout << "\n" << kBenchmarkHelp;
+            std::exit(0);
+        }
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            std::cerr << "Invalid argument: " << arg << "\n";
+            return false;
+        }
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        bool found = false;
+        for (const auto& f : flags) {
+            if (name == f.name) {
+                found = true;
+                given_flags.insert(name);
+                if (!f.set(value)) {
+                    std::cerr << "Invalid value for --" << name << ": " << value << "\n";
+                    return false;
+                }
+            }
+        }
+        if (!found) {
+            std::cerr << "Unknown flag: --" << name << "\n";
+            return false;
+        }
+    }
+    if (FLAGS.threads < 1 || FLAGS.key_size < 1 || FLAGS.value_size < 0 || FLAGS.num < 1 ||
+        FLAGS.trace_sampling < 1) {
+        std::cerr << "threads, key_size, num and trace_sampling must be positive\n";
+        return false;
+    }
+
+    Status s = ycsb::LoadWorkload(FLAGS.workload, &WORKLOAD);
+    if (!s.ok()) {
+        std::cerr << "Bad --workload: " << s.ToString() << "\n";
+        return false;
+    }
+    if (given_flags.count("workload") && !given_flags.count("benchmarks")) {
+        FLAGS.benchmarks = "ycsbload,ycsbrun";
+    }
+    // Without a workload file, or when given, the usual flags size the workload
+    ycsb::WorkloadSpec unused;
+    bool preset = ycsb::PresetWorkload(FLAGS.workload, &unused);
+    if (preset || given_flags.count("num")) {
+        WORKLOAD.record_count = static_cast<uint64_t>(FLAGS.num);
+    }
+    if (preset || given_flags.count("reads")) {
+        WORKLOAD.operation_count = static_cast<uint64_t>(FLAGS.reads < 0 ? FLAGS.num : FLAGS.reads);
+    }
+    if (preset || given_flags.count("value_size")) {
+        WORKLOAD.value_size = static_cast<size_t>(FLAGS.value_size);
+    }
+    if (WORKLOAD.threads < 1 || given_flags.count("threads")) {
+        WORKLOAD.threads = FLAGS.threads;
+    }
+    return true;
+}
+
+wal::SyncPolicy ParseSyncPolicy(const std::string& s) {
+    if (s == "per_write") return wal::SyncPolicy::kSyncPerWrite;
+    if (s == "batched") return wal::SyncPolicy::kSyncBatched;
+    if (s == "periodic") return wal::SyncPolicy::kSyncPeriodic;
+    if (s != "none") {
+        std::cerr << "Unknown --wal_sync_policy " << s << ", using none\n";
+    }
+    return wal::SyncPolicy::kNoSync;
+}
+
+// ============================================================================
+// Data generation
+// ============================================================================
+
+// Values are slices of a pre-generated random buffer, so generating them
+// costs nothing measurable
+class RandomGenerator {
+public:
+    RandomGenerator() {
+        std::mt19937_64 rng(FLAGS.seed);
+        data_.resize(std::max<size_t>(1 << 20, static_cast<size_t>(FLAGS.value_size) * 4));
+        for (char& c : data_) c = static_cast<char>(' ' + rng() % 95);
+    }
+
+    Slice Generate(size_t len) {
+        if (pos_ + len > data_.size()) pos_ = 0;
+        pos_ += len;
+        return Slice(data_.data() + pos_ - len, len);
+    }
+
+private:
+    std::string data_;
+    size_t pos_ = 0;
+};
+
+// Fixed-size keys that sort in numeric order: zero-padded decimal digits,
+// truncated to the low-order digits or padded with 'x' to key_size
+class KeyGenerator {
+public:
+    explicit KeyGenerator(int key_size) : key_size_(static_cast<size_t>(key_size)) {}
+
+    Slice Make(uint64_t k) {
+        char digits[32];
+        int n = std::snprintf(digits, sizeof(digits), "%020llu",
+                              static_cast<unsigned long long>(k));
+        size_t len = static_cast<size_t>(n);
+        if (key_size_ <= len) {
+            buf_.assign(digits + len - key_size_, key_size_);
+        } else {
+            buf_.assign(digits, len);
+            buf_.append(key_size_ - len, 'x');
+        }
+        return buf_;
+    }
+
+private:
+    size_t key_size_;
+    std::string buf_;
+};
+
+// ============================================================================
+// Stats
+// ============================================================================
+
+using Clock = std::chrono::steady_clock;
+
+class Stats {
+public:
+    void Start() {
+        start_ = Clock::now();
+        last_op_ = start_;
+        finish_ = start_;
+        ops_ = 0;
+        bytes_ = 0;
+        hist_.Clear();
+        op_hists_.clear();
+        message_.clear();
+    }
+
+    void Stop() { finish_ = Clock::now(); }
+
+    void Merge(const Stats& other) {
+        hist_.Merge(other.hist_);
+        for (const auto& [op, hist] : other.op_hists_) op_hists_[op].Merge(hist);
+        ops_ += other.ops_;
+        bytes_ += other.bytes_;
+        // Overall span covers every thread
+        if (other.start_ < start_) start_ = other.start_;
+        if (other.finish_ > finish_) finish_ = other.finish_;
+        if (message_.empty()) message_ = other.message_;
+    }
+
+    void FinishedOps(int64_t n = 1) {
+        if (FLAGS.histogram) {
+            Clock::time_point now = Clock::now();
+            hist_.Add(std::chrono::duration<double, std::micro>(now - last_op_).count());
+            last_op_ = now;
+        }
+        ops_ += n;
+    }
+
+    // One op of a named kind; each kind also gets its own latency histogram
+    void FinishedOp(const char* op) {
+        Clock::time_point now = Clock::now();
+        double micros = std::chrono::duration<double, std::micro>(now - last_op_).count();
+        last_op_ = now;
+        if (FLAGS.histogram) hist_.Add(micros);
+        auto it = op_hists_.find(op);
+        if (it == op_hists_.end()) it = op_hists_.emplace(op, Histogram()).first;
+        it->second.Add(micros);
+        ops_++;
+    }
+
+    // Ops of a named kind timed elsewhere (by replay workers)
+    void AddOps(const std::string& op, const Histogram& hist) {
+        if (hist.Count() == 0) return;
+        op_hists_[op].Merge(hist);
+        ops_ += static_cast<int64_t>(hist.Count());
+    }
+
+    void AddBytes(int64_t n) { bytes_ += n; }
+    void AddMessage(const std::string& msg) { message_ = msg; }
+    int64_t ops() const { return ops_; }
+
+    void Report(const std::string& name) const {
+        double elapsed = std::chrono::duration<double, std::micro>(finish_ - start_).count();
+        int64_t ops = std::max<int64_t>(ops_, 1);
+
+        std::string extra;
+        if (bytes_ > 0) {
+            char rate[64];
+            std::snprintf(rate, sizeof(rate), "%6.1f MB/s",
+                          (static_cast<double>(bytes_) / 1048576.0) / (elapsed / 1e6));
+            extra = rate;
+        }
+        if (!message_.empty()) {
+            extra += extra.empty() ? message_ : " " + message_;
+        }
+        std::printf("%-16s : %11.3f micros/op %10.0f ops/s; %s\n", name.c_str(),
+                    elapsed / static_cast<double>(ops),
+                    static_cast<double>(ops_) / (elapsed / 1e6), extra.c_str());
+        for (const auto& [op, hist] : op_hists_) {
+            std::printf("  %-8s %10llu ops  avg %9.2f  P50 %9.2f  P99 %9.2f  P99.9 %9.2f"
+                        "  P99.99 %9.2f  max %9.0f us\n",
+                        op.c_str(), static_cast<unsigned long long>(hist.Count()),
+                        hist.Average(), hist.Percentile(50), hist.Percentile(99),
+                        hist.Percentile(99.9), hist.Percentile(99.99), hist.Max());
+        }
+        if (FLAGS.histogram && hist_.Count() > 0) {
+            std::printf("Microseconds per op:\n%s\n", hist_.ToString().c_str());
+        }
+        std::fflush(stdout);
+    }
+
+private:
+    Clock::time_point start_;
+    Clock::time_point finish_;
+    Clock::time_point last_op_;
+    int64_t ops_ = 0;
+    int64_t bytes_ = 0;
+    Histogram hist_;
+    std::map<std::string, Histogram, std::less<>> op_hists_;  // By op kind
+    std::string message_;
+};
+
+// Threads of one benchmark start together and the last to finish reports
+struct SharedState {
+    std::mutex mu;
+    std::condition_variable cv;
+    int total = 0;
+    int num_initialized = 0;
+    int num_done = 0;
+    bool start = false;
+};
+
+struct ThreadState {
+    int tid;
+    std::mt19937_64 rand;
+    Stats stats;
+    SharedState* shared;
+
+    ThreadState(int index, SharedState* s)
+        : tid(index), rand(FLAGS.seed + static_cast<uint64_t>(index)), shared(s) {}
+
+    uint64_t Uniform(uint64_t n) { return rand() % n; }
+};
+
+// Stops a loop after max_ops, or after --duration seconds when set
+class Duration {
+public:
+    explicit Duration(int64_t max_ops) : max_ops_(max_ops), start_(Clock::now()) {}
+
+    bool Done(int64_t ops_done) const {
+        if (FLAGS.duration > 0) {
+            // Check the clock only every 64 ops
+            return (ops_done & 63) == 0 &&
+                   Clock::now() - start_ >= std::chrono::seconds(FLAGS.duration);
+        }
+        return ops_done >= max_ops_;
+    }
+
+private:
+    int64_t max_ops_;
+    Clock::time_point start_;
+};
+
+// Remove the files a DB at path may own, and nothing else
+void DestroyDB(const std::string& path) {
+    auto remove_db_files = [](const std::string& dir_path) {
+        DIR* dir = ::opendir(dir_path.c_str());
+        if (dir == nullptr) return;
+        std::vector<std::string> names;
+        struct dirent* entry;
+        while ((entry = ::readdir(dir)) != nullptr) {
+            std::string name = entry->d_name;
+            uint64_t number;
+            if (ParseTableFileName(name, &number) || ParseBlobFileName(name, &number) ||
+                ParseNumberedFileName(name, ".tmp", &number) || name == "MANIFEST" ||
+                name == "COLUMN_FAMILIES" || name == "LOG" ||
+                name.compare(0, 4, "log.") == 0) {
+                names.push_back(name);
+            }
+        }
+        ::closedir(dir);
+        for (const auto& name : names) ::unlink((dir_path + "/" + name).c_str());
+        ::rmdir(dir_path.c_str());
+    };
+
+    remove_db_files(path + "/wal");
+    DIR* dir = ::opendir(path.c_str());
+    if (dir != nullptr) {
+        std::vector<std::string> cf_dirs;
+        struct dirent* entry;
+        while ((entry = ::readdir(dir)) != nullptr) {
+            std::string name = entry->d_name;
+            if (name.size() > 2 && name.compare(0, 2, "cf") == 0 &&
+                name.find_first_not_of("0123456789", 2) == std::string::npos) {
+                cf_dirs.push_back(path + "/" + name);
+            }
+        }
+        ::closedir(dir);
+        for (const auto& d : cf_dirs) remove_db_files(d);
+    }
+    remove_db_files(path);
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+
+class Benchmark {
+public:
+    Benchmark() : reads_(FLAGS.reads < 0 ? FLAGS.num : FLAGS.reads) {}
+
+    ~Benchmark() { db_.reset(); }
+
+    void Run() {
+        PrintHeader();
+        if (!FLAGS.use_existing_db) DestroyDB(FLAGS.db);
+
+        std::stringstream names(FLAGS.benchmarks);
+        std::string name;
+        while (std::getline(names, name, ',')) {
+            if (name.empty()) continue;
+            RunOne(name);
+        }
+    }
+
+private:
+    using Method = void (Benchmark::*)(ThreadState*);
+
+    struct Spec {
+        Method method;
+        bool fresh_db;   // Start from an empty database
+        bool needs_db;   // Open the database before running
+    };
+
+    void RunOne(const std::string& name) {
+        static const std::map<std::string, Spec> kBenchmarks = {
+            {"fillseq", {&Benchmark::WriteSeq, true, true}},
+            {"fillrandom", {&Benchmark::WriteRandom, true, true}},
+            {"overwrite", {&Benchmark::WriteRandom, false, true}},
+            {"fillsync", {&Benchmark::WriteRandom, true, true}},
+            {"readseq", {&Benchmark::ReadSequential, false, true}},
+            {"readreverse", {&Benchmark::ReadReverse, false, true}},
+            {"readrandom", {&Benchmark::ReadRandom, false, true}},
+            {"readmissing", {&Benchmark::ReadMissing, false, true}},
+            {"seekrandom", {&Benchmark::SeekRandom, false, true}},
+            {"deleterandom", {&Benchmark::DeleteRandom, false, true}},
+            {"readwhilewriting", {&Benchmark::ReadWhileWriting, false, true}},
+            {"mixedworkload", {&Benchmark::MixedWorkload, false, true}},
+            {"memtablefill", {&Benchmark::MemTableFill, false, false}},
+            {"walappend", {&Benchmark::WalAppend, false, false}},
+            {"sstablebuild", {&Benchmark::SSTableBuild, false, false}},
+            {"recovery", {&Benchmark::Recovery, true, false}},
+            {"compact", {&Benchmark::Compact, false, true}},
+            {"ycsbload", {&Benchmark::YcsbLoad, true, true}},
+            {"ycsbrun", {&Benchmark::YcsbRun, false, true}},
+            {"replay", {&Benchmark::Replay, false, true}},
+        };
+
+        auto it = kBenchmarks.find(name);
+        if (it == kBenchmarks.end()) {
+            std::cerr << "Unknown benchmark '" << name << "'\n";
+            return;
+        }
+        const Spec& spec = it->second;
+
+        sync_ = FLAGS.sync || name == "fillsync";
+        num_ = (name == "fillsync") ? std::max<int64_t>(FLAGS.num / 1000, 1) : FLAGS.num;
+
+        if (spec.fresh_db) {
+            if (FLAGS.use_existing_db) {
+                std::printf("%-16s : skipped (--use_existing_db is true)\n", name.c_str());
+                return;
+            }
+            db_.reset();
+            DestroyDB(FLAGS.db);
+        }
+        if (spec.needs_db && !db_ && !OpenDB()) return;
+        if (!spec.needs_db) db_.reset();
+
+        int threads = FLAGS.threads;
+        if (name == "readwhilewriting") threads++;  // Plus the writer
+        // replay runs its own --threads workers
+        if (name == "recovery" || name == "compact" || name == "replay") threads = 1;
+
+        if (name == "ycsbload" || name == "ycsbrun") {
+            threads = WORKLOAD.threads;
+            workload_ = std::make_unique<ycsb::Workload>(WORKLOAD);
+        } else if (name == "memtablefill") {
+            MemTableOptions mem_options;
+            mem_options.max_size = static_cast<size_t>(FLAGS.write_buffer_size);
+            memtables_ = std::make_unique<MemTableManager>(mem_options);
+            memtables_->SetFlushCallback([this](MemTable*) { drop_pending_ = true; });
+        } else if (name == "walappend") {
+            ::mkdir(FLAGS.db.c_str(), 0755);
+            ::mkdir(ScratchDir().c_str(), 0755);
+            wal::WALOptions wal_options;
+            wal_options.sync_policy = ParseSyncPolicy(FLAGS.wal_sync_policy);
+            wal_options.statistics = dbstats.get();
+            wal_ = std::make_unique<wal::WALManager>(ScratchDir(), wal_options);
+            Status s = wal_->Open();
+            if (!s.ok()) {
+                std::cerr << "WAL open error: " << s.ToString() << "\n";
+                return;
+            }
+        }
+
+        bool tracing = db_ && !FLAGS.trace_file.empty() && name != "replay";
+        if (tracing) {
+            TraceOptions trace_options;
+            trace_options.sampling_frequency = static_cast<uint64_t>(FLAGS.trace_sampling);
+            Status s = db_->StartTrace(trace_options, FLAGS.trace_file);
+            if (!s.ok()) {
+                std::cerr << "trace error: " << s.ToString() << "\n";
+                return;
+            }
+        }
+        RunBenchmark(threads, name, spec.method);
+        if (tracing) {
+            Status s = db_->EndTrace();
+            if (!s.ok()) std::cerr << "trace error: " << s.ToString() << "\n";
+        }
+        if (dbstats) {
+            std::printf("\nSTATISTICS:\n%s\n", dbstats->ToString().c_str());
+            dbstats->Reset();
+            std::string stats;
+            if (db_ && db_->GetProperty("lsm.stats", &stats)) std::printf("%s\n", stats.c_str());
+        }
+
+        memtables_.reset();
+        workload_.reset();
+        if (wal_) {
+            wal_->Close();
+            wal_.reset();
+        }
+        if (name == "walappend" || name == "sstablebuild") DestroyDB(ScratchDir());
+    }
+
+    // walappend and sstablebuild write here, never into the DB itself,
+    // so they can run between benchmarks of an existing DB
+    static std::string ScratchDir() { return FLAGS.db + "/bench_scratch"; }
+
+    bool OpenDB() {
+        DB* db = nullptr;
+        Status s = DB::Open(MakeOptions(), FLAGS.db, &db);
+        if (!s.ok()) {
+            std::cerr << "open error: " << s.ToString() << "\n";
+            return false;
+        }
+        db_.reset(db);
+        return true;
+    }
+
+    static Options MakeOptions() {
+        Options options;
+        options.write_buffer_size = static_cast<size_t>(FLAGS.write_buffer_size);
+        options.block_cache_size = static_cast<size_t>(FLAGS.cache_size);
+        options.max_open_files = FLAGS.max_open_files;
+        options.table_options.block_size = static_cast<size_t>(FLAGS.block_size);
+        options.table_options.use_bloom_filter = FLAGS.bloom_bits > 0;
+        options.table_options.bloom_policy.bits_per_key = FLAGS.bloom_bits;
+        options.wal_options.sync_policy = ParseSyncPolicy(FLAGS.wal_sync_policy);
+        options.statistics = dbstats;
+        return options;
+    }
+
+    void PrintHeader() const {
+        std::printf("Keys:       %d bytes each\n", FLAGS.key_size);
+        std::printf("Values:     %d bytes each\n", FLAGS.value_size);
+        std::printf("Entries:    %lld\n", static_cast<long long>(FLAGS.num));
+        std::printf("Threads:    %d\n", FLAGS.threads);
+        std::printf("WAL sync:   %s%s\n", FLAGS.wal_sync_policy.c_str(),
+                    FLAGS.sync ? " (+ sync per write)" : "");
+        std::printf("Block size: %d, bloom bits: %d, cache: %lld bytes\n", FLAGS.block_size,
+                    FLAGS.bloom_bits, static_cast<long long>(FLAGS.cache_size));
+        if (FLAGS.benchmarks.find("ycsb") != std::string::npos) {
+            const ycsb::WorkloadSpec& w = WORKLOAD;
+            std::printf("Workload:   %s, %llu records, %llu ops, %s keys, %d threads\n",
+                        w.name.c_str(), static_cast<unsigned long long>(w.record_count),
+                        static_cast<unsigned long long>(w.operation_count),
+                        ycsb::DistributionName(w.request_distribution), w.threads);
+            std::printf("Mix:        read %.2f update %.2f insert %.2f scan %.2f rmw %.2f\n",
+                        w.read_proportion, w.update_proportion, w.insert_proportion,
+                        w.scan_proportion, w.read_modify_write_proportion);
+        }
+#ifndef NDEBUG
+        std::printf("WARNING: Assertions are enabled; benchmarks unnecessarily slow\n");
+#endif
+        std::printf("------------------------------------------------\n");
+        std::fflush(stdout);
+    }
+
+    void RunBenchmark(int n, const std::string& name, Method method) {
+        SharedState shared;
+        shared.total = n;
+
+        std::vector<std::unique_ptr<ThreadState>> states;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < n; i++) {
+            states.push_back(std::make_unique<ThreadState>(i, &shared));
+        }
+        for (int i = 0; i < n; i++) {
+            threads.emplace_back([this, &shared, method, state = states[i].get()] {
+                {
+                    std::unique_lock<std::mutex> lock(shared.mu);
+                    shared.num_initialized++;
+                    if (shared.num_initialized >= shared.total) shared.cv.notify_all();
+                    shared.cv.wait(lock, [&] { return shared.start; });
+                }
+                state->stats.Start();
+                (this->*method)(state);
+                state->stats.Stop();
+                std::lock_guard<std::mutex> lock(shared.mu);
+                shared.num_done++;
+                shared.cv.notify_all();
+            });
+        }
+        {
+            std::unique_lock<std::mutex> lock(shared.mu);
+            shared.cv.wait(lock, [&] { return shared.num_initialized >= n; });
+            shared.start = true;
+            shared.cv.notify_all();
+        }
+        for (auto& t : threads) t.join();
+
+        // The readwhilewriting writer (last thread) is not part of the result
+        int reported = (name == "readwhilewriting") ? n - 1 : n;
+        Stats merged = states[0]->stats;
+        for (int i = 1; i < reported; i++) merged.Merge(states[i]->stats);
+        merged.Report(name);
+    }
+
+    WriteOptions MakeWriteOptions() const {
+        WriteOptions wo;
+        wo.sync = sync_;
+        return wo;
+    }
+
+    // ---- DB write benchmarks ----
+
+    void DoWrite(ThreadState* thread, bool seq) {
+        RandomGenerator gen;
+        KeyGenerator keys(FLAGS.key_size);
+        WriteOptions wo = MakeWriteOptions();
+        Duration duration(num_);
+        int64_t i = 0;
+        for (; !duration.Done(i); i++) {
+            uint64_t k = seq ? static_cast<uint64_t>(i) : thread->Uniform(FLAGS.num);
+            Status s = db_->Put(wo, keys.Make(k), gen.Generate(FLAGS.value_size));
+            if (!s.ok()) {
+                std::cerr << "put error: " << s.ToString() << "\n";
+                std::exit(1);
+            }
+            thread->stats.AddBytes(FLAGS.key_size + FLAGS.value_size);
+            thread->stats.FinishedOps();
+        }
+    }
+
+    void WriteSeq(ThreadState* thread) { DoWrite(thread, true); }
+    void WriteRandom(ThreadState* thread) { DoWrite(thread, false); }
+
+    void DeleteRandom(ThreadState* thread) {
+        KeyGenerator keys(FLAGS.key_size);
+        WriteOptions wo = MakeWriteOptions();
+        Duration duration(num_);
+        for (int64_t i = 0; !duration.Done(i); i++) {
+            Status s = db_->Delete(wo, keys.Make(thread->Uniform(FLAGS.num)));
+            if (!s.ok()) {
+                std::cerr << "delete error: " << s.ToString() << "\n";
+                std::exit(1);
+            }
+            thread->stats.FinishedOps();
+        }
+    }
+
+    // ---- DB read benchmarks ----
+
+    void ReadSequential(ThreadState* thread) {
+        std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+        int64_t i = 0;
+        Duration duration(reads_);
+        for (iter->SeekToFirst(); iter->Valid() && !duration.Done(i); iter->Next()) {
+            thread->stats.AddBytes(static_cast<int64_t>(iter->key().size() + iter->value().size()));
+            thread->stats.FinishedOps();
+            i++;
+        }
+    }
+
+    void ReadReverse(ThreadState* thread) {
+        std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+        int64_t i = 0;
+        Duration duration(reads_);
+        for (iter->SeekToLast(); iter->Valid() && !duration.Done(i); iter->Prev()) {
+            thread->stats.AddBytes(static_cast<int64_t>(iter->key().size() + iter->value().size()));
+            thread->stats.FinishedOps();
+            i++;
+        }
+    }
+
+    void ReadRandom(ThreadState* thread) {
+        KeyGenerator keys(FLAGS.key_size);
+        PinnableSlice value;
+        ReadOptions ro;
+        int64_t found = 0;
+        Duration duration(reads_);
+        int64_t i = 0;
+        for (; !duration.Done(i); i++) {
+            Status s = db_->Get(ro, keys.Make(thread->Uniform(FLAGS.num)), &value);
+            if (s.ok()) {
+                found++;
+                thread->stats.AddBytes(static_cast<int64_t>(FLAGS.key_size + value.size()));
+            }
+            value.Reset();
+            thread->stats.FinishedOps();
+        }
+        char msg[64];
+        std::snprintf(msg, sizeof(msg), "(%lld of %lld found)", static_cast<long long>(found),
+                      static_cast<long long>(i));
+        thread->stats.AddMessage(msg);
+    }
+
+    void ReadMissing(ThreadState* thread) {
+        KeyGenerator keys(FLAGS.key_size);
+        PinnableSlice value;
+        Duration duration(reads_);
+        for (int64_t i = 0; !duration.Done(i); i++) {
+            std::string key(keys.Make(thread->Uniform(FLAGS.num)));
+            key.push_back('.');  // Sorts between existing keys
+            db_->Get(ReadOptions(), key, &value);
+            value.Reset();
+            thread->stats.FinishedOps();
+        }
+    }
+
+    void SeekRandom(ThreadState* thread) {
+        KeyGenerator keys(FLAGS.key_size);
+        std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+        int64_t found = 0;
+        Duration duration(reads_);
+        int64_t i = 0;
+        for (; !duration.Done(i); i++) {
+            Slice key = keys.Make(thread->Uniform(FLAGS.num));
+            iter->Seek(key);
+            if (iter->Valid() && iter->key() == key) found++;
+            thread->stats.FinishedOps();
+        }
+        char msg[64];
+        std::snprintf(msg, sizeof(msg), "(%lld of %lld found)", static_cast<long long>(found),
+                      static_cast<long long>(i));
+        thread->stats.AddMessage(msg);
+    }
+
+    void ReadWhileWriting(ThreadState* thread) {
+        if (thread->tid < thread->shared->total - 1) {
+            ReadRandom(thread);
+            return;
+        }
+
+        // The writer runs until every reader is done
+        RandomGenerator gen;
+        KeyGenerator keys(FLAGS.key_size);
+        WriteOptions wo = MakeWriteOptions();
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(thread->shared->mu);
+                if (thread->shared->num_done >= thread->shared->total - 1) break;
+            }
+            Status s = db_->Put(wo, keys.Make(thread->Uniform(FLAGS.num)),
+                                gen.Generate(FLAGS.value_size));
+            if (!s.ok()) {
+                std::cerr << "put error: " << s.ToString() << "\n";
+                std::exit(1);
+            }
+        }
+    }
+
+    void MixedWorkload(ThreadState* thread) {
+        RandomGenerator gen;
+        KeyGenerator keys(FLAGS.key_size);
+        WriteOptions wo = MakeWriteOptions();
+        PinnableSlice value;
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        int64_t writes = 0;
+        Duration duration(reads_);
+        int64_t i = 0;
+        for (; !duration.Done(i); i++) {
+            Slice key = keys.Make(thread->Uniform(FLAGS.num));
+            if (coin(thread->rand) < FLAGS.write_ratio) {
+                Status s = db_->Put(wo, key, gen.Generate(FLAGS.value_size));
+                if (!s.ok()) {
+                    std::cerr << "put error: " << s.ToString() << "\n";
+                    std::exit(1);
+                }
+                thread->stats.AddBytes(FLAGS.key_size + FLAGS.value_size);
+                writes++;
+            } else if (db_->Get(ReadOptions(), key, &value).ok()) {
+                thread->stats.AddBytes(static_cast<int64_t>(FLAGS.key_size + value.size()));
+                value.Reset();
+            }
+            thread->stats.FinishedOps();
+        }
+        char msg[64];
+        std::snprintf(msg, sizeof(msg), "(%lld writes, %lld reads)",
+                      static_cast<long long>(writes), static_cast<long long>(i - writes));
+        thread->stats.AddMessage(msg);
+    }
+
+    void Compact(ThreadState* thread) {
+        Status s = db_->CompactRange(nullptr, nullptr);
+        if (!s.ok()) {
+            std::cerr << "compact error: " << s.ToString() << "\n";
+            std::exit(1);
+        }
+        thread->stats.FinishedOps();
+    }
+
+    // ---- YCSB workloads ----
+
+    // Ops for one of shared->total threads sharing total ops
+    static int64_t ThreadShare(const ThreadState* thread, uint64_t total) {
+        auto n = static_cast<uint64_t>(thread->shared->total);
+        auto tid = static_cast<uint64_t>(thread->tid);
+        return static_cast<int64_t>(total / n + (tid < total % n ? 1 : 0));
+    }
+
+    void YcsbLoad(ThreadState* thread) {
+        RandomGenerator gen;
+        WriteOptions wo = MakeWriteOptions();
+        const ycsb::WorkloadSpec& spec = workload_->spec();
+        auto stride = static_cast<uint64_t>(thread->shared->total);
+        for (uint64_t k = static_cast<uint64_t>(thread->tid); k < spec.record_count; k += stride) {
+            std::string key = workload_->KeyName(k);
+            Status s = db_->Put(wo, key, gen.Generate(spec.value_size));
+            if (!s.ok()) {
+                std::cerr << "put error: " << s.ToString() << "\n";
+                std::exit(1);
+            }
+            thread->stats.AddBytes(static_cast<int64_t>(key.size() + spec.value_size));
+            thread->stats.FinishedOp("insert");
+        }
+    }
+
+    void YcsbRun(ThreadState* thread) {
+        RandomGenerator gen;
+        WriteOptions wo = MakeWriteOptions();
+        const ycsb::WorkloadSpec& spec = workload_->spec();
+        PinnableSlice value;
+        std::unique_ptr<Iterator> iter;
+        int64_t found = 0, reads = 0;
+
+        auto put = [&](const std::string& key) {
+            Status s = db_->Put(wo, key, gen.Generate(spec.value_size));
+            if (!s.ok()) {
+                std::cerr << "put error: " << s.ToString() << "\n";
+                std::exit(1);
+            }
+            thread->stats.AddBytes(static_cast<int64_t>(key.size() + spec.value_size));
+        };
+        auto get = [&](const std::string& key) {
+            reads++;
+            if (db_->Get(ReadOptions(), key, &value).ok()) {
+                found++;
+                thread->stats.AddBytes(static_cast<int64_t>(key.size() + value.size()));
+            }
+            value.Reset();
+        };
+
+        Duration duration(ThreadShare(thread, spec.operation_count));
+        for (int64_t i = 0; !duration.Done(i); i++) {
+            ycsb::Operation op = workload_->NextOperation(&thread->rand);
+            switch (op) {
+                case ycsb::Operation::kRead:
+                    get(workload_->KeyName(workload_->NextKeyNum(&thread->rand)));
+                    break;
+                case ycsb::Operation::kUpdate:
+                    put(workload_->KeyName(workload_->NextKeyNum(&thread->rand)));
+                    break;
+                case ycsb::Operation::kInsert:
+                    put(workload_->KeyName(workload_->NextInsertKeyNum()));
+                    workload_->InsertDone();
+                    break;
+                case ycsb::Operation::kScan: {
+                    // A fresh iterator per scan, so scans see recent inserts
+                    iter.reset(db_->NewIterator(ReadOptions()));
+                    uint64_t len = workload_->NextScanLength(&thread->rand);
+                    iter->Seek(workload_->KeyName(workload_->NextKeyNum(&thread->rand)));
+                    for (uint64_t j = 0; j < len && iter->Valid(); j++, iter->Next()) {
+                        thread->stats.AddBytes(
+                            static_cast<int64_t>(iter->key().size() + iter->value().size()));
+                    }
+                    break;
+                }
+                case ycsb::Operation::kReadModifyWrite: {
+                    std::string key = workload_->KeyName(workload_->NextKeyNum(&thread->rand));
+                    get(key);
+                    put(key);
+                    break;
+                }
+            }
+            thread->stats.FinishedOp(ycsb::OperationName(op));
+        }
+        iter.reset();
+
+        std::string msg = "(" + spec.name + ", " +
+                          ycsb::DistributionName(spec.request_distribution) + " keys";
+        if (reads > 0) {
+            msg += ", " + std::to_string(found) + " of " + std::to_string(reads) + " reads found";
+        }
+        thread->stats.AddMessage(msg + ")");
+    }
+
+    // ---- Trace replay ----
+
+    void Replay(ThreadState* thread) {
+        if (FLAGS.trace_file.empty()) {
+            std::cerr << "replay needs --trace_file\n";
+            std::exit(1);
+        }
+        ReplayOptions options;
+        options.num_threads = FLAGS.threads;
+        options.speed = FLAGS.trace_replay_speed;
+        ReplayStats stats;
+        Status s = Replayer(db_.get()).Replay(FLAGS.trace_file, options, &stats);
+        if (s.ok()) s = stats.first_error;
+        if (!s.ok()) {
+            std::cerr << "replay error: " << s.ToString() << "\n";
+            std::exit(1);
+        }
+        for (int t = 0; t < kNumTraceTypes; t++) {
+            thread->stats.AddOps(TraceTypeName(static_cast<TraceType>(t + 1)), stats.latency[t]);
+        }
+        char msg[128];
+        std::snprintf(msg, sizeof(msg), "(%.3f s of trace in %.3f s, %llu of %llu gets found,"
+                      " max lag %.1f ms)",
+                      static_cast<double>(stats.trace_micros) / 1e6,
+                      static_cast<double>(stats.replay_micros) / 1e6,
+                      static_cast<unsigned long long>(stats.gets_found),
+                      static_cast<unsigned long long>(stats.ops[0]),
+                      static_cast<double>(stats.max_lag_micros) / 1e3);
+        thread->stats.AddMessage(msg);
+    }
+
+    // ---- Component benchmarks ----
+
+    // Inserts into a shared MemTableManager. Rotated memtables are dropped
+    // at once, since nothing flushes them here.
+    void MemTableFill(ThreadState* thread) {
+        RandomGenerator gen;
+        KeyGenerator keys(FLAGS.key_size);
+        Duration duration(num_);
+        for (int64_t i = 0; !duration.Done(i); i++) {
+            memtables_->Put(keys.Make(thread->Uniform(FLAGS.num)), gen.Generate(FLAGS.value_size));
+            if (drop_pending_.exchange(false)) memtables_->RemoveFlushedMemTable();
+            thread->stats.AddBytes(FLAGS.key_size + FLAGS.value_size);
+            thread->stats.FinishedOps();
+        }
+    }
+
+    void WalAppend(ThreadState* thread) {
+        RandomGenerator gen;
+        KeyGenerator keys(FLAGS.key_size);
+        Duration duration(num_);
+        for (int64_t i = 0; !duration.Done(i); i++) {
+            SequenceNumber seq = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+            Status s = wal_->AppendPut(seq, keys.Make(thread->Uniform(FLAGS.num)),
+                                       gen.Generate(FLAGS.value_size));
+            if (s.ok() && sync_) s = wal_->Sync();
+            if (!s.ok()) {
+                std::cerr << "WAL append error: " << s.ToString() << "\n";
+                std::exit(1);
+            }
+            thread->stats.AddBytes(FLAGS.key_size + FLAGS.value_size);
+            thread->stats.FinishedOps();
+        }
+    }
+
+    // Each thread builds its own table of num sorted keys
+    void SSTableBuild(ThreadState* thread) {
+        ::mkdir(FLAGS.db.c_str(), 0755);
+        ::mkdir(ScratchDir().c_str(), 0755);
+        std::string path = ScratchDir() + "/bench" + std::to_string(thread->tid) + ".sst";
+        sstable::SSTableOptions options = MakeOptions().table_options;
+        sstable::SSTableWriter writer(path, options);
+        Status s = writer.Open();
+
+        RandomGenerator gen;
+        KeyGenerator keys(FLAGS.key_size);
+        Duration duration(num_);
+        for (int64_t i = 0; s.ok() && !duration.Done(i); i++) {
+            s = writer.Add(keys.Make(static_cast<uint64_t>(i)), gen.Generate(FLAGS.value_size),
+                           static_cast<SequenceNumber>(i + 1), ValueType::kValue);
+            thread->stats.AddBytes(FLAGS.key_size + FLAGS.value_size);
+            thread->stats.FinishedOps();
+        }
+        sstable::SSTableWriteStats stats;
+        if (s.ok()) s = writer.Finish(&stats);
+        if (!s.ok()) {
+            std::cerr << "SSTable build error: " << s.ToString() << "\n";
+            std::exit(1);
+        }
+        ::unlink(path.c_str());
+        char msg[64];
+        std::snprintf(msg, sizeof(msg), "(%.1f MB table)",
+                      static_cast<double>(stats.file_size) / 1048576.0);
+        thread->stats.AddMessage(msg);
+    }
+
+    // Write wal_size_mb of entries without flushing, then time reopening,
+    // which replays the WAL and flushes it to L0
+    void Recovery(ThreadState* thread) {
+        Options options = MakeOptions();
+        options.write_buffer_size = static_cast<size_t>(-1) / 2;  // Never rotate
+        options.wal_options.sync_policy = wal::SyncPolicy::kNoSync;
+        int64_t entry_size = FLAGS.key_size + FLAGS.value_size;
+        int64_t entries = std::max<int64_t>(FLAGS.wal_size_mb * 1048576 / entry_size, 1);
+        {
+            DB* db = nullptr;
+            Status s = DB::Open(options, FLAGS.db, &db);
+            std::unique_ptr<DB> guard(db);
+            RandomGenerator gen;
+            KeyGenerator keys(FLAGS.key_size);
+            for (int64_t i = 0; s.ok() && i < entries; i++) {
+                s = db->Put(WriteOptions(), keys.Make(thread->Uniform(FLAGS.num)),
+                            gen.Generate(FLAGS.value_size));
+            }
+            if (!s.ok()) {
+                std::cerr << "recovery setup error: " << s.ToString() << "\n";
+                std::exit(1);
+            }
+        }
+
+        thread->stats.Start();  // Exclude the setup above
+        DB* db = nullptr;
+        Status s = DB::Open(options, FLAGS.db, &db);
+        thread->stats.AddBytes(entries * entry_size);
+        thread->stats.FinishedOps(entries);
+        delete db;
+        if (!s.ok()) {
+            std::cerr << "recovery error: " << s.ToString() << "\n";
+            std::exit(1);
+        }
+        char msg[64];
+        std::snprintf(msg, sizeof(msg), "(%lld entries replayed)",
+                      static_cast<long long>(entries));
+        thread->stats.AddMessage(msg);
+    }
+
+    const int64_t reads_;
+    int64_t num_ = 0;
+    bool sync_ = false;
+    std::unique_ptr<DB> db_;
+    std::unique_ptr<MemTableManager> memtables_;
+    std::atomic<bool> drop_pending_{false};
+    std::unique_ptr<wal::WALManager> wal_;
+    std::atomic<SequenceNumber> next_sequence_{1};
+    std::unique_ptr<ycsb::Workload> workload_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (!ParseFlags(argc, argv)) return 1;
+    if (FLAGS.statistics) dbstats = CreateDBStatistics();
+    Benchmark benchmark;
+    benchmark.Run();
+    return 0;
+}
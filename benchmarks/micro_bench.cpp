@@ -0,0 +1,756 @@
+// benchmarks/micro_bench.cpp
+// Microbenchmarks for hot-path primitives
+//
+// Usage: micro_bench [--filter=regex] [--min_time=0.5] [--json=out.json]
+//
+// Each benchmark runs with growing iteration counts until one run takes at
+// least --min_time seconds, then reports time per iteration. --json writes
+// the results in Google Benchmark's JSON layout, so its compare.py and
+// other tracking tools can diff runs.
+
+#include "util/types.h"
+#include "util/arena.h"
+#include "util/bloom_filter.h"
+#include "memtable/skiplist.h"
+#include "sstable/block_builder.h"
+#include "sstable/sstable_format.h"
+#include "wal/wal_format.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lsm;
+
+namespace {
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+// Keep the compiler from discarding a value or the stores before it
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() { asm volatile("" : : : "memory"); }
+
+using Clock = std::chrono::steady_clock;
+
+inline double ThreadCpuSeconds() {
+    timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+// Parameters of one benchmark instance; unused ones stay 0
+struct Args {
+    int key_size = 0;
+    int value_size = 0;
+    int size = 0;     // Bytes per call, or entries in a prebuilt structure
+    int threads = 1;
+};
+
+// Per-thread view of a running benchmark
+class State {
+public:
+    State(const Args& args, int64_t iterations, int thread_index, void* fixture)
+        : args(args), thread_index(thread_index),
+          iterations_(iterations), fixture_(fixture) {}
+
+    const Args args;
+    const int thread_index;
+
+    // for (...; state.KeepRunning();) { timed body }
+    bool KeepRunning() {
+        if (done_ == 0 && !running_) Start();
+        if (done_ < iterations_) {
+            done_++;
+            return true;
+        }
+        Stop();
+        return false;
+    }
+
+    int64_t iterations() const { return iterations_; }
+
+    // Exclude setup inside the loop (e.g. rebuilding a full structure)
+    void PauseTiming() {
+        wall_ += std::chrono::duration<double>(Clock::now() - start_).count();
+        cpu_ += ThreadCpuSeconds() - cpu_start_;
+        running_ = false;
+    }
+    void ResumeTiming() { Start(); }
+
+    void SetBytesProcessed(int64_t n) { bytes_ = n; }
+    void SetItemsProcessed(int64_t n) { items_ = n; }
+
+    template <typename T>
+    T& fixture() const { return *static_cast<T*>(fixture_); }
+
+    double wall_seconds() const { return wall_; }
+    double cpu_seconds() const { return cpu_; }
+    int64_t bytes() const { return bytes_; }
+    int64_t items() const { return items_; }
+
+private:
+    void Start() {
+        running_ = true;
+        start_ = Clock::now();
+        cpu_start_ = ThreadCpuSeconds();
+    }
+
+    void Stop() {
+        if (running_) PauseTiming();
+    }
+
+    const int64_t iterations_;
+    void* fixture_;
+    int64_t done_ = 0;
+    bool running_ = false;
+    Clock::time_point start_;
+    double cpu_start_ = 0;
+    double wall_ = 0;
+    double cpu_ = 0;
+    int64_t bytes_ = 0;
+    int64_t items_ = 0;
+};
+
+// A benchmark function and the argument sets to run it with. An optional
+// setup builds a fixture shared by all threads of one instance, outside
+// the timed region.
+struct Benchmark {
+    std::string name;
+    std::function<std::shared_ptr<void>(const Args&)> setup;
+    std::function<void(State&)> run;
+    std::vector<Args> args;
+};
+
+std::string InstanceName(const Benchmark& b, const Args& a) {
+    std::string name = b.name;
+    if (a.key_size > 0) name += "/key_size:" + std::to_string(a.key_size);
+    if (a.value_size > 0) name += "/value_size:" + std::to_string(a.value_size);
+    if (a.size > 0) name += "/size:" + std::to_string(a.size);
+    name += "/threads:" + std::to_string(a.threads);
+    return name;
+}
+
+struct Result {
+    std::string name;
+    Args args;
+    int64_t iterations;  // Per thread
+    double real_ns;      // Wall time per iteration
+    double cpu_ns;       // CPU time per iteration, averaged over threads
+    double bytes_per_second;
+    double items_per_second;
+};
+
+// Run iterations on args.threads threads started together
+Result RunInstance(const Benchmark& b, const Args& args, void* fixture, int64_t iterations) {
+    std::vector<std::unique_ptr<State>> states;
+    for (int t = 0; t < args.threads; t++) {
+        states.push_back(std::make_unique<State>(args, iterations, t, fixture));
+    }
+
+    std::mutex mu;
+    std::condition_variable cv;
+    int ready = 0;
+    bool go = false;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < args.threads; t++) {
+        threads.emplace_back([&, state = states[t].get()] {
+            {
+                std::unique_lock<std::mutex> lock(mu);
+                ready++;
+                cv.notify_all();
+                cv.wait(lock, [&] { return go; });
+            }
+            b.run(*state);
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] { return ready == args.threads; });
+        go = true;
+        cv.notify_all();
+    }
+    for (auto& t : threads) t.join();
+
+    double wall = 0, cpu = 0;
+    int64_t bytes = 0, items = 0;
+    for (const auto& s : states) {
+        wall = std::max(wall, s->wall_seconds());
+        cpu += s->cpu_seconds();
+        bytes += s->bytes();
+        items += s->items();
+    }
+    Result r;
+    r.name = InstanceName(b, args);
+    r.args = args;
+    r.iterations = iterations;
+    r.real_ns = wall * 1e9 / static_cast<double>(iterations);
+    r.cpu_ns = cpu * 1e9 / static_cast<double>(iterations * args.threads);
+    r.bytes_per_second = wall > 0 ? static_cast<double>(bytes) / wall : 0;
+    r.items_per_second = wall > 0 ? static_cast<double>(items) / wall : 0;
+    return r;
+}
+
+// Grow the iteration count until a run lasts min_time
+Result Measure(const Benchmark& b, const Args& args, double min_time) {
+    std::shared_ptr<void> fixture = b.setup ? b.setup(args) : nullptr;
+    int64_t iterations = 1;
+    while (true) {
+        Result r = RunInstance(b, args, fixture.get(), iterations);
+        double seconds = r.real_ns * static_cast<double>(iterations) * 1e-9;
+        if (seconds >= min_time || iterations >= 1000000000) return r;
+        // Aim 40% past min_time, growing at most 10x per round
+        double scale = seconds > 0 ? min_time * 1.4 / seconds : 10;
+        iterations = std::max(iterations + 1,
+                              static_cast<int64_t>(static_cast<double>(iterations) *
+                                                   std::min(scale, 10.0)));
+    }
+}
+
+std::vector<Benchmark>& Registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+// Cartesian product of parameter lists
+std::vector<Args> Product(std::vector<int> key_sizes, std::vector<int> value_sizes,
+                          std::vector<int> sizes, std::vector<int> threads) {
+    std::vector<Args> out;
+    for (int k : key_sizes)
+        for (int v : value_sizes)
+            for (int s : sizes)
+                for (int t : threads) {
+                    Args a;
+                    a.key_size = k;
+                    a.value_size = v;
+                    a.size = s;
+                    a.threads = t;
+                    out.push_back(a);
+                }
+    return out;
+}
+
+// ============================================================================
+// Data
+// ============================================================================
+
+// Bijective 64-bit mix (splitmix64 finalizer): distinct inputs give
+// distinct, well-scattered outputs
+inline uint64_t Mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Distinct keys of key_size bytes (at least 16) in random order; sorted
+// ones when ordered is true
+std::vector<std::string> MakeKeys(size_t n, int key_size, bool ordered, uint64_t salt = 0) {
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    char buf[32];
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v = ordered ? i : Mix(i ^ (salt << 40));
+        std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+        std::string key(buf);
+        key.resize(std::max<size_t>(static_cast<size_t>(key_size), 16), 'x');
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+std::string RandomBytes(size_t n, uint64_t seed = 301) {
+    std::mt19937_64 rng(seed);
+    std::string s(n, '\0');
+    for (char& c : s) c = static_cast<char>(rng());
+    return s;
+}
+
+// Keys in the skip list point into strings owned by the benchmark, so the
+// list measures linking and comparisons only
+struct SliceComparator {
+    int operator()(const Slice& a, const Slice& b) const { return a.compare(b); }
+};
+using SliceSkipList = SkipList<Slice, SliceComparator>;
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+void RegisterBenchmarks() {
+    auto add = [](Benchmark b) { Registry().push_back(std::move(b)); };
+
+    // ---- Arena ----
+
+    add({"Arena::Allocate", nullptr,
+         [](State& state) {
+             const auto bytes = static_cast<size_t>(state.args.size);
+             Arena arena;
+             int64_t n = 0;
+             while (state.KeepRunning()) {
+                 DoNotOptimize(arena.Allocate(bytes));
+                 // Keep the footprint bounded; Reset keeps the first block
+                 if ((++n & 0xFFFF) == 0) arena.Reset();
+             }
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({0}, {0}, {16, 128, 1024}, {1})});
+
+    add({"Arena::AllocateAligned", nullptr,
+         [](State& state) {
+             const auto bytes = static_cast<size_t>(state.args.size);
+             Arena arena;
+             int64_t n = 0;
+             while (state.KeepRunning()) {
+                 DoNotOptimize(arena.AllocateAligned(bytes));
+                 if ((++n & 0xFFFF) == 0) arena.Reset();
+             }
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({0}, {0}, {24, 72}, {1})});
+
+    // ---- SkipList ----
+
+    // Inserts in random order into lists growing to size entries
+    add({"SkipList::Insert", nullptr,
+         [](State& state) {
+             const auto n = static_cast<size_t>(state.args.size);
+             std::vector<std::string> keys = MakeKeys(n, state.args.key_size, false);
+             auto arena = std::make_unique<Arena>();
+             auto list = std::make_unique<SliceSkipList>(SliceComparator(), arena.get());
+             size_t i = 0;
+             while (state.KeepRunning()) {
+                 if (i == n) {
+                     state.PauseTiming();
+                     list.reset();
+                     arena = std::make_unique<Arena>();
+                     list = std::make_unique<SliceSkipList>(SliceComparator(), arena.get());
+                     i = 0;
+                     state.ResumeTiming();
+                 }
+                 list->Insert(keys[i++]);
+             }
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({16, 64}, {0}, {1000, 100000}, {1})});
+
+    // Inserts in ascending order (time-ordered keys), searching from the
+    // previous insert; compare with SkipList::Insert on random keys
+    add({"SkipList::InsertWithHint", nullptr,
+         [](State& state) {
+             const auto n = static_cast<size_t>(state.args.size);
+             std::vector<std::string> keys = MakeKeys(n, state.args.key_size, true);
+             auto arena = std::make_unique<Arena>();
+             auto list = std::make_unique<SliceSkipList>(SliceComparator(), arena.get());
+             SliceSkipList::InsertHint hint;
+             size_t i = 0;
+             while (state.KeepRunning()) {
+                 if (i == n) {
+                     state.PauseTiming();
+                     list.reset();
+                     arena = std::make_unique<Arena>();
+                     list = std::make_unique<SliceSkipList>(SliceComparator(), arena.get());
+                     hint = SliceSkipList::InsertHint();
+                     i = 0;
+                     state.ResumeTiming();
+                 }
+                 list->InsertWithHint(keys[i++], &hint);
+             }
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({16, 64}, {0}, {1000, 100000}, {1})});
+
+    struct SkipListFixture {
+        std::vector<std::string> keys;
+        Arena arena;
+        SliceSkipList list{SliceComparator(), &arena};
+    };
+    auto skiplist_setup = [](const Args& a) -> std::shared_ptr<void> {
+        auto f = std::make_shared<SkipListFixture>();
+        f->keys = MakeKeys(static_cast<size_t>(a.size), a.key_size, false);
+        for (const auto& k : f->keys) f->list.Insert(k);
+        return f;
+    };
+
+    // Seeks to random existing keys; concurrent readers share the list
+    add({"SkipList::Seek", skiplist_setup,
+         [](State& state) {
+             auto& f = state.fixture<SkipListFixture>();
+             SliceSkipList::Iterator iter(&f.list);
+             std::mt19937_64 rng(static_cast<uint64_t>(state.thread_index) + 1);
+             const size_t n = f.keys.size();
+             while (state.KeepRunning()) {
+                 iter.Seek(f.keys[rng() % n]);
+                 DoNotOptimize(iter.Valid());
+             }
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({16, 64}, {0}, {1000, 1000000}, {1, 4})});
+
+    // ---- Checksums and hashing ----
+
+    add({"CRC32::Compute", nullptr,
+         [](State& state) {
+             std::string data = RandomBytes(static_cast<size_t>(state.args.size));
+             while (state.KeepRunning()) {
+                 DoNotOptimize(wal::CRC32::Compute(data.data(), data.size()));
+             }
+             state.SetBytesProcessed(state.iterations() * state.args.size);
+         },
+         Product({0}, {0}, {64, 4096, 65536}, {1, 4})});
+
+    add({"MurmurHash::Hash128", nullptr,
+         [](State& state) {
+             std::string data = RandomBytes(static_cast<size_t>(state.args.size));
+             uint64_t h1, h2;
+             while (state.KeepRunning()) {
+                 MurmurHash::Hash128(data.data(), data.size(), &h1, &h2);
+                 DoNotOptimize(h1);
+                 DoNotOptimize(h2);
+             }
+             state.SetBytesProcessed(state.iterations() * state.args.size);
+         },
+         Product({0}, {0}, {16, 64, 1024}, {1})});
+
+    // ---- Bloom filter ----
+
+    struct BloomFixture {
+        std::string filter;
+        std::vector<std::string> probes;  // Half present, half absent
+    };
+    auto bloom_setup = [](const Args& a) -> std::shared_ptr<void> {
+        auto f = std::make_shared<BloomFixture>();
+        const auto n = static_cast<size_t>(a.size);
+        std::vector<std::string> present = MakeKeys(n, a.key_size, false, 1);
+        std::vector<std::string> absent = MakeKeys(n, a.key_size, false, 2);
+        BloomFilterBuilder builder;
+        for (const auto& k : present) builder.AddKey(k);
+        f->filter = builder.Finish();
+        for (size_t i = 0; i < n; i++) {
+            f->probes.push_back((i & 1) ? present[i] : absent[i]);
+        }
+        return f;
+    };
+
+    add({"BloomFilterReader::MayContain", bloom_setup,
+         [](State& state) {
+             auto& f = state.fixture<BloomFixture>();
+             BloomFilterReader reader;
+             reader.Init(f.filter);
+             std::mt19937_64 rng(static_cast<uint64_t>(state.thread_index) + 1);
+             const size_t n = f.probes.size();
+             while (state.KeepRunning()) {
+                 DoNotOptimize(reader.MayContain(f.probes[rng() % n]));
+             }
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({16}, {0}, {10000, 1000000}, {1, 4})});
+
+    // ---- SSTable blocks ----
+
+    // Adds sorted entries, finishing the block every 4KB
+    add({"BlockBuilder::Add/Finish", nullptr,
+         [](State& state) {
+             std::vector<std::string> keys = MakeKeys(4096, state.args.key_size, true);
+             std::string value = RandomBytes(static_cast<size_t>(state.args.value_size));
+             sstable::BlockBuilder builder;
+             size_t i = 0;
+             while (state.KeepRunning()) {
+                 // Restart on wrap-around too: keys must ascend within a block
+                 if (i == keys.size() || builder.CurrentSizeEstimate() >= 4096) {
+                     DoNotOptimize(builder.Finish().size());
+                     builder.Reset();
+                     if (i == keys.size()) i = 0;
+                 }
+                 builder.Add(keys[i++], value);
+             }
+             state.SetItemsProcessed(state.iterations());
+             state.SetBytesProcessed(state.iterations() *
+                                     (state.args.key_size + state.args.value_size));
+         },
+         Product({16, 64}, {100, 1000}, {0}, {1})});
+
+    // ---- Varint ----
+
+    // Values spread over every encoded length
+    auto varint_values = [](int bits) {
+        std::mt19937_64 rng(301);
+        std::vector<uint64_t> values(4096);
+        for (auto& v : values) {
+            int width = 1 + static_cast<int>(rng() % static_cast<uint64_t>(bits));
+            v = rng() & (width == 64 ? ~0ULL : ((1ULL << width) - 1));
+        }
+        return values;
+    };
+
+    add({"Varint::PutVarint32", nullptr,
+         [varint_values](State& state) {
+             std::vector<uint64_t> values = varint_values(32);
+             std::string buf;
+             buf.reserve(values.size() * 5);
+             size_t i = 0;
+             while (state.KeepRunning()) {
+                 if (i == values.size()) {
+                     buf.clear();
+                     i = 0;
+                 }
+                 sstable::Varint::PutVarint32(&buf, static_cast<uint32_t>(values[i++]));
+             }
+             DoNotOptimize(buf.data());
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({0}, {0}, {0}, {1})});
+
+    add({"Varint::GetVarint32", nullptr,
+         [varint_values](State& state) {
+             std::vector<uint64_t> values = varint_values(32);
+             std::string buf;
+             for (uint64_t v : values) sstable::Varint::PutVarint32(&buf, static_cast<uint32_t>(v));
+             const char* p = buf.data();
+             const char* limit = p + buf.size();
+             uint32_t v;
+             while (state.KeepRunning()) {
+                 if (p == limit) p = buf.data();
+                 sstable::Varint::GetVarint32(&p, limit, &v);
+                 DoNotOptimize(v);
+             }
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({0}, {0}, {0}, {1})});
+
+    add({"Varint::PutVarint64", nullptr,
+         [varint_values](State& state) {
+             std::vector<uint64_t> values = varint_values(64);
+             std::string buf;
+             buf.reserve(values.size() * 10);
+             size_t i = 0;
+             while (state.KeepRunning()) {
+                 if (i == values.size()) {
+                     buf.clear();
+                     i = 0;
+                 }
+                 sstable::Varint::PutVarint64(&buf, values[i++]);
+             }
+             DoNotOptimize(buf.data());
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({0}, {0}, {0}, {1})});
+
+    add({"Varint::GetVarint64", nullptr,
+         [varint_values](State& state) {
+             std::vector<uint64_t> values = varint_values(64);
+             std::string buf;
+             for (uint64_t v : values) sstable::Varint::PutVarint64(&buf, v);
+             const char* p = buf.data();
+             const char* limit = p + buf.size();
+             uint64_t v;
+             while (state.KeepRunning()) {
+                 if (p == limit) p = buf.data();
+                 sstable::Varint::GetVarint64(&p, limit, &v);
+                 DoNotOptimize(v);
+             }
+             state.SetItemsProcessed(state.iterations());
+         },
+         Product({0}, {0}, {0}, {1})});
+
+    // ---- WAL ----
+
+    add({"EncodeWALEntry", nullptr,
+         [](State& state) {
+             wal::WALEntry entry;
+             entry.type = wal::WALEntryType::kPut;
+             entry.sequence = 1;
+             entry.key = MakeKeys(1, state.args.key_size, false)[0];
+             entry.value = RandomBytes(static_cast<size_t>(state.args.value_size));
+             while (state.KeepRunning()) {
+                 std::string encoded = wal::EncodeWALEntry(entry);
+                 DoNotOptimize(encoded.data());
+                 entry.sequence++;
+             }
+             state.SetBytesProcessed(state.iterations() *
+                                     (state.args.key_size + state.args.value_size));
+         },
+         Product({16, 64}, {100, 1000}, {0}, {1, 4})});
+
+    add({"DecodeWALEntry", nullptr,
+         [](State& state) {
+             wal::WALEntry entry;
+             entry.type = wal::WALEntryType::kPut;
+             entry.sequence = 1;
+             entry.key = MakeKeys(1, state.args.key_size, false)[0];
+             entry.value = RandomBytes(static_cast<size_t>(state.args.value_size));
+             std::string encoded = wal::EncodeWALEntry(entry);
+             wal::WALEntry decoded;
+             while (state.KeepRunning()) {
+                 DoNotOptimize(wal::DecodeWALEntry(encoded, &decoded));
+             }
+             state.SetBytesProcessed(state.iterations() *
+                                     (state.args.key_size + state.args.value_size));
+         },
+         Product({16}, {100, 1000}, {0}, {1})});
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+std::string JsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+    }
+    return out;
+}
+
+bool WriteJson(const std::string& path, const std::vector<Result>& results, const char* argv0) {
+    FILE* f = (path == "-") ? stdout : std::fopen(path.c_str(), "w");
+    if (f == nullptr) return false;
+
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+    char host[256] = "";
+    ::gethostname(host, sizeof(host) - 1);
+
+    std::fprintf(f, "{\n  \"context\": {\n");
+    std::fprintf(f, "    \"date\": \"%s\",\n", date);
+    std::fprintf(f, "    \"host_name\": \"%s\",\n", JsonEscape(host).c_str());
+    std::fprintf(f, "    \"executable\": \"%s\",\n", JsonEscape(argv0).c_str());
+    std::fprintf(f, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+    std::fprintf(f, "    \"library_build_type\": \"release\"\n");
+#else
+    std::fprintf(f, "    \"library_build_type\": \"debug\"\n");
+#endif
+    std::fprintf(f, "  },\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::fprintf(f, "    {\n");
+        std::fprintf(f, "      \"name\": \"%s\",\n", JsonEscape(r.name).c_str());
+        std::fprintf(f, "      \"run_name\": \"%s\",\n", JsonEscape(r.name).c_str());
+        std::fprintf(f, "      \"run_type\": \"iteration\",\n");
+        std::fprintf(f, "      \"iterations\": %lld,\n", static_cast<long long>(r.iterations));
+        std::fprintf(f, "      \"real_time\": %.4f,\n", r.real_ns);
+        std::fprintf(f, "      \"cpu_time\": %.4f,\n", r.cpu_ns);
+        std::fprintf(f, "      \"time_unit\": \"ns\",\n");
+        std::fprintf(f, "      \"threads\": %d,\n", r.args.threads);
+        std::fprintf(f, "      \"key_size\": %d,\n", r.args.key_size);
+        std::fprintf(f, "      \"value_size\": %d,\n", r.args.value_size);
+        std::fprintf(f, "      \"size\": %d", r.args.size);
+        if (r.bytes_per_second > 0) {
+            std::fprintf(f, ",\n      \"bytes_per_second\": %.2f", r.bytes_per_second);
+        }
+        if (r.items_per_second > 0) {
+            std::fprintf(f, ",\n      \"items_per_second\": %.2f", r.items_per_second);
+        }
+        std::fprintf(f, "\n    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    if (f != stdout) std::fclose(f);
+    return true;
+}
+
+std::string HumanRate(double per_second, const char* unit) {
+    static const char* kPrefixes[] = {"", "k", "M", "G", "T"};
+    int p = 0;
+    double v = per_second;
+    double step = std::string(unit) == "B/s" ? 1024 : 1000;
+    while (v >= step && p < 4) {
+        v /= step;
+        p++;
+    }
+    char buf[32];
+    if (std::string(unit) == "B/s") {
+        std::snprintf(buf, sizeof(buf), "%.1f%s%s", v, p ? kPrefixes[p] : "",
+                      p ? "iB/s" : "B/s");
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.1f%s%s", v, kPrefixes[p], unit);
+    }
+    return buf;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string filter = ".";
+    std::string json;
+    double min_time = 0.5;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--filter=") == 0) {
+            filter = arg.substr(9);
+        } else if (arg.compare(0, 11, "--min_time=") == 0) {
+            min_time = std::strtod(arg.c_str() + 11, nullptr);
+        } else if (arg.compare(0, 7, "--json=") == 0) {
+            json = arg.substr(7);
+        } else {
+            std::cerr << "Usage: micro_bench [--filter=regex] [--min_time=seconds]"
+                         " [--json=path|-]\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    std::regex re;
+    try {
+        re = std::regex(filter);
+    } catch (const std::regex_error&) {
+        std::cerr << "Invalid --filter regex: " << filter << "\n";
+        return 1;
+    }
+
+    RegisterBenchmarks();
+
+    // Console table goes to stderr when JSON goes to stdout
+    FILE* out = (json == "-") ? stderr : stdout;
+#ifndef NDEBUG
+    std::fprintf(out, "WARNING: Assertions are enabled; benchmarks unnecessarily slow\n");
+#endif
+    std::fprintf(out, "%-62s %13s %13s %12s %s\n", "Benchmark", "Time", "CPU", "Iterations",
+                 "Rate");
+    std::fprintf(out, "%s\n", std::string(120, '-').c_str());
+
+    std::vector<Result> results;
+    for (const Benchmark& b : Registry()) {
+        for (const Args& args : b.args) {
+            std::string name = InstanceName(b, args);
+            if (!std::regex_search(name, re)) continue;
+            Result r = Measure(b, args, min_time);
+            std::string rate;
+            if (r.bytes_per_second > 0) rate = HumanRate(r.bytes_per_second, "B/s");
+            if (r.items_per_second > 0) {
+                rate += (rate.empty() ? "" : " ") + HumanRate(r.items_per_second, " items/s");
+            }
+            std::fprintf(out, "%-62s %10.1f ns %10.1f ns %12lld %s\n", name.c_str(), r.real_ns,
+                         r.cpu_ns, static_cast<long long>(r.iterations), rate.c_str());
+            std::fflush(out);
+            results.push_back(r);
+        }
+    }
+
+    if (!json.empty() && !WriteJson(json, results, argv[0])) {
+        std::cerr << "Cannot write " << json << "\n";
+        return 1;
+    }
+    return 0;
+}
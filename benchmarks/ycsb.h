@@ -0,0 +1,524 @@
+// benchmarks/ycsb.h
+// YCSB-style workloads: key choosers, operation mixes, presets and a
+// YAML workload file parser
+
+#pragma once
+
+#include "util/types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace lsm {
+namespace ycsb {
+
+using Random = std::mt19937_64;
+
+inline double NextDouble(Random* rng) {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(*rng);
+}
+
+// 64-bit FNV-1a over the bytes of v, as YCSB uses to scatter key numbers
+inline uint64_t FNVHash64(uint64_t v) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 8; i++) {
+        hash ^= v & 0xFF;
+        hash *= 1099511628211ULL;
+        v >>= 8;
+    }
+    return hash;
+}
+
+// ============================================================================
+// Key choosers
+// ============================================================================
+
+// Chooses key numbers in [0, item_count). item_count grows as a workload
+// inserts, so it is passed on every call.
+class KeyChooser {
+public:
+    virtual ~KeyChooser() = default;
+    virtual uint64_t Next(Random* rng, uint64_t item_count) = 0;
+};
+
+class UniformChooser : public KeyChooser {
+public:
+    uint64_t Next(Random* rng, uint64_t item_count) override {
+        return (*rng)() % std::max<uint64_t>(item_count, 1);
+    }
+};
+
+// Zipfian over [0, items): item 0 is the most popular, item i has weight
+// 1 / (i + 1)^theta. Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases" (the generator YCSB uses). zeta(n) is extended
+// incrementally when the item count grows, so growing workloads stay O(1)
+// amortized. Thread-safe.
+class ZipfianChooser : public KeyChooser {
+public:
+    static constexpr double kDefaultTheta = 0.99;
+
+    explicit ZipfianChooser(uint64_t initial_items, double theta = kDefaultTheta)
+        : theta_(theta),
+          alpha_(1.0 / (1.0 - theta)),
+          zeta2theta_(Zeta(0, 2, theta, 0)) {
+        Grow(std::max<uint64_t>(initial_items, 1));
+    }
+
+    uint64_t Next(Random* rng, uint64_t item_count) override {
+        item_count = std::max<uint64_t>(item_count, 1);
+        Params p = Load();
+        if (item_count > p.items) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (item_count > items_) Grow(item_count);
+            p = {items_, zetan_, eta_};
+        }
+        // A smaller item count than computed for (another thread grew it)
+        // reuses the larger count's zeta and eta, as YCSB does; results
+        // are clamped below
+        double u = NextDouble(rng);
+        double uz = u * p.zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta_)) return std::min<uint64_t>(1, item_count - 1);
+        auto r = static_cast<uint64_t>(static_cast<double>(item_count) *
+                                       std::pow(p.eta * u - p.eta + 1.0, alpha_));
+        return std::min(r, item_count - 1);
+    }
+
+private:
+    struct Params {
+        uint64_t items;
+        double zetan;
+        double eta;
+    };
+
+    // sum_{i=from}^{to-1} 1 / (i + 1)^theta, added to initial
+    static double Zeta(uint64_t from, uint64_t to, double theta, double initial) {
+        double sum = initial;
+        for (uint64_t i = from; i < to; i++) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), theta);
+        }
+        return sum;
+    }
+
+    // REQUIRES: mutex_ held (or constructor)
+    void Grow(uint64_t items) {
+        zetan_ = Zeta(items_, items, theta_, zetan_);
+        items_ = items;
+        eta_ = (1.0 - std::pow(2.0 / static_cast<double>(items), 1.0 - theta_)) /
+               (1.0 - zeta2theta_ / zetan_);
+
+        // Publish for Load: an odd version marks an update in progress
+        uint64_t version = version_.load(std::memory_order_relaxed);
+        version_.store(version + 1, std::memory_order_relaxed);
+        published_items_.store(items_, std::memory_order_release);
+        published_zetan_.store(zetan_, std::memory_order_release);
+        published_eta_.store(eta_, std::memory_order_release);
+        version_.store(version + 2, std::memory_order_release);
+    }
+
+    // Lock-free snapshot of the parameters last published by Grow
+    Params Load() const {
+        while (true) {
+            uint64_t version = version_.load(std::memory_order_acquire);
+            // Acquire loads: seeing any of a later Grow's stores means the
+            // recheck below sees its odd version
+            Params p{published_items_.load(std::memory_order_acquire),
+                     published_zetan_.load(std::memory_order_acquire),
+                     published_eta_.load(std::memory_order_acquire)};
+            if ((version & 1) == 0 && version_.load(std::memory_order_relaxed) == version) {
+                return p;
+            }
+        }
+    }
+
+    const double theta_;
+    const double alpha_;
+    const double zeta2theta_;
+
+    std::mutex mutex_;  // Serializes Grow
+    uint64_t items_ = 0;
+    double zetan_ = 0;
+    double eta_ = 0;
+
+    std::atomic<uint64_t> version_{0};
+    std::atomic<uint64_t> published_items_{0};
+    std::atomic<double> published_zetan_{0};
+    std::atomic<double> published_eta_{0};
+};
+
+// Zipfian popularity with the popular items scattered over the key space
+// instead of clustered at its start
+class ScrambledZipfianChooser : public KeyChooser {
+public:
+    explicit ScrambledZipfianChooser(uint64_t initial_items,
+                                     double theta = ZipfianChooser::kDefaultTheta)
+        : zipfian_(initial_items, theta) {}
+
+    uint64_t Next(Random* rng, uint64_t item_count) override {
+        item_count = std::max<uint64_t>(item_count, 1);
+        return FNVHash64(zipfian_.Next(rng, item_count)) % item_count;
+    }
+
+private:
+    ZipfianChooser zipfian_;
+};
+
+// Zipfian over recency: the most recently inserted key is the most popular
+class LatestChooser : public KeyChooser {
+public:
+    explicit LatestChooser(uint64_t initial_items,
+                           double theta = ZipfianChooser::kDefaultTheta)
+        : zipfian_(initial_items, theta) {}
+
+    uint64_t Next(Random* rng, uint64_t item_count) override {
+        item_count = std::max<uint64_t>(item_count, 1);
+        return item_count - 1 - zipfian_.Next(rng, item_count);
+    }
+
+private:
+    ZipfianChooser zipfian_;
+};
+
+// hot_opn_fraction of requests go uniformly to the first hot_data_fraction
+// of the keys; the rest go uniformly to the others
+class HotspotChooser : public KeyChooser {
+public:
+    HotspotChooser(double hot_data_fraction, double hot_opn_fraction)
+        : hot_data_fraction_(std::clamp(hot_data_fraction, 0.0, 1.0)),
+          hot_opn_fraction_(std::clamp(hot_opn_fraction, 0.0, 1.0)) {}
+
+    uint64_t Next(Random* rng, uint64_t item_count) override {
+        item_count = std::max<uint64_t>(item_count, 1);
+        uint64_t hot = static_cast<uint64_t>(static_cast<double>(item_count) * hot_data_fraction_);
+        hot = std::clamp<uint64_t>(hot, 1, item_count);
+        if (hot == item_count || NextDouble(rng) < hot_opn_fraction_) {
+            return (*rng)() % hot;
+        }
+        return hot + (*rng)() % (item_count - hot);
+    }
+
+private:
+    double hot_data_fraction_;
+    double hot_opn_fraction_;
+};
+
+// ============================================================================
+// Workload specification
+// ============================================================================
+
+enum class Distribution { kUniform, kZipfian, kLatest, kHotspot };
+
+inline const char* DistributionName(Distribution d) {
+    switch (d) {
+        case Distribution::kUniform: return "uniform";
+        case Distribution::kZipfian: return "zipfian";
+        case Distribution::kLatest: return "latest";
+        case Distribution::kHotspot: return "hotspot";
+    }
+    return "unknown";
+}
+
+inline bool ParseDistribution(const std::string& s, Distribution* d) {
+    if (s == "uniform") *d = Distribution::kUniform;
+    else if (s == "zipfian") *d = Distribution::kZipfian;
+    else if (s == "latest") *d = Distribution::kLatest;
+    else if (s == "hotspot") *d = Distribution::kHotspot;
+    else return false;
+    return true;
+}
+
+enum class Operation { kRead, kUpdate, kInsert, kScan, kReadModifyWrite };
+constexpr int kNumOperations = 5;
+
+inline const char* OperationName(Operation op) {
+    switch (op) {
+        case Operation::kRead: return "read";
+        case Operation::kUpdate: return "update";
+        case Operation::kInsert: return "insert";
+        case Operation::kScan: return "scan";
+        case Operation::kReadModifyWrite: return "rmw";
+    }
+    return "unknown";
+}
+
+struct WorkloadSpec {
+    std::string name = "custom";
+    uint64_t record_count = 1000000;     // Keys loaded before the run phase
+    uint64_t operation_count = 1000000;  // Operations in the run phase
+
+    // Operation mix; normalized when the workload is built
+    double read_proportion = 0.95;
+    double update_proportion = 0.05;
+    double insert_proportion = 0;
+    double scan_proportion = 0;
+    double read_modify_write_proportion = 0;
+
+    Distribution request_distribution = Distribution::kZipfian;
+    double zipfian_constant = ZipfianChooser::kDefaultTheta;
+    double hotspot_data_fraction = 0.2;
+    double hotspot_opn_fraction = 0.8;
+
+    uint64_t max_scan_length = 100;  // Scan lengths are uniform in [1, max]
+    size_t value_size = 100;
+
+    // Hashed: key numbers are scattered over the key space. Ordered: keys
+    // sort in insertion order, so inserts append at the end.
+    bool ordered_inserts = false;
+
+    int threads = 0;  // 0 = leave to the harness
+};
+
+// The standard YCSB core workloads A-F. Returns false for other names.
+inline bool PresetWorkload(const std::string& name, WorkloadSpec* spec) {
+    std::string n = name;
+    std::transform(n.begin(), n.end(), n.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (n.size() == 9 && n.compare(0, 8, "workload") == 0) n = n.substr(8);
+
+    WorkloadSpec s;
+    s.read_proportion = s.update_proportion = 0;
+    if (n == "a") {         // Update heavy: session store
+        s.read_proportion = 0.5;
+        s.update_proportion = 0.5;
+    } else if (n == "b") {  // Read mostly: photo tagging
+        s.read_proportion = 0.95;
+        s.update_proportion = 0.05;
+    } else if (n == "c") {  // Read only: user profile cache
+        s.read_proportion = 1.0;
+    } else if (n == "d") {  // Read latest: status updates
+        s.read_proportion = 0.95;
+        s.insert_proportion = 0.05;
+        s.request_distribution = Distribution::kLatest;
+    } else if (n == "e") {  // Short ranges: threaded conversations
+        s.scan_proportion = 0.95;
+        s.insert_proportion = 0.05;
+    } else if (n == "f") {  // Read-modify-write: user database
+        s.read_proportion = 0.5;
+        s.read_modify_write_proportion = 0.5;
+    } else {
+        return false;
+    }
+    s.name = "workload" + n;
+    *spec = s;
+    return true;
+}
+
+// Parse a workload file. The format is the YAML subset of
+// benchmarks/workloads/*.yaml: "key: value" lines, optionally nested under
+// a "workload:" section, with '#' comments and optionally quoted values.
+// "base: <a-f>" starts from a preset; later keys override it.
+inline Status ParseWorkload(const std::string& text, WorkloadSpec* spec) {
+    auto trim = [](std::string s) {
+        size_t b = s.find_first_not_of(" \t\r");
+        size_t e = s.find_last_not_of(" \t\r");
+        return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+    };
+    auto number = [](const std::string& v, double* out) {
+        char* end = nullptr;
+        *out = std::strtod(v.c_str(), &end);
+        return !v.empty() && *end == '\0';
+    };
+
+    std::istringstream in(text);
+    std::string line;
+    int line_no = 0;
+    while (std::getline(in, line)) {
+        line_no++;
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); i++) {
+            if (line[i] == '"') quoted = !quoted;
+            if (line[i] == '#' && !quoted) {
+                line.resize(i);
+                break;
+            }
+        }
+        line = trim(line);
+        if (line.empty()) continue;
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            return Status::InvalidArgument("workload line " + std::to_string(line_no) +
+                                           ": expected key: value");
+        }
+        std::string key = trim(line.substr(0, colon));
+        std::string value = trim(line.substr(colon + 1));
+        if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') &&
+            value.back() == value.front()) {
+            value = value.substr(1, value.size() - 2);
+        }
+        if (key == "workload" && value.empty()) continue;  // Section header
+
+        auto bad_value = [&]() {
+            return Status::InvalidArgument("workload line " + std::to_string(line_no) +
+                                           ": bad value for " + key + ": " + value);
+        };
+        double d = 0;
+        bool is_number = number(value, &d);
+
+        if (key == "name") {
+            spec->name = value;
+        } else if (key == "base") {
+            std::string name = spec->name;
+            if (!PresetWorkload(value, spec)) return bad_value();
+            if (name != "custom") spec->name = name;
+        } else if (key == "key_distribution" || key == "request_distribution") {
+            if (!ParseDistribution(value, &spec->request_distribution)) return bad_value();
+        } else if (key == "insert_order") {
+            if (value != "hashed" && value != "ordered") return bad_value();
+            spec->ordered_inserts = (value == "ordered");
+        } else if (!is_number || d < 0) {
+            if (key == "record_count" || key == "operation_count" || key == "value_size" ||
+                key == "threads" || key == "max_scan_length" ||
+                key.find("proportion") != std::string::npos ||
+                key.find("fraction") != std::string::npos || key == "zipfian_constant") {
+                return bad_value();
+            }
+            return Status::InvalidArgument("workload line " + std::to_string(line_no) +
+                                           ": unknown key " + key);
+        } else if (key == "record_count") {
+            spec->record_count = static_cast<uint64_t>(d);
+        } else if (key == "operation_count") {
+            spec->operation_count = static_cast<uint64_t>(d);
+        } else if (key == "read_proportion") {
+            spec->read_proportion = d;
+        } else if (key == "update_proportion" || key == "write_proportion") {
+            spec->update_proportion = d;
+        } else if (key == "insert_proportion") {
+            spec->insert_proportion = d;
+        } else if (key == "scan_proportion") {
+            spec->scan_proportion = d;
+        } else if (key == "read_modify_write_proportion" || key == "rmw_proportion") {
+            spec->read_modify_write_proportion = d;
+        } else if (key == "zipfian_constant") {
+            if (d <= 0 || d >= 1) return bad_value();
+            spec->zipfian_constant = d;
+        } else if (key == "hotspot_data_fraction") {
+            spec->hotspot_data_fraction = d;
+        } else if (key == "hotspot_opn_fraction") {
+            spec->hotspot_opn_fraction = d;
+        } else if (key == "max_scan_length") {
+            spec->max_scan_length = std::max<uint64_t>(static_cast<uint64_t>(d), 1);
+        } else if (key == "value_size") {
+            spec->value_size = static_cast<size_t>(d);
+        } else if (key == "threads") {
+            spec->threads = static_cast<int>(d);
+        } else {
+            return Status::InvalidArgument("workload line " + std::to_string(line_no) +
+                                           ": unknown key " + key);
+        }
+    }
+
+    double total = spec->read_proportion + spec->update_proportion + spec->insert_proportion +
+                   spec->scan_proportion + spec->read_modify_write_proportion;
+    if (total <= 0) {
+        return Status::InvalidArgument("workload has no operations");
+    }
+    return Status::OK();
+}
+
+// Load a preset name (a-f, workloada-f) or a workload file
+inline Status LoadWorkload(const std::string& name_or_path, WorkloadSpec* spec) {
+    *spec = WorkloadSpec();
+    if (PresetWorkload(name_or_path, spec)) return Status::OK();
+
+    std::ifstream in(name_or_path);
+    if (!in) return Status::IOError("Cannot read workload file " + name_or_path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return ParseWorkload(text.str(), spec);
+}
+
+// ============================================================================
+// Workload
+// ============================================================================
+
+// Runtime state of a workload shared by all client threads: the operation
+// mix, the key chooser, and the counter handing out keys to insert.
+class Workload {
+public:
+    explicit Workload(const WorkloadSpec& spec)
+        : spec_(spec),
+          insert_next_(spec.record_count),
+          inserted_(spec.record_count) {
+        double weights[kNumOperations] = {spec.read_proportion, spec.update_proportion,
+                                          spec.insert_proportion, spec.scan_proportion,
+                                          spec.read_modify_write_proportion};
+        double total = 0;
+        for (double w : weights) total += std::max(w, 0.0);
+        double cumulative = 0;
+        for (int i = 0; i < kNumOperations; i++) {
+            cumulative += std::max(weights[i], 0.0) / total;
+            cumulative_[i] = cumulative;
+        }
+
+        switch (spec.request_distribution) {
+            case Distribution::kUniform:
+                chooser_ = std::make_unique<UniformChooser>();
+                break;
+            case Distribution::kZipfian:
+                chooser_ = std::make_unique<ScrambledZipfianChooser>(spec.record_count,
+                                                                     spec.zipfian_constant);
+                break;
+            case Distribution::kLatest:
+                chooser_ = std::make_unique<LatestChooser>(spec.record_count,
+                                                           spec.zipfian_constant);
+                break;
+            case Distribution::kHotspot:
+                chooser_ = std::make_unique<HotspotChooser>(spec.hotspot_data_fraction,
+                                                            spec.hotspot_opn_fraction);
+                break;
+        }
+    }
+
+    const WorkloadSpec& spec() const { return spec_; }
+
+    Operation NextOperation(Random* rng) const {
+        double u = NextDouble(rng);
+        for (int i = 0; i < kNumOperations - 1; i++) {
+            if (u < cumulative_[i]) return static_cast<Operation>(i);
+        }
+        return static_cast<Operation>(kNumOperations - 1);
+    }
+
+    // Key number for a read, update, scan or read-modify-write. Only keys
+    // whose inserts have completed are chosen (approximately, when several
+    // inserts are in flight).
+    uint64_t NextKeyNum(Random* rng) {
+        return chooser_->Next(rng, inserted_.load(std::memory_order_acquire));
+    }
+
+    // Key number for the next insert; call InsertDone once it is written
+    uint64_t NextInsertKeyNum() { return insert_next_.fetch_add(1, std::memory_order_relaxed); }
+    void InsertDone() { inserted_.fetch_add(1, std::memory_order_release); }
+
+    uint64_t NextScanLength(Random* rng) const {
+        return 1 + (*rng)() % std::max<uint64_t>(spec_.max_scan_length, 1);
+    }
+
+    std::string KeyName(uint64_t keynum) const {
+        uint64_t k = spec_.ordered_inserts ? keynum : FNVHash64(keynum);
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "user%020llu", static_cast<unsigned long long>(k));
+        return buf;
+    }
+
+private:
+    const WorkloadSpec spec_;
+    double cumulative_[kNumOperations];
+    std::unique_ptr<KeyChooser> chooser_;
+    std::atomic<uint64_t> insert_next_;
+    std::atomic<uint64_t> inserted_;
+};
+
+}  // namespace ycsb
+}  // namespace lsm
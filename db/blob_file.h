@@ -0,0 +1,371 @@
+// db/blob_file.h
+// Blob files: large values stored outside the LSM tree (key-value separation)
+
+#pragma once
+
+#include "util/types.h"
+#include "util/env.h"
+#include "util/file_reader.h"
+#include "db/filename.h"
+#include "db/options.h"
+#include "wal/wal_format.h"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsm {
+
+// Reference stored in the LSM tree (as a kBlobIndex entry) in place of a
+// value that was moved to a blob file
+struct BlobIndex {
+    uint64_t file_number = 0;
+    uint64_t offset = 0;      // Start of the record in the blob file
+    uint64_t value_size = 0;
+
+    static constexpr size_t kEncodedLength = 24;
+
+    std::string Encode() const {
+        std::string result;
+        wal::Encoder enc(&result);
+        enc.PutFixed64(file_number);
+        enc.PutFixed64(offset);
+        enc.PutFixed64(value_size);
+        return result;
+    }
+
+    bool Decode(Slice input) {
+        if (input.size() != kEncodedLength) return false;
+        wal::Decoder dec(input.data(), input.size());
+        return dec.GetFixed64(&file_number) && dec.GetFixed64(&offset) &&
+               dec.GetFixed64(&value_size);
+    }
+};
+
+// Per-file accounting kept in the MANIFEST. Garbage is counted when
+// compaction drops or relocates an entry referencing the file; once every
+// record is garbage the file leaves the Version and is deleted.
+struct BlobFileMetaData {
+    uint64_t number = 0;
+    uint64_t total_count = 0;     // Records written
+    uint64_t total_bytes = 0;     // Value bytes written
+    uint64_t garbage_count = 0;   // Records no longer referenced
+    uint64_t garbage_bytes = 0;
+
+    bool FullyGarbage() const { return garbage_count >= total_count; }
+};
+
+// Blob file format:
+//   magic (fixed32) | record...
+// Each record:
+//   crc32 (fixed32) | key_size (fixed32) | value_size (fixed32) | key | value
+// The CRC covers everything after it. The user key is kept so that a read
+// can verify the record belongs to the key that references it.
+constexpr uint32_t kBlobFileMagic = 0x424C4231;  // "BLB1"
+constexpr size_t kBlobRecordHeaderSize = 12;
+
+// Appends records to a new blob file
+class BlobFileWriter {
+public:
+    BlobFileWriter(const std::string& path, uint64_t number, Env* env = Env::Default())
+        : path_(path), env_(env), offset_(0) {
+        meta_.number = number;
+    }
+
+    ~BlobFileWriter() { Abandon(); }
+
+    BlobFileWriter(const BlobFileWriter&) = delete;
+    BlobFileWriter& operator=(const BlobFileWriter&) = delete;
+
+    Status Open() {
+        if (!env_->NewWritableFile(path_, &file_).ok()) {
+            return Status::IOError("Failed to create blob file: " + path_);
+        }
+        std::string header;
+        wal::Encoder enc(&header);
+        enc.PutFixed32(kBlobFileMagic);
+        return WriteRaw(header);
+    }
+
+    Status Add(Slice user_key, Slice value, BlobIndex* index) {
+        std::string record;
+        record.reserve(kBlobRecordHeaderSize + user_key.size() + value.size());
+        wal::Encoder enc(&record);
+        enc.PutFixed32(0);  // CRC, filled in below
+        enc.PutFixed32(static_cast<uint32_t>(user_key.size()));
+        enc.PutFixed32(static_cast<uint32_t>(value.size()));
+        record.append(user_key.data(), user_key.size());
+        record.append(value.data(), value.size());
+
+        uint32_t crc = wal::CRC32::Compute(record.data() + 4, record.size() - 4);
+        std::string crc_bytes;
+        wal::Encoder crc_enc(&crc_bytes);
+        crc_enc.PutFixed32(crc);
+        record.replace(0, 4, crc_bytes);
+
+        index->file_number = meta_.number;
+        index->offset = offset_;
+        index->value_size = value.size();
+
+        Status s = WriteRaw(record);
+        if (!s.ok()) return s;
+        meta_.total_count++;
+        meta_.total_bytes += value.size();
+        return Status::OK();
+    }
+
+    // Sync and close the file
+    Status Finish() {
+        if (!file_->Sync().ok()) {
+            return Status::IOError("Failed to sync blob file: " + path_);
+        }
+        Status s = file_->Close();
+        file_.reset();
+        if (!s.ok()) {
+            return Status::IOError("Failed to close blob file: " + path_);
+        }
+        return Status::OK();
+    }
+
+    // Close and delete an unfinished file
+    void Abandon() {
+        if (file_) {
+            file_.reset();
+            env_->DeleteFile(path_);
+        }
+    }
+
+    uint64_t FileSize() const { return offset_; }
+    const BlobFileMetaData& meta() const { return meta_; }
+
+private:
+    Status WriteRaw(const std::string& data) {
+        if (!file_->Append(data).ok()) {
+            return Status::IOError("Failed to write blob file: " + path_);
+        }
+        offset_ += data.size();
+        return Status::OK();
+    }
+
+    std::string path_;
+    Env* env_;
+    std::unique_ptr<WritableFile> file_;
+    uint64_t offset_;
+    BlobFileMetaData meta_;
+};
+
+// Reads single records from a finished blob file
+class BlobFileReader {
+public:
+    static Status Open(const std::string& path, std::unique_ptr<BlobFileReader>* reader,
+                       Env* env = Env::Default()) {
+        auto file = std::make_unique<RandomAccessFileReader>(path, env);
+        Status s = file->Open();
+        if (!s.ok()) return s;
+        reader->reset(new BlobFileReader(std::move(file)));
+        return Status::OK();
+    }
+
+    // Read the value referenced by index into *value, checking that the
+    // record belongs to user_key
+    Status GetBlob(const ReadOptions& read_options, Slice user_key,
+                   const BlobIndex& index, std::string* value) const {
+        size_t record_size = kBlobRecordHeaderSize + user_key.size() + index.value_size;
+        if (index.offset + record_size > file_->Size()) {
+            return Status::Corruption("Blob reference past end of file: " + file_->Path());
+        }
+        Status s = file_->Read(index.offset, record_size, value);
+        if (!s.ok()) return s;
+
+        wal::Decoder dec(value->data(), kBlobRecordHeaderSize);
+        uint32_t crc, key_size, value_size;
+        dec.GetFixed32(&crc);
+        dec.GetFixed32(&key_size);
+        dec.GetFixed32(&value_size);
+        if (key_size != user_key.size() || value_size != index.value_size ||
+            Slice(*value).substr(kBlobRecordHeaderSize, key_size) != user_key) {
+            return Status::Corruption("Blob record does not match its reference");
+        }
+        if (read_options.verify_checksums &&
+            wal::CRC32::Compute(value->data() + 4, record_size - 4) != crc) {
+            return Status::Corruption("Blob record checksum mismatch");
+        }
+        value->erase(0, kBlobRecordHeaderSize + key_size);
+        return Status::OK();
+    }
+
+private:
+    explicit BlobFileReader(std::unique_ptr<RandomAccessFileReader> file)
+        : file_(std::move(file)) {}
+
+    std::unique_ptr<RandomAccessFileReader> file_;
+};
+
+// LRU cache of open blob file readers, keyed by file number
+class BlobFileCache {
+public:
+    BlobFileCache(const std::string& db_path, size_t capacity, Env* env = Env::Default())
+        : db_path_(db_path), env_(env), capacity_(capacity > 0 ? capacity : 1) {}
+
+    BlobFileCache(const BlobFileCache&) = delete;
+    BlobFileCache& operator=(const BlobFileCache&) = delete;
+
+    Status GetBlob(const ReadOptions& read_options, Slice user_key,
+                   const BlobIndex& index, std::string* value) {
+        std::shared_ptr<BlobFileReader> reader;
+        Status s = FindFile(index.file_number, &reader);
+        if (!s.ok()) return s;
+        return reader->GetBlob(read_options, user_key, index, value);
+    }
+
+    // Drop a file's reader once the file is obsolete
+    void Evict(uint64_t file_number) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = map_.find(file_number);
+        if (it != map_.end()) {
+            lru_.erase(it->second);
+            map_.erase(it);
+        }
+    }
+
+private:
+    using Entry = std::pair<uint64_t, std::shared_ptr<BlobFileReader>>;
+
+    Status FindFile(uint64_t file_number, std::shared_ptr<BlobFileReader>* reader) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = map_.find(file_number);
+            if (it != map_.end()) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                *reader = it->second->second;
+                return Status::OK();
+            }
+        }
+
+        std::unique_ptr<BlobFileReader> opened;
+        Status s = BlobFileReader::Open(BlobFileName(db_path_, file_number), &opened, env_);
+        if (!s.ok()) return s;
+        std::shared_ptr<BlobFileReader> shared(std::move(opened));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = map_.find(file_number);
+        if (it != map_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            *reader = it->second->second;
+            return Status::OK();
+        }
+        lru_.emplace_front(file_number, shared);
+        map_[file_number] = lru_.begin();
+        while (lru_.size() > capacity_) {
+            map_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+        *reader = std::move(shared);
+        return Status::OK();
+    }
+
+    std::string db_path_;
+    Env* env_;
+    size_t capacity_;
+
+    std::mutex mutex_;
+    std::list<Entry> lru_;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> map_;
+};
+
+// Separates values for one flush or compaction: values of at least
+// min_blob_size go to blob files (rolled at blob_file_size), everything
+// else stays inline
+class BlobFileBuilder {
+public:
+    using FileNumberAllocator = std::function<uint64_t()>;
+
+    BlobFileBuilder(const std::string& db_path, const ColumnFamilyOptions& options,
+                    FileNumberAllocator new_file_number)
+        : db_path_(db_path),
+          env_(options.table_options.env),
+          enabled_(options.enable_blob_files),
+          min_blob_size_(options.min_blob_size),
+          blob_file_size_(options.blob_file_size),
+          new_file_number_(std::move(new_file_number)) {}
+
+    ~BlobFileBuilder() { Abandon(); }
+
+    BlobFileBuilder(const BlobFileBuilder&) = delete;
+    BlobFileBuilder& operator=(const BlobFileBuilder&) = delete;
+
+    bool ShouldSeparate(Slice value) const {
+        return enabled_ && value.size() >= min_blob_size_;
+    }
+
+    // Write value to the current blob file; *blob_index receives the
+    // encoded reference to store in the LSM tree
+    Status Add(Slice user_key, Slice value, std::string* blob_index) {
+        if (!writer_) {
+            uint64_t number = new_file_number_();
+            writer_ = std::make_unique<BlobFileWriter>(BlobFileName(db_path_, number),
+                                                       number, env_);
+            Status s = writer_->Open();
+            if (!s.ok()) return s;
+        }
+
+        BlobIndex index;
+        Status s = writer_->Add(user_key, value, &index);
+        if (!s.ok()) return s;
+        *blob_index = index.Encode();
+
+        if (writer_->FileSize() >= blob_file_size_) {
+            return FinishCurrent();
+        }
+        return Status::OK();
+    }
+
+    Status Finish() {
+        return writer_ ? FinishCurrent() : Status::OK();
+    }
+
+    // Delete every file written so far, e.g. after a failed flush
+    void Abandon() {
+        if (writer_) {
+            writer_->Abandon();
+            writer_.reset();
+        }
+        for (const auto& f : outputs_) {
+            env_->DeleteFile(BlobFileName(db_path_, f->number));
+        }
+        outputs_.clear();
+    }
+
+    // Hand the finished files over for the VersionEdit; Abandon() no
+    // longer deletes them
+    std::vector<std::shared_ptr<BlobFileMetaData>> ReleaseOutputs() {
+        std::vector<std::shared_ptr<BlobFileMetaData>> result;
+        result.swap(outputs_);
+        return result;
+    }
+
+private:
+    Status FinishCurrent() {
+        Status s = writer_->Finish();
+        if (!s.ok()) return s;
+        outputs_.push_back(std::make_shared<BlobFileMetaData>(writer_->meta()));
+        writer_.reset();
+        return Status::OK();
+    }
+
+    std::string db_path_;
+    Env* env_;
+    bool enabled_;
+    size_t min_blob_size_;
+    uint64_t blob_file_size_;
+    FileNumberAllocator new_file_number_;
+
+    std::unique_ptr<BlobFileWriter> writer_;
+    std::vector<std::shared_ptr<BlobFileMetaData>> outputs_;
+};
+
+}  // namespace lsm
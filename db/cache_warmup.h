@@ -0,0 +1,83 @@
+// db/cache_warmup.h
+// List of hot block cache entries, saved so a reopened DB can reload them
+
+#pragma once
+
+#include "util/types.h"
+#include "util/env.h"
+#include "wal/wal_format.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lsm {
+
+// One cached data block: where it lives, not what it holds
+struct CachedBlockInfo {
+    uint32_t column_family = 0;
+    uint64_t file_number = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;  // Including the block trailer
+};
+
+// Block cache warm-up file format:
+//   magic (fixed32) | count (fixed32) | blocks... | crc32 (fixed32)
+// Each block: column_family (fixed32) | file_number | offset | size
+// Blocks are listed hottest first.
+constexpr uint32_t kCacheWarmupMagic = 0x4C534D57;  // "LSMW"
+
+inline Status SaveCacheWarmupFile(Env* env, const std::string& path,
+                                  const std::vector<CachedBlockInfo>& blocks) {
+    std::string payload;
+    wal::Encoder enc(&payload);
+    enc.PutFixed32(kCacheWarmupMagic);
+    enc.PutFixed32(static_cast<uint32_t>(blocks.size()));
+    for (const auto& b : blocks) {
+        enc.PutFixed32(b.column_family);
+        enc.PutFixed64(b.file_number);
+        enc.PutFixed64(b.offset);
+        enc.PutFixed64(b.size);
+    }
+    enc.PutFixed32(wal::CRC32::Compute(payload.data(), payload.size()));
+    return WriteFileAtomically(env, path, path + ".tmp", payload);
+}
+
+// NotFound if there is no warm-up file
+inline Status LoadCacheWarmupFile(Env* env, const std::string& path,
+                                  std::vector<CachedBlockInfo>* blocks) {
+    blocks->clear();
+    std::string contents;
+    Status s = ReadFileToString(env, path, &contents);
+    if (!s.ok()) return s;
+    if (contents.size() < 12) {
+        return Status::Corruption("Cache warm-up file too short: " + path);
+    }
+
+    size_t payload_size = contents.size() - 4;
+    wal::Decoder crc_dec(contents.data() + payload_size, 4);
+    uint32_t crc = 0;
+    crc_dec.GetFixed32(&crc);
+    if (crc != wal::CRC32::Compute(contents.data(), payload_size)) {
+        return Status::Corruption("Cache warm-up file checksum mismatch: " + path);
+    }
+
+    wal::Decoder dec(contents.data(), payload_size);
+    uint32_t magic = 0;
+    uint32_t count = 0;
+    if (!dec.GetFixed32(&magic) || magic != kCacheWarmupMagic || !dec.GetFixed32(&count) ||
+        count > payload_size / 28) {
+        return Status::Corruption("Bad cache warm-up file: " + path);
+    }
+    blocks->resize(count);
+    for (auto& b : *blocks) {
+        if (!dec.GetFixed32(&b.column_family) || !dec.GetFixed64(&b.file_number) ||
+            !dec.GetFixed64(&b.offset) || !dec.GetFixed64(&b.size)) {
+            blocks->clear();
+            return Status::Corruption("Truncated cache warm-up file: " + path);
+        }
+    }
+    return Status::OK();
+}
+
+}  // namespace lsm
@@ -0,0 +1,215 @@
+// db/column_family.h
+// Column families: independent keyspaces sharing one DB, WAL and write path
+
+#pragma once
+
+#include "util/types.h"
+#include "util/env.h"
+#include "db/blob_file.h"
+#include "db/filename.h"
+#include "db/internal_stats.h"
+#include "db/listener.h"
+#include "db/memtable_manager.h"
+#include "db/options.h"
+#include "db/table_cache.h"
+#include "db/version_set.h"
+#include "wal/wal_format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lsm {
+
+inline constexpr const char* kDefaultColumnFamilyName = "default";
+
+// Name and options of a column family to open; see DB::Open
+struct ColumnFamilyDescriptor {
+    std::string name;
+    ColumnFamilyOptions options;
+
+    ColumnFamilyDescriptor() = default;
+    ColumnFamilyDescriptor(std::string n, const ColumnFamilyOptions& o)
+        : name(std::move(n)), options(o) {}
+};
+
+class ColumnFamilyData;
+
+// Names a column family in DB calls. Handles are owned by the DB and stay
+// valid until it is deleted.
+class ColumnFamilyHandle {
+public:
+    explicit ColumnFamilyHandle(ColumnFamilyData* cfd) : cfd_(cfd) {}
+
+    ColumnFamilyHandle(const ColumnFamilyHandle&) = delete;
+    ColumnFamilyHandle& operator=(const ColumnFamilyHandle&) = delete;
+
+    uint32_t GetID() const;
+    const std::string& GetName() const;
+    ColumnFamilyData* cfd() const { return cfd_; }
+
+private:
+    ColumnFamilyData* cfd_;
+};
+
+// Everything one column family owns: memtables, levels (VersionSet and
+// MANIFEST in its own directory) and the caches over its files. The WAL,
+// sequence numbers and background thread belong to the DB.
+class ColumnFamilyData {
+public:
+    ColumnFamilyData(uint32_t id, std::string name, const ColumnFamilyOptions& options,
+                     const std::string& db_path, size_t max_open_files,
+                     WriteBufferManager* write_buffer_manager = nullptr)
+        : id_(id),
+          name_(std::move(name)),
+          options_(options),
+          path_(ColumnFamilyDirName(db_path, id)),
+          mem_options_(MakeMemTableOptions(options, write_buffer_manager)),
+          mem(mem_options_),
+          versions(path_, options.max_levels, options.table_options.env),
+          table_cache(path_, options_.table_options, max_open_files),
+          blob_cache(path_, max_open_files, options.table_options.env),
+          compact_pointers(options.max_levels),
+          internal_stats(options.max_levels),
+          handle_(this) {}
+
+    ColumnFamilyData(const ColumnFamilyData&) = delete;
+    ColumnFamilyData& operator=(const ColumnFamilyData&) = delete;
+
+    uint32_t id() const { return id_; }
+    const std::string& name() const { return name_; }
+    const ColumnFamilyOptions& options() const { return options_; }
+    const std::string& path() const { return path_; }
+    ColumnFamilyHandle* handle() { return &handle_; }
+
+    // True while some write to this family is not yet in an SSTable
+    bool HasUnflushedData() const {
+        return mem.ImmutableCount() > 0 || mem.ActiveMemoryUsage() > 0;
+    }
+
+    // Oldest WAL that may hold writes of this family not yet in an SSTable
+    uint64_t OldestLogWithUnflushedData() const {
+        return std::max(versions.LogNumber(), log_floor.load(std::memory_order_acquire));
+    }
+
+    // Options of this family's memtables, e.g. for ones built in recovery
+    const MemTableOptions& memtable_options() const { return mem_options_; }
+
+    static MemTableOptions MakeMemTableOptions(const ColumnFamilyOptions& options,
+                                               WriteBufferManager* write_buffer_manager) {
+        MemTableOptions mem_options;
+        mem_options.max_size = options.write_buffer_size;
+        double bloom_ratio = std::min(options.memtable_bloom_size_ratio, 0.25);
+        if (bloom_ratio > 0) {
+            mem_options.bloom_bits =
+                static_cast<size_t>(static_cast<double>(options.write_buffer_size) * bloom_ratio * 8);
+        }
+        mem_options.write_buffer_manager = write_buffer_manager;
+        return mem_options;
+    }
+
+private:
+    const uint32_t id_;
+    const std::string name_;
+    const ColumnFamilyOptions options_;
+    const std::string path_;
+    const MemTableOptions mem_options_;
+
+public:
+    MemTableManager mem;
+    VersionSet versions;
+    TableCache table_cache;
+    BlobFileCache blob_cache;
+    std::vector<std::string> compact_pointers;  // Guarded by DB::bg_work_mutex_
+    std::deque<uint64_t> imm_log_numbers;       // Guarded by DB::mutex_
+    InternalStats internal_stats;
+
+    // Write stall reporting (see DB::UpdateStallCondition): the cause of
+    // the last stall a writer hit, guarded by DB::mutex_, and the condition
+    // last reported to listeners, guarded by DB::bg_work_mutex_
+    WriteStallCause stalled_cause = WriteStallCause::kNone;
+    WriteStallCondition stall_condition = WriteStallCondition::kNormal;
+
+    // Set to the new WAL number when the WAL rotates while this family has
+    // nothing unflushed: none of its writes are in older logs, even though
+    // its MANIFEST log number is older. Not persisted; recovery just replays
+    // from the MANIFEST log number.
+    std::atomic<uint64_t> log_floor{0};
+
+private:
+    ColumnFamilyHandle handle_;
+};
+
+inline uint32_t ColumnFamilyHandle::GetID() const { return cfd_->id(); }
+inline const std::string& ColumnFamilyHandle::GetName() const { return cfd_->name(); }
+
+// The COLUMN_FAMILIES file maps ids of non-default families to names.
+// Like the MANIFEST it is rewritten whole (temp file, fsync, rename).
+//
+// Format: magic (fixed32) | next_id (fixed32) | count (fixed32)
+//   | {id (fixed32) | name (length-prefixed)}... | crc32 (fixed32)
+struct ColumnFamilyRegistry {
+    static constexpr uint32_t kMagic = 0x4C434631;  // "LCF1"
+
+    std::map<uint32_t, std::string> families;  // id -> name
+    uint32_t next_id = 1;
+
+    // A missing file means only the default family exists
+    Status Load(Env* env, const std::string& db_path) {
+        families.clear();
+        next_id = 1;
+
+        std::string path = ColumnFamiliesFileName(db_path);
+        std::string contents;
+        Status s = ReadFileToString(env, path, &contents);
+        if (s.IsNotFound()) return Status::OK();
+        if (!s.ok()) return Status::IOError("Failed to read " + path);
+
+        if (contents.size() < 4) return Status::Corruption("COLUMN_FAMILIES too short");
+        size_t payload_size = contents.size() - 4;
+        wal::Decoder crc_dec(contents.data() + payload_size, 4);
+        uint32_t stored_crc;
+        crc_dec.GetFixed32(&stored_crc);
+        if (wal::CRC32::Compute(contents.data(), payload_size) != stored_crc) {
+            return Status::Corruption("COLUMN_FAMILIES checksum mismatch");
+        }
+
+        wal::Decoder dec(contents.data(), payload_size);
+        uint32_t magic, count;
+        if (!dec.GetFixed32(&magic) || magic != kMagic || !dec.GetFixed32(&next_id) ||
+            !dec.GetFixed32(&count)) {
+            return Status::Corruption("Bad COLUMN_FAMILIES header");
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t id;
+            std::string name;
+            if (!dec.GetFixed32(&id) || !dec.GetLengthPrefixed(&name) || id == 0 ||
+                id >= next_id) {
+                return Status::Corruption("Bad COLUMN_FAMILIES entry");
+            }
+            families[id] = std::move(name);
+        }
+        return Status::OK();
+    }
+
+    Status Save(Env* env, const std::string& db_path) const {
+        std::string payload;
+        wal::Encoder enc(&payload);
+        enc.PutFixed32(kMagic);
+        enc.PutFixed32(next_id);
+        enc.PutFixed32(static_cast<uint32_t>(families.size()));
+        for (const auto& [id, name] : families) {
+            enc.PutFixed32(id);
+            enc.PutLengthPrefixed(name);
+        }
+        enc.PutFixed32(wal::CRC32::Compute(payload.data(), payload.size()));
+
+        std::string path = ColumnFamiliesFileName(db_path);
+        return WriteFileAtomically(env, path, path + ".tmp", payload);
+    }
+};
+
+}  // namespace lsm
@@ -0,0 +1,437 @@
+// db/compaction.h
+// Leveled compaction: picking inputs and merging them into new SSTables
+
+#pragma once
+
+#include "util/types.h"
+#include "db/blob_file.h"
+#include "db/filename.h"
+#include "db/iterator.h"
+#include "db/merging_iterator.h"
+#include "db/options.h"
+#include "db/table_cache.h"
+#include "db/version_set.h"
+#include "sstable/sstable_format.h"
+#include "sstable/sstable_writer.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace lsm {
+
+// A compaction merges inputs[0] (from level) with the overlapping
+// inputs[1] (from output_level) and writes the result to output_level
+struct Compaction {
+    int level = 0;
+    int output_level = 1;
+    FileList inputs[2];
+    std::shared_ptr<Version> input_version;
+
+    // True if no level below output_level may hold user_key, so a
+    // tombstone for it has nothing left to shadow. Those levels are L1+,
+    // whose files are sorted and disjoint: one binary search per level.
+    bool IsBaseLevelForKey(Slice user_key) const {
+        for (int lvl = output_level + 1; lvl < input_version->NumLevels(); lvl++) {
+            const FileList& files = input_version->files(lvl);
+            auto it = std::lower_bound(files.begin(), files.end(), user_key,
+                [](const std::shared_ptr<FileMetaData>& f, Slice key) {
+                    return Slice(f->largest) < key;
+                });
+            if (it != files.end() && !(user_key < Slice((*it)->smallest))) return false;
+        }
+        return true;
+    }
+
+    void AddInputDeletions(VersionEdit* edit) const {
+        for (int which = 0; which < 2; which++) {
+            int lvl = which == 0 ? level : output_level;
+            for (const auto& f : inputs[which]) edit->DeleteFile(lvl, f->number);
+        }
+    }
+};
+
+// Max bytes for a level before it is scored for compaction
+inline uint64_t MaxBytesForLevel(const ColumnFamilyOptions& options, int level) {
+    uint64_t result = options.max_bytes_for_level_base;
+    for (int i = 1; i < level; i++) {
+        result *= static_cast<uint64_t>(options.max_bytes_for_level_multiplier);
+    }
+    return result;
+}
+
+// Smallest and largest user keys across files
+inline void GetRange(const FileList& files, std::string* smallest, std::string* largest) {
+    smallest->clear();
+    largest->clear();
+    for (size_t i = 0; i < files.size(); i++) {
+        if (i == 0 || files[i]->smallest < *smallest) *smallest = files[i]->smallest;
+        if (i == 0 || files[i]->largest > *largest) *largest = files[i]->largest;
+    }
+}
+
+// Fill inputs[1] from output_level for the range covered by inputs[0]
+inline void SetupOtherInputs(Compaction* c) {
+    if (c->output_level == c->level) return;
+    std::string smallest, largest;
+    GetRange(c->inputs[0], &smallest, &largest);
+    Slice begin(smallest), end(largest);
+    c->inputs[1] = c->input_version->GetOverlappingInputs(c->output_level, &begin, &end);
+}
+
+// Pick the next compaction, or return null if the tree is in shape.
+//
+// Size-triggered work comes first: the level with the highest score
+// (L0: files / trigger, Ln: bytes / target) above 1.0. Otherwise a file
+// marked by tombstone-heavy scans is rewritten into the next level, or in
+// place at the last level. compact_pointers rotate Ln picks through the key
+// space so every file is eventually compacted.
+inline std::unique_ptr<Compaction> PickCompaction(const ColumnFamilyOptions& options,
+                                                  std::shared_ptr<Version> version,
+                                                  std::vector<std::string>* compact_pointers) {
+    const int num_levels = version->NumLevels();
+    const int last_level = num_levels - 1;
+
+    int best_level = -1;
+    double best_score = 1.0;
+    for (int level = 0; level < last_level; level++) {
+        double score;
+        if (level == 0) {
+            score = static_cast<double>(version->NumFiles(0)) /
+                    std::max(1, options.level0_file_num_compaction_trigger);
+        } else {
+            score = static_cast<double>(version->NumLevelBytes(level)) /
+                    static_cast<double>(MaxBytesForLevel(options, level));
+        }
+        if (score >= best_score) {
+            best_score = score;
+            best_level = level;
+        }
+    }
+
+    auto c = std::make_unique<Compaction>();
+    c->input_version = version;
+
+    if (best_level == 0) {
+        c->level = 0;
+        c->output_level = 1;
+        c->inputs[0] = version->files(0);
+        SetupOtherInputs(c.get());
+        return c;
+    }
+
+    if (best_level > 0) {
+        c->level = best_level;
+        c->output_level = best_level + 1;
+        const FileList& files = version->files(best_level);
+        const std::string& pointer = (*compact_pointers)[best_level];
+        std::shared_ptr<FileMetaData> pick = files.front();
+        for (const auto& f : files) {
+            if (pointer.empty() || f->largest > pointer) {
+                pick = f;
+                break;
+            }
+        }
+        c->inputs[0].push_back(pick);
+        (*compact_pointers)[best_level] = pick->largest;
+        SetupOtherInputs(c.get());
+        return c;
+    }
+
+    for (int level = 0; level < num_levels; level++) {
+        for (const auto& f : version->files(level)) {
+            if (!f->marked_for_compaction.load(std::memory_order_relaxed)) continue;
+            c->level = level;
+            if (level == 0) {
+                // L0 files overlap: compact all of them so ordering holds
+                c->output_level = 1;
+                c->inputs[0] = version->files(0);
+            } else {
+                c->output_level = level == last_level ? level : level + 1;
+                c->inputs[0].push_back(f);
+            }
+            SetupOtherInputs(c.get());
+            return c;
+        }
+    }
+    return nullptr;
+}
+
+// Compaction of all files in level overlapping [begin, end] into level + 1
+inline std::unique_ptr<Compaction> CompactRangeAtLevel(std::shared_ptr<Version> version,
+                                                       int level, const Slice* begin,
+                                                       const Slice* end) {
+    FileList inputs = version->GetOverlappingInputs(level, begin, end);
+    if (inputs.empty()) return nullptr;
+
+    auto c = std::make_unique<Compaction>();
+    c->input_version = version;
+    c->level = level;
+    c->output_level = std::min(level + 1, version->NumLevels() - 1);
+    // L0 files overlap each other; take them all to keep newer data on top
+    c->inputs[0] = level == 0 ? version->files(0) : std::move(inputs);
+    SetupOtherInputs(c.get());
+    return c;
+}
+
+// Statistics for one compaction run
+struct CompactionStats {
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    uint64_t entries_read = 0;
+    uint64_t entries_dropped = 0;
+    uint64_t tombstones_dropped = 0;
+    uint64_t blob_bytes_written = 0;    // Values moved into new blob files
+    uint64_t blob_bytes_relocated = 0;  // Live values copied out of old blob files
+};
+
+// Merges a compaction's inputs and writes the surviving entries to new
+// SSTables, split at target_file_size_base (only between user keys, so a
+// key's versions never straddle two files of the same level).
+//
+// With blob files enabled, blob references are copied as-is, so large
+// values are not rewritten. Dropped references become garbage of their
+// blob file. References into the oldest blob files (the GC age cutoff)
+// are relocated: the value is copied to a new blob file, leaving the old
+// record as garbage so that the old file can eventually be deleted.
+class CompactionJob {
+public:
+    using FileNumberAllocator = std::function<uint64_t()>;
+
+    CompactionJob(const std::string& db_path, const ColumnFamilyOptions& options,
+                  TableCache* table_cache, BlobFileCache* blob_cache,
+                  const Compaction& compaction, SequenceNumber smallest_snapshot,
+                  FileNumberAllocator new_file_number)
+        : db_path_(db_path),
+          options_(options),
+          table_cache_(table_cache),
+          blob_cache_(blob_cache),
+          compaction_(compaction),
+          smallest_snapshot_(smallest_snapshot),
+          new_file_number_(std::move(new_file_number)),
+          blobs_(db_path, options, new_file_number_) {
+        if (options.enable_blob_garbage_collection) {
+            const BlobFileMap& blob_files = compaction.input_version->blob_files();
+            size_t cutoff = static_cast<size_t>(
+                static_cast<double>(blob_files.size()) *
+                options.blob_garbage_collection_age_cutoff);
+            for (auto it = blob_files.begin(); it != blob_files.end() && cutoff > 0;
+                 ++it, --cutoff) {
+                gc_blob_files_.insert(it->first);
+            }
+        }
+    }
+
+    Status Run() {
+        ReadOptions read_options;
+        read_options.verify_checksums = options_.table_options.verify_checksums;
+
+        std::vector<std::unique_ptr<InternalIterator>> children;
+        for (int which = 0; which < 2; which++) {
+            for (const auto& f : compaction_.inputs[which]) {
+                std::shared_ptr<sstable::SSTableReader> table;
+                Status s = table_cache_->FindTable(f->number, &table);
+                if (!s.ok()) return s;
+                stats_.bytes_read += f->file_size;
+                children.push_back(std::make_unique<TableInternalIterator>(std::move(table),
+                                                                           read_options));
+            }
+        }
+        MergingIterator iter(std::move(children));
+
+        std::string current_user_key;
+        bool has_current_user_key = false;
+        SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
+
+        Status s;
+        for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+            sstable::ParsedInternalKey ikey;
+            if (!sstable::ParseInternalKey(iter.key(), &ikey)) {
+                s = Status::Corruption("Bad internal key in compaction input");
+                break;
+            }
+            stats_.entries_read++;
+
+            if (!has_current_user_key || ikey.user_key != Slice(current_user_key)) {
+                // First occurrence of this user key: a safe point to cut
+                current_user_key.assign(ikey.user_key);
+                has_current_user_key = true;
+                last_sequence_for_key = kMaxSequenceNumber;
+
+                if (builder_ && builder_->FileSize() >= options_.target_file_size_base) {
+                    s = FinishOutput();
+                    if (!s.ok()) break;
+                }
+            }
+
+            bool drop = false;
+            if (last_sequence_for_key <= smallest_snapshot_) {
+                // Hidden by a newer entry for the same key that every
+                // snapshot can already see
+                drop = true;
+            } else if (ikey.type == ValueType::kDeletion &&
+                       ikey.sequence <= smallest_snapshot_ &&
+                       compaction_.IsBaseLevelForKey(ikey.user_key)) {
+                // Nothing older remains below for this tombstone to hide;
+                // older entries in this compaction are dropped by the rule
+                // above on the following iterations
+                drop = true;
+                stats_.tombstones_dropped++;
+            }
+            last_sequence_for_key = ikey.sequence;
+
+            if (drop) {
+                stats_.entries_dropped++;
+                if (ikey.type == ValueType::kBlobIndex) {
+                    BlobIndex index;
+                    s = DecodeBlobIndex(iter.value(), &index);
+                    if (!s.ok()) break;
+                    AddBlobGarbage(index);
+                }
+                continue;
+            }
+
+            ValueType type = ikey.type;
+            Slice value = iter.value();
+            s = PlaceValue(read_options, ikey.user_key, &type, &value);
+            if (!s.ok()) break;
+
+            if (!builder_) {
+                s = OpenOutput();
+                if (!s.ok()) break;
+            }
+            s = builder_->Add(ikey.user_key, value, ikey.sequence, type);
+            if (!s.ok()) break;
+        }
+
+        if (s.ok()) s = iter.status();
+        if (s.ok() && builder_) s = FinishOutput();
+        if (s.ok()) s = blobs_.Finish();
+        if (!s.ok()) {
+            if (builder_) {
+                builder_->Abandon();
+                builder_.reset();
+            }
+            blobs_.Abandon();
+            return s;
+        }
+        blob_outputs_ = blobs_.ReleaseOutputs();
+        return s;
+    }
+
+    // Files produced by Run(), all destined for compaction.output_level
+    const FileList& outputs() const { return outputs_; }
+
+    // Blob files produced by Run(), and garbage it created in older ones
+    const std::vector<std::shared_ptr<BlobFileMetaData>>& blob_outputs() const {
+        return blob_outputs_;
+    }
+    const std::map<uint64_t, BlobGarbage>& blob_garbage() const { return blob_garbage_; }
+
+    const CompactionStats& stats() const { return stats_; }
+
+private:
+    // Decide where the value of a surviving entry lives in the output:
+    // large inline values move to a blob file, and references into blob
+    // files being collected are rewritten (inline if the value is now below
+    // min_blob_size). *value may point into job-owned buffers until the
+    // next call.
+    Status PlaceValue(const ReadOptions& read_options, Slice user_key,
+                      ValueType* type, Slice* value) {
+        if (*type == ValueType::kValue) {
+            if (!blobs_.ShouldSeparate(*value)) return Status::OK();
+            Status s = blobs_.Add(user_key, *value, &blob_index_);
+            if (!s.ok()) return s;
+            stats_.blob_bytes_written += value->size();
+            *type = ValueType::kBlobIndex;
+            *value = blob_index_;
+            return Status::OK();
+        }
+        if (*type != ValueType::kBlobIndex) return Status::OK();
+
+        BlobIndex index;
+        Status s = DecodeBlobIndex(*value, &index);
+        if (!s.ok() || gc_blob_files_.count(index.file_number) == 0) return s;
+
+        s = blob_cache_->GetBlob(read_options, user_key, index, &blob_value_);
+        if (!s.ok()) return s;
+        AddBlobGarbage(index);
+        stats_.blob_bytes_relocated += blob_value_.size();
+        if (blobs_.ShouldSeparate(blob_value_)) {
+            s = blobs_.Add(user_key, blob_value_, &blob_index_);
+            if (!s.ok()) return s;
+            *value = blob_index_;
+        } else {
+            *type = ValueType::kValue;
+            *value = blob_value_;
+        }
+        return Status::OK();
+    }
+
+    static Status DecodeBlobIndex(Slice input, BlobIndex* index) {
+        if (!index->Decode(input)) {
+            return Status::Corruption("Bad blob index in compaction input");
+        }
+        return Status::OK();
+    }
+
+    void AddBlobGarbage(const BlobIndex& index) {
+        BlobGarbage& garbage = blob_garbage_[index.file_number];
+        garbage.number = index.file_number;
+        garbage.count++;
+        garbage.bytes += index.value_size;
+    }
+
+    Status OpenOutput() {
+        current_number_ = new_file_number_();
+        builder_ = std::make_unique<sstable::SSTableWriter>(
+            TableFileName(db_path_, current_number_), options_.table_options);
+        return builder_->Open();
+    }
+
+    Status FinishOutput() {
+        sstable::SSTableWriteStats write_stats;
+        Status s = builder_->Finish(&write_stats);
+        builder_.reset();
+        if (!s.ok()) return s;
+
+        auto f = std::make_shared<FileMetaData>();
+        f->number = current_number_;
+        f->file_size = write_stats.file_size;
+        f->smallest = write_stats.smallest_key;
+        f->largest = write_stats.largest_key;
+        f->min_sequence = write_stats.min_seq;
+        f->max_sequence = write_stats.max_seq;
+        f->num_entries = write_stats.num_entries;
+        f->num_deletions = write_stats.num_deletions;
+        stats_.bytes_written += f->file_size;
+        outputs_.push_back(std::move(f));
+        return Status::OK();
+    }
+
+    std::string db_path_;
+    const ColumnFamilyOptions& options_;
+    TableCache* table_cache_;
+    BlobFileCache* blob_cache_;
+    const Compaction& compaction_;
+    SequenceNumber smallest_snapshot_;
+    FileNumberAllocator new_file_number_;
+
+    std::unique_ptr<sstable::SSTableWriter> builder_;
+    uint64_t current_number_ = 0;
+    FileList outputs_;
+    CompactionStats stats_;
+
+    BlobFileBuilder blobs_;
+    std::set<uint64_t> gc_blob_files_;  // Blob files whose live values are relocated
+    std::vector<std::shared_ptr<BlobFileMetaData>> blob_outputs_;
+    std::map<uint64_t, BlobGarbage> blob_garbage_;
+    std::string blob_index_;  // Backs the value of the entry being written
+    std::string blob_value_;
+};
+
+}  // namespace lsm
@@ -0,0 +1,1665 @@
+// db/db.h
+// The database: write path, reads, background flush and compaction
+
+#pragma once
+
+#include "util/types.h"
+#include "util/cache.h"
+#include "util/compressed_secondary_cache.h"
+#include "util/perf_context.h"
+#include "util/pinnable_slice.h"
+#include "util/statistics.h"
+#include "db/blob_file.h"
+#include "db/cache_warmup.h"
+#include "db/column_family.h"
+#include "db/compaction.h"
+#include "db/db_iter.h"
+#include "db/filename.h"
+#include "db/iterator.h"
+#include "db/listener.h"
+#include "db/memtable.h"
+#include "db/memtable_manager.h"
+#include "db/merging_iterator.h"
+#include "db/options.h"
+#include "db/table_cache.h"
+#include "db/trace.h"
+#include "db/version_set.h"
+#include "sstable/sstable_writer.h"
+#include "wal/wal_manager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lsm {
+
+// DB is safe for concurrent use from multiple threads. Writes are
+// committed in groups: one writer appends a whole group to the WAL with a
+// single write and sync. Reads take no locks beyond pinning the current
+// memtables and Version. A single background thread flushes immutable
+// memtables to L0 and runs compactions.
+//
+// Keys live in column families: independent keyspaces with their own
+// memtables, levels and options that share the WAL, sequence numbers and
+// background thread. Calls without a ColumnFamilyHandle use the default
+// family.
+class DB {
+public:
+    // Open (or create) the database at path with only the default column
+    // family. Fails if the database has other column families.
+    static Status Open(const Options& options, const std::string& path, DB** dbptr) {
+        std::vector<ColumnFamilyHandle*> handles;
+        return Open(options, path,
+                    {ColumnFamilyDescriptor(kDefaultColumnFamilyName, options)},
+                    &handles, dbptr);
+    }
+
+    // Open (or create) the database at path with the given column families,
+    // which must include "default" and every family the database has.
+    // *handles receives one handle per descriptor, in order; the DB owns them.
+    static Status Open(const Options& options, const std::string& path,
+                       const std::vector<ColumnFamilyDescriptor>& column_families,
+                       std::vector<ColumnFamilyHandle*>* handles, DB** dbptr) {
+        *dbptr = nullptr;
+        handles->clear();
+        for (const auto& desc : column_families) {
+            Status s = ValidateOptions(desc.options);
+            if (!s.ok()) return s;
+        }
+
+        if (!options.env->FileExists(path)) {
+            if (!options.create_if_missing) {
+                return Status::InvalidArgument(path + " does not exist");
+            }
+            Status s = options.env->CreateDirIfMissing(path);
+            if (!s.ok()) return s;
+        }
+
+        std::unique_ptr<DB> db(new DB(options, path));
+        Status s = db->Recover(column_families);
+        if (!s.ok()) return s;
+
+        for (const auto& desc : column_families) {
+            handles->push_back(db->FindColumnFamily(desc.name)->handle());
+        }
+
+        db->bg_thread_ = std::thread([raw = db.get()] { raw->BackgroundThread(); });
+        db->MaybeScheduleWork();
+        db->StartBlockCacheWarmup();
+        *dbptr = db.release();
+        return Status::OK();
+    }
+
+    ~DB() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutting_down_ = true;
+        }
+        bg_cv_.notify_all();
+        bool opened = bg_thread_.joinable();
+        if (bg_thread_.joinable()) {
+            bg_thread_.join();
+        }
+        if (warmup_thread_.joinable()) {
+            warmup_thread_.join();
+        }
+        if (opened && options_.block_cache_dump_period_sec > 0) {
+            DumpBlockCache();
+        }
+        if (wal_) {
+            wal_->Close();
+        }
+    }
+
+    DB(const DB&) = delete;
+    DB& operator=(const DB&) = delete;
+
+    // Add a column family. Its writes share the WAL with every other family;
+    // its files go in a directory of their own.
+    Status CreateColumnFamily(const ColumnFamilyOptions& cf_options, const std::string& name,
+                              ColumnFamilyHandle** handle) {
+        *handle = nullptr;
+        if (name.empty()) {
+            return Status::InvalidArgument("Column family name is empty");
+        }
+        Status s = ValidateOptions(cf_options);
+        if (!s.ok()) return s;
+
+        // Serializes registry updates, and keeps DeleteObsoleteFiles from
+        // removing the registry's temp file
+        std::lock_guard<std::mutex> work_lock(bg_work_mutex_);
+        if (FindColumnFamily(name) != nullptr) {
+            return Status::InvalidArgument("Column family already exists: " + name);
+        }
+
+        uint32_t id = registry_.next_id;
+        auto cfd = NewColumnFamilyData(id, name, cf_options);
+        s = CreateColumnFamilyDir(cfd.get());
+        if (!s.ok()) return s;
+
+        // Nothing in the current or older logs belongs to the new family
+        VersionEdit edit;
+        edit.SetLogNumber(wal_->CurrentLogNumber());
+        s = cfd->versions.LogAndApply(edit);
+        if (!s.ok()) return s;
+
+        ColumnFamilyRegistry registry = registry_;
+        registry.families[id] = name;
+        registry.next_id = id + 1;
+        s = registry.Save(options_.env, path_);
+        if (!s.ok()) return s;
+        registry_ = std::move(registry);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        *handle = cfd->handle();
+        column_families_.push_back(std::move(cfd));
+        return Status::OK();
+    }
+
+    ColumnFamilyHandle* DefaultColumnFamily() const { return default_cf_->handle(); }
+
+    // Block until the block cache warm-up started by Open (see
+    // Options::block_cache_warmup_bytes_per_sec) has finished, e.g. before
+    // taking traffic. Returns the bytes it read into the cache.
+    uint64_t WaitForBlockCacheWarmup() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        bg_done_cv_.wait(lock, [&] { return !warmup_running_; });
+        return warmup_bytes_;
+    }
+
+    Status Put(const WriteOptions& write_options, Slice key, Slice value) {
+        return Put(write_options, DefaultColumnFamily(), key, value);
+    }
+
+    Status Put(const WriteOptions& write_options, ColumnFamilyHandle* column_family,
+               Slice key, Slice value) {
+        return Write(write_options, column_family->cfd(), ValueType::kValue, key, value);
+    }
+
+    Status Delete(const WriteOptions& write_options, Slice key) {
+        return Delete(write_options, DefaultColumnFamily(), key);
+    }
+
+    Status Delete(const WriteOptions& write_options, ColumnFamilyHandle* column_family,
+                  Slice key) {
+        return Write(write_options, column_family->cfd(), ValueType::kDeletion, key, Slice());
+    }
+
+    // Returns NotFound if the key is absent or deleted at the read snapshot
+    Status Get(const ReadOptions& read_options, Slice key, std::string* value) {
+        return Get(read_options, DefaultColumnFamily(), key, value);
+    }
+
+    Status Get(const ReadOptions& read_options, ColumnFamilyHandle* column_family,
+               Slice key, std::string* value) {
+        PinnableSlice pinned;
+        Status s = Get(read_options, column_family, key, &pinned);
+        if (s.ok()) value->assign(pinned.data(), pinned.size());
+        return s;
+    }
+
+    // Zero-copy Get: *value points into the memtable or the cached data
+    // block holding the value, and keeps it alive until value->Reset()
+    Status Get(const ReadOptions& read_options, Slice key, PinnableSlice* value) {
+        return Get(read_options, DefaultColumnFamily(), key, value);
+    }
+
+    Status Get(const ReadOptions& read_options, ColumnFamilyHandle* column_family,
+               Slice key, PinnableSlice* value) {
+        value->Reset();
+        ColumnFamilyData* cfd = column_family->cfd();
+        StopWatch sw(stats_, kDbGet);
+        RecordTick(stats_, kNumberKeysRead);
+        tracer_.Record(TraceType::kGet, cfd->id(), key, 0);
+
+        ReadState read_state = PinReadState(cfd, read_options);
+        SequenceNumber snapshot = read_state.snapshot;
+        const auto& mems = read_state.mems;
+        const std::shared_ptr<Version>& version = read_state.version;
+
+        // tables = [active, oldest immutable, ..., newest immutable]
+        PerfTimer memtable_timer(&PerfContext::get_from_memtable_nanos);
+        PerfCounterAdd(&PerfContext::get_from_memtable_count);
+        GetState state = mems->tables[0]->Get(key, snapshot, value);
+        for (size_t i = mems->tables.size() - 1;
+             state == GetState::kNotFound && i >= 1; i--) {
+            PerfCounterAdd(&PerfContext::get_from_memtable_count);
+            state = mems->tables[i]->Get(key, snapshot, value);
+        }
+        memtable_timer.Stop();
+        RecordTick(stats_, state == GetState::kNotFound ? kMemtableMiss : kMemtableHit);
+
+        if (state == GetState::kNotFound) {
+            PerfTimer files_timer(&PerfContext::get_from_output_files_nanos);
+            Status s = version->Get(read_options, key, snapshot, &cfd->table_cache, value,
+                                    &state, &cfd->internal_stats);
+            if (!s.ok()) return s;
+        }
+
+        if (state == GetState::kBlobIndex) {
+            Status s = GetBlobValue(cfd, read_options, key, value);
+            if (!s.ok()) return s;
+        } else if (state != GetState::kFound) {
+            return Status::NotFound();
+        }
+        RecordTick(stats_, kNumberKeysFound);
+        RecordTick(stats_, kBytesRead, value->size());
+        return Status::OK();
+    }
+
+    // Iterator over the live keys at read_options.snapshot (default: now).
+    // The caller owns the result and must delete it before the DB.
+    Iterator* NewIterator(const ReadOptions& read_options) {
+        return NewIterator(read_options, DefaultColumnFamily());
+    }
+
+    Iterator* NewIterator(const ReadOptions& read_options, ColumnFamilyHandle* column_family) {
+        ColumnFamilyData* cfd = column_family->cfd();
+        ReadState read_state = PinReadState(cfd, read_options);
+        SequenceNumber snapshot = read_state.snapshot;
+        auto mems = std::move(read_state.mems);
+        std::shared_ptr<Version> version = std::move(read_state.version);
+
+        std::vector<std::unique_ptr<InternalIterator>> children;
+        for (MemTable* mem : mems->tables) {
+            children.push_back(std::make_unique<MemTableInternalIterator>(mem));
+        }
+        version->AddIterators(read_options, &cfd->table_cache, &children);
+
+        return new DBIter(std::make_unique<MergingIterator>(std::move(children)),
+                          snapshot, read_options,
+                          cfd->options().scan_tombstone_compaction_trigger,
+                          [this, cfd](Slice begin, Slice end, uint64_t count) {
+                              MarkRangeForCompaction(cfd, begin, end, count);
+                          },
+                          std::move(version),
+                          [cfd, read_options](Slice user_key, Slice blob_index,
+                                              std::string* value) {
+                              BlobIndex index;
+                              if (!index.Decode(blob_index)) {
+                                  return Status::Corruption("Bad blob index");
+                              }
+                              return cfd->blob_cache.GetBlob(read_options, user_key, index,
+                                                             value);
+                          });
+    }
+
+    // Pin the current state; reads with ReadOptions::snapshot set to the
+    // result see exactly the writes made before this call, in every family
+    SequenceNumber GetSnapshot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        SequenceNumber snapshot = last_sequence_.load(std::memory_order_acquire);
+        snapshots_.insert(snapshot);
+        return snapshot;
+    }
+
+    void ReleaseSnapshot(SequenceNumber snapshot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = snapshots_.find(snapshot);
+        if (it != snapshots_.end()) snapshots_.erase(it);
+    }
+
+    // Flush the active memtable and wait until every memtable is on disk
+    // and the WAL no longer holds logs kept only for them
+    Status Flush() { return Flush(DefaultColumnFamily()); }
+
+    Status Flush(ColumnFamilyHandle* column_family) {
+        ColumnFamilyData* cfd = column_family->cfd();
+        {
+            std::lock_guard<std::mutex> write_lock(write_mutex_);
+            if (cfd->mem.ActiveMemoryUsage() > 0) {
+                Status s = SwitchMemTable(cfd);
+                if (!s.ok()) return s;
+            }
+        }
+        MaybeScheduleWork();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        bg_done_cv_.wait(lock, [&] {
+            return !bg_error_.ok() || cfd->imm_log_numbers.empty();
+        });
+        return bg_error_;
+    }
+
+    // Compact all files overlapping [*begin, *end] (null = unbounded) down
+    // the tree, dropping shadowed entries and obsolete tombstones
+    Status CompactRange(const Slice* begin, const Slice* end) {
+        return CompactRange(DefaultColumnFamily(), begin, end);
+    }
+
+    Status CompactRange(ColumnFamilyHandle* column_family, const Slice* begin,
+                        const Slice* end) {
+        ColumnFamilyData* cfd = column_family->cfd();
+        Status s = Flush(column_family);
+        if (!s.ok()) return s;
+
+        std::lock_guard<std::mutex> work_lock(bg_work_mutex_);
+        int max_level_with_files = 0;
+        {
+            std::shared_ptr<Version> version = cfd->versions.current();
+            for (int level = 1; level < version->NumLevels(); level++) {
+                if (!version->GetOverlappingInputs(level, begin, end).empty()) {
+                    max_level_with_files = level;
+                }
+            }
+        }
+
+        int last_level = std::max(1, max_level_with_files);
+        for (int level = 0; level < last_level && s.ok(); level++) {
+            auto c = CompactRangeAtLevel(cfd->versions.current(), level, begin, end);
+            if (c) s = RunCompaction(cfd, *c, /*manual=*/true);
+        }
+        DeleteObsoleteFiles(cfd);
+        return s;
+    }
+
+    // Record every Get, Put and Delete (or one in
+    // trace_options.sampling_frequency) to a new trace file at trace_path,
+    // until EndTrace. Replayer runs a trace against a DB.
+    Status StartTrace(const TraceOptions& trace_options, const std::string& trace_path) {
+        return tracer_.Start(trace_path, trace_options);
+    }
+
+    Status EndTrace() { return tracer_.End(); }
+
+    // Block until no flush or compaction is pending or running
+    Status WaitForCompact() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        bg_done_cv_.wait(lock, [&] {
+            if (!bg_error_.ok()) return true;
+            if (bg_work_pending_ || bg_running_) return false;
+            for (const auto& cfd : column_families_) {
+                if (!cfd->imm_log_numbers.empty()) return false;
+            }
+            return true;
+        });
+        return bg_error_;
+    }
+
+    // Number of SSTables at level, for tests and monitoring
+    int NumFilesAtLevel(int level) const {
+        return NumFilesAtLevel(DefaultColumnFamily(), level);
+    }
+
+    int NumFilesAtLevel(ColumnFamilyHandle* column_family, int level) const {
+        return column_family->cfd()->versions.current()->NumFiles(level);
+    }
+
+    // Number of live blob files, for tests and monitoring
+    int NumBlobFiles() const { return NumBlobFiles(DefaultColumnFamily()); }
+
+    int NumBlobFiles(ColumnFamilyHandle* column_family) const {
+        return static_cast<int>(column_family->cfd()->versions.current()->blob_files().size());
+    }
+
+    // Text properties for monitoring. Returns false for unknown names.
+    //   "lsm.stats"     lsm.cfstats followed by lsm.dbstats
+    //   "lsm.cfstats"   per level: files, size, estimated live bytes, and
+    //                   flush/compaction reads, writes and write amplification
+    //                   and table bytes read by Gets; then totals with write
+    //                   and space amplification
+    //   "lsm.dbstats"   uptime, user and WAL bytes written, write stalls
+    //   "lsm.num-files-at-level<N>", "lsm.total-sst-files-size",
+    //   "lsm.estimate-live-data-size", "lsm.write-amplification",
+    //   "lsm.space-amplification"
+    bool GetProperty(Slice property, std::string* value) {
+        return GetProperty(DefaultColumnFamily(), property, value);
+    }
+
+    bool GetProperty(ColumnFamilyHandle* column_family, Slice property, std::string* value) {
+        ColumnFamilyData* cfd = column_family->cfd();
+        std::shared_ptr<Version> version = cfd->versions.current();
+        value->clear();
+        char buf[64];
+
+        static constexpr Slice kFilesAtLevel = "lsm.num-files-at-level";
+        if (property.substr(0, kFilesAtLevel.size()) == kFilesAtLevel) {
+            Slice digits = property.substr(kFilesAtLevel.size());
+            int level = 0;
+            if (digits.empty() || digits.size() > 2) return false;
+            for (char c : digits) {
+                if (c < '0' || c > '9') return false;
+                level = level * 10 + (c - '0');
+            }
+            if (level >= version->NumLevels()) return false;
+            *value = std::to_string(version->NumFiles(level));
+            return true;
+        }
+        if (property == "lsm.stats") {
+            *value = CFStats(cfd) + DBStats();
+        } else if (property == "lsm.cfstats") {
+            *value = CFStats(cfd);
+        } else if (property == "lsm.dbstats") {
+            *value = DBStats();
+        } else if (property == "lsm.total-sst-files-size") {
+            uint64_t total = 0;
+            for (int level = 0; level < version->NumLevels(); level++) {
+                total += version->NumLevelBytes(level);
+            }
+            *value = std::to_string(total);
+        } else if (property == "lsm.estimate-live-data-size") {
+            uint64_t live = 0;
+            for (uint64_t bytes : version->EstimateLiveBytes()) live += bytes;
+            *value = std::to_string(live);
+        } else if (property == "lsm.write-amplification") {
+            std::snprintf(buf, sizeof(buf), "%.4f", cfd->internal_stats.WriteAmplification());
+            *value = buf;
+        } else if (property == "lsm.space-amplification") {
+            uint64_t total = 0;
+            uint64_t live = 0;
+            std::vector<uint64_t> live_bytes = version->EstimateLiveBytes();
+            for (int level = 0; level < version->NumLevels(); level++) {
+                total += version->NumLevelBytes(level);
+                live += live_bytes[static_cast<size_t>(level)];
+            }
+            std::snprintf(buf, sizeof(buf), "%.4f",
+                          live > 0 ? static_cast<double>(total) / static_cast<double>(live) : 0);
+            *value = buf;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const Options& options() const { return options_; }
+    TableCache* table_cache() { return &default_cf_->table_cache; }
+
+private:
+    // A write waiting in the queue; see Write
+    struct Writer {
+        Writer(ColumnFamilyData* c, ValueType t, Slice k, Slice v, bool s)
+            : cfd(c), type(t), key(k), value(v), sync(s) {}
+
+        ColumnFamilyData* cfd;
+        ValueType type;
+        Slice key;
+        Slice value;
+        bool sync;
+        bool done = false;
+        Status status;
+        std::condition_variable cv;
+    };
+
+    DB(const Options& options, const std::string& path)
+        : options_(SanitizeOptions(options)),
+          path_(path),
+          stats_(options_.statistics.get()),
+          open_time_(std::chrono::steady_clock::now()) {}
+
+    // Give the DB a block cache unless the caller supplied (or sized) one,
+    // and let the WAL record into the DB's statistics and use its Env
+    static Options SanitizeOptions(const Options& src) {
+        Options options = src;
+        if (!options.table_options.block_cache && options.block_cache_size > 0) {
+            std::shared_ptr<SecondaryCache> secondary;
+            if (options.compressed_secondary_cache_size > 0) {
+                secondary = NewCompressedSecondaryCache(options.compressed_secondary_cache_size);
+            }
+            options.table_options.block_cache =
+                NewLRUCache(options.block_cache_size, 4, std::move(secondary));
+        }
+        options.table_options.env = options.env;
+        options.wal_options.statistics = options.statistics.get();
+        options.wal_options.env = options.env;
+        return options;
+    }
+
+    static Status ValidateOptions(const ColumnFamilyOptions& options) {
+        double cutoff = options.blob_garbage_collection_age_cutoff;
+        if (!(cutoff >= 0.0 && cutoff <= 1.0)) {
+            return Status::InvalidArgument("blob_garbage_collection_age_cutoff must be in [0, 1]");
+        }
+        return Status::OK();
+    }
+
+    // Families without a block cache of their own share the DB's; all of
+    // them use the DB's Env. Each learns its own table tail prefetch size.
+    std::unique_ptr<ColumnFamilyData> NewColumnFamilyData(uint32_t id, const std::string& name,
+                                                          const ColumnFamilyOptions& src) {
+        ColumnFamilyOptions cf_options = src;
+        if (!cf_options.table_options.block_cache) {
+            cf_options.table_options.block_cache = options_.table_options.block_cache;
+        }
+        if (!cf_options.table_options.tail_prefetch_stats) {
+            cf_options.table_options.tail_prefetch_stats =
+                std::make_shared<sstable::TailPrefetchStats>();
+        }
+        cf_options.table_options.env = options_.env;
+        return std::make_unique<ColumnFamilyData>(
+            id, name, cf_options, path_,
+            static_cast<size_t>(std::max(options_.max_open_files, 1)),
+            options_.write_buffer_manager.get());
+    }
+
+    Status CreateColumnFamilyDir(ColumnFamilyData* cfd) {
+        if (cfd->id() == 0) return Status::OK();
+        return options_.env->CreateDirIfMissing(cfd->path());
+    }
+
+    ColumnFamilyData* FindColumnFamily(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& cfd : column_families_) {
+            if (cfd->name() == name) return cfd.get();
+        }
+        return nullptr;
+    }
+
+    // Snapshot of the family list; families live as long as the DB
+    std::vector<ColumnFamilyData*> ColumnFamilies() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<ColumnFamilyData*> result;
+        for (const auto& cfd : column_families_) result.push_back(cfd.get());
+        return result;
+    }
+
+    std::string CFStats(ColumnFamilyData* cfd) {
+        std::shared_ptr<Version> version = cfd->versions.current();
+        std::vector<uint64_t> live = version->EstimateLiveBytes();
+        std::vector<LevelSummary> levels(static_cast<size_t>(version->NumLevels()));
+        for (int level = 0; level < version->NumLevels(); level++) {
+            LevelSummary& l = levels[static_cast<size_t>(level)];
+            l.files = version->NumFiles(level);
+            l.bytes = version->NumLevelBytes(level);
+            l.live_bytes = live[static_cast<size_t>(level)];
+        }
+        return "** Compaction Stats [" + cfd->name() + "] **\n" +
+               cfd->internal_stats.DumpLevels(levels);
+    }
+
+    std::string DBStats() {
+        uint64_t user = 0;
+        uint64_t table = 0;
+        for (ColumnFamilyData* cfd : ColumnFamilies()) {
+            user += cfd->internal_stats.user_bytes_written();
+            for (int level = 0; level < cfd->internal_stats.num_levels(); level++) {
+                table += cfd->internal_stats.GetCompactionStats(level).bytes_written;
+            }
+        }
+        uint64_t wal = wal_->BytesWritten();
+        double uptime = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - open_time_).count();
+
+        std::string r = "** DB Stats **\n";
+        char buf[256];
+        std::snprintf(buf, sizeof(buf), "Uptime(secs): %.1f\n", uptime);
+        r.append(buf);
+        std::snprintf(buf, sizeof(buf), "User writes: %.2f MB, WAL: %.2f MB, tables: %.2f MB\n",
+                      static_cast<double>(user) / 1048576.0, static_cast<double>(wal) / 1048576.0,
+                      static_cast<double>(table) / 1048576.0);
+        r.append(buf);
+        std::snprintf(buf, sizeof(buf),
+                      "Write amplification (WAL + tables): %.2f\n",
+                      user > 0 ? static_cast<double>(wal + table) / static_cast<double>(user) : 0);
+        r.append(buf);
+        std::snprintf(buf, sizeof(buf), "Stalls(secs): %.3f\n",
+                      static_cast<double>(stall_micros_.load(std::memory_order_relaxed)) / 1e6);
+        r.append(buf);
+        return r;
+    }
+
+    // Append every family's stats to <db>/LOG (stats_dump_period_sec)
+    void DumpStats() {
+        std::string text;
+        for (ColumnFamilyData* cfd : ColumnFamilies()) text += CFStats(cfd);
+        text += DBStats();
+
+        std::time_t now = std::time(nullptr);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y/%m/%d-%H:%M:%S", std::localtime(&now));
+        FILE* f = std::fopen(InfoLogFileName(path_).c_str(), "a");
+        if (f == nullptr) return;
+        std::fprintf(f, "%s ------- DUMPING STATS -------\n%s\n", stamp, text.c_str());
+        std::fclose(f);
+    }
+
+    // Data blocks of this DB's open tables in the block cache(s), hottest
+    // first. A cached block is charged its contents without the trailer.
+    std::vector<CachedBlockInfo> CollectCachedBlocks() {
+        std::map<std::pair<const Cache*, uint64_t>, std::pair<uint32_t, uint64_t>> tables;
+        std::vector<const Cache*> caches;
+        for (ColumnFamilyData* cfd : ColumnFamilies()) {
+            const Cache* cache = cfd->options().table_options.block_cache.get();
+            if (cache == nullptr) continue;
+            if (std::find(caches.begin(), caches.end(), cache) == caches.end()) {
+                caches.push_back(cache);
+            }
+            cfd->table_cache.ForEachTable(
+                [&](uint64_t number, const sstable::SSTableReader& table) {
+                    tables[{cache, table.cache_id()}] = {cfd->id(), number};
+                });
+        }
+
+        std::vector<CachedBlockInfo> blocks;
+        for (const Cache* cache : caches) {
+            cache->ApplyToAllEntries([&](Slice key, size_t charge) {
+                uint64_t cache_id = 0;
+                uint64_t offset = 0;
+                if (!sstable::SSTableReader::ParseBlockCacheKey(key, &cache_id, &offset)) return;
+                auto it = tables.find({cache, cache_id});
+                if (it == tables.end()) return;  // Another DB's, or a closed table's
+                blocks.push_back({it->second.first, it->second.second, offset,
+                                  charge + sstable::kBlockTrailerSize});
+            });
+        }
+        return blocks;
+    }
+
+    // Save the hot block list for the next open (block_cache_dump_period_sec).
+    // An empty cache keeps the previous list.
+    void DumpBlockCache() {
+        std::vector<CachedBlockInfo> blocks = CollectCachedBlocks();
+        if (blocks.empty()) return;
+        // Keeps DeleteObsoleteFiles from removing the temp file
+        std::lock_guard<std::mutex> work_lock(bg_work_mutex_);
+        SaveCacheWarmupFile(options_.env, BlockCacheWarmupFileName(path_), blocks);
+    }
+
+    void StartBlockCacheWarmup() {
+        if (options_.block_cache_warmup_bytes_per_sec == 0) return;
+        std::vector<CachedBlockInfo> blocks;
+        Status s = LoadCacheWarmupFile(options_.env, BlockCacheWarmupFileName(path_), &blocks);
+        if (!s.ok() || blocks.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            warmup_running_ = true;
+        }
+        warmup_thread_ = std::thread([this, blocks = std::move(blocks)] {
+            uint64_t bytes = WarmBlockCache(blocks);
+            std::lock_guard<std::mutex> lock(mutex_);
+            warmup_bytes_ = bytes;
+            warmup_running_ = false;
+            bg_done_cv_.notify_all();
+        });
+    }
+
+    // Read the listed blocks of still-live tables into the block cache,
+    // hottest first, at block_cache_warmup_bytes_per_sec. Stops loading a
+    // cache once the blocks loaded fill it: colder ones would evict hotter.
+    uint64_t WarmBlockCache(const std::vector<CachedBlockInfo>& blocks) {
+        struct Family {
+            ColumnFamilyData* cfd;
+            std::set<uint64_t> live;
+        };
+        std::map<uint32_t, Family> families;
+        for (ColumnFamilyData* cfd : ColumnFamilies()) {
+            families[cfd->id()] = {cfd, cfd->versions.LiveFiles()};
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const double rate = static_cast<double>(options_.block_cache_warmup_bytes_per_sec);
+        std::map<const Cache*, uint64_t> loaded;
+        uint64_t bytes = 0;
+        for (const auto& b : blocks) {
+            auto it = families.find(b.column_family);
+            if (it == families.end() || it->second.live.count(b.file_number) == 0) continue;
+            ColumnFamilyData* cfd = it->second.cfd;
+            const Cache* cache = cfd->options().table_options.block_cache.get();
+            if (cache == nullptr ||
+                loaded[cache] + cache->GetReserved() >= cache->GetCapacity()) {
+                continue;
+            }
+
+            auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                   std::chrono::duration<double>(static_cast<double>(bytes) / rate));
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (bg_cv_.wait_until(lock, due, [&] { return shutting_down_; })) break;
+            }
+
+            std::shared_ptr<sstable::SSTableReader> table;
+            if (!cfd->table_cache.FindTable(b.file_number, &table).ok()) continue;
+            uint64_t read = 0;
+            if (table->CacheBlock({b.offset, b.size}, &read).ok()) loaded[cache] += b.size;
+            bytes += read;
+        }
+        return bytes;
+    }
+
+    // Replace the blob reference in *value with the value it points to
+    static Status GetBlobValue(ColumnFamilyData* cfd, const ReadOptions& read_options,
+                               Slice user_key, PinnableSlice* value) {
+        BlobIndex index;
+        if (!index.Decode(*value)) {
+            return Status::Corruption("Bad blob index");
+        }
+        auto blob = std::make_shared<std::string>();
+        Status s = cfd->blob_cache.GetBlob(read_options, user_key, index, blob.get());
+        if (!s.ok()) {
+            value->Reset();
+            return s;
+        }
+        value->PinSlice(*blob, [blob]() {});
+        return Status::OK();
+    }
+
+    // A read's snapshot and the memtables and Version it reads at it
+    struct ReadState {
+        SequenceNumber snapshot;
+        std::unique_ptr<MemTableManager::MemTableSet> mems;
+        std::shared_ptr<Version> version;
+    };
+
+    // Every write the snapshot covers is in the pinned memtables or Version.
+    // Memtables are pinned before the Version: a flush installs its Version
+    // before dropping the memtable. An implicit snapshot is not registered,
+    // so all three are taken under mutex_, as SmallestSnapshot is: a
+    // compaction either computed its smallest snapshot first, and then it
+    // is no newer than ours and the compaction keeps every entry visible
+    // at ours, or it installs its output after we pinned the Version,
+    // whose files stay readable until we release it.
+    ReadState PinReadState(ColumnFamilyData* cfd, const ReadOptions& read_options) {
+        ReadState state;
+        std::lock_guard<std::mutex> lock(mutex_);
+        state.snapshot = read_options.snapshot != kMaxSequenceNumber
+                             ? read_options.snapshot
+                             : last_sequence_.load(std::memory_order_acquire);
+        state.mems = cfd->mem.GetCurrentMemTables();
+        state.version = cfd->versions.current();
+        return state;
+    }
+
+    // Open the requested column families, then replay the WAL into them.
+    // Each family skips logs its MANIFEST says are already flushed.
+    // Recovered writes are flushed to L0 so every log before the new one
+    // can be dropped.
+    Status Recover(const std::vector<ColumnFamilyDescriptor>& descriptors) {
+        Status s = registry_.Load(options_.env, path_);
+        if (!s.ok()) return s;
+
+        // Every existing family must be opened: its writes may be in the WAL
+        std::set<std::string> requested;
+        for (const auto& desc : descriptors) {
+            if (!requested.insert(desc.name).second) {
+                return Status::InvalidArgument("Column family listed twice: " + desc.name);
+            }
+        }
+        if (requested.count(kDefaultColumnFamilyName) == 0) {
+            return Status::InvalidArgument("The default column family must be opened");
+        }
+        for (const auto& [id, name] : registry_.families) {
+            if (requested.count(name) == 0) {
+                return Status::InvalidArgument("Column family not opened: " + name);
+            }
+        }
+
+        bool registry_changed = false;
+        for (const auto& desc : descriptors) {
+            uint32_t id = 0;
+            if (desc.name != kDefaultColumnFamilyName) {
+                auto it = std::find_if(registry_.families.begin(), registry_.families.end(),
+                                       [&](const auto& entry) { return entry.second == desc.name; });
+                if (it != registry_.families.end()) {
+                    id = it->first;
+                } else if (options_.create_missing_column_families) {
+                    id = registry_.next_id++;
+                    registry_.families[id] = desc.name;
+                    registry_changed = true;
+                } else {
+                    return Status::InvalidArgument("Column family does not exist: " + desc.name);
+                }
+            }
+            auto cfd = NewColumnFamilyData(id, desc.name, desc.options);
+            s = CreateColumnFamilyDir(cfd.get());
+            if (!s.ok()) return s;
+            if (id == 0) default_cf_ = cfd.get();
+            column_families_.push_back(std::move(cfd));
+        }
+
+        uint64_t min_log = std::numeric_limits<uint64_t>::max();
+        std::map<uint32_t, ColumnFamilyData*> by_id;
+        for (const auto& cfd : column_families_) {
+            bool exists = false;
+            s = cfd->versions.Recover(&exists);
+            if (!s.ok()) return s;
+            if (cfd.get() == default_cf_ && exists && options_.error_if_exists) {
+                return Status::InvalidArgument(path_ + " exists (error_if_exists is true)");
+            }
+            min_log = std::min(min_log, cfd->versions.LogNumber());
+            by_id[cfd->id()] = cfd.get();
+        }
+        s = LoadTables();
+        if (!s.ok()) return s;
+
+        wal_ = std::make_unique<wal::WALManager>(path_, options_.wal_options);
+        s = wal_->Open();
+        if (!s.ok()) return s;
+
+        std::map<uint32_t, MemTable*> recovered;
+        Status replay_status;
+        wal::RecoveryStats stats;
+        s = wal_->Recover(
+            [&](uint64_t log_number, const wal::WALEntry& entry) {
+                auto it = by_id.find(entry.column_family);
+                if (it == by_id.end()) {
+                    if (replay_status.ok()) {
+                        replay_status = Status::Corruption("WAL entry for unknown column family");
+                    }
+                    return;
+                }
+                ColumnFamilyData* cfd = it->second;
+                if (log_number < cfd->versions.LogNumber()) return;  // Already flushed
+
+                MemTable*& mem = recovered[cfd->id()];
+                if (mem == nullptr) {
+                    mem = new MemTable(cfd->memtable_options());
+                    mem->Ref();
+                }
+                if (entry.IsPut()) {
+                    mem->Put(entry.sequence, entry.key, entry.value);
+                } else {
+                    mem->Delete(entry.sequence, entry.key);
+                }
+            },
+            &stats, min_log);
+        if (s.ok()) s = replay_status;
+
+        uint64_t log_number = wal_->CurrentLogNumber();
+        for (const auto& cfd : column_families_) {
+            if (!s.ok()) break;
+            VersionEdit edit;
+            auto it = recovered.find(cfd->id());
+            if (it != recovered.end() && it->second->EntryCount() > 0) {
+                s = WriteLevel0Table(cfd.get(), it->second, &edit);
+                edit.last_sequence = it->second->MaxSequence();
+            }
+            edit.SetLogNumber(log_number);
+            if (s.ok()) s = cfd->versions.LogAndApply(edit);
+        }
+        for (auto& [id, mem] : recovered) {
+            mem->Unref();
+        }
+        if (!s.ok()) return s;
+
+        if (registry_changed) {
+            s = registry_.Save(options_.env, path_);
+            if (!s.ok()) return s;
+        }
+        s = wal_->MarkFlushed(log_number);
+        if (!s.ok()) return s;
+
+        // Sequence numbers start at 1 so that 0 can act as "before anything"
+        SequenceNumber last = 0;
+        for (const auto& cfd : column_families_) {
+            last = std::max(last, cfd->versions.LastSequence());
+        }
+        last_sequence_.store(last, std::memory_order_release);
+        for (const auto& cfd : column_families_) {
+            cfd->mem.SetSequence(last + 1);
+            DeleteObsoleteFiles(cfd.get());
+        }
+        return Status::OK();
+    }
+
+    // Open the live tables of every family in parallel (see
+    // Options::max_file_opening_threads), checking each against its MANIFEST
+    // size and, with verify_tables_on_open, every block checksum. Preloaded
+    // tables stay in the table cache; the others are only verified.
+    Status LoadTables() {
+        int num_threads = options_.max_file_opening_threads;
+        if (num_threads <= 0 && !options_.verify_tables_on_open) return Status::OK();
+
+        struct Job {
+            ColumnFamilyData* cfd;
+            std::shared_ptr<FileMetaData> file;
+            bool preload;
+        };
+        std::vector<Job> jobs;
+        for (const auto& cfd : column_families_) {
+            std::shared_ptr<Version> v = cfd->versions.current();
+            size_t budget = num_threads > 0 ? cfd->table_cache.Capacity() : 0;
+            for (int level = 0; level < v->NumLevels(); level++) {
+                for (const auto& f : v->files(level)) {
+                    bool preload = budget > 0;
+                    if (preload) budget--;
+                    if (preload || options_.verify_tables_on_open) {
+                        jobs.push_back({cfd.get(), f, preload});
+                    }
+                }
+            }
+        }
+
+        std::vector<Status> results(jobs.size());
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        auto work = [&] {
+            size_t i;
+            while (!failed.load(std::memory_order_relaxed) &&
+                   (i = next.fetch_add(1, std::memory_order_relaxed)) < jobs.size()) {
+                results[i] = LoadTable(jobs[i].cfd, *jobs[i].file, jobs[i].preload);
+                if (!results[i].ok()) failed.store(true, std::memory_order_relaxed);
+            }
+        };
+        size_t threads_wanted = std::min<size_t>(std::max(num_threads, 1), jobs.size());
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < threads_wanted; t++) threads.emplace_back(work);
+        work();
+        for (auto& t : threads) t.join();
+
+        for (const Status& r : results) {
+            if (!r.ok()) return r;
+        }
+        return Status::OK();
+    }
+
+    Status LoadTable(ColumnFamilyData* cfd, const FileMetaData& f, bool preload) {
+        std::shared_ptr<sstable::SSTableReader> table;
+        Status s;
+        if (preload) {
+            s = cfd->table_cache.FindTable(f.number, &table);
+        } else {
+            std::unique_ptr<sstable::SSTableReader> reader;
+            s = cfd->table_cache.OpenTable(f.number, &reader);
+            table = std::move(reader);
+        }
+        if (!s.ok()) return s;
+        if (table->FileSize() != f.file_size) {
+            return Status::Corruption("Table size " + std::to_string(table->FileSize()) +
+                                      " does not match MANIFEST size " +
+                                      std::to_string(f.file_size) + ": " + table->Path());
+        }
+        if (options_.verify_tables_on_open) return table->VerifyChecksums();
+        return Status::OK();
+    }
+
+    // Queue the write and wait until the writer at the front of the queue
+    // (possibly this one) has committed it. The front writer commits itself
+    // and the writers queued behind it as one group: one WAL write, one
+    // sync, consecutive sequence numbers.
+    Status Write(const WriteOptions& write_options, ColumnFamilyData* cfd, ValueType type,
+                 Slice key, Slice value) {
+        StopWatch sw(stats_, kDbWrite);
+        RecordTick(stats_, kNumberKeysWritten);
+        RecordTick(stats_, kBytesWritten, key.size() + value.size());
+        tracer_.Record(type == ValueType::kValue ? TraceType::kPut : TraceType::kDelete,
+                       cfd->id(), key, value.size());
+        Writer w(cfd, type, key, value, write_options.sync);
+
+        std::unique_lock<std::mutex> lock(writers_mutex_);
+        writers_.push_back(&w);
+        {
+            PerfTimer perf_timer(&PerfContext::write_wait_nanos);
+            w.cv.wait(lock, [&] { return w.done || writers_.front() == &w; });
+        }
+        if (w.done) return w.status;
+
+        std::vector<Writer*> group = BuildWriteGroup();
+        lock.unlock();
+        Status s = CommitWriteGroup(group);
+        lock.lock();
+
+        for (Writer* writer : group) {
+            writers_.pop_front();
+            if (writer != &w) {
+                writer->status = s;
+                writer->done = true;
+                writer->cv.notify_one();
+            }
+        }
+        if (!writers_.empty()) {
+            writers_.front()->cv.notify_one();
+        }
+        return s;
+    }
+
+    // The leader and the writers behind it, up to max_write_group_bytes.
+    // A sync write is never added to a group whose leader does not sync.
+    // REQUIRES: writers_mutex_ held, writers_ not empty
+    std::vector<Writer*> BuildWriteGroup() {
+        Writer* leader = writers_.front();
+        std::vector<Writer*> group = {leader};
+        size_t bytes = leader->key.size() + leader->value.size();
+        for (size_t i = 1; i < writers_.size(); i++) {
+            Writer* w = writers_[i];
+            if (w->sync && !leader->sync) break;
+            bytes += w->key.size() + w->value.size();
+            if (bytes > options_.max_write_group_bytes) break;
+            group.push_back(w);
+        }
+        return group;
+    }
+
+    Status CommitWriteGroup(const std::vector<Writer*>& group) {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+
+        for (size_t i = 0; i < group.size(); i++) {
+            bool seen = false;
+            for (size_t j = 0; j < i && !seen; j++) {
+                seen = group[j]->cfd == group[i]->cfd;
+            }
+            if (seen) continue;
+            Status s = MakeRoomForWrite(group[i]->cfd);
+            if (!s.ok()) return s;
+        }
+
+        SequenceNumber first = last_sequence_.load(std::memory_order_relaxed) + 1;
+        std::vector<wal::WALEntry> entries;
+        entries.reserve(group.size());
+        for (size_t i = 0; i < group.size(); i++) {
+            const Writer* w = group[i];
+            entries.push_back(wal::WALEntry{
+                w->type == ValueType::kValue ? wal::WALEntryType::kPut : wal::WALEntryType::kDelete,
+                first + i, std::string(w->key), std::string(w->value), w->cfd->id()});
+        }
+
+        Status s;
+        {
+            StopWatch sw(stats_, kWalAppend);
+            PerfTimer perf_timer(&PerfContext::write_wal_nanos);
+            s = wal_->AppendBatch(entries);
+        }
+        RecordTick(stats_, kWalWrites);
+        if (s.ok() && group.front()->sync) {
+            s = wal_->Sync();
+        }
+        if (!s.ok()) return s;
+
+        PerfTimer perf_timer(&PerfContext::write_memtable_nanos);
+        for (size_t i = 0; i < group.size(); i++) {
+            const Writer* w = group[i];
+            s = w->cfd->mem.Add(first + i, w->type, w->key, w->value);
+            if (!s.ok()) return s;
+            w->cfd->internal_stats.AddUserBytesWritten(w->key.size() + w->value.size());
+        }
+        // Readers see the group only once all of it is in the memtables
+        last_sequence_.store(first + group.size() - 1, std::memory_order_release);
+        return Status::OK();
+    }
+
+    // Rotate cfd's memtable once it is full, stalling while too many of its
+    // memtables or L0 files are waiting on the background thread.
+    // REQUIRES: write_mutex_ held
+    Status MakeRoomForWrite(ColumnFamilyData* cfd) {
+        while (true) {
+            if (!ActiveMemTableFull(cfd)) {
+                return Status::OK();
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (!bg_error_.ok()) return bg_error_;
+
+                WriteStallCause cause = StallCause(cfd);
+                if (cause != WriteStallCause::kNone) {
+                    // Seen by the background thread even if the stall ends
+                    // before it next checks
+                    cfd->stalled_cause = cause;
+                    bg_work_pending_ = true;
+                    bg_cv_.notify_all();
+                    auto stall_start = std::chrono::steady_clock::now();
+                    bg_done_cv_.wait(lock);
+                    auto stall_micros = static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - stall_start).count());
+                    stall_micros_.fetch_add(stall_micros, std::memory_order_relaxed);
+                    RecordTick(stats_, kStallMicros, stall_micros);
+                    continue;
+                }
+            }
+
+            Status s = SwitchMemTable(cfd);
+            if (!s.ok()) return s;
+            MaybeScheduleWork();
+            return Status::OK();
+        }
+    }
+
+    // True once cfd's active memtable must become immutable: it reached
+    // write_buffer_size, or the write buffer manager is over budget
+    bool ActiveMemTableFull(ColumnFamilyData* cfd) {
+        size_t active = cfd->mem.ActiveMemoryUsage();
+        if (active >= cfd->options().write_buffer_size) return true;
+        const WriteBufferManager* wbm = options_.write_buffer_manager.get();
+        return wbm != nullptr && active > 0 && wbm->ShouldFlush();
+    }
+
+    // Why writes to a full active memtable of cfd would block, if they would.
+    // REQUIRES: mutex_ held
+    WriteStallCause StallCause(ColumnFamilyData* cfd) {
+        const ColumnFamilyOptions& cf_options = cfd->options();
+        if (!ActiveMemTableFull(cfd)) {
+            return WriteStallCause::kNone;
+        }
+        if (cfd->mem.ImmutableCount() + 1 >=
+            static_cast<size_t>(std::max(cf_options.max_write_buffer_number, 2))) {
+            return WriteStallCause::kMemtableLimit;
+        }
+        // Over the memory budget with a flush of cfd in flight: wait for it
+        // to free memory rather than cutting ever smaller memtables
+        if (cfd->mem.ImmutableCount() > 0 &&
+            cfd->mem.ActiveMemoryUsage() < cf_options.write_buffer_size) {
+            return WriteStallCause::kWriteBufferManager;
+        }
+        if (cfd->versions.current()->NumFiles(0) >= cf_options.level0_stop_writes_trigger) {
+            return WriteStallCause::kL0FileCountLimit;
+        }
+        return WriteStallCause::kNone;
+    }
+
+    // Make cfd's active memtable immutable and start a new WAL for its
+    // successor. REQUIRES: write_mutex_ held.
+    Status SwitchMemTable(ColumnFamilyData* cfd) {
+        uint64_t old_log_number = wal_->CurrentLogNumber();
+        Status s = wal_->Rotate();
+        if (!s.ok()) return s;
+        uint64_t log_number = wal_->CurrentLogNumber();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        s = cfd->mem.ForceRotation();
+        if (!s.ok()) return s;
+        // Every write in the new immutable memtable is in a log before this
+        cfd->imm_log_numbers.push_back(log_number);
+        if (!options_.listeners.empty()) {
+            pending_wal_rotations_.push_back({cfd->name(), old_log_number, log_number});
+        }
+
+        // Families with nothing unflushed need none of the older logs
+        for (const auto& other : column_families_) {
+            if (other.get() != cfd && !other->HasUnflushedData()) {
+                other->log_floor.store(log_number, std::memory_order_release);
+            }
+        }
+        return Status::OK();
+    }
+
+    // Logs before the result hold no unflushed write of any family. Reading
+    // the current log first keeps writes racing with this call safe: they
+    // land in the current log or a newer one.
+    uint64_t MinLogNumberToKeep() {
+        uint64_t min_log = wal_->CurrentLogNumber();
+        for (ColumnFamilyData* cfd : ColumnFamilies()) {
+            if (cfd->HasUnflushedData()) {
+                min_log = std::min(min_log, cfd->OldestLogWithUnflushedData());
+            }
+        }
+        return min_log;
+    }
+
+    void MaybeScheduleWork() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bg_work_pending_ = true;
+        bg_cv_.notify_all();
+    }
+
+    // Returns false if an earlier error is already set
+    bool SetBackgroundError(const Status& s) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool first = bg_error_.ok();
+        if (first) bg_error_ = s;
+        bg_done_cv_.notify_all();
+        return first;
+    }
+
+    // Mark files holding tombstones in [begin, end] for compaction; called
+    // by iterators whose scans stepped over too many tombstones
+    void MarkRangeForCompaction(ColumnFamilyData* cfd, Slice begin, Slice end,
+                                uint64_t /*count*/) {
+        std::shared_ptr<Version> version = cfd->versions.current();
+        bool marked = false;
+        for (int level = 0; level < version->NumLevels(); level++) {
+            for (const auto& f : version->files(level)) {
+                if (f->num_deletions > 0 && f->Overlaps(begin, end)) {
+                    f->marked_for_compaction.store(true, std::memory_order_relaxed);
+                    marked = true;
+                }
+            }
+        }
+        if (marked) MaybeScheduleWork();
+    }
+
+    // Runs flushes and compactions when signalled, and dumps stats every
+    // stats_dump_period_sec
+    void BackgroundThread() {
+        using Clock = std::chrono::steady_clock;
+        const auto stats_period = std::chrono::seconds(options_.stats_dump_period_sec);
+        const auto cache_period = std::chrono::seconds(options_.block_cache_dump_period_sec);
+        auto next_stats_dump = Clock::now() + stats_period;
+        auto next_cache_dump = Clock::now() + cache_period;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            auto ready = [&] { return shutting_down_ || bg_work_pending_; };
+            if (stats_period.count() > 0 || cache_period.count() > 0) {
+                auto wake = stats_period.count() == 0 ? next_cache_dump
+                          : cache_period.count() == 0 ? next_stats_dump
+                          : std::min(next_stats_dump, next_cache_dump);
+                bg_cv_.wait_until(lock, wake, ready);
+            } else {
+                bg_cv_.wait(lock, ready);
+            }
+            if (shutting_down_) break;
+            if (stats_period.count() > 0 && Clock::now() >= next_stats_dump) {
+                lock.unlock();
+                DumpStats();
+                lock.lock();
+                next_stats_dump = Clock::now() + stats_period;
+            }
+            if (cache_period.count() > 0 && Clock::now() >= next_cache_dump) {
+                lock.unlock();
+                DumpBlockCache();
+                lock.lock();
+                next_cache_dump = Clock::now() + cache_period;
+            }
+            if (!bg_work_pending_) continue;
+            bg_work_pending_ = false;
+            bg_running_ = true;
+            lock.unlock();
+
+            BackgroundErrorReason reason = BackgroundErrorReason::kFlush;
+            Status s = BackgroundWork(&reason);
+            if (!s.ok() && SetBackgroundError(s)) {
+                for (const auto& listener : options_.listeners) {
+                    listener->OnBackgroundError(reason, s);
+                }
+            }
+
+            lock.lock();
+            bg_running_ = false;
+            bg_done_cv_.notify_all();
+        }
+    }
+
+    // Flushes come first in every family: they unblock writers and let the
+    // shared WAL shrink. On failure *reason says which kind of work failed.
+    Status BackgroundWork(BackgroundErrorReason* reason) {
+        std::lock_guard<std::mutex> work_lock(bg_work_mutex_);
+        std::vector<ColumnFamilyData*> cfds = ColumnFamilies();
+        NotifyWALRotations();
+        for (ColumnFamilyData* cfd : cfds) UpdateStallCondition(cfd);
+
+        Status s;
+        for (ColumnFamilyData* cfd : cfds) {
+            if (s.ok()) s = FlushImmutableMemTables(cfd);
+        }
+        if (!s.ok()) {
+            *reason = BackgroundErrorReason::kFlush;
+        } else {
+            for (ColumnFamilyData* cfd : cfds) {
+                if (s.ok()) s = RunScheduledCompactions(cfd);
+            }
+            if (!s.ok()) *reason = BackgroundErrorReason::kCompaction;
+        }
+        for (ColumnFamilyData* cfd : cfds) {
+            DeleteObsoleteFiles(cfd);
+            UpdateStallCondition(cfd);
+        }
+        return s;
+    }
+
+    // Deliver the WAL rotations writers queued. REQUIRES: bg_work_mutex_ held
+    void NotifyWALRotations() {
+        std::vector<WALRotationInfo> rotations;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            rotations.swap(pending_wal_rotations_);
+        }
+        for (const auto& info : rotations) {
+            for (const auto& listener : options_.listeners) listener->OnWALRotated(info);
+        }
+    }
+
+    // Report changes in whether cfd's writers are stalled. A stall that
+    // began and ended since the last call is reported as both transitions.
+    // REQUIRES: bg_work_mutex_ held
+    void UpdateStallCondition(ColumnFamilyData* cfd) {
+        if (options_.listeners.empty()) return;
+        WriteStallCause stalled;
+        WriteStallCause current;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stalled = cfd->stalled_cause;
+            cfd->stalled_cause = WriteStallCause::kNone;
+            current = StallCause(cfd);
+        }
+        if (stalled != WriteStallCause::kNone) {
+            SetStallCondition(cfd, WriteStallCondition::kStopped, stalled);
+        }
+        SetStallCondition(cfd,
+                          current == WriteStallCause::kNone ? WriteStallCondition::kNormal
+                                                            : WriteStallCondition::kStopped,
+                          current);
+    }
+
+    void SetStallCondition(ColumnFamilyData* cfd, WriteStallCondition condition,
+                           WriteStallCause cause) {
+        if (cfd->stall_condition == condition) return;
+        WriteStallInfo info;
+        info.cf_name = cfd->name();
+        info.cur = condition;
+        info.prev = cfd->stall_condition;
+        info.cause = cause;
+        cfd->stall_condition = condition;
+        for (const auto& listener : options_.listeners) listener->OnStallConditionsChanged(info);
+    }
+
+    Status FlushImmutableMemTables(ColumnFamilyData* cfd) {
+        while (!IsShuttingDown()) {
+            MemTable* imm = cfd->mem.GetOldestImmutable();
+            if (imm == nullptr) break;
+
+            uint64_t log_number;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                log_number = cfd->imm_log_numbers.front();
+            }
+
+            FlushJobInfo info;
+            if (!options_.listeners.empty()) {
+                info.cf_name = cfd->name();
+                info.num_entries = imm->EntryCount();
+                info.smallest_seqno = imm->MinSequence();
+                info.largest_seqno = imm->MaxSequence();
+                for (const auto& listener : options_.listeners) {
+                    listener->OnFlushBegin(this, info);
+                }
+            }
+
+            StopWatch sw(stats_, kFlushTime);
+            auto start = std::chrono::steady_clock::now();
+            VersionEdit edit;
+            Status s;
+            if (imm->EntryCount() > 0) {
+                s = WriteLevel0Table(cfd, imm, &edit);
+            }
+            edit.SetLogNumber(log_number);
+            edit.last_sequence = imm->EntryCount() > 0 ? imm->MaxSequence() : 0;
+            imm->Unref();
+            if (s.ok()) s = cfd->versions.LogAndApply(edit);
+            if (!s.ok()) return s;
+            sw.Stop();
+            LevelCompactionStats flush_stats;
+            flush_stats.count = 1;
+            flush_stats.micros = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+            for (const auto& [level, f] : edit.new_files) {
+                flush_stats.bytes_written += f->file_size;
+                flush_stats.files_out++;
+            }
+            for (const auto& b : edit.new_blob_files) {
+                flush_stats.bytes_written += b->total_bytes;
+            }
+            cfd->internal_stats.AddCompactionStats(0, flush_stats);
+            RecordTick(stats_, kFlushCount);
+            RecordTick(stats_, kFlushBytes, flush_stats.bytes_written);
+
+            cfd->mem.RemoveFlushedMemTable();
+
+            // The WAL is shared: a log goes only once every family has
+            // flushed past it
+            s = wal_->MarkFlushed(MinLogNumberToKeep());
+            if (!s.ok()) return s;
+
+            // Listeners hear of the flush before Flush() callers wake up
+            if (!options_.listeners.empty()) {
+                for (const auto& [level, f] : edit.new_files) {
+                    info.file_number = f->number;
+                    info.file_path = TableFileName(cfd->path(), f->number);
+                    info.file_size = f->file_size;
+                }
+                for (const auto& b : edit.new_blob_files) info.blob_bytes += b->total_bytes;
+                info.micros = flush_stats.micros;
+                for (const auto& listener : options_.listeners) {
+                    listener->OnFlushCompleted(this, info);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                cfd->imm_log_numbers.pop_front();
+                bg_done_cv_.notify_all();
+            }
+            UpdateStallCondition(cfd);
+        }
+        return Status::OK();
+    }
+
+    // Write mem to a new L0 table of cfd and add it to *edit. Values large
+    // enough for key-value separation go to new blob files, also added to
+    // *edit.
+    Status WriteLevel0Table(ColumnFamilyData* cfd, MemTable* mem, VersionEdit* edit) {
+        VersionSet* versions = &cfd->versions;
+        uint64_t number = versions->NewFileNumber();
+        sstable::SSTableWriter writer(TableFileName(cfd->path(), number),
+                                      cfd->options().table_options);
+        BlobFileBuilder blobs(cfd->path(), cfd->options(),
+                              [versions] { return versions->NewFileNumber(); });
+
+        Status s = writer.Open();
+        std::string blob_index;
+        std::unique_ptr<MemTable::Iterator> iter(mem->NewIterator());
+        for (iter->SeekToFirst(); s.ok() && iter->Valid(); iter->Next()) {
+            if (iter->Type() == ValueType::kValue && blobs.ShouldSeparate(iter->Value())) {
+                s = blobs.Add(iter->UserKey(), iter->Value(), &blob_index);
+                if (s.ok()) {
+                    s = writer.Add(iter->UserKey(), blob_index, iter->Sequence(),
+                                   ValueType::kBlobIndex);
+                }
+            } else {
+                s = writer.Add(iter->InternalKey(), iter->Value());
+            }
+        }
+
+        sstable::SSTableWriteStats stats;
+        if (s.ok()) s = blobs.Finish();
+        if (s.ok()) s = writer.Finish(&stats);
+        if (!s.ok()) {
+            writer.Abandon();
+            blobs.Abandon();
+            return s;
+        }
+
+        auto f = std::make_shared<FileMetaData>();
+        f->number = number;
+        f->file_size = stats.file_size;
+        f->smallest = stats.smallest_key;
+        f->largest = stats.largest_key;
+        f->min_sequence = stats.min_seq;
+        f->max_sequence = stats.max_seq;
+        f->num_entries = stats.num_entries;
+        f->num_deletions = stats.num_deletions;
+        edit->AddFile(0, std::move(f));
+        for (auto& b : blobs.ReleaseOutputs()) {
+            edit->AddBlobFile(std::move(b));
+        }
+        return Status::OK();
+    }
+
+    Status RunScheduledCompactions(ColumnFamilyData* cfd) {
+        while (!IsShuttingDown()) {
+            auto c = PickCompaction(cfd->options(), cfd->versions.current(),
+                                    &cfd->compact_pointers);
+            if (!c) break;
+            Status s = RunCompaction(cfd, *c, /*manual=*/false);
+            if (!s.ok()) return s;
+            {
+                // Let stalled writers re-check L0 between compactions
+                std::lock_guard<std::mutex> lock(mutex_);
+                bg_done_cv_.notify_all();
+            }
+            UpdateStallCondition(cfd);
+        }
+        return Status::OK();
+    }
+
+    // REQUIRES: bg_work_mutex_ held
+    Status RunCompaction(ColumnFamilyData* cfd, const Compaction& c, bool manual) {
+        VersionSet* versions = &cfd->versions;
+        CompactionJob job(cfd->path(), cfd->options(), &cfd->table_cache, &cfd->blob_cache, c,
+                          SmallestSnapshot(),
+                          [versions] { return versions->NewFileNumber(); });
+        StopWatch sw(stats_, kCompactionTime);
+        auto start = std::chrono::steady_clock::now();
+        Status s = job.Run();
+        sw.Stop();
+        auto micros = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        if (!s.ok()) {
+            for (const auto& f : job.outputs()) {
+                options_.env->DeleteFile(TableFileName(cfd->path(), f->number));
+            }
+            NotifyCompactionCompleted(cfd, c, job, manual, micros, s);
+            return s;
+        }
+
+        VersionEdit edit;
+        c.AddInputDeletions(&edit);
+        for (const auto& f : job.outputs()) {
+            edit.AddFile(c.output_level, f);
+        }
+        for (const auto& b : job.blob_outputs()) {
+            edit.AddBlobFile(b);
+        }
+        for (const auto& [number, garbage] : job.blob_garbage()) {
+            edit.AddBlobGarbage(number, garbage.count, garbage.bytes);
+        }
+
+        LevelCompactionStats compaction_stats;
+        compaction_stats.count = 1;
+        compaction_stats.micros = micros;
+        for (const auto& f : c.inputs[0]) compaction_stats.bytes_read_input += f->file_size;
+        for (const auto& f : c.inputs[1]) compaction_stats.bytes_read_output += f->file_size;
+        compaction_stats.bytes_written = job.stats().bytes_written + job.stats().blob_bytes_written;
+        compaction_stats.files_in = c.inputs[0].size() + c.inputs[1].size();
+        compaction_stats.files_out = job.outputs().size();
+        compaction_stats.keys_dropped = job.stats().entries_dropped;
+        cfd->internal_stats.AddCompactionStats(c.output_level, compaction_stats);
+        if (stats_) {
+            stats_->RecordTick(kCompactionCount);
+            stats_->RecordTick(kCompactionBytesRead, job.stats().bytes_read);
+            stats_->RecordTick(kCompactionBytesWritten, job.stats().bytes_written);
+            stats_->RecordTick(kCompactionKeysDropped, job.stats().entries_dropped);
+        }
+        s = versions->LogAndApply(edit);
+        NotifyCompactionCompleted(cfd, c, job, manual, micros, s);
+        return s;
+    }
+
+    void NotifyCompactionCompleted(ColumnFamilyData* cfd, const Compaction& c,
+                                   const CompactionJob& job, bool manual, uint64_t micros,
+                                   const Status& s) {
+        if (options_.listeners.empty()) return;
+        CompactionJobInfo info;
+        info.cf_name = cfd->name();
+        info.status = s;
+        info.base_input_level = c.level;
+        info.output_level = c.output_level;
+        info.manual = manual;
+        for (const auto& f : c.inputs[0]) {
+            info.input_files.push_back(f->number);
+            info.input_bytes_base_level += f->file_size;
+        }
+        for (const auto& f : c.inputs[1]) {
+            info.input_files.push_back(f->number);
+            info.input_bytes_output_level += f->file_size;
+        }
+        if (s.ok()) {
+            for (const auto& f : job.outputs()) info.output_files.push_back(f->number);
+        }
+        info.stats = job.stats();
+        info.micros = micros;
+        for (const auto& listener : options_.listeners) {
+            listener->OnCompactionCompleted(this, info);
+        }
+    }
+
+    SequenceNumber SmallestSnapshot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!snapshots_.empty()) return *snapshots_.begin();
+        return last_sequence_.load(std::memory_order_acquire);
+    }
+
+    // Delete table and blob files of cfd no live Version references, and
+    // stray temp files.
+    // REQUIRES: bg_work_mutex_ held (so no compaction outputs are in flight)
+    void DeleteObsoleteFiles(ColumnFamilyData* cfd) {
+        std::set<uint64_t> live = cfd->versions.LiveFiles();
+
+        std::vector<std::string> children;
+        if (!options_.env->GetChildren(cfd->path(), &children).ok()) return;
+        std::vector<std::string> to_delete;
+        for (const std::string& name : children) {
+            uint64_t number;
+            if (ParseTableFileName(name, &number)) {
+                if (live.count(number) == 0) {
+                    cfd->table_cache.Evict(number);
+                    to_delete.push_back(name);
+                }
+            } else if (ParseBlobFileName(name, &number)) {
+                if (live.count(number) == 0) {
+                    cfd->blob_cache.Evict(number);
+                    to_delete.push_back(name);
+                }
+            } else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0) {
+                to_delete.push_back(name);
+            }
+        }
+
+        for (const auto& name : to_delete) {
+            options_.env->DeleteFile(cfd->path() + "/" + name);
+        }
+    }
+
+    bool IsShuttingDown() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return shutting_down_;
+    }
+
+    const Options options_;
+    const std::string path_;
+    Statistics* const stats_;  // options_.statistics; may be null
+    Tracer tracer_;
+
+    std::unique_ptr<wal::WALManager> wal_;
+
+    // Last sequence number visible to reads; published after a write
+    // group is in the memtables
+    std::atomic<SequenceNumber> last_sequence_{0};
+
+    // Queue of pending writes; the front one leads the next write group
+    std::mutex writers_mutex_;
+    std::deque<Writer*> writers_;
+
+    // Held by the write group leader (and Flush) while it switches
+    // memtables, appends to the WAL and inserts
+    std::mutex write_mutex_;
+
+    // Serializes flushes, compactions (background thread, CompactRange) and
+    // column family creation
+    std::mutex bg_work_mutex_;
+    ColumnFamilyRegistry registry_;  // Guarded by bg_work_mutex_
+
+    // Guards the fields below
+    std::mutex mutex_;
+    std::condition_variable bg_cv_;       // Wakes the background thread
+    std::condition_variable bg_done_cv_;  // Signalled as background work completes
+    bool shutting_down_ = false;
+    bool bg_work_pending_ = false;
+    bool bg_running_ = false;
+    bool warmup_running_ = false;
+    uint64_t warmup_bytes_ = 0;  // Read into the block cache by the warm-up
+    Status bg_error_;
+    std::vector<WALRotationInfo> pending_wal_rotations_;  // For NotifyWALRotations
+    std::multiset<SequenceNumber> snapshots_;
+    std::vector<std::unique_ptr<ColumnFamilyData>> column_families_;
+    ColumnFamilyData* default_cf_ = nullptr;  // Set once at open
+
+    std::thread bg_thread_;
+    std::thread warmup_thread_;  // Block cache warm-up, see StartBlockCacheWarmup
+
+    const std::chrono::steady_clock::time_point open_time_;
+    std::atomic<uint64_t> stall_micros_{0};  // Writers blocked in MakeRoomForWrite
+};
+
+}  // namespace lsm
@@ -0,0 +1,350 @@
+// db/db_iter.h
+// User-facing iterator: collapses internal entries into live user keys
+
+#pragma once
+
+#include "util/types.h"
+#include "db/iterator.h"
+#include "sstable/sstable_format.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace lsm {
+
+// Called when a scan has stepped over `count` tombstones in [begin, end]
+using TombstoneScanCallback = std::function<void(Slice begin, Slice end, uint64_t count)>;
+
+// Reads the value a kBlobIndex entry refers to
+using BlobFetcher = std::function<Status(Slice user_key, Slice blob_index, std::string* value)>;
+
+// DBIter turns a merged stream of internal entries into the user view at a
+// snapshot: the newest visible version of each key, with deleted keys and
+// shadowed versions skipped.
+//
+// Forward: the internal iterator is positioned at the entry that yields
+// key()/value().
+// Reverse: the internal iterator is positioned just before all entries for
+// key(), whose value is held in saved_value_.
+//
+// Two things keep tombstone-heavy ranges cheap:
+//  - When more than kMaxSequentialSkips entries of one user key are stepped
+//    over, the iterator reseeks directly past that key.
+//  - Tombstones stepped over are counted; each time the count reaches the
+//    configured trigger, the callback reports the range so the DB can
+//    compact the tombstones away.
+//
+// Entries whose value lives in a blob file are resolved through the blob
+// fetcher when the iterator lands on them.
+class DBIter : public Iterator {
+public:
+    static constexpr int kMaxSequentialSkips = 8;
+
+    DBIter(std::unique_ptr<InternalIterator> iter, SequenceNumber snapshot,
+           const ReadOptions& read_options, uint64_t tombstone_trigger,
+           TombstoneScanCallback tombstone_callback,
+           std::shared_ptr<void> pinned_state = nullptr,
+           BlobFetcher blob_fetcher = nullptr)
+        : pinned_state_(std::move(pinned_state)),
+          iter_(std::move(iter)),
+          snapshot_(snapshot),
+          read_options_(read_options),
+          tombstone_trigger_(tombstone_trigger),
+          tombstone_callback_(std::move(tombstone_callback)),
+          blob_fetcher_(std::move(blob_fetcher)),
+          direction_(kForward),
+          valid_(false) {}
+
+    DBIter(const DBIter&) = delete;
+    DBIter& operator=(const DBIter&) = delete;
+
+    bool Valid() const override { return valid_; }
+
+    Slice key() const override {
+        return direction_ == kForward ? sstable::ExtractUserKey(iter_->key())
+                                      : Slice(saved_key_);
+    }
+
+    Slice value() const override {
+        if (direction_ == kReverse) return saved_value_;
+        return is_blob_ ? Slice(blob_value_) : iter_->value();
+    }
+
+    Status status() const override {
+        if (!status_.ok()) return status_;
+        return iter_->status();
+    }
+
+    void SeekToFirst() override {
+        if (read_options_.iterate_lower_bound) {
+            Seek(*read_options_.iterate_lower_bound);
+            return;
+        }
+        direction_ = kForward;
+        ClearSavedValue();
+        iter_->SeekToFirst();
+        if (iter_->Valid()) {
+            FindNextUserEntry(false, &saved_key_);
+        } else {
+            valid_ = false;
+        }
+        MaybeReportTombstones();
+    }
+
+    void SeekToLast() override {
+        direction_ = kReverse;
+        ClearSavedValue();
+        if (read_options_.iterate_upper_bound) {
+            // Land on the last entry below the upper bound
+            iter_->Seek(sstable::EncodeSeekKey(*read_options_.iterate_upper_bound,
+                                               kMaxSequenceNumber));
+            if (iter_->Valid()) {
+                iter_->Prev();
+            } else {
+                iter_->SeekToLast();
+            }
+        } else {
+            iter_->SeekToLast();
+        }
+        FindPrevUserEntry();
+        MaybeReportTombstones();
+    }
+
+    void Seek(Slice target) override {
+        if (read_options_.BelowLowerBound(target)) {
+            target = *read_options_.iterate_lower_bound;
+        }
+        direction_ = kForward;
+        ClearSavedValue();
+        saved_key_.clear();
+        iter_->Seek(sstable::EncodeSeekKey(target, snapshot_));
+        if (iter_->Valid()) {
+            FindNextUserEntry(false, &saved_key_);
+        } else {
+            valid_ = false;
+        }
+        MaybeReportTombstones();
+    }
+
+    void Next() override {
+        if (direction_ == kReverse) {
+            direction_ = kForward;
+            // iter_ is before all entries for key(); move onto them so the
+            // skip below steps past them
+            if (!iter_->Valid()) {
+                iter_->SeekToFirst();
+            } else {
+                iter_->Next();
+            }
+            if (!iter_->Valid()) {
+                valid_ = false;
+                saved_key_.clear();
+                return;
+            }
+            // saved_key_ already holds the current key
+        } else {
+            saved_key_.assign(sstable::ExtractUserKey(iter_->key()));
+            iter_->Next();
+            if (!iter_->Valid()) {
+                valid_ = false;
+                saved_key_.clear();
+                return;
+            }
+        }
+        FindNextUserEntry(true, &saved_key_);
+        MaybeReportTombstones();
+    }
+
+    void Prev() override {
+        if (direction_ == kForward) {
+            // iter_ is at the current entry; back up before all of its key
+            saved_key_.assign(sstable::ExtractUserKey(iter_->key()));
+            while (true) {
+                iter_->Prev();
+                if (!iter_->Valid()) {
+                    valid_ = false;
+                    saved_key_.clear();
+                    ClearSavedValue();
+                    return;
+                }
+                if (sstable::ExtractUserKey(iter_->key()) < Slice(saved_key_)) {
+                    break;
+                }
+            }
+            direction_ = kReverse;
+        }
+        FindPrevUserEntry();
+        MaybeReportTombstones();
+    }
+
+    // Tombstones stepped over since creation, for tests and statistics
+    uint64_t TombstonesSkipped() const { return total_tombstones_; }
+
+private:
+    enum Direction { kForward, kReverse };
+
+    bool ParseKey(sstable::ParsedInternalKey* ikey) {
+        if (!sstable::ParseInternalKey(iter_->key(), ikey)) {
+            status_ = Status::Corruption("Corrupted internal key in DBIter");
+            return false;
+        }
+        return true;
+    }
+
+    // Advance to the next visible, non-deleted entry. If skipping, entries
+    // for user keys <= *skip are hidden.
+    void FindNextUserEntry(bool skipping, std::string* skip) {
+        int num_skipped = 0;
+        while (iter_->Valid()) {
+            sstable::ParsedInternalKey ikey;
+            if (!ParseKey(&ikey)) break;
+
+            if (ikey.sequence <= snapshot_) {
+                if (read_options_.AtOrAboveUpperBound(ikey.user_key)) {
+                    break;
+                }
+                if (ikey.type == ValueType::kDeletion) {
+                    // Hide all older entries for this key
+                    skip->assign(ikey.user_key);
+                    skipping = true;
+                    num_skipped = 0;
+                    RecordTombstone(ikey.user_key);
+                } else if (skipping && ikey.user_key <= Slice(*skip)) {
+                    // Shadowed by a newer entry; if there are many, jump
+                    // straight past the key instead of walking them all
+                    if (++num_skipped > kMaxSequentialSkips) {
+                        num_skipped = 0;
+                        iter_->Seek(sstable::EncodeSeekKey(*skip, 0));
+                        continue;
+                    }
+                } else {
+                    is_blob_ = ikey.type == ValueType::kBlobIndex;
+                    if (is_blob_ && !FetchBlob(ikey.user_key, iter_->value(), &blob_value_)) {
+                        break;
+                    }
+                    valid_ = true;
+                    saved_key_.clear();
+                    return;
+                }
+            }
+            iter_->Next();
+        }
+        saved_key_.clear();
+        valid_ = false;
+    }
+
+    // Step backward over the entries before iter_ until a complete user key
+    // with a live value has been collected into saved_key_/saved_value_
+    void FindPrevUserEntry() {
+        ValueType value_type = ValueType::kDeletion;
+        while (iter_->Valid()) {
+            sstable::ParsedInternalKey ikey;
+            if (!ParseKey(&ikey)) break;
+
+            if (ikey.sequence <= snapshot_) {
+                if (value_type != ValueType::kDeletion &&
+                    ikey.user_key < Slice(saved_key_)) {
+                    // Reached the previous user key; saved_key_ is complete
+                    break;
+                }
+                if (read_options_.BelowLowerBound(ikey.user_key)) {
+                    break;
+                }
+                value_type = ikey.type;
+                if (value_type == ValueType::kDeletion) {
+                    saved_key_.clear();
+                    ClearSavedValue();
+                    RecordTombstone(ikey.user_key);
+                } else {
+                    saved_key_.assign(ikey.user_key);
+                    saved_value_.assign(iter_->value());
+                }
+            }
+            iter_->Prev();
+        }
+
+        if (value_type == ValueType::kBlobIndex) {
+            std::string blob_index = saved_value_;
+            if (!FetchBlob(saved_key_, blob_index, &saved_value_)) {
+                value_type = ValueType::kDeletion;
+            }
+        }
+
+        if (value_type == ValueType::kDeletion) {
+            valid_ = false;
+            saved_key_.clear();
+            ClearSavedValue();
+            direction_ = kForward;
+        } else {
+            valid_ = true;
+        }
+    }
+
+    // Read the value behind a blob reference; on failure the iterator
+    // becomes invalid with the error in status()
+    bool FetchBlob(Slice user_key, Slice blob_index, std::string* value) {
+        Status s = blob_fetcher_
+            ? blob_fetcher_(user_key, blob_index, value)
+            : Status::NotSupported("Blob reference without blob files");
+        if (!s.ok()) {
+            status_ = s;
+            return false;
+        }
+        return true;
+    }
+
+    void ClearSavedValue() {
+        if (saved_value_.capacity() > 1024 * 1024) {
+            std::string empty;
+            std::swap(empty, saved_value_);
+        } else {
+            saved_value_.clear();
+        }
+    }
+
+    void RecordTombstone(Slice user_key) {
+        total_tombstones_++;
+        if (tombstone_trigger_ == 0 || !tombstone_callback_) return;
+        if (tombstone_count_ == 0) {
+            tombstone_begin_.assign(user_key);
+            tombstone_end_.assign(user_key);
+        } else if (user_key < Slice(tombstone_begin_)) {
+            tombstone_begin_.assign(user_key);
+        } else if (user_key > Slice(tombstone_end_)) {
+            tombstone_end_.assign(user_key);
+        }
+        tombstone_count_++;
+    }
+
+    void MaybeReportTombstones() {
+        if (tombstone_trigger_ == 0 || tombstone_count_ < tombstone_trigger_) return;
+        tombstone_callback_(tombstone_begin_, tombstone_end_, tombstone_count_);
+        tombstone_count_ = 0;
+    }
+
+    // Declared first so that it is released after iter_
+    std::shared_ptr<void> pinned_state_;
+    std::unique_ptr<InternalIterator> iter_;
+
+    SequenceNumber snapshot_;
+    ReadOptions read_options_;
+    Status status_;
+
+    uint64_t tombstone_trigger_;
+    TombstoneScanCallback tombstone_callback_;
+    BlobFetcher blob_fetcher_;
+    uint64_t tombstone_count_ = 0;
+    uint64_t total_tombstones_ = 0;
+    std::string tombstone_begin_;
+    std::string tombstone_end_;
+
+    Direction direction_;
+    bool valid_;
+    std::string saved_key_;    // == current key when direction_ == kReverse
+    std::string saved_value_;  // == current value when direction_ == kReverse
+    bool is_blob_ = false;     // Forward: value() is blob_value_
+    std::string blob_value_;
+};
+
+}  // namespace lsm
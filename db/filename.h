@@ -0,0 +1,88 @@
+// db/filename.h
+// File naming for database directories
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace lsm {
+
+// <db>/000123.sst
+inline std::string TableFileName(const std::string& db_path, uint64_t number) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "/%06llu.sst", static_cast<unsigned long long>(number));
+    return db_path + buf;
+}
+
+// <db>/000123.blob: values separated from the LSM tree
+inline std::string BlobFileName(const std::string& db_path, uint64_t number) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "/%06llu.blob", static_cast<unsigned long long>(number));
+    return db_path + buf;
+}
+
+// <db>/MANIFEST: current set of live files, replaced atomically
+inline std::string ManifestFileName(const std::string& db_path) {
+    return db_path + "/MANIFEST";
+}
+
+// <db>/COLUMN_FAMILIES: ids and names of the non-default column families
+inline std::string ColumnFamiliesFileName(const std::string& db_path) {
+    return db_path + "/COLUMN_FAMILIES";
+}
+
+// <db>/cf000001: tables, blobs and MANIFEST of a non-default column family.
+// The default family (id 0) lives in <db> itself.
+inline std::string ColumnFamilyDirName(const std::string& db_path, uint32_t id) {
+    if (id == 0) return db_path;
+    char buf[32];
+    snprintf(buf, sizeof(buf), "/cf%06u", static_cast<unsigned>(id));
+    return db_path + buf;
+}
+
+// <db>/LOG: periodic statistics dumps (Options::stats_dump_period_sec)
+inline std::string InfoLogFileName(const std::string& db_path) {
+    return db_path + "/LOG";
+}
+
+// <db>/BLOCK_CACHE_WARMUP: hot blocks to reload at open
+// (Options::block_cache_dump_period_sec)
+inline std::string BlockCacheWarmupFileName(const std::string& db_path) {
+    return db_path + "/BLOCK_CACHE_WARMUP";
+}
+
+inline std::string TempFileName(const std::string& db_path, uint64_t number) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "/%06llu.tmp", static_cast<unsigned long long>(number));
+    return db_path + buf;
+}
+
+// Parse "<digits><suffix>" into its number. Returns false for any other name.
+inline bool ParseNumberedFileName(const std::string& name, const std::string& suffix,
+                                  uint64_t* number) {
+    if (name.size() <= suffix.size() ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    std::string digits = name.substr(0, name.size() - suffix.size());
+    for (char c : digits) {
+        if (c < '0' || c > '9') return false;
+    }
+    *number = std::strtoull(digits.c_str(), nullptr, 10);
+    return true;
+}
+
+// Parse "000123.sst" into 123
+inline bool ParseTableFileName(const std::string& name, uint64_t* number) {
+    return ParseNumberedFileName(name, ".sst", number);
+}
+
+// Parse "000123.blob" into 123
+inline bool ParseBlobFileName(const std::string& name, uint64_t* number) {
+    return ParseNumberedFileName(name, ".blob", number);
+}
+
+}  // namespace lsm
@@ -0,0 +1,201 @@
+// db/internal_stats.h
+// Per-level I/O accounting for write, read and space amplification
+
+#pragma once
+
+#include "util/types.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lsm {
+
+// Work done by the flushes (level 0) or compactions writing into one level
+struct LevelCompactionStats {
+    uint64_t count = 0;                // Flushes or compactions
+    uint64_t micros = 0;
+    uint64_t bytes_read_input = 0;     // Read from the level above ("Rn")
+    uint64_t bytes_read_output = 0;    // Read from this level ("Rnp1")
+    uint64_t bytes_written = 0;        // Tables and blob values written
+    uint64_t files_in = 0;
+    uint64_t files_out = 0;
+    uint64_t keys_dropped = 0;
+
+    void Add(const LevelCompactionStats& other) {
+        count += other.count;
+        micros += other.micros;
+        bytes_read_input += other.bytes_read_input;
+        bytes_read_output += other.bytes_read_output;
+        bytes_written += other.bytes_written;
+        files_in += other.files_in;
+        files_out += other.files_out;
+        keys_dropped += other.keys_dropped;
+    }
+};
+
+// Shape of one level in the current Version, for DumpLevels
+struct LevelSummary {
+    int files = 0;
+    uint64_t bytes = 0;
+    uint64_t live_bytes = 0;  // Estimate; see Version::EstimateLiveBytes
+};
+
+// Counters of one column family since the DB was opened: bytes users
+// wrote, what flushes and compactions read and wrote at each level, and
+// the table bytes Gets read from each level. Together with the level sizes
+// these give the write, read and space amplification of the family.
+//
+// Compaction stats are added once per job under a mutex. The write and Get
+// counters are relaxed atomics: user bytes are added by the write-group
+// leader only, and Get bytes only on a block cache miss.
+class InternalStats {
+public:
+    explicit InternalStats(int num_levels)
+        : num_levels_(num_levels),
+          compaction_stats_(static_cast<size_t>(num_levels)),
+          get_bytes_read_(new std::atomic<uint64_t>[static_cast<size_t>(num_levels)]) {
+        for (int level = 0; level < num_levels; level++) get_bytes_read_[level] = 0;
+    }
+
+    InternalStats(const InternalStats&) = delete;
+    InternalStats& operator=(const InternalStats&) = delete;
+
+    int num_levels() const { return num_levels_; }
+
+    void AddUserBytesWritten(uint64_t bytes) {
+        user_bytes_written_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    uint64_t user_bytes_written() const {
+        return user_bytes_written_.load(std::memory_order_relaxed);
+    }
+
+    void AddCompactionStats(int level, const LevelCompactionStats& stats) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        compaction_stats_[static_cast<size_t>(level)].Add(stats);
+    }
+
+    LevelCompactionStats GetCompactionStats(int level) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return compaction_stats_[static_cast<size_t>(level)];
+    }
+
+    void AddGetBytesRead(int level, uint64_t bytes) {
+        get_bytes_read_[level].fetch_add(bytes, std::memory_order_relaxed);
+    }
+    uint64_t get_bytes_read(int level) const {
+        return get_bytes_read_[level].load(std::memory_order_relaxed);
+    }
+
+    // Bytes flushes and compactions wrote, over user bytes written.
+    // Excludes the WAL, which the DB shares between families.
+    double WriteAmplification() const {
+        uint64_t user = user_bytes_written();
+        if (user == 0) return 0;
+        uint64_t written = 0;
+        for (int level = 0; level < num_levels_; level++) {
+            written += GetCompactionStats(level).bytes_written;
+        }
+        return static_cast<double>(written) / static_cast<double>(user);
+    }
+
+    // Per-level table followed by totals and amplification figures
+    std::string DumpLevels(const std::vector<LevelSummary>& levels) const {
+        std::string r;
+        char buf[256];
+        std::snprintf(buf, sizeof(buf),
+                      "Level Files  Size(MB)  Live(MB) Comp(cnt) Comp(sec)    Rn(MB)"
+                      "  Rnp1(MB) Write(MB)  W-Amp  KeyDrop GetRead(MB)\n");
+        r.append(buf);
+        LevelCompactionStats total;
+        LevelSummary total_shape;
+        uint64_t total_get_read = 0;
+        for (int level = 0; level < num_levels_; level++) {
+            LevelCompactionStats c = GetCompactionStats(level);
+            LevelSummary shape = static_cast<size_t>(level) < levels.size()
+                                     ? levels[static_cast<size_t>(level)]
+                                     : LevelSummary();
+            uint64_t get_read = get_bytes_read(level);
+            if (shape.files == 0 && c.count == 0 && get_read == 0) continue;
+            AppendRow(&r, ("L" + std::to_string(level)).c_str(), shape, c,
+                      LevelWriteAmp(level, c), get_read);
+            total.Add(c);
+            total_shape.files += shape.files;
+            total_shape.bytes += shape.bytes;
+            total_shape.live_bytes += shape.live_bytes;
+            total_get_read += get_read;
+        }
+        double user = static_cast<double>(user_bytes_written());
+        AppendRow(&r, "Sum", total_shape, total,
+                  user > 0 ? static_cast<double>(total.bytes_written) / user : 0,
+                  total_get_read);
+
+        std::snprintf(buf, sizeof(buf),
+                      "User writes: %.2f MB, flushed %.2f MB, compacted %.2f MB\n",
+                      user / kMB, static_cast<double>(GetCompactionStats(0).bytes_written) / kMB,
+                      static_cast<double>(total.bytes_written -
+                                          GetCompactionStats(0).bytes_written) / kMB);
+        r.append(buf);
+        std::snprintf(buf, sizeof(buf),
+                      "Write amplification: %.2f (flush and compaction bytes per user byte)\n",
+                      user > 0 ? static_cast<double>(total.bytes_written) / user : 0);
+        r.append(buf);
+        std::snprintf(buf, sizeof(buf),
+                      "Space amplification: %.2f (%.2f MB in tables, %.2f MB estimated live)\n",
+                      total_shape.live_bytes > 0
+                          ? static_cast<double>(total_shape.bytes) /
+                                static_cast<double>(total_shape.live_bytes)
+                          : 0,
+                      static_cast<double>(total_shape.bytes) / kMB,
+                      static_cast<double>(total_shape.live_bytes) / kMB);
+        r.append(buf);
+        std::snprintf(buf, sizeof(buf),
+                      "Compaction reads: %.2f MB; Get reads: %.2f MB from tables\n",
+                      static_cast<double>(total.bytes_read_input + total.bytes_read_output) / kMB,
+                      static_cast<double>(total_get_read) / kMB);
+        r.append(buf);
+        return r;
+    }
+
+private:
+    static constexpr double kMB = 1048576.0;
+
+    // Bytes written into a level per byte moved in from the level above.
+    // Level 0 is written by flushes, which read no tables.
+    static double LevelWriteAmp(int level, const LevelCompactionStats& c) {
+        if (level == 0) return c.bytes_written > 0 ? 1.0 : 0;
+        if (c.bytes_read_input == 0) return 0;
+        return static_cast<double>(c.bytes_written) / static_cast<double>(c.bytes_read_input);
+    }
+
+    static void AppendRow(std::string* r, const char* name, const LevelSummary& shape,
+                          const LevelCompactionStats& c, double w_amp, uint64_t get_read) {
+        char buf[256];
+        std::snprintf(buf, sizeof(buf),
+                      "%-5s %5d %9.2f %9.2f %9llu %9.3f %9.2f %9.2f %9.2f %6.2f %8llu %11.2f\n",
+                      name, shape.files, static_cast<double>(shape.bytes) / kMB,
+                      static_cast<double>(shape.live_bytes) / kMB,
+                      static_cast<unsigned long long>(c.count),
+                      static_cast<double>(c.micros) / 1e6,
+                      static_cast<double>(c.bytes_read_input) / kMB,
+                      static_cast<double>(c.bytes_read_output) / kMB,
+                      static_cast<double>(c.bytes_written) / kMB, w_amp,
+                      static_cast<unsigned long long>(c.keys_dropped),
+                      static_cast<double>(get_read) / kMB);
+        r->append(buf);
+    }
+
+    const int num_levels_;
+    std::atomic<uint64_t> user_bytes_written_{0};
+
+    mutable std::mutex mutex_;
+    std::vector<LevelCompactionStats> compaction_stats_;  // Guarded by mutex_
+
+    std::unique_ptr<std::atomic<uint64_t>[]> get_bytes_read_;
+};
+
+}  // namespace lsm
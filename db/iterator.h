@@ -0,0 +1,139 @@
+// db/iterator.h
+// Iterator interfaces and adapters over memtables and SSTables
+
+#pragma once
+
+#include "util/types.h"
+#include "db/memtable.h"
+#include "sstable/sstable_format.h"
+#include "sstable/sstable_reader.h"
+
+#include <memory>
+#include <string>
+
+namespace lsm {
+
+// User-facing iterator: keys are user keys, only live values are visible
+class Iterator {
+public:
+    virtual ~Iterator() = default;
+
+    virtual bool Valid() const = 0;
+    virtual void SeekToFirst() = 0;
+    virtual void SeekToLast() = 0;
+    virtual void Seek(Slice target) = 0;
+    virtual void Next() = 0;
+    virtual void Prev() = 0;
+    virtual Slice key() const = 0;
+    virtual Slice value() const = 0;
+    virtual Status status() const = 0;
+};
+
+// Iterator over encoded internal keys (user_key | seq/type trailer), used to
+// merge memtables and SSTables
+class InternalIterator {
+public:
+    virtual ~InternalIterator() = default;
+
+    virtual bool Valid() const = 0;
+    virtual void SeekToFirst() = 0;
+    virtual void SeekToLast() = 0;
+    virtual void Seek(Slice target) = 0;  // First entry with key >= target
+    virtual void Next() = 0;
+    virtual void Prev() = 0;
+    virtual Slice key() const = 0;
+    virtual Slice value() const = 0;
+    virtual Status status() const = 0;
+};
+
+// Exposes a memtable as an InternalIterator; holds a reference on the
+// memtable for the iterator's lifetime
+class MemTableInternalIterator : public InternalIterator {
+public:
+    explicit MemTableInternalIterator(MemTable* mem)
+        : mem_(mem), iter_(mem) {
+        mem_->Ref();
+    }
+
+    ~MemTableInternalIterator() override {
+        mem_->Unref();
+    }
+
+    bool Valid() const override { return iter_.Valid(); }
+    void SeekToFirst() override { iter_.SeekToFirst(); Update(); }
+    void SeekToLast() override { iter_.SeekToLast(); Update(); }
+
+    void Seek(Slice target) override {
+        sstable::ParsedInternalKey parsed;
+        if (!sstable::ParseInternalKey(target, &parsed)) {
+            parsed.user_key = target;
+            parsed.sequence = sstable::kMaxInternalSequence;
+        }
+        iter_.Seek(InternalKey(parsed.user_key, parsed.sequence, parsed.type));
+        Update();
+    }
+
+    void Next() override { iter_.Next(); Update(); }
+    void Prev() override { iter_.Prev(); Update(); }
+
+    Slice key() const override { return key_; }
+    Slice value() const override { return iter_.Value(); }
+    Status status() const override { return Status::OK(); }
+
+private:
+    void Update() {
+        key_.clear();
+        if (iter_.Valid()) {
+            sstable::AppendInternalKey(&key_, iter_.UserKey(), iter_.Sequence(), iter_.Type());
+        }
+    }
+
+    MemTable* mem_;
+    MemTable::Iterator iter_;
+    std::string key_;
+};
+
+// Exposes an SSTable iterator as an InternalIterator; shares ownership of
+// the table so a table cache eviction cannot close it mid-scan
+class TableInternalIterator : public InternalIterator {
+public:
+    TableInternalIterator(std::shared_ptr<sstable::SSTableReader> table,
+                          const ReadOptions& read_options)
+        : table_(std::move(table)),
+          iter_(table_->NewIterator(read_options)) {}
+
+    bool Valid() const override { return iter_->Valid(); }
+    void SeekToFirst() override { iter_->SeekToFirst(); }
+    void SeekToLast() override { iter_->SeekToLast(); }
+    void Seek(Slice target) override { iter_->Seek(target); }
+    void Next() override { iter_->Next(); }
+    void Prev() override { iter_->Prev(); }
+    Slice key() const override { return iter_->key(); }
+    Slice value() const override { return iter_->value(); }
+    Status status() const override { return iter_->status(); }
+
+private:
+    std::shared_ptr<sstable::SSTableReader> table_;
+    std::unique_ptr<sstable::SSTableReader::Iterator> iter_;
+};
+
+// Iterator over nothing, optionally carrying an error
+class EmptyInternalIterator : public InternalIterator {
+public:
+    explicit EmptyInternalIterator(Status s = Status::OK()) : status_(std::move(s)) {}
+
+    bool Valid() const override { return false; }
+    void SeekToFirst() override {}
+    void SeekToLast() override {}
+    void Seek(Slice) override {}
+    void Next() override {}
+    void Prev() override {}
+    Slice key() const override { return Slice(); }
+    Slice value() const override { return Slice(); }
+    Status status() const override { return status_; }
+
+private:
+    Status status_;
+};
+
+}  // namespace lsm
@@ -0,0 +1,106 @@
+// db/listener.h
+// Callbacks for flushes, compactions, write stalls, WAL rotations and
+// background errors
+
+#pragma once
+
+#include "util/types.h"
+#include "db/compaction.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lsm {
+
+class DB;
+
+// A memtable flush of one column family
+struct FlushJobInfo {
+    std::string cf_name;
+    uint64_t num_entries = 0;           // Entries in the memtable
+    SequenceNumber smallest_seqno = 0;
+    SequenceNumber largest_seqno = 0;
+
+    // Set for OnFlushCompleted; file_number is 0 for an empty memtable
+    uint64_t file_number = 0;
+    std::string file_path;
+    uint64_t file_size = 0;
+    uint64_t blob_bytes = 0;            // Values written to blob files
+    uint64_t micros = 0;
+};
+
+// A finished (or failed) compaction of one column family
+struct CompactionJobInfo {
+    std::string cf_name;
+    Status status;
+    int base_input_level = 0;
+    int output_level = 0;
+    bool manual = false;                // Run by CompactRange
+    std::vector<uint64_t> input_files;  // File numbers
+    std::vector<uint64_t> output_files;
+    uint64_t input_bytes_base_level = 0;    // Read from base_input_level
+    uint64_t input_bytes_output_level = 0;  // Read from output_level
+    CompactionStats stats;              // Bytes and entries read, written and dropped
+    uint64_t micros = 0;
+};
+
+// Writers block when a column family's active memtable is full and either
+// max_write_buffer_number memtables or level0_stop_writes_trigger L0 files
+// are waiting for the background thread
+enum class WriteStallCondition {
+    kNormal,
+    kStopped,
+};
+
+enum class WriteStallCause {
+    kNone,
+    kMemtableLimit,
+    kL0FileCountLimit,
+    kWriteBufferManager,  // Memtable memory budget spent; waiting on a flush
+};
+
+struct WriteStallInfo {
+    std::string cf_name;
+    WriteStallCondition cur = WriteStallCondition::kNormal;
+    WriteStallCondition prev = WriteStallCondition::kNormal;
+    WriteStallCause cause = WriteStallCause::kNone;  // For kStopped
+};
+
+// The DB started a new WAL because cf_name switched memtables
+struct WALRotationInfo {
+    std::string cf_name;
+    uint64_t old_log_number = 0;
+    uint64_t new_log_number = 0;
+};
+
+enum class BackgroundErrorReason {
+    kFlush,
+    kCompaction,
+};
+
+// Receives DB events; set Options::listeners. Every callback has a no-op
+// default.
+//
+// Callbacks run on the thread doing the work: the background thread, or a
+// caller of Flush/CompactRange. Events raised on the write path (WAL
+// rotations, stalls) are queued and delivered by the background thread, so
+// writers never run listener code. Background work is paused while a
+// callback runs, so keep callbacks short and do not call Flush,
+// CompactRange, CreateColumnFamily, or writes that could stall, from them.
+class EventListener {
+public:
+    virtual ~EventListener() = default;
+
+    virtual void OnFlushBegin(DB* /*db*/, const FlushJobInfo& /*info*/) {}
+    virtual void OnFlushCompleted(DB* /*db*/, const FlushJobInfo& /*info*/) {}
+    virtual void OnCompactionCompleted(DB* /*db*/, const CompactionJobInfo& /*info*/) {}
+    virtual void OnStallConditionsChanged(const WriteStallInfo& /*info*/) {}
+    virtual void OnWALRotated(const WALRotationInfo& /*info*/) {}
+
+    // The DB stopped background work after this error; writes fail with it
+    virtual void OnBackgroundError(BackgroundErrorReason /*reason*/,
+                                   const Status& /*bg_error*/) {}
+};
+
+}  // namespace lsm
@@ -5,9 +5,14 @@
 
 #include "util/types.h"
 #include "util/arena.h"
+#include "util/perf_context.h"
+#include "util/pinnable_slice.h"
+#include "db/write_buffer_manager.h"
 #include "memtable/skiplist.h"
+#include "memtable/dynamic_bloom.h"
 
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
 #include <string>
@@ -25,6 +30,7 @@ struct MemTableEntry {
 
 struct MemTableKeyComparator {
     int operator()(const MemTableEntry& a, const MemTableEntry& b) const {
+        PerfCounterAdd(&PerfContext::user_key_comparison_count);
         int r = a.internal_key.user_key.compare(b.internal_key.user_key);
         if (r != 0) return r;
         if (a.internal_key.sequence > b.internal_key.sequence) return -1;
@@ -43,14 +49,24 @@ public:
           approximate_memory_usage_(0),
           entry_count_(0),
           min_sequence_(kMaxSequenceNumber),
-          max_sequence_(0) {}
+          max_sequence_(0) {
+        if (options_.bloom_bits > 0) {
+            bloom_ = std::make_unique<DynamicBloom>(options_.bloom_bits);
+            if (options_.write_buffer_manager != nullptr) {
+                options_.write_buffer_manager->ReserveMem(bloom_->MemoryUsage());
+            }
+        }
+    }
 
-    void Ref() { ++refs_; }
+    void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
 
+    // Threads may drop references concurrently (e.g. a pinned value released
+    // while a flush drops the memtable), so only the decrement that took the
+    // count to zero deletes
     void Unref() {
-        --refs_;
-        assert(refs_ >= 0);
-        if (refs_ == 0) {
+        int prev = refs_.fetch_sub(1, std::memory_order_acq_rel);
+        assert(prev > 0);
+        if (prev == 1) {
             delete this;
         }
     }
@@ -64,6 +80,7 @@ public:
     }
 
     LookupResult Get(Slice key, SequenceNumber snapshot_seq) const {
+        if (!MayContain(key)) return LookupResult::NotFound();
         MemTableEntry lookup_key(InternalKey(key, snapshot_seq, ValueType::kValue), "");
 
         Table::Iterator iter(&table_);
@@ -82,6 +99,25 @@ public:
         return LookupResult::NotFound();
     }
 
+    // Zero-copy lookup: on kFound, *value points at the entry stored in
+    // this memtable and holds a reference that keeps the memtable alive
+    GetState Get(Slice key, SequenceNumber snapshot_seq, PinnableSlice* value) {
+        if (!MayContain(key)) return GetState::kNotFound;
+        MemTableEntry lookup_key(InternalKey(key, snapshot_seq, ValueType::kValue), "");
+
+        Table::Iterator iter(&table_);
+        iter.Seek(lookup_key);
+
+        if (!iter.Valid()) return GetState::kNotFound;
+        const MemTableEntry& entry = iter.key();
+        if (entry.internal_key.user_key != key) return GetState::kNotFound;
+        if (entry.internal_key.type == ValueType::kDeletion) return GetState::kDeleted;
+
+        Ref();
+        value->PinSlice(entry.value, [this] { Unref(); });
+        return GetState::kFound;
+    }
+
     size_t ApproximateMemoryUsage() const {
         return approximate_memory_usage_.load(std::memory_order_relaxed);
     }
@@ -109,7 +145,7 @@ public:
         bool Valid() const { return iter_.Valid(); }
         void SeekToFirst() { iter_.SeekToFirst(); }
         void SeekToLast() { iter_.SeekToLast(); }
-        void Seek(const InternalKey& target) {
+        void Seek(const lsm::InternalKey& target) {
             MemTableEntry entry(target, "");
             iter_.Seek(entry);
         }
@@ -121,7 +157,7 @@ public:
         ValueType Type() const { return iter_.key().internal_key.type; }
         Slice Value() const { return iter_.key().value; }
 
-        const InternalKey& InternalKey() const {
+        const lsm::InternalKey& InternalKey() const {
             return iter_.key().internal_key;
         }
 
@@ -134,18 +170,74 @@ public:
         return new Iterator(this);
     }
 
+    // Called once the memtable stops taking writes: the write buffer
+    // manager no longer counts its memory towards forcing flushes.
+    // REQUIRES: no concurrent Put or Delete
+    void MarkImmutable() {
+        if (options_.write_buffer_manager != nullptr && !free_scheduled_) {
+            options_.write_buffer_manager->ScheduleFreeMem(ChargedMemory());
+        }
+        free_scheduled_ = true;
+    }
+
 private:
-    ~MemTable() = default;
+    ~MemTable() {
+        if (options_.write_buffer_manager != nullptr) {
+            MarkImmutable();
+            options_.write_buffer_manager->FreeMem(ChargedMemory());
+        }
+    }
+
+    // Bytes reserved in options_.write_buffer_manager
+    size_t ChargedMemory() const {
+        return ApproximateMemoryUsage() + (bloom_ ? bloom_->MemoryUsage() : 0);
+    }
+
+    // False if this memtable holds no entry for key: it is outside the
+    // range of user keys added, or the bloom filter rules it out. Writes
+    // update both before they become visible to a snapshot, so a reader
+    // never skips a memtable holding an entry it could see.
+    bool MayContain(Slice key) const {
+        const MemTableEntry* smallest = smallest_.load(std::memory_order_acquire);
+        const MemTableEntry* largest = largest_.load(std::memory_order_acquire);
+        if (smallest == nullptr || key.compare(smallest->internal_key.user_key) < 0 ||
+            key.compare(largest->internal_key.user_key) > 0) {
+            PerfCounterAdd(&PerfContext::memtable_key_range_miss_count);
+            return false;
+        }
+        if (bloom_) {
+            PerfCounterAdd(&PerfContext::bloom_memtable_probe_count);
+            if (!bloom_->MayContain(key)) {
+                PerfCounterAdd(&PerfContext::bloom_memtable_miss_count);
+                return false;
+            }
+        }
+        return true;
+    }
 
     void Add(SequenceNumber seq, ValueType type, Slice key, Slice value) {
+        if (bloom_) bloom_->Add(key);
         MemTableEntry entry(InternalKey(key, seq, type), value);
-        table_.Insert(entry);
+        const MemTableEntry* stored = &table_.InsertWithHint(entry, &insert_hint_);
+
+        // Adds are serialized, so plain load-compare-store is enough
+        const MemTableEntry* smallest = smallest_.load(std::memory_order_relaxed);
+        if (smallest == nullptr || key.compare(smallest->internal_key.user_key) < 0) {
+            smallest_.store(stored, std::memory_order_release);
+        }
+        const MemTableEntry* largest = largest_.load(std::memory_order_relaxed);
+        if (largest == nullptr || key.compare(largest->internal_key.user_key) > 0) {
+            largest_.store(stored, std::memory_order_release);
+        }
 
         size_t entry_size = key.size() + value.size() +
                            sizeof(SequenceNumber) + sizeof(ValueType) +
                            sizeof(MemTableEntry);
         approximate_memory_usage_.fetch_add(entry_size, std::memory_order_relaxed);
         entry_count_.fetch_add(1, std::memory_order_relaxed);
+        if (options_.write_buffer_manager != nullptr) {
+            options_.write_buffer_manager->ReserveMem(entry_size);
+        }
 
         SequenceNumber expected = min_sequence_.load(std::memory_order_relaxed);
         while (seq < expected &&
@@ -163,11 +255,19 @@ private:
     MemTableOptions options_;
     std::unique_ptr<Arena> arena_;
     Table table_;
+    Table::InsertHint insert_hint_;  // Makes in-order (e.g. time-ordered) keys O(1) to add
     std::atomic<int> refs_;
+    bool free_scheduled_ = false;  // Set by MarkImmutable
     std::atomic<size_t> approximate_memory_usage_;
     std::atomic<size_t> entry_count_;
     std::atomic<SequenceNumber> min_sequence_;
     std::atomic<SequenceNumber> max_sequence_;
+
+    // Entries with the smallest and largest user keys (null while empty);
+    // they live in table_, so they stay valid as long as the memtable
+    std::atomic<const MemTableEntry*> smallest_{nullptr};
+    std::atomic<const MemTableEntry*> largest_{nullptr};
+    std::unique_ptr<DynamicBloom> bloom_;  // Null unless options_.bloom_bits > 0
 };
 
 }  // namespace lsm
\ No newline at end of file
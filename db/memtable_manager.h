@@ -52,6 +52,27 @@ public:
         return Write(ValueType::kDeletion, key, Slice(), rotated);
     }
 
+    // Insert with a sequence number assigned by the caller, e.g. one shared
+    // by several managers. The manager's own sequence moves past seq.
+    // Never rotates; the caller decides when to call ForceRotation().
+    // REQUIRES: calls to Add are serialized (readers may run concurrently)
+    Status Add(SequenceNumber seq, ValueType type, Slice key, Slice value) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (type == ValueType::kValue) {
+            active_->Put(seq, key, value);
+        } else {
+            active_->Delete(seq, key);
+        }
+        total_memory_usage_.fetch_add(key.size() + value.size() + 32,
+                                      std::memory_order_relaxed);
+
+        SequenceNumber next = current_sequence_.load(std::memory_order_relaxed);
+        while (seq + 1 > next &&
+               !current_sequence_.compare_exchange_weak(next, seq + 1,
+                   std::memory_order_acq_rel));
+        return Status::OK();
+    }
+
     LookupResult Get(Slice key) const {
         SequenceNumber snapshot = current_sequence_.load(std::memory_order_acquire);
         return Get(key, snapshot);
@@ -120,6 +141,11 @@ public:
         return current_sequence_.fetch_add(1, std::memory_order_acq_rel);
     }
 
+    // Set the next sequence number to allocate (used after recovery)
+    void SetSequence(SequenceNumber next) {
+        current_sequence_.store(next, std::memory_order_release);
+    }
+
     size_t TotalMemoryUsage() const {
         return total_memory_usage_.load(std::memory_order_relaxed);
     }
@@ -194,6 +220,7 @@ private:
 
     Status RotateLocked() {
         MemTable* imm = active_;
+        imm->MarkImmutable();
         immutables_.push_back(imm);
         immutable_count_.fetch_add(1, std::memory_order_relaxed);
 
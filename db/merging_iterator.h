@@ -0,0 +1,128 @@
+// db/merging_iterator.h
+// Merges several sorted internal iterators into one sorted stream
+
+#pragma once
+
+#include "util/types.h"
+#include "db/iterator.h"
+#include "sstable/sstable_format.h"
+
+#include <memory>
+#include <vector>
+
+namespace lsm {
+
+// MergingIterator yields the union of its children in internal key order.
+// Entries with equal keys (the same write seen in a memtable and in the
+// SSTable it was just flushed to) are all returned; DBIter collapses them.
+//
+// Children are few (memtables + L0 files + one per level), so a linear scan
+// for the smallest/largest child is cheaper than maintaining a heap.
+class MergingIterator : public InternalIterator {
+public:
+    explicit MergingIterator(std::vector<std::unique_ptr<InternalIterator>> children)
+        : children_(std::move(children)), current_(nullptr), direction_(kForward) {}
+
+    bool Valid() const override { return current_ != nullptr; }
+
+    void SeekToFirst() override {
+        for (auto& child : children_) child->SeekToFirst();
+        FindSmallest();
+        direction_ = kForward;
+    }
+
+    void SeekToLast() override {
+        for (auto& child : children_) child->SeekToLast();
+        FindLargest();
+        direction_ = kReverse;
+    }
+
+    void Seek(Slice target) override {
+        for (auto& child : children_) child->Seek(target);
+        FindSmallest();
+        direction_ = kForward;
+    }
+
+    void Next() override {
+        // Ensure that all children are positioned after key(). If we are
+        // moving forward, that already holds for every non-current child.
+        if (direction_ != kForward) {
+            std::string saved(key());
+            for (auto& child : children_) {
+                if (child.get() == current_) continue;
+                child->Seek(saved);
+                if (child->Valid() && sstable::CompareInternalKeys(saved, child->key()) == 0) {
+                    child->Next();
+                }
+            }
+            direction_ = kForward;
+        }
+        current_->Next();
+        FindSmallest();
+    }
+
+    void Prev() override {
+        // Ensure that all children are positioned before key()
+        if (direction_ != kReverse) {
+            std::string saved(key());
+            for (auto& child : children_) {
+                if (child.get() == current_) continue;
+                child->Seek(saved);
+                if (child->Valid()) {
+                    // Child is at first entry >= key(); step back one
+                    child->Prev();
+                } else {
+                    // Child has no entries >= key(); position at last entry
+                    child->SeekToLast();
+                }
+            }
+            direction_ = kReverse;
+        }
+        current_->Prev();
+        FindLargest();
+    }
+
+    Slice key() const override { return current_->key(); }
+    Slice value() const override { return current_->value(); }
+
+    Status status() const override {
+        for (const auto& child : children_) {
+            Status s = child->status();
+            if (!s.ok()) return s;
+        }
+        return Status::OK();
+    }
+
+private:
+    enum Direction { kForward, kReverse };
+
+    void FindSmallest() {
+        InternalIterator* smallest = nullptr;
+        for (auto& child : children_) {
+            if (!child->Valid()) continue;
+            if (smallest == nullptr ||
+                sstable::CompareInternalKeys(child->key(), smallest->key()) < 0) {
+                smallest = child.get();
+            }
+        }
+        current_ = smallest;
+    }
+
+    void FindLargest() {
+        InternalIterator* largest = nullptr;
+        for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
+            if (!(*it)->Valid()) continue;
+            if (largest == nullptr ||
+                sstable::CompareInternalKeys((*it)->key(), largest->key()) > 0) {
+                largest = it->get();
+            }
+        }
+        current_ = largest;
+    }
+
+    std::vector<std::unique_ptr<InternalIterator>> children_;
+    InternalIterator* current_;
+    Direction direction_;
+};
+
+}  // namespace lsm
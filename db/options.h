@@ -0,0 +1,162 @@
+// db/options.h
+// Options controlling database behavior
+
+#pragma once
+
+#include "util/types.h"
+#include "util/env.h"
+#include "util/statistics.h"
+#include "db/write_buffer_manager.h"
+#include "sstable/sstable_format.h"
+#include "wal/wal_writer.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lsm {
+
+class EventListener;
+
+// Settings of one column family (keyspace). Each family has its own
+// memtables, levels and tables; see DB::CreateColumnFamily.
+struct ColumnFamilyOptions {
+    // MemTable size before it is rotated and flushed
+    size_t write_buffer_size = 64 * 1024 * 1024;
+
+    // Max memtables (active + immutable) before writes stall for a flush
+    int max_write_buffer_number = 3;
+
+    // Each memtable gets a bloom filter of this fraction of
+    // write_buffer_size (capped at 0.25), so point lookups skip memtables
+    // that do not hold the key. 0.02 costs about 1.3MB per 64MB memtable
+    // and rules out nearly all absent keys for 100-byte entries
+    // (0 = no filter; the key range check is always on)
+    double memtable_bloom_size_ratio = 0;
+
+    // Number of SSTable levels
+    int max_levels = 7;
+
+    // L0 file count that triggers compaction, and that stalls writes
+    int level0_file_num_compaction_trigger = 4;
+    int level0_stop_writes_trigger = 12;
+
+    // Target SSTable size for compaction outputs
+    uint64_t target_file_size_base = 64 * 1024 * 1024;
+
+    // Max bytes at L1; each deeper level holds multiplier times more
+    uint64_t max_bytes_for_level_base = 256 * 1024 * 1024;
+    int max_bytes_for_level_multiplier = 10;
+
+    // Scans that step over this many tombstones mark the scanned range
+    // for compaction, so queue-like workloads do not keep paying for
+    // deleted entries (0 = disabled)
+    uint64_t scan_tombstone_compaction_trigger = 4096;
+
+    // Key-value separation: at flush and compaction, values of at least
+    // min_blob_size bytes are written to blob files and the LSM tree keeps
+    // a small reference, so compactions stop rewriting large values
+    bool enable_blob_files = false;
+    size_t min_blob_size = 4096;
+
+    // Blob files are closed once they reach this size
+    uint64_t blob_file_size = 256 * 1024 * 1024;
+
+    // Compactions relocate live values out of the oldest
+    // blob_garbage_collection_age_cutoff fraction of blob files. Blob files
+    // whose values are all overwritten, deleted or relocated are dropped.
+    // The cutoff must be in [0, 1].
+    bool enable_blob_garbage_collection = true;
+    double blob_garbage_collection_age_cutoff = 0.25;
+
+    // SSTable format settings (block size, restart interval, bloom bits,
+    // block cache)
+    sstable::SSTableOptions table_options;
+};
+
+// Database-wide settings, plus the options of the default column family
+struct Options : public ColumnFamilyOptions {
+    // Create the database directory if it does not exist
+    bool create_if_missing = true;
+
+    // Fail to open if the database already exists
+    bool error_if_exists = false;
+
+    // Create column families passed to DB::Open that do not exist yet
+    bool create_missing_column_families = false;
+
+    // Every file of the DB (WAL, tables, blob files, MANIFESTs) is read and
+    // written through this Env; not owned, and must outlive the DB. Also
+    // used for each column family's table_options.env.
+    Env* env = Env::Default();
+
+    // Max SSTables kept open by each column family's table cache
+    int max_open_files = 1000;
+
+    // Threads that open the live SSTables of every column family during
+    // DB::Open, loading their footers, indexes and filters before the first
+    // read needs them. Each family preloads as many tables as its table
+    // cache holds, lowest levels first; the rest open on first use.
+    // 0 = open every table lazily.
+    int max_file_opening_threads = 16;
+
+    // During DB::Open, also read every block of every live SSTable (on
+    // max_file_opening_threads threads, at least one) and verify its
+    // checksum; a corrupt or truncated table fails the open
+    bool verify_tables_on_open = false;
+
+    // Block cache created for the DB when table_options.block_cache is
+    // null (0 = no block cache). Shared by every column family that does
+    // not bring its own.
+    size_t block_cache_size = 8 * 1024 * 1024;
+
+    // Memory for a CompressedSecondaryCache behind that block cache:
+    // blocks evicted from it are kept compressed and read back from memory
+    // instead of the table file (0 = none)
+    size_t compressed_secondary_cache_size = 0;
+
+    // Memtable memory budget, shareable with other DBs (null = none): once
+    // their memtables together reach its buffer_size, writes flush them
+    // early, and with a cache the memory is also charged to that cache.
+    // For one memory ceiling per process, give every DB the same block
+    // cache and a manager charging to it, and set
+    // table_options.charge_table_memory.
+    std::shared_ptr<WriteBufferManager> write_buffer_manager;
+
+    // Writers queued behind a write leader are committed with it, up to
+    // this many bytes of keys and values per WAL write and sync
+    size_t max_write_group_bytes = 1024 * 1024;
+
+    // WAL settings, shared by all column families; WriteOptions::sync
+    // forces an fsync regardless of policy
+    wal::WALOptions wal_options;
+
+    // Tickers and latency histograms of this DB (null = none); see
+    // CreateDBStatistics. May be shared by several DBs.
+    std::shared_ptr<Statistics> statistics;
+
+    // Append the "lsm.stats" property of every column family to <db>/LOG
+    // this often (0 = never)
+    unsigned int stats_dump_period_sec = 0;
+
+    // Save the block cache's data block keys (table, offset), hottest
+    // first, to <db>/BLOCK_CACHE_WARMUP this often and when the DB closes,
+    // so that the next open can reload them (0 = never)
+    unsigned int block_cache_dump_period_sec = 0;
+
+    // After open, a background thread reloads the blocks listed in
+    // <db>/BLOCK_CACHE_WARMUP, hottest first and until the cache is full,
+    // reading at most this many bytes per second (0 = no warm-up)
+    uint64_t block_cache_warmup_bytes_per_sec = 16 * 1024 * 1024;
+
+    // Notified of flushes, compactions, write stalls, WAL rotations and
+    // background errors; see EventListener
+    std::vector<std::shared_ptr<EventListener>> listeners;
+};
+
+struct WriteOptions {
+    // fsync the WAL before the write returns
+    bool sync = false;
+};
+
+}  // namespace lsm
@@ -0,0 +1,176 @@
+// db/table_cache.h
+// LRU cache of open SSTable readers, keyed by file number, and the row
+// cache for point lookups in them
+
+#pragma once
+
+#include "util/types.h"
+#include "util/perf_context.h"
+#include "util/pinnable_slice.h"
+#include "db/filename.h"
+#include "sstable/sstable_format.h"
+#include "sstable/sstable_reader.h"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsm {
+
+class TableCache {
+public:
+    TableCache(const std::string& db_path, const sstable::SSTableOptions& options,
+               size_t capacity)
+        : db_path_(db_path),
+          options_(options),
+          capacity_(capacity > 0 ? capacity : 1),
+          row_cache_id_(options.row_cache && options.block_cache ? options.block_cache->NewId()
+                                                                  : 0) {}
+
+    TableCache(const TableCache&) = delete;
+    TableCache& operator=(const TableCache&) = delete;
+
+    // Return the reader for a table file, opening it on a miss. Readers are
+    // shared, so an evicted table stays open until its last user drops it.
+    Status FindTable(uint64_t file_number,
+                     std::shared_ptr<sstable::SSTableReader>* table) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = map_.find(file_number);
+            if (it != map_.end()) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                *table = it->second->second;
+                return Status::OK();
+            }
+        }
+
+        // Open outside the lock; a racing open of the same file is harmless
+        std::unique_ptr<sstable::SSTableReader> reader;
+        Status s = OpenTable(file_number, &reader);
+        if (!s.ok()) return s;
+        std::shared_ptr<sstable::SSTableReader> shared(std::move(reader));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = map_.find(file_number);
+        if (it != map_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            *table = it->second->second;
+            return Status::OK();
+        }
+        lru_.emplace_front(file_number, shared);
+        map_[file_number] = lru_.begin();
+        while (lru_.size() > capacity_) {
+            map_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+        *table = std::move(shared);
+        return Status::OK();
+    }
+
+    // Look up user_key in a table (see SSTableReader::Get). With
+    // table_options.row_cache, the result is served from and saved to the
+    // row cache when the read sees every entry of the table (snapshot >=
+    // max_sequence): the newest entry is then the answer at any such
+    // snapshot. Misses are only cached when a data block was searched; a
+    // key the filter or index rules out is as cheap to check again.
+    // Tables are immutable and file numbers never reused, so rows of
+    // deleted tables are never looked up again and age out of the LRU.
+    Status Get(const ReadOptions& read_options, uint64_t file_number,
+               SequenceNumber max_sequence, Slice user_key, SequenceNumber snapshot,
+               PinnableSlice* value, GetState* state, uint64_t* bytes_read = nullptr) {
+        Cache* row_cache = row_cache_id_ != 0 ? options_.block_cache.get() : nullptr;
+        std::string row_key;
+        if (row_cache != nullptr && snapshot >= max_sequence) {
+            sstable::FixedEncode::PutFixed64(&row_key, row_cache_id_);
+            sstable::FixedEncode::PutFixed64(&row_key, file_number);
+            row_key.append(user_key.data(), user_key.size());
+            std::shared_ptr<Row> row = row_cache->Lookup<Row>(row_key);
+            if (row) {
+                PerfCounterAdd(&PerfContext::row_cache_hit_count);
+                *state = row->state;
+                if (row->HasValue()) value->PinSlice(row->value, [row]() {});
+                return Status::OK();
+            }
+            PerfCounterAdd(&PerfContext::row_cache_miss_count);
+        }
+
+        std::shared_ptr<sstable::SSTableReader> table;
+        Status s = FindTable(file_number, &table);
+        if (!s.ok()) return s;
+        bool searched_block = false;
+        s = table->Get(read_options, user_key, snapshot, value, state, bytes_read,
+                       &searched_block);
+        if (!s.ok() || row_key.empty() || !searched_block) return s;
+
+        auto row = std::make_shared<Row>();
+        row->state = *state;
+        if (row->HasValue()) row->value.assign(value->data(), value->size());
+        row_cache->Insert(row_key, row, sizeof(Row) + row_key.size() + row->value.size());
+        return Status::OK();
+    }
+
+    // Open a table without adding it to the cache
+    Status OpenTable(uint64_t file_number,
+                     std::unique_ptr<sstable::SSTableReader>* table) const {
+        return sstable::SSTableReader::Open(TableFileName(db_path_, file_number), options_,
+                                            table);
+    }
+
+    // Drop a table, e.g. once compaction has made it obsolete
+    void Evict(uint64_t file_number) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = map_.find(file_number);
+        if (it != map_.end()) {
+            lru_.erase(it->second);
+            map_.erase(it);
+        }
+    }
+
+    // Call fn(file_number, table) for every table in the cache
+    void ForEachTable(
+        const std::function<void(uint64_t, const sstable::SSTableReader&)>& fn) const {
+        std::vector<Entry> tables;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tables.assign(lru_.begin(), lru_.end());
+        }
+        for (const auto& [number, table] : tables) fn(number, *table);
+    }
+
+    // Most tables kept open at once
+    size_t Capacity() const { return capacity_; }
+
+    // Number of tables currently open in the cache
+    size_t Size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lru_.size();
+    }
+
+private:
+    using Entry = std::pair<uint64_t, std::shared_ptr<sstable::SSTableReader>>;
+
+    // Row cache value: a table's newest entry for a user key, or its absence
+    struct Row {
+        GetState state = GetState::kNotFound;
+        std::string value;  // Value or blob reference
+
+        bool HasValue() const {
+            return state == GetState::kFound || state == GetState::kBlobIndex;
+        }
+    };
+
+    std::string db_path_;
+    sstable::SSTableOptions options_;
+    size_t capacity_;
+    uint64_t row_cache_id_;  // Prefix of this cache's row keys (0 = no row cache)
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> map_;
+};
+
+}  // namespace lsm
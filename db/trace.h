@@ -0,0 +1,378 @@
+// db/trace.h
+// Recording DB operations to a compact trace file, and reading traces back
+
+#pragma once
+
+#include "util/types.h"
+#include "sstable/sstable_format.h"
+#include "wal/wal_format.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace lsm {
+
+enum class TraceType : uint8_t {
+    kGet = 1,
+    kPut = 2,
+    kDelete = 3,
+};
+
+constexpr int kNumTraceTypes = 3;
+
+inline const char* TraceTypeName(TraceType type) {
+    switch (type) {
+        case TraceType::kGet: return "get";
+        case TraceType::kPut: return "put";
+        case TraceType::kDelete: return "delete";
+    }
+    return "unknown";
+}
+
+// Trace file format:
+//   magic (fixed32) | start time, micros since the epoch (fixed64)
+//   | sampling_frequency (fixed64) | record...
+// Each record:
+//   type (byte) | micros since the previous record (varint64)
+//   | column family id (varint32) | key size (varint32) | key
+//   | value size (varint32, kPut only)
+// Values are not recorded, only their sizes. A record cut short at the end
+// of the file (the process died mid-write) ends the trace.
+constexpr uint32_t kTraceFileMagic = 0x54524331;  // "TRC1"
+constexpr size_t kTraceHeaderSize = 20;
+
+struct TraceOptions {
+    uint64_t sampling_frequency = 1;                // Record one in this many operations
+    uint64_t max_trace_file_size = uint64_t{64} << 20;  // Stop recording past this
+};
+
+// One operation read back from a trace
+struct TraceRecord {
+    TraceType type = TraceType::kGet;
+    uint64_t timestamp = 0;  // Micros since the trace started
+    uint32_t cf_id = 0;
+    std::string key;
+    uint32_t value_size = 0;
+};
+
+// Records operations into a trace file. Record() only encodes into a
+// buffer under a short lock; a thread of the tracer's own writes the
+// buffer out, so callers never wait on the trace file. If that thread falls
+// behind by more than kMaxPendingBytes, records are dropped and counted.
+class Tracer {
+public:
+    static constexpr size_t kFlushBytes = 64 * 1024;
+    static constexpr size_t kMaxPendingBytes = 16 << 20;
+
+    Tracer() = default;
+    ~Tracer() { End(); }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Create path and start recording
+    Status Start(const std::string& path, const TraceOptions& options) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd_ >= 0) return Status::InvalidArgument("A trace is already running");
+        if (options.sampling_frequency == 0) {
+            return Status::InvalidArgument("sampling_frequency must be positive");
+        }
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return Status::IOError("Failed to create trace file: " + path);
+
+        auto wall = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        pending_.clear();
+        wal::Encoder enc(&pending_);
+        enc.PutFixed32(kTraceFileMagic);
+        enc.PutFixed64(static_cast<uint64_t>(wall));
+        enc.PutFixed64(options.sampling_frequency);
+
+        fd_ = fd;
+        path_ = path;
+        status_ = Status::OK();
+        max_file_size_ = options.max_trace_file_size;
+        file_size_ = pending_.size();
+        records_ = 0;
+        dropped_ = 0;
+        stop_ = false;
+        start_ = std::chrono::steady_clock::now();
+        last_timestamp_ = 0;
+        sampling_frequency_.store(options.sampling_frequency, std::memory_order_relaxed);
+        op_count_.store(0, std::memory_order_relaxed);
+        writer_ = std::thread([this] { WriterThread(); });
+        active_.store(true, std::memory_order_release);
+        return Status::OK();
+    }
+
+    // Stop recording, write out what is buffered and close the file.
+    // Returns the first write error, if any.
+    Status End() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (fd_ < 0) return Status::OK();
+            active_.store(false, std::memory_order_relaxed);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        writer_.join();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (::close(fd_) != 0 && status_.ok()) {
+            status_ = Status::IOError("Failed to close trace file: " + path_);
+        }
+        fd_ = -1;
+        return status_;
+    }
+
+    bool active() const { return active_.load(std::memory_order_relaxed); }
+
+    void Record(TraceType type, uint32_t cf_id, Slice key, size_t value_size) {
+        if (!active_.load(std::memory_order_acquire)) return;
+        uint64_t frequency = sampling_frequency_.load(std::memory_order_relaxed);
+        if (frequency > 1 &&
+            op_count_.fetch_add(1, std::memory_order_relaxed) % frequency != 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd_ < 0 || stop_) return;
+        if (pending_.size() >= kMaxPendingBytes) {
+            dropped_++;
+            return;
+        }
+        // Read the clock under the lock so timestamps never go backwards
+        auto timestamp = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start_).count());
+
+        size_t old_size = pending_.size();
+        pending_.push_back(static_cast<char>(type));
+        sstable::Varint::PutVarint64(&pending_, timestamp - last_timestamp_);
+        sstable::Varint::PutVarint32(&pending_, cf_id);
+        sstable::Varint::PutVarint32(&pending_, static_cast<uint32_t>(key.size()));
+        pending_.append(key.data(), key.size());
+        if (type == TraceType::kPut) {
+            sstable::Varint::PutVarint32(&pending_, static_cast<uint32_t>(value_size));
+        }
+
+        uint64_t record_size = pending_.size() - old_size;
+        if (file_size_ + record_size > max_file_size_) {
+            pending_.resize(old_size);
+            active_.store(false, std::memory_order_relaxed);
+            return;
+        }
+        file_size_ += record_size;
+        last_timestamp_ = timestamp;
+        records_++;
+        if (pending_.size() >= kFlushBytes) cv_.notify_one();
+    }
+
+    uint64_t records() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return records_;
+    }
+
+    uint64_t dropped() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
+private:
+    // Writes the buffer out whenever kFlushBytes are pending, at least once
+    // a second, and a last time on End
+    void WriterThread() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait_for(lock, std::chrono::seconds(1),
+                         [&] { return stop_ || pending_.size() >= kFlushBytes; });
+            if (!pending_.empty()) {
+                std::string data;
+                data.swap(pending_);
+                lock.unlock();
+                Status s = WriteRaw(data);
+                lock.lock();
+                if (!s.ok() && status_.ok()) {
+                    status_ = s;
+                    active_.store(false, std::memory_order_relaxed);
+                }
+            }
+            if (stop_ && pending_.empty()) break;
+        }
+    }
+
+    // REQUIRES: called by the writer thread only
+    Status WriteRaw(const std::string& data) {
+        const char* ptr = data.data();
+        size_t remaining = data.size();
+        while (remaining > 0) {
+            ssize_t written = ::write(fd_, ptr, remaining);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return Status::IOError("Failed to write trace file: " + path_);
+            }
+            ptr += written;
+            remaining -= static_cast<size_t>(written);
+        }
+        return Status::OK();
+    }
+
+    std::atomic<bool> active_{false};
+    std::atomic<uint64_t> sampling_frequency_{1};
+    std::atomic<uint64_t> op_count_{0};
+
+    // Guards the fields below. fd_ and path_ change only while no writer
+    // thread runs.
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;  // Wakes the writer thread
+    int fd_ = -1;
+    std::string path_;
+    Status status_;
+    std::string pending_;         // Encoded records not yet written
+    uint64_t max_file_size_ = 0;
+    uint64_t file_size_ = 0;      // Header and records accepted so far
+    uint64_t records_ = 0;
+    uint64_t dropped_ = 0;
+    bool stop_ = false;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t last_timestamp_ = 0;
+    std::thread writer_;
+};
+
+// Reads the records of a trace file in order
+class TraceReader {
+public:
+    static Status Open(const std::string& path, std::unique_ptr<TraceReader>* reader) {
+        std::unique_ptr<TraceReader> r(new TraceReader(path));
+        r->fd_ = ::open(path.c_str(), O_RDONLY);
+        if (r->fd_ < 0) return Status::IOError("Failed to open trace file: " + path);
+
+        Status s = r->Fill(kTraceHeaderSize);
+        if (!s.ok()) return s;
+        if (r->buf_.size() < kTraceHeaderSize) {
+            return Status::Corruption("Trace file too short: " + path);
+        }
+        wal::Decoder dec(r->buf_.data(), kTraceHeaderSize);
+        uint32_t magic = 0;
+        uint64_t frequency = 0;
+        dec.GetFixed32(&magic);
+        dec.GetFixed64(&r->start_time_);
+        dec.GetFixed64(&frequency);
+        if (magic != kTraceFileMagic) {
+            return Status::Corruption("Not a trace file: " + path);
+        }
+        r->sampling_frequency_ = frequency;
+        r->pos_ = kTraceHeaderSize;
+        *reader = std::move(r);
+        return Status::OK();
+    }
+
+    ~TraceReader() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    // Read the next record into *record. Returns false at the end of the
+    // trace or on error; status() tells them apart.
+    bool Next(TraceRecord* record) {
+        while (status_.ok()) {
+            const char* p = buf_.data() + pos_;
+            const char* limit = buf_.data() + buf_.size();
+            if (p < limit) {
+                bool complete = Parse(&p, limit, record);
+                if (!status_.ok()) return false;
+                if (complete) {
+                    pos_ = static_cast<size_t>(p - buf_.data());
+                    return true;
+                }
+            }
+            if (eof_) return false;  // Nothing left, or a cut-short last record
+            size_t have = buf_.size() - pos_;
+            buf_.erase(0, pos_);
+            pos_ = 0;
+            status_ = Fill(have + kReadSize);
+        }
+        return false;
+    }
+
+    const Status& status() const { return status_; }
+    uint64_t start_time() const { return start_time_; }  // Micros since the epoch
+    uint64_t sampling_frequency() const { return sampling_frequency_; }
+
+private:
+    static constexpr size_t kReadSize = 1 << 20;
+
+    explicit TraceReader(std::string path) : path_(std::move(path)) {}
+
+    // Returns false if the record is cut short by the end of the buffer
+    bool Parse(const char** p, const char* limit, TraceRecord* record) {
+        auto type = static_cast<uint8_t>(**p);
+        if (type < static_cast<uint8_t>(TraceType::kGet) ||
+            type > static_cast<uint8_t>(TraceType::kDelete)) {
+            status_ = Status::Corruption("Bad trace record type in " + path_);
+            return false;
+        }
+        (*p)++;
+        uint64_t delta = 0;
+        uint32_t key_size = 0;
+        if (!sstable::Varint::GetVarint64(p, limit, &delta) ||
+            !sstable::Varint::GetVarint32(p, limit, &record->cf_id) ||
+            !sstable::Varint::GetVarint32(p, limit, &key_size) ||
+            static_cast<size_t>(limit - *p) < key_size) {
+            return false;
+        }
+        record->key.assign(*p, key_size);
+        *p += key_size;
+        record->value_size = 0;
+        record->type = static_cast<TraceType>(type);
+        if (record->type == TraceType::kPut &&
+            !sstable::Varint::GetVarint32(p, limit, &record->value_size)) {
+            return false;
+        }
+        timestamp_ += delta;
+        record->timestamp = timestamp_;
+        return true;
+    }
+
+    // Read until buf_ holds at least n bytes or the file ends
+    Status Fill(size_t n) {
+        while (buf_.size() < n && !eof_) {
+            size_t old_size = buf_.size();
+            buf_.resize(std::max(n, old_size + kReadSize));
+            ssize_t r = ::read(fd_, &buf_[old_size], buf_.size() - old_size);
+            if (r < 0) {
+                buf_.resize(old_size);
+                if (errno == EINTR) continue;
+                return Status::IOError("Failed to read trace file: " + path_);
+            }
+            buf_.resize(old_size + static_cast<size_t>(r));
+            if (r == 0) eof_ = true;
+        }
+        return Status::OK();
+    }
+
+    const std::string path_;
+    int fd_ = -1;
+    std::string buf_;
+    size_t pos_ = 0;
+    bool eof_ = false;
+    Status status_;
+    uint64_t start_time_ = 0;
+    uint64_t sampling_frequency_ = 1;
+    uint64_t timestamp_ = 0;
+};
+
+}  // namespace lsm
@@ -0,0 +1,211 @@
+// db/trace_replayer.h
+// Re-running a recorded trace against a DB
+
+#pragma once
+
+#include "util/types.h"
+#include "util/histogram.h"
+#include "util/pinnable_slice.h"
+#include "db/db.h"
+#include "db/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lsm {
+
+struct ReplayOptions {
+    int num_threads = 1;
+    // Multiple of the recorded rate: 2 replays twice as fast, 0 issues
+    // every operation as soon as a thread is free
+    double speed = 1.0;
+};
+
+struct ReplayStats {
+    uint64_t ops[kNumTraceTypes] = {};  // Indexed by TraceType - 1
+    uint64_t gets_found = 0;
+    uint64_t skipped = 0;               // Records of column families not given
+    uint64_t errors = 0;
+    Status first_error;
+    uint64_t trace_micros = 0;          // Span of the recorded operations
+    uint64_t replay_micros = 0;
+    uint64_t max_lag_micros = 0;        // Furthest an operation started behind schedule
+    Histogram latency[kNumTraceTypes];  // Micros per operation, by type
+
+    uint64_t total_ops() const {
+        uint64_t n = 0;
+        for (uint64_t c : ops) n += c;
+        return n;
+    }
+};
+
+// Issues the operations of a trace against a DB, paced by their recorded
+// timestamps scaled by ReplayOptions::speed. The calling thread reads the
+// trace and hands each operation to one of num_threads workers, picked by
+// key, so operations on one key run in their recorded order. Puts write
+// values of the recorded size; their contents are not in the trace.
+class Replayer {
+public:
+    // Records are matched to column families by id; with no handles every
+    // record goes to the default family
+    explicit Replayer(DB* db, const std::vector<ColumnFamilyHandle*>& handles = {}) : db_(db) {
+        for (ColumnFamilyHandle* handle : handles) handles_[handle->GetID()] = handle;
+    }
+
+    Status Replay(const std::string& trace_path, const ReplayOptions& options,
+                  ReplayStats* stats) {
+        *stats = ReplayStats();
+        if (options.num_threads < 1 || options.speed < 0) {
+            return Status::InvalidArgument("Bad replay options");
+        }
+        std::unique_ptr<TraceReader> reader;
+        Status s = TraceReader::Open(trace_path, &reader);
+        if (!s.ok()) return s;
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        for (int i = 0; i < options.num_threads; i++) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (auto& w : workers) {
+            w->thread = std::thread([this, w = w.get()] { RunWorker(w); });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        TraceRecord record;
+        while (reader->Next(&record)) {
+            ColumnFamilyHandle* cf = Handle(record.cf_id);
+            if (cf == nullptr) {
+                stats->skipped++;
+                continue;
+            }
+            stats->trace_micros = record.timestamp;
+            if (options.speed > 0) {
+                auto due = start + std::chrono::microseconds(static_cast<int64_t>(
+                                       static_cast<double>(record.timestamp) / options.speed));
+                auto now = std::chrono::steady_clock::now();
+                if (due > now) {
+                    std::this_thread::sleep_until(due);
+                } else {
+                    auto lag = static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(now - due).count());
+                    stats->max_lag_micros = std::max(stats->max_lag_micros, lag);
+                }
+            }
+            size_t index = std::hash<std::string>()(record.key) % workers.size();
+            workers[index]->Push(Op{record.type, cf, std::move(record.key), record.value_size});
+        }
+
+        for (auto& w : workers) w->Push(Op{});  // A null family ends the worker
+        for (auto& w : workers) {
+            w->thread.join();
+            for (int t = 0; t < kNumTraceTypes; t++) {
+                stats->ops[t] += w->ops[t];
+                stats->latency[t].Merge(w->latency[t]);
+            }
+            stats->gets_found += w->gets_found;
+            stats->errors += w->errors;
+            if (stats->first_error.ok()) stats->first_error = w->first_error;
+        }
+        stats->replay_micros = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        return reader->status();
+    }
+
+private:
+    struct Op {
+        TraceType type = TraceType::kGet;
+        ColumnFamilyHandle* cf = nullptr;
+        std::string key;
+        uint32_t value_size = 0;
+    };
+
+    // A thread with a bounded queue; the reader blocks while it is full
+    struct Worker {
+        static constexpr size_t kMaxQueued = 1024;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Op> queue;
+        std::thread thread;
+
+        // Owned by the worker thread until it is joined
+        uint64_t ops[kNumTraceTypes] = {};
+        uint64_t gets_found = 0;
+        uint64_t errors = 0;
+        Status first_error;
+        Histogram latency[kNumTraceTypes];
+
+        void Push(Op op) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return queue.size() < kMaxQueued; });
+            queue.push_back(std::move(op));
+            cv.notify_all();
+        }
+
+        Op Pop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return !queue.empty(); });
+            Op op = std::move(queue.front());
+            queue.pop_front();
+            cv.notify_all();
+            return op;
+        }
+    };
+
+    ColumnFamilyHandle* Handle(uint32_t cf_id) const {
+        if (handles_.empty()) return cf_id == 0 ? db_->DefaultColumnFamily() : nullptr;
+        auto it = handles_.find(cf_id);
+        return it == handles_.end() ? nullptr : it->second;
+    }
+
+    void RunWorker(Worker* w) {
+        std::string value;
+        PinnableSlice pinned;
+        while (true) {
+            Op op = w->Pop();
+            if (op.cf == nullptr) break;
+
+            auto start = std::chrono::steady_clock::now();
+            Status s;
+            switch (op.type) {
+                case TraceType::kGet:
+                    s = db_->Get(ReadOptions(), op.cf, op.key, &pinned);
+                    if (s.ok()) w->gets_found++;
+                    if (s.IsNotFound()) s = Status::OK();
+                    pinned.Reset();
+                    break;
+                case TraceType::kPut:
+                    if (value.size() < op.value_size) value.resize(op.value_size, 'v');
+                    s = db_->Put(WriteOptions(), op.cf, op.key, Slice(value.data(), op.value_size));
+                    break;
+                case TraceType::kDelete:
+                    s = db_->Delete(WriteOptions(), op.cf, op.key);
+                    break;
+            }
+            auto t = static_cast<size_t>(op.type) - 1;
+            w->latency[t].Add(std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count());
+            w->ops[t]++;
+            if (!s.ok()) {
+                if (w->first_error.ok()) w->first_error = s;
+                w->errors++;
+            }
+        }
+    }
+
+    DB* const db_;
+    std::map<uint32_t, ColumnFamilyHandle*> handles_;
+};
+
+}  // namespace lsm
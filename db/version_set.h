@@ -0,0 +1,603 @@
+// db/version_set.h
+// Versions (immutable snapshots of the LSM file layout) and the MANIFEST
+
+#pragma once
+
+#include "util/types.h"
+#include "util/env.h"
+#include "db/blob_file.h"
+#include "db/filename.h"
+#include "db/internal_stats.h"
+#include "db/iterator.h"
+#include "db/table_cache.h"
+#include "sstable/sstable_format.h"
+#include "wal/wal_format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lsm {
+
+// Metadata for one SSTable. Shared between every Version that contains it.
+struct FileMetaData {
+    uint64_t number = 0;
+    uint64_t file_size = 0;
+    std::string smallest;               // Smallest user key
+    std::string largest;                // Largest user key
+    SequenceNumber min_sequence = 0;
+    SequenceNumber max_sequence = 0;
+    uint64_t num_entries = 0;
+    uint64_t num_deletions = 0;
+
+    // Set when scans over this file step over too many tombstones; the
+    // compaction picker rewrites marked files even if no level is over size
+    std::atomic<bool> marked_for_compaction{false};
+
+    bool Overlaps(Slice begin, Slice end) const {
+        return !(Slice(largest) < begin || end < Slice(smallest));
+    }
+
+    bool OverlapsBounds(const ReadOptions& read_options) const {
+        return !read_options.BelowLowerBound(largest) &&
+               !read_options.AtOrAboveUpperBound(smallest);
+    }
+};
+
+using FileList = std::vector<std::shared_ptr<FileMetaData>>;
+
+// Live blob files by number (oldest first). Metadata is immutable: a
+// garbage update installs a new copy in the next Version.
+using BlobFileMap = std::map<uint64_t, std::shared_ptr<const BlobFileMetaData>>;
+
+// Iterates the files of one sorted level (L1+) as a single sequence,
+// opening each table through the TableCache only when the scan reaches it
+class LevelIterator : public InternalIterator {
+public:
+    LevelIterator(FileList files, TableCache* table_cache, const ReadOptions& read_options)
+        : files_(std::move(files)),
+          table_cache_(table_cache),
+          read_options_(read_options),
+          index_(files_.size()) {}
+
+    bool Valid() const override { return iter_ && iter_->Valid(); }
+
+    void SeekToFirst() override {
+        OpenFile(0);
+        if (iter_) iter_->SeekToFirst();
+        SkipEmptyFilesForward();
+    }
+
+    void SeekToLast() override {
+        OpenFile(files_.empty() ? 0 : files_.size() - 1);
+        if (iter_) iter_->SeekToLast();
+        SkipEmptyFilesBackward();
+    }
+
+    void Seek(Slice target) override {
+        Slice user_key = sstable::ExtractUserKey(target);
+        auto it = std::lower_bound(files_.begin(), files_.end(), user_key,
+            [](const std::shared_ptr<FileMetaData>& f, Slice key) {
+                return Slice(f->largest) < key;
+            });
+        OpenFile(static_cast<size_t>(it - files_.begin()));
+        if (iter_) iter_->Seek(target);
+        SkipEmptyFilesForward();
+    }
+
+    void Next() override {
+        iter_->Next();
+        SkipEmptyFilesForward();
+    }
+
+    void Prev() override {
+        iter_->Prev();
+        SkipEmptyFilesBackward();
+    }
+
+    Slice key() const override { return iter_->key(); }
+    Slice value() const override { return iter_->value(); }
+
+    Status status() const override {
+        if (!status_.ok()) return status_;
+        return iter_ ? iter_->status() : Status::OK();
+    }
+
+private:
+    void OpenFile(size_t index) {
+        if (index == index_ && iter_) return;
+        iter_.reset();
+        index_ = index;
+        if (index_ >= files_.size()) return;
+
+        std::shared_ptr<sstable::SSTableReader> table;
+        Status s = table_cache_->FindTable(files_[index_]->number, &table);
+        if (!s.ok()) {
+            // Remember the error and treat the file as empty
+            if (status_.ok()) status_ = s;
+            return;
+        }
+        iter_ = std::make_unique<TableInternalIterator>(std::move(table), read_options_);
+    }
+
+    void SkipEmptyFilesForward() {
+        while (!iter_ || !iter_->Valid()) {
+            if (iter_ && !iter_->status().ok()) return;
+            if (index_ + 1 >= files_.size()) {
+                iter_.reset();
+                index_ = files_.size();
+                return;
+            }
+            OpenFile(index_ + 1);
+            if (iter_) iter_->SeekToFirst();
+        }
+    }
+
+    void SkipEmptyFilesBackward() {
+        while (!iter_ || !iter_->Valid()) {
+            if (iter_ && !iter_->status().ok()) return;
+            if (index_ == 0 || index_ > files_.size()) {
+                iter_.reset();
+                index_ = files_.size();
+                return;
+            }
+            OpenFile(index_ - 1);
+            if (iter_) iter_->SeekToLast();
+        }
+    }
+
+    FileList files_;
+    TableCache* table_cache_;
+    ReadOptions read_options_;
+    size_t index_;
+    std::unique_ptr<InternalIterator> iter_;
+    Status status_;
+};
+
+// Immutable set of live SSTables per level. L0 files may overlap and are
+// ordered oldest first; files in L1+ are disjoint and sorted by key.
+class Version {
+public:
+    explicit Version(int num_levels) : files_(num_levels) {}
+
+    int NumLevels() const { return static_cast<int>(files_.size()); }
+    const FileList& files(int level) const { return files_[level]; }
+
+    int NumFiles(int level) const { return static_cast<int>(files_[level].size()); }
+
+    const BlobFileMap& blob_files() const { return blob_files_; }
+
+    uint64_t NumLevelBytes(int level) const {
+        uint64_t total = 0;
+        for (const auto& f : files_[level]) total += f->file_size;
+        return total;
+    }
+
+    // Estimate of the live bytes in each level: walking from the bottom
+    // level up, a file counts only if its key range overlaps no file
+    // already counted, since newer data over an older range mostly
+    // replaces it. Exact once everything is compacted into one level; an
+    // underestimate while overwrites of the same keys are in flight.
+    std::vector<uint64_t> EstimateLiveBytes() const {
+        std::vector<uint64_t> live(files_.size(), 0);
+        std::map<std::string, std::string> counted;  // smallest -> largest, disjoint
+        for (int level = NumLevels() - 1; level >= 0; level--) {
+            for (const auto& f : files_[level]) {
+                // The counted range starting at or before f->largest with the
+                // greatest start is the only one that can overlap f
+                auto it = counted.upper_bound(f->largest);
+                if (it != counted.begin() && Slice(std::prev(it)->second) >= Slice(f->smallest)) {
+                    continue;
+                }
+                counted.emplace(f->smallest, f->largest);
+                live[static_cast<size_t>(level)] += f->file_size;
+            }
+        }
+        return live;
+    }
+
+    // Newest visible entry for user_key at snapshot, searching L0 newest
+    // first and then one candidate file per sorted level. On kFound, *value
+    // pins the data block holding the value; on kBlobIndex, the block
+    // holding the blob reference. Table bytes read are charged to their
+    // level in *internal_stats, if given.
+    Status Get(const ReadOptions& read_options, Slice user_key, SequenceNumber snapshot,
+               TableCache* table_cache, PinnableSlice* value, GetState* state,
+               InternalStats* internal_stats = nullptr) const {
+        *state = GetState::kNotFound;
+
+        const FileList& level0 = files_[0];
+        for (auto it = level0.rbegin(); it != level0.rend(); ++it) {
+            if (!(*it)->Overlaps(user_key, user_key)) continue;
+            Status s = GetFromFile(read_options, **it, 0, user_key, snapshot, table_cache,
+                                   value, state, internal_stats);
+            if (!s.ok() || *state != GetState::kNotFound) return s;
+        }
+
+        for (int level = 1; level < NumLevels(); level++) {
+            const FileList& files = files_[level];
+            auto it = std::lower_bound(files.begin(), files.end(), user_key,
+                [](const std::shared_ptr<FileMetaData>& f, Slice key) {
+                    return Slice(f->largest) < key;
+                });
+            if (it == files.end() || user_key < Slice((*it)->smallest)) continue;
+            Status s = GetFromFile(read_options, **it, level, user_key, snapshot, table_cache,
+                                   value, state, internal_stats);
+            if (!s.ok() || *state != GetState::kNotFound) return s;
+        }
+        return Status::OK();
+    }
+
+    // Append iterators covering this version to *iters. Files whose key range
+    // lies entirely outside the read bounds are skipped without being opened.
+    void AddIterators(const ReadOptions& read_options, TableCache* table_cache,
+                      std::vector<std::unique_ptr<InternalIterator>>* iters) const {
+        for (auto it = files_[0].rbegin(); it != files_[0].rend(); ++it) {
+            if (!(*it)->OverlapsBounds(read_options)) continue;
+            std::shared_ptr<sstable::SSTableReader> table;
+            Status s = table_cache->FindTable((*it)->number, &table);
+            if (!s.ok()) {
+                iters->push_back(std::make_unique<EmptyInternalIterator>(s));
+                continue;
+            }
+            iters->push_back(std::make_unique<TableInternalIterator>(std::move(table),
+                                                                     read_options));
+        }
+
+        for (int level = 1; level < NumLevels(); level++) {
+            FileList in_range;
+            for (const auto& f : files_[level]) {
+                if (f->OverlapsBounds(read_options)) in_range.push_back(f);
+            }
+            if (!in_range.empty()) {
+                iters->push_back(std::make_unique<LevelIterator>(std::move(in_range),
+                                                                 table_cache, read_options));
+            }
+        }
+    }
+
+    // Files in level whose range intersects [begin, end]; null means unbounded
+    FileList GetOverlappingInputs(int level, const Slice* begin, const Slice* end) const {
+        FileList result;
+        for (const auto& f : files_[level]) {
+            if (begin != nullptr && Slice(f->largest) < *begin) continue;
+            if (end != nullptr && *end < Slice(f->smallest)) continue;
+            result.push_back(f);
+        }
+        return result;
+    }
+
+private:
+    friend class VersionSet;
+
+    static Status GetFromFile(const ReadOptions& read_options, const FileMetaData& file,
+                              int level, Slice user_key, SequenceNumber snapshot,
+                              TableCache* table_cache, PinnableSlice* value,
+                              GetState* state, InternalStats* internal_stats) {
+        uint64_t bytes_read = 0;
+        Status s = table_cache->Get(read_options, file.number, file.max_sequence, user_key,
+                                    snapshot, value, state, &bytes_read);
+        if (internal_stats != nullptr && bytes_read > 0) {
+            internal_stats->AddGetBytesRead(level, bytes_read);
+        }
+        return s;
+    }
+
+    std::vector<FileList> files_;
+    BlobFileMap blob_files_;
+};
+
+// Blob records of one file that compaction dropped or relocated
+struct BlobGarbage {
+    uint64_t number = 0;
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// Changes applied to a Version to produce the next one
+struct VersionEdit {
+    std::vector<std::pair<int, uint64_t>> deleted_files;                  // (level, number)
+    std::vector<std::pair<int, std::shared_ptr<FileMetaData>>> new_files;  // (level, file)
+    std::vector<std::shared_ptr<BlobFileMetaData>> new_blob_files;
+    std::vector<BlobGarbage> blob_garbage;
+
+    bool has_log_number = false;
+    uint64_t log_number = 0;
+    SequenceNumber last_sequence = 0;
+
+    void SetLogNumber(uint64_t number) {
+        has_log_number = true;
+        log_number = number;
+    }
+
+    void DeleteFile(int level, uint64_t number) {
+        deleted_files.emplace_back(level, number);
+    }
+
+    void AddFile(int level, std::shared_ptr<FileMetaData> file) {
+        new_files.emplace_back(level, std::move(file));
+    }
+
+    void AddBlobFile(std::shared_ptr<BlobFileMetaData> file) {
+        new_blob_files.push_back(std::move(file));
+    }
+
+    void AddBlobGarbage(uint64_t number, uint64_t count, uint64_t bytes) {
+        blob_garbage.push_back(BlobGarbage{number, count, bytes});
+    }
+};
+
+// Owns the current Version and persists it to the MANIFEST.
+//
+// The MANIFEST is a full snapshot of the file layout, rewritten on every
+// edit (write temp file, fsync, rename). The layout is small, so this keeps
+// recovery trivial at the cost of a few KB of I/O per flush or compaction.
+//
+// MANIFEST format:
+//   magic (fixed32) | next_file_number (fixed64) | last_sequence (fixed64)
+//   | log_number (fixed64) | num_files (fixed32) | files...
+//   | num_blob_files (fixed32) | blob files... | crc32 (fixed32)
+// Each file: level (byte) | number | file_size | smallest | largest
+//   | min_seq | max_seq | num_entries | num_deletions
+// Each blob file: number | total_count | total_bytes | garbage_count
+//   | garbage_bytes
+class VersionSet {
+public:
+    static constexpr uint32_t kManifestMagic = 0x4C534D31;  // "LSM1"
+
+    VersionSet(const std::string& db_path, int num_levels, Env* env = Env::Default())
+        : db_path_(db_path),
+          env_(env),
+          num_levels_(num_levels),
+          next_file_number_(1),
+          last_sequence_(0),
+          log_number_(0),
+          current_(std::make_shared<Version>(num_levels)) {
+        versions_.push_back(current_);
+    }
+
+    VersionSet(const VersionSet&) = delete;
+    VersionSet& operator=(const VersionSet&) = delete;
+
+    // Load the MANIFEST if one exists; a missing MANIFEST means a new DB
+    Status Recover(bool* exists) {
+        *exists = false;
+        std::string path = ManifestFileName(db_path_);
+        std::string contents;
+        Status s = ReadFileToString(env_, path, &contents);
+        if (s.IsNotFound()) return Status::OK();
+        if (!s.ok()) return Status::IOError("Failed to read MANIFEST: " + path);
+
+        if (contents.size() < 4) return Status::Corruption("MANIFEST too short");
+        size_t payload_size = contents.size() - 4;
+        wal::Decoder crc_dec(contents.data() + payload_size, 4);
+        uint32_t stored_crc;
+        crc_dec.GetFixed32(&stored_crc);
+        if (wal::CRC32::Compute(contents.data(), payload_size) != stored_crc) {
+            return Status::Corruption("MANIFEST checksum mismatch");
+        }
+
+        wal::Decoder dec(contents.data(), payload_size);
+        uint32_t magic, num_files;
+        uint64_t next_file, last_seq, log_number;
+        if (!dec.GetFixed32(&magic) || magic != kManifestMagic ||
+            !dec.GetFixed64(&next_file) || !dec.GetFixed64(&last_seq) ||
+            !dec.GetFixed64(&log_number) || !dec.GetFixed32(&num_files)) {
+            return Status::Corruption("Bad MANIFEST header");
+        }
+
+        auto version = std::make_shared<Version>(num_levels_);
+        for (uint32_t i = 0; i < num_files; i++) {
+            uint8_t level;
+            auto f = std::make_shared<FileMetaData>();
+            if (!dec.GetByte(&level) || !dec.GetFixed64(&f->number) ||
+                !dec.GetFixed64(&f->file_size) || !dec.GetLengthPrefixed(&f->smallest) ||
+                !dec.GetLengthPrefixed(&f->largest) || !dec.GetFixed64(&f->min_sequence) ||
+                !dec.GetFixed64(&f->max_sequence) || !dec.GetFixed64(&f->num_entries) ||
+                !dec.GetFixed64(&f->num_deletions)) {
+                return Status::Corruption("Bad MANIFEST file entry");
+            }
+            if (level >= num_levels_) {
+                return Status::Corruption("MANIFEST level out of range");
+            }
+            version->files_[level].push_back(std::move(f));
+        }
+
+        uint32_t num_blob_files = 0;
+        if (!dec.GetFixed32(&num_blob_files)) {
+            return Status::Corruption("Bad MANIFEST blob file count");
+        }
+        for (uint32_t i = 0; i < num_blob_files; i++) {
+            auto b = std::make_shared<BlobFileMetaData>();
+            if (!dec.GetFixed64(&b->number) || !dec.GetFixed64(&b->total_count) ||
+                !dec.GetFixed64(&b->total_bytes) || !dec.GetFixed64(&b->garbage_count) ||
+                !dec.GetFixed64(&b->garbage_bytes)) {
+                return Status::Corruption("Bad MANIFEST blob file entry");
+            }
+            version->blob_files_[b->number] = std::move(b);
+        }
+        SortLevels(version.get());
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        next_file_number_ = next_file;
+        last_sequence_ = last_seq;
+        log_number_ = log_number;
+        InstallLocked(std::move(version));
+        *exists = true;
+        return Status::OK();
+    }
+
+    // Apply edit to the current version, persist the result, and install it.
+    // Callers serialize edits; readers may call current() concurrently.
+    Status LogAndApply(const VersionEdit& edit) {
+        std::shared_ptr<Version> base = current();
+        auto version = std::make_shared<Version>(num_levels_);
+
+        std::set<std::pair<int, uint64_t>> deleted(edit.deleted_files.begin(),
+                                                   edit.deleted_files.end());
+        for (int level = 0; level < num_levels_; level++) {
+            for (const auto& f : base->files_[level]) {
+                if (deleted.count({level, f->number}) == 0) {
+                    version->files_[level].push_back(f);
+                }
+            }
+        }
+        for (const auto& [level, f] : edit.new_files) {
+            version->files_[level].push_back(f);
+        }
+        SortLevels(version.get());
+        ApplyBlobChanges(*base, edit, version.get());
+
+        uint64_t log_number = edit.has_log_number ? edit.log_number : LogNumber();
+        SequenceNumber last_sequence = std::max(LastSequence(), edit.last_sequence);
+
+        Status s = WriteManifest(*version, log_number, last_sequence);
+        if (!s.ok()) return s;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        log_number_ = log_number;
+        last_sequence_ = last_sequence;
+        InstallLocked(std::move(version));
+        return Status::OK();
+    }
+
+    std::shared_ptr<Version> current() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return current_;
+    }
+
+    uint64_t NewFileNumber() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return next_file_number_++;
+    }
+
+    uint64_t LogNumber() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return log_number_;
+    }
+
+    SequenceNumber LastSequence() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_sequence_;
+    }
+
+    // Table and blob file numbers referenced by any version still in use
+    // (current version, or older ones pinned by iterators)
+    std::set<uint64_t> LiveFiles() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::set<uint64_t> live;
+        for (auto it = versions_.begin(); it != versions_.end();) {
+            std::shared_ptr<Version> v = it->lock();
+            if (!v) {
+                it = versions_.erase(it);
+                continue;
+            }
+            for (const auto& level : v->files_) {
+                for (const auto& f : level) live.insert(f->number);
+            }
+            for (const auto& entry : v->blob_files_) live.insert(entry.first);
+            ++it;
+        }
+        return live;
+    }
+
+private:
+    static void SortLevels(Version* version) {
+        auto& level0 = version->files_[0];
+        std::sort(level0.begin(), level0.end(),
+            [](const auto& a, const auto& b) { return a->number < b->number; });
+        for (size_t level = 1; level < version->files_.size(); level++) {
+            auto& files = version->files_[level];
+            std::sort(files.begin(), files.end(),
+                [](const auto& a, const auto& b) { return a->smallest < b->smallest; });
+        }
+    }
+
+    // Carry blob files over from base, add new ones, and apply garbage.
+    // Files that become entirely garbage are left out.
+    static void ApplyBlobChanges(const Version& base, const VersionEdit& edit,
+                                 Version* version) {
+        version->blob_files_ = base.blob_files_;
+        for (const auto& b : edit.new_blob_files) {
+            version->blob_files_[b->number] = b;
+        }
+        for (const auto& garbage : edit.blob_garbage) {
+            auto it = version->blob_files_.find(garbage.number);
+            if (it == version->blob_files_.end()) continue;
+            auto updated = std::make_shared<BlobFileMetaData>(*it->second);
+            updated->garbage_count += garbage.count;
+            updated->garbage_bytes += garbage.bytes;
+            if (updated->FullyGarbage()) {
+                version->blob_files_.erase(it);
+            } else {
+                it->second = std::move(updated);
+            }
+        }
+    }
+
+    void InstallLocked(std::shared_ptr<Version> version) {
+        current_ = std::move(version);
+        versions_.push_back(current_);
+    }
+
+    Status WriteManifest(const Version& version, uint64_t log_number,
+                         SequenceNumber last_sequence) {
+        uint64_t next_file = NewFileNumber();  // Also names the temp file
+
+        std::string payload;
+        wal::Encoder enc(&payload);
+        size_t num_files = 0;
+        for (const auto& level : version.files_) num_files += level.size();
+
+        enc.PutFixed32(kManifestMagic);
+        enc.PutFixed64(next_file + 1);
+        enc.PutFixed64(last_sequence);
+        enc.PutFixed64(log_number);
+        enc.PutFixed32(static_cast<uint32_t>(num_files));
+        for (size_t level = 0; level < version.files_.size(); level++) {
+            for (const auto& f : version.files_[level]) {
+                enc.PutByte(static_cast<uint8_t>(level));
+                enc.PutFixed64(f->number);
+                enc.PutFixed64(f->file_size);
+                enc.PutLengthPrefixed(f->smallest);
+                enc.PutLengthPrefixed(f->largest);
+                enc.PutFixed64(f->min_sequence);
+                enc.PutFixed64(f->max_sequence);
+                enc.PutFixed64(f->num_entries);
+                enc.PutFixed64(f->num_deletions);
+            }
+        }
+        enc.PutFixed32(static_cast<uint32_t>(version.blob_files_.size()));
+        for (const auto& [number, b] : version.blob_files_) {
+            enc.PutFixed64(number);
+            enc.PutFixed64(b->total_count);
+            enc.PutFixed64(b->total_bytes);
+            enc.PutFixed64(b->garbage_count);
+            enc.PutFixed64(b->garbage_bytes);
+        }
+        enc.PutFixed32(wal::CRC32::Compute(payload.data(), payload.size()));
+
+        return WriteFileAtomically(env_, ManifestFileName(db_path_),
+                                   TempFileName(db_path_, next_file), payload);
+    }
+
+    std::string db_path_;
+    Env* env_;
+    int num_levels_;
+
+    mutable std::mutex mutex_;
+    uint64_t next_file_number_;
+    SequenceNumber last_sequence_;
+    uint64_t log_number_;
+    std::shared_ptr<Version> current_;
+    std::list<std::weak_ptr<Version>> versions_;
+};
+
+}  // namespace lsm
@@ -0,0 +1,103 @@
+// db/write_buffer_manager.h
+// Memtable memory budget shared by column families and DBs, optionally
+// charged to a block cache
+
+#pragma once
+
+#include "util/types.h"
+#include "util/cache.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace lsm {
+
+// Tracks the memory of every memtable of the DBs it is given to (see
+// Options::write_buffer_manager). Only memory not yet scheduled for flush
+// counts towards forcing flushes: once it passes 7/8 of buffer_size, or
+// half of it while the total is over buffer_size, a write to a column
+// family with no flush in flight first makes its active memtable
+// immutable and schedules the flush, whatever its size. Memory that a
+// flush will soon free does not make other memtables flush again.
+//
+// With a cache, the same memory is also reserved in it (in kReservationUnit
+// steps), so the cache shrinks while memtables grow and the memtables and
+// cached blocks together stay within the cache's capacity. Share one cache
+// and one manager among all DBs in a process for a single memory ceiling.
+class WriteBufferManager {
+public:
+    static constexpr size_t kReservationUnit = 256 * 1024;
+
+    // buffer_size 0 = never force flushes (only charge the cache)
+    explicit WriteBufferManager(size_t buffer_size, std::shared_ptr<Cache> cache = nullptr)
+        : buffer_size_(buffer_size),
+          mutable_limit_(buffer_size / 8 * 7) {
+        if (cache) reservation_ = std::make_unique<CacheReservation>(std::move(cache),
+                                                                     kReservationUnit);
+    }
+
+    WriteBufferManager(const WriteBufferManager&) = delete;
+    WriteBufferManager& operator=(const WriteBufferManager&) = delete;
+
+    // Memtable memory allocated and freed. Memory is scheduled to be freed
+    // when its memtable becomes immutable and freed when it is deleted;
+    // FreeMem's bytes must have been passed to ScheduleFreeMem first.
+    void ReserveMem(size_t bytes) {
+        mutable_used_.fetch_add(bytes, std::memory_order_relaxed);
+        size_t used = memory_used_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        if (reservation_) MaybeUpdateReservation(used);
+    }
+
+    void ScheduleFreeMem(size_t bytes) {
+        mutable_used_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    void FreeMem(size_t bytes) {
+        size_t used = memory_used_.fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+        if (reservation_) MaybeUpdateReservation(used);
+    }
+
+    size_t memory_usage() const { return memory_used_.load(std::memory_order_relaxed); }
+
+    // Memory of memtables that still accept writes
+    size_t mutable_memtable_memory_usage() const {
+        return mutable_used_.load(std::memory_order_relaxed);
+    }
+
+    size_t buffer_size() const { return buffer_size_; }
+
+    // Bytes currently reserved in the cache
+    size_t cache_reservation() const {
+        return cache_reserved_.load(std::memory_order_relaxed);
+    }
+
+    bool ShouldFlush() const {
+        if (buffer_size_ == 0) return false;
+        size_t mutable_used = mutable_memtable_memory_usage();
+        return mutable_used > mutable_limit_ ||
+               (memory_usage() >= buffer_size_ && mutable_used >= buffer_size_ / 2);
+    }
+
+private:
+    // Lock-free unless usage crossed a unit boundary since the last update
+    void MaybeUpdateReservation(size_t used) {
+        size_t target = (used + kReservationUnit - 1) / kReservationUnit * kReservationUnit;
+        if (target == cache_reserved_.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        reservation_->Update(memory_used_.load(std::memory_order_relaxed));
+        cache_reserved_.store(reservation_->reserved(), std::memory_order_relaxed);
+    }
+
+    const size_t buffer_size_;
+    const size_t mutable_limit_;
+    std::atomic<size_t> memory_used_{0};
+    std::atomic<size_t> mutable_used_{0};
+    std::atomic<size_t> cache_reserved_{0};
+
+    std::mutex mutex_;
+    std::unique_ptr<CacheReservation> reservation_;  // Guarded by mutex_
+};
+
+}  // namespace lsm
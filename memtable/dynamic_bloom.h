@@ -0,0 +1,85 @@
+// memtable/dynamic_bloom.h
+// Bloom filter built incrementally while it is being read, for memtables
+
+#pragma once
+
+#include "util/types.h"
+#include "util/bloom_filter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace lsm {
+
+// Fixed-size bloom filter that keys are added to one at a time. Add may
+// run concurrently with MayContain (and with other Adds): bits are only
+// ever set, with atomic ORs, so a reader sees every key added before it
+// started. Each key's probes fall in one 64-byte cache line, so a lookup
+// costs a single cache miss.
+class DynamicBloom {
+public:
+    static constexpr int kDefaultNumProbes = 6;
+
+    // total_bits is rounded up to whole cache lines
+    explicit DynamicBloom(size_t total_bits, int num_probes = kDefaultNumProbes)
+        : num_lines_((total_bits + kBitsPerLine - 1) / kBitsPerLine),
+          num_probes_(num_probes) {
+        if (num_lines_ == 0) num_lines_ = 1;
+        words_ = std::make_unique<std::atomic<uint64_t>[]>(num_lines_ * kWordsPerLine);
+    }
+
+    DynamicBloom(const DynamicBloom&) = delete;
+    DynamicBloom& operator=(const DynamicBloom&) = delete;
+
+    void Add(Slice key) {
+        uint64_t h1, h2;
+        MurmurHash::Hash128(key.data(), key.size(), &h1, &h2);
+        std::atomic<uint64_t>* line = Line(h1);
+        for (int i = 0; i < num_probes_; i++) {
+            uint64_t bit = ProbeBit(&h2);
+            uint64_t mask = uint64_t{1} << (bit % 64);
+            std::atomic<uint64_t>& word = line[bit / 64];
+            // Skip the write (and the cache line invalidation) if already set
+            if ((word.load(std::memory_order_relaxed) & mask) == 0) {
+                word.fetch_or(mask, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // False means key was never added
+    bool MayContain(Slice key) const {
+        uint64_t h1, h2;
+        MurmurHash::Hash128(key.data(), key.size(), &h1, &h2);
+        const std::atomic<uint64_t>* line = Line(h1);
+        for (int i = 0; i < num_probes_; i++) {
+            uint64_t bit = ProbeBit(&h2);
+            uint64_t mask = uint64_t{1} << (bit % 64);
+            if ((line[bit / 64].load(std::memory_order_relaxed) & mask) == 0) return false;
+        }
+        return true;
+    }
+
+    size_t MemoryUsage() const { return num_lines_ * kWordsPerLine * sizeof(uint64_t); }
+
+private:
+    static constexpr size_t kWordsPerLine = 8;
+    static constexpr size_t kBitsPerLine = kWordsPerLine * 64;
+
+    std::atomic<uint64_t>* Line(uint64_t h1) const {
+        return &words_[(h1 % num_lines_) * kWordsPerLine];
+    }
+
+    // Next bit within the line: successive 9-bit slices of h2, rotating
+    static uint64_t ProbeBit(uint64_t* h) {
+        uint64_t bit = *h % kBitsPerLine;
+        *h = (*h >> 9) | (*h << 55);
+        return bit;
+    }
+
+    size_t num_lines_;
+    const int num_probes_;
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+};
+
+}  // namespace lsm
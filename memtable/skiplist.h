@@ -10,6 +10,7 @@
 #include <cassert>
 #include <cstdlib>
 #include <random>
+#include <type_traits>
 
 namespace lsm {
 
@@ -22,7 +23,18 @@ private:
     struct Node {
         Key const key;
 
-        explicit Node(const Key& k) : key(k) {}
+        explicit Node(const Key& k) : key(k), prev_(nullptr) {}
+
+        // Level-0 predecessor (head_ for the first node). Set after the node
+        // is linked in, so a reader stepping back may miss an insert still
+        // in progress, just as a reader stepping forward may.
+        Node* Prev() {
+            return prev_.load(std::memory_order_acquire);
+        }
+
+        void SetPrev(Node* x) {
+            prev_.store(x, std::memory_order_release);
+        }
 
         Node* Next(int level) {
             assert(level >= 0);
@@ -43,7 +55,8 @@ private:
         }
 
     private:
-        std::atomic<Node*> next_[1];
+        std::atomic<Node*> prev_;
+        std::atomic<Node*> next_[1];  // Must be last: NewNode allocates one per level
     };
 
 public:
@@ -58,28 +71,83 @@ public:
         }
     }
 
+    // Nodes live in the arena, which frees their memory but runs no
+    // destructors; destroy the keys here so keys that own heap memory
+    // (e.g. std::string) don't leak. REQUIRES: the arena outlives the list
+    ~SkipList() {
+        if constexpr (!std::is_trivially_destructible_v<Key>) {
+            Node* x = head_;
+            while (x != nullptr) {
+                Node* next = x->NoBarrier_Next(0);
+                x->~Node();
+                x = next;
+            }
+        }
+    }
+
     SkipList(const SkipList&) = delete;
     SkipList& operator=(const SkipList&) = delete;
 
-    void Insert(const Key& key) {
-        Node* prev[kMaxHeight];
-        Node* x = FindGreaterOrEqual(key, prev);
+    // Where the last InsertWithHint call put its key; lets the next call
+    // start from there instead of head_. Empty until first used.
+    struct InsertHint {
+        Node* prev[kMaxHeight];  // Per level: the inserted node or a node before it
+        int height = 0;          // Levels of prev that are set
+    };
 
-        assert(x == nullptr || !Equal(key, x->key));
+    // Returns the copy of key stored in the list, valid for its lifetime
+    const Key& Insert(const Key& key) {
+        Node* prev[kMaxHeight];
+        FindGreaterOrEqual(key, prev);
+        return Link(key, RandomHeight(), prev)->key;
+    }
 
-        int height = RandomHeight();
-        if (height > GetMaxHeight()) {
-            for (int i = GetMaxHeight(); i < height; i++) {
-                prev[i] = head_;
+    // Insert for keys that mostly arrive in order (e.g. time-ordered keys).
+    // If key follows the previous insert made with *hint, the search
+    // climbs from that insert's position until a level's successor is
+    // past key, then descends as usual. An append touches one or two
+    // levels, so it is O(1) expected instead of O(log n). Other keys cost
+    // one extra comparison and fall back to Insert's search.
+    // REQUIRES: the same as Insert; *hint is only used with this list
+    const Key& InsertWithHint(const Key& key, InsertHint* hint) {
+        Node* prev[kMaxHeight];
+        const int height = RandomHeight();
+        const int max_height = GetMaxHeight();
+        int valid = max_height;  // Levels of prev computed
+
+        int level = height - 1;
+        if (hint->height > 0 && KeyIsAfterNode(key, hint->prev[0])) {
+            // Every hinted node precedes key; find the lowest level at or
+            // above the new node's top whose hinted node is key's predecessor
+            while (level < max_height &&
+                   KeyIsAfterNode(key, HintedNode(*hint, level)->Next(level))) {
+                level++;
             }
-            max_height_.store(height, std::memory_order_relaxed);
+        } else {
+            level = max_height;
         }
 
-        x = NewNode(key, height);
-        for (int i = 0; i < height; i++) {
-            x->NoBarrier_SetNext(i, prev[i]->NoBarrier_Next(i));
-            prev[i]->SetNext(i, x);
+        if (level < max_height) {
+            Node* x = HintedNode(*hint, level);
+            prev[level] = x;
+            for (int i = level - 1; i >= 0; i--) {
+                Node* next = x->Next(i);
+                while (KeyIsAfterNode(key, next)) {
+                    x = next;
+                    next = x->Next(i);
+                }
+                prev[i] = x;
+            }
+            valid = level + 1;
+        } else {
+            FindGreaterOrEqual(key, prev);
         }
+
+        Node* x = Link(key, height, prev);
+        if (height > valid) valid = height;
+        for (int i = 0; i < valid; i++) hint->prev[i] = i < height ? x : prev[i];
+        if (valid > hint->height) hint->height = valid;
+        return x->key;
     }
 
     bool Contains(const Key& key) const {
@@ -107,9 +175,10 @@ public:
             node_ = node_->Next(0);
         }
 
+        // O(1): follows the level-0 back link
         void Prev() {
             assert(Valid());
-            node_ = list_->FindLessThan(node_->key);
+            node_ = node_->Prev();
             if (node_ == list_->head_) {
                 node_ = nullptr;
             }
@@ -136,6 +205,32 @@ public:
     };
 
 private:
+    // Inserts key after prev[i] at each level below height (levels above
+    // the list's current height need not be set)
+    Node* Link(const Key& key, int height, Node** prev) {
+        assert(prev[0]->Next(0) == nullptr || !Equal(key, prev[0]->Next(0)->key));
+        if (height > GetMaxHeight()) {
+            for (int i = GetMaxHeight(); i < height; i++) {
+                prev[i] = head_;
+            }
+            max_height_.store(height, std::memory_order_relaxed);
+        }
+
+        Node* x = NewNode(key, height);
+        x->SetPrev(prev[0]);
+        for (int i = 0; i < height; i++) {
+            x->NoBarrier_SetNext(i, prev[i]->NoBarrier_Next(i));
+            prev[i]->SetNext(i, x);
+        }
+        Node* next = x->NoBarrier_Next(0);
+        if (next != nullptr) next->SetPrev(x);
+        return x;
+    }
+
+    Node* HintedNode(const InsertHint& hint, int level) const {
+        return level < hint.height ? hint.prev[level] : head_;
+    }
+
     int GetMaxHeight() const {
         return max_height_.load(std::memory_order_relaxed);
     }
@@ -182,25 +277,6 @@ private:
         }
     }
 
-    Node* FindLessThan(const Key& key) const {
-        Node* x = head_;
-        int level = GetMaxHeight() - 1;
-
-        while (true) {
-            assert(x == head_ || compare_(x->key, key) < 0);
-            Node* next = x->Next(level);
-            if (next == nullptr || compare_(next->key, key) >= 0) {
-                if (level == 0) {
-                    return x;
-                } else {
-                    level--;
-                }
-            } else {
-                x = next;
-            }
-        }
-    }
-
     Node* FindLast() const {
         Node* x = head_;
         int level = GetMaxHeight() - 1;
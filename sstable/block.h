@@ -0,0 +1,283 @@
+// sstable/block.h
+// Parses blocks produced by BlockBuilder and iterates over their entries
+
+#pragma once
+
+#include "util/types.h"
+#include "sstable/sstable_format.h"
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+namespace lsm {
+namespace sstable {
+
+// Block holds the contents of one block (trailer already stripped) and
+// exposes an iterator that decodes the prefix-compressed entries. See
+// block_builder.h for the entry and restart array layout.
+class Block {
+public:
+    explicit Block(std::string contents)
+        : data_(std::move(contents)), restart_offset_(0), num_restarts_(0) {
+        if (data_.size() < sizeof(uint32_t)) {
+            return;  // Malformed: leaves num_restarts_ = 0
+        }
+        uint32_t n = FixedEncode::DecodeFixed32(data_.data() + data_.size() - 4);
+        size_t max_restarts = (data_.size() - sizeof(uint32_t)) / sizeof(uint32_t);
+        if (n == 0 || n > max_restarts) {
+            return;
+        }
+        num_restarts_ = n;
+        restart_offset_ = static_cast<uint32_t>(
+            data_.size() - (1 + n) * sizeof(uint32_t));
+    }
+
+    Block(const Block&) = delete;
+    Block& operator=(const Block&) = delete;
+
+    bool ok() const { return num_restarts_ > 0; }
+    size_t size() const { return data_.size(); }
+    Slice contents() const { return data_; }
+    uint32_t NumRestarts() const { return num_restarts_; }
+
+    class Iterator {
+    public:
+        Iterator(const Block* block, KeyComparator cmp)
+            : cmp_(cmp),
+              data_(block->data_.data()),
+              restarts_(block->restart_offset_),
+              num_restarts_(block->num_restarts_),
+              current_(block->restart_offset_),
+              restart_index_(block->num_restarts_) {
+            if (num_restarts_ == 0) {
+                status_ = Status::Corruption("Bad block contents");
+            }
+        }
+
+        bool Valid() const { return current_ < restarts_; }
+        const Status& status() const { return status_; }
+
+        Slice key() const {
+            assert(Valid());
+            return key_;
+        }
+
+        Slice value() const {
+            assert(Valid());
+            return value_;
+        }
+
+        void Next() {
+            assert(Valid());
+            ParseNextEntry();
+        }
+
+        // Keys are prefix-compressed, so an entry can only be decoded by
+        // scanning forward from its restart point. Prev decodes the whole
+        // restart interval once and keeps its entries, so a reverse scan
+        // costs O(1) amortized per entry instead of O(restart interval).
+        void Prev() {
+            assert(Valid());
+
+            if (prev_index_ > 0 && prev_entries_[prev_index_].offset == current_) {
+                const CachedEntry& e = prev_entries_[--prev_index_];
+                current_ = e.offset;
+                key_.assign(prev_keys_, e.key_offset, e.key_size);
+                value_ = e.value;
+                return;
+            }
+
+            // Scan backwards to a restart point before current_
+            const uint32_t original = current_;
+            while (GetRestartPoint(restart_index_) >= original) {
+                if (restart_index_ == 0) {
+                    // No more entries
+                    current_ = restarts_;
+                    restart_index_ = num_restarts_;
+                    return;
+                }
+                restart_index_--;
+            }
+
+            // Decode the interval up to the entry before original, keeping
+            // each entry for the following Prev calls
+            SeekToRestartPoint(restart_index_);
+            prev_entries_.clear();
+            prev_keys_.clear();
+            prev_index_ = 0;
+            while (ParseNextEntry()) {
+                prev_entries_.push_back({current_, static_cast<uint32_t>(prev_keys_.size()),
+                                         static_cast<uint32_t>(key_.size()), value_});
+                prev_keys_.append(key_);
+                if (NextEntryOffset() >= original) break;
+            }
+            if (!status_.ok()) {
+                prev_entries_.clear();
+                return;
+            }
+            prev_index_ = prev_entries_.size() - 1;
+        }
+
+        // Position at the first entry with key >= target
+        void Seek(Slice target) {
+            if (num_restarts_ == 0) return;
+
+            // Binary search in restart array for the last restart point
+            // with a key < target
+            uint32_t left = 0;
+            uint32_t right = num_restarts_ - 1;
+            while (left < right) {
+                uint32_t mid = (left + right + 1) / 2;
+                uint32_t region_offset = GetRestartPoint(mid);
+                uint32_t shared, non_shared, value_length;
+                const char* key_ptr = DecodeEntry(data_ + region_offset,
+                                                  data_ + restarts_,
+                                                  &shared, &non_shared, &value_length);
+                if (key_ptr == nullptr || shared != 0) {
+                    CorruptionError();
+                    return;
+                }
+                Slice mid_key(key_ptr, non_shared);
+                if (cmp_(mid_key, target) < 0) {
+                    left = mid;
+                } else {
+                    right = mid - 1;
+                }
+            }
+
+            // Linear search within restart block for first key >= target
+            SeekToRestartPoint(left);
+            while (true) {
+                if (!ParseNextEntry()) {
+                    return;
+                }
+                if (cmp_(key_, target) >= 0) {
+                    return;
+                }
+            }
+        }
+
+        void SeekToFirst() {
+            if (num_restarts_ == 0) return;
+            SeekToRestartPoint(0);
+            ParseNextEntry();
+        }
+
+        void SeekToLast() {
+            if (num_restarts_ == 0) return;
+            SeekToRestartPoint(num_restarts_ - 1);
+            while (ParseNextEntry() && NextEntryOffset() < restarts_) {
+                // Keep skipping
+            }
+        }
+
+    private:
+        // An entry decoded by Prev; its key is in prev_keys_
+        struct CachedEntry {
+            uint32_t offset;
+            uint32_t key_offset;
+            uint32_t key_size;
+            Slice value;
+        };
+
+        uint32_t NextEntryOffset() const {
+            return static_cast<uint32_t>((value_.data() + value_.size()) - data_);
+        }
+
+        uint32_t GetRestartPoint(uint32_t index) const {
+            assert(index < num_restarts_);
+            return FixedEncode::DecodeFixed32(data_ + restarts_ + index * sizeof(uint32_t));
+        }
+
+        void SeekToRestartPoint(uint32_t index) {
+            key_.clear();
+            restart_index_ = index;
+            // current_ will be fixed by ParseNextEntry()
+            uint32_t offset = GetRestartPoint(index);
+            value_ = Slice(data_ + offset, 0);
+        }
+
+        // Decode the three varint32 lengths of the entry at p. Returns a
+        // pointer to the key delta, or nullptr on malformed input.
+        static const char* DecodeEntry(const char* p, const char* limit,
+                                       uint32_t* shared, uint32_t* non_shared,
+                                       uint32_t* value_length) {
+            if (!Varint::GetVarint32(&p, limit, shared)) return nullptr;
+            if (!Varint::GetVarint32(&p, limit, non_shared)) return nullptr;
+            if (!Varint::GetVarint32(&p, limit, value_length)) return nullptr;
+            if (static_cast<uint64_t>(limit - p) <
+                static_cast<uint64_t>(*non_shared) + *value_length) {
+                return nullptr;
+            }
+            return p;
+        }
+
+        bool ParseNextEntry() {
+            current_ = NextEntryOffset();
+            const char* p = data_ + current_;
+            const char* limit = data_ + restarts_;
+            if (p >= limit) {
+                // No more entries to return; mark as invalid
+                current_ = restarts_;
+                restart_index_ = num_restarts_;
+                return false;
+            }
+
+            uint32_t shared, non_shared, value_length;
+            p = DecodeEntry(p, limit, &shared, &non_shared, &value_length);
+            if (p == nullptr || key_.size() < shared) {
+                CorruptionError();
+                return false;
+            }
+
+            key_.resize(shared);
+            key_.append(p, non_shared);
+            value_ = Slice(p + non_shared, value_length);
+            while (restart_index_ + 1 < num_restarts_ &&
+                   GetRestartPoint(restart_index_ + 1) < current_) {
+                ++restart_index_;
+            }
+            return true;
+        }
+
+        void CorruptionError() {
+            current_ = restarts_;
+            restart_index_ = num_restarts_;
+            status_ = Status::Corruption("Bad entry in block");
+            key_.clear();
+            value_ = Slice();
+        }
+
+        KeyComparator const cmp_;
+        const char* const data_;      // Underlying block contents
+        uint32_t const restarts_;     // Offset of restart array
+        uint32_t const num_restarts_; // Number of uint32_t entries in restart array
+
+        uint32_t current_;            // Offset of current entry; >= restarts_ if !Valid
+        uint32_t restart_index_;      // Index of restart block containing current_
+        std::string key_;
+        Slice value_;
+        Status status_;
+
+        // Entries of the restart interval last decoded by Prev, and the
+        // index of the one the iterator was left at. Only used when
+        // current_ still points at that entry, so other moves need not
+        // reset them.
+        std::vector<CachedEntry> prev_entries_;
+        std::string prev_keys_;
+        size_t prev_index_ = 0;
+    };
+
+    Iterator* NewIterator(KeyComparator cmp = BytewiseCompare) const {
+        return new Iterator(this, cmp);
+    }
+
+private:
+    std::string data_;
+    uint32_t restart_offset_;  // Offset in data_ of restart array
+    uint32_t num_restarts_;
+};
+
+}  // namespace sstable
+}  // namespace lsm
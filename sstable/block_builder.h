@@ -32,8 +32,10 @@ namespace sstable {
 
 class BlockBuilder {
 public:
-    explicit BlockBuilder(int restart_interval = kDefaultRestartInterval)
-        : restart_interval_(restart_interval),
+    explicit BlockBuilder(int restart_interval = kDefaultRestartInterval,
+                          KeyComparator cmp = BytewiseCompare)
+        : cmp_(cmp),
+          restart_interval_(restart_interval),
           counter_(0),
           finished_(false) {
         assert(restart_interval >= 1);
@@ -54,7 +56,7 @@ public:
     void Add(Slice key, Slice value) {
         assert(!finished_);
         assert(counter_ <= restart_interval_);
-        assert(buffer_.empty() || key.compare(last_key_) > 0);
+        assert(buffer_.empty() || cmp_(key, last_key_) > 0);
 
         size_t shared = 0;
         if (counter_ < restart_interval_) {
@@ -115,6 +117,7 @@ public:
     }
 
 private:
+    KeyComparator cmp_;               // Orders keys (for sanity checks)
     std::string buffer_;              // Destination buffer
     std::vector<uint32_t> restarts_;  // Restart points
     std::string last_key_;            // Last key added
@@ -126,7 +129,8 @@ private:
 // Builds the index block: maps last key of each data block to its location
 class IndexBlockBuilder {
 public:
-    IndexBlockBuilder() : block_builder_(1) {}  // No prefix compression for index
+    explicit IndexBlockBuilder(KeyComparator cmp = BytewiseCompare)
+        : block_builder_(1, cmp) {}  // No prefix compression for index
 
     void AddEntry(Slice last_key, const BlockHandle& handle) {
         std::string handle_encoding = handle.Encode();
@@ -0,0 +1,192 @@
+// sstable/prefetch_buffer.h
+// Readahead buffer that turns sequential block reads into large file reads
+
+#pragma once
+
+#include "util/types.h"
+#include "util/file_reader.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lsm {
+namespace sstable {
+
+// FilePrefetchBuffer sits between a table iterator and its file. Each data
+// block read goes through Read(); when the iterator walks blocks in file
+// order, the buffer reads ahead so that many blocks are served from one
+// pread, and asks the kernel to start fetching the following window.
+//
+// Two modes:
+//   - fixed: readahead_size > 0, every buffer miss reads that many bytes
+//   - auto:  readahead starts after kSequentialReadsBeforeReadahead
+//            consecutive sequential reads at initial_size and doubles on
+//            every refill up to max_size; a random read resets it
+class FilePrefetchBuffer {
+public:
+    static constexpr size_t kDefaultInitialReadaheadSize = 8 * 1024;
+    static constexpr size_t kDefaultMaxReadaheadSize = 256 * 1024;
+    static constexpr int kSequentialReadsBeforeReadahead = 2;
+
+    FilePrefetchBuffer(const RandomAccessFileReader* file,
+                       size_t readahead_size,
+                       size_t initial_size = kDefaultInitialReadaheadSize,
+                       size_t max_size = kDefaultMaxReadaheadSize)
+        : file_(file),
+          fixed_(readahead_size > 0),
+          initial_size_(fixed_ ? readahead_size : initial_size),
+          max_size_(fixed_ ? readahead_size : std::max(initial_size, max_size)),
+          readahead_size_(initial_size_),
+          buffer_offset_(0),
+          prev_end_(0),
+          num_sequential_(0),
+          num_prefetches_(0) {}
+
+    FilePrefetchBuffer(const FilePrefetchBuffer&) = delete;
+    FilePrefetchBuffer& operator=(const FilePrefetchBuffer&) = delete;
+
+    // Read [offset, offset + n) into *result, from the buffer when possible
+    Status Read(uint64_t offset, size_t n, std::string* result) {
+        bool sequential = (offset == prev_end_);
+        prev_end_ = offset + n;
+
+        if (InBuffer(offset, n)) {
+            result->assign(buffer_.data() + (offset - buffer_offset_), n);
+            return Status::OK();
+        }
+
+        if (sequential) {
+            num_sequential_++;
+        } else {
+            num_sequential_ = 0;
+            if (!fixed_) readahead_size_ = initial_size_;
+        }
+
+        if (!fixed_ && num_sequential_ < kSequentialReadsBeforeReadahead) {
+            return file_->Read(offset, n, result);
+        }
+
+        // Refill the buffer with this read plus the readahead window
+        uint64_t file_size = file_->Size();
+        size_t len = std::max(n, readahead_size_);
+        if (offset + len > file_size) {
+            len = offset < file_size ? static_cast<size_t>(file_size - offset) : n;
+            len = std::max(len, n);
+        }
+
+        Status s = file_->Read(offset, len, &buffer_);
+        if (!s.ok()) {
+            buffer_.clear();
+            return s;
+        }
+        buffer_offset_ = offset;
+        num_prefetches_++;
+
+        // Let the kernel fetch the next window while we consume this one
+        uint64_t next = offset + len;
+        if (next < file_size) {
+            size_t next_len = fixed_ ? readahead_size_
+                                     : std::min(readahead_size_ * 2, max_size_);
+            file_->Prefetch(next, static_cast<size_t>(
+                std::min<uint64_t>(next_len, file_size - next)));
+        }
+
+        if (!fixed_) {
+            readahead_size_ = std::min(readahead_size_ * 2, max_size_);
+        }
+
+        result->assign(buffer_.data(), n);
+        return Status::OK();
+    }
+
+    // Fill the buffer with [offset, offset + n) in one read, e.g. a table's
+    // tail before its metadata is parsed; later Reads inside it are free
+    Status Prefetch(uint64_t offset, size_t n) {
+        Status s = file_->Read(offset, n, &buffer_);
+        if (!s.ok()) {
+            buffer_.clear();
+            return s;
+        }
+        buffer_offset_ = offset;
+        num_prefetches_++;
+        return Status::OK();
+    }
+
+    // Current readahead window (for tests and statistics)
+    size_t ReadaheadSize() const { return readahead_size_; }
+
+    // Number of buffer refills issued
+    uint64_t NumPrefetches() const { return num_prefetches_; }
+
+private:
+    bool InBuffer(uint64_t offset, size_t n) const {
+        return !buffer_.empty() &&
+               offset >= buffer_offset_ &&
+               offset + n <= buffer_offset_ + buffer_.size();
+    }
+
+    const RandomAccessFileReader* file_;
+    const bool fixed_;
+    const size_t initial_size_;
+    const size_t max_size_;
+    size_t readahead_size_;
+
+    std::string buffer_;
+    uint64_t buffer_offset_;
+    uint64_t prev_end_;
+    int num_sequential_;
+    uint64_t num_prefetches_;
+};
+
+// Learns how many bytes to read from the end of a table when opening it,
+// so the footer, metaindex, properties, index and filter usually come from
+// one read. Keeps the metadata sizes of the last kNumSamples tables opened
+// and suggests the largest of them for which the bytes wasted on the
+// smaller tables stay within 1/8 of all bytes read; a rare outlier then
+// costs itself an extra read instead of inflating every open. Shared by
+// the tables of a column family; safe for concurrent use.
+class TailPrefetchStats {
+public:
+    static constexpr size_t kNumSamples = 32;
+    static constexpr size_t kDefaultSize = 64 * 1024;  // Until a table was opened
+    static constexpr size_t kMaxSize = 512 * 1024;
+
+    void RecordMetadataSize(size_t size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (samples_.size() < kNumSamples) {
+            samples_.push_back(size);
+        } else {
+            samples_[next_] = size;
+        }
+        next_ = (next_ + 1) % kNumSamples;
+    }
+
+    size_t SuggestedPrefetchSize() const {
+        std::vector<size_t> sorted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (samples_.empty()) return kDefaultSize;
+            sorted = samples_;
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        // Prefetching sorted[i] wastes sorted[i] - sorted[j] on each j < i
+        size_t suggested = sorted[0];
+        size_t wasted = 0;
+        for (size_t i = 1; i < sorted.size(); i++) {
+            wasted += (sorted[i] - sorted[i - 1]) * i;
+            if (wasted <= sorted[i] * sorted.size() / 8) suggested = sorted[i];
+        }
+        return std::min(suggested, kMaxSize);
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<size_t> samples_;
+    size_t next_ = 0;
+};
+
+}  // namespace sstable
+}  // namespace lsm
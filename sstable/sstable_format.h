@@ -5,7 +5,10 @@
 
 #include "util/types.h"
 #include "util/bloom_filter.h"
+#include "util/cache.h"
+#include "util/env.h"
 #include <cstdint>
+#include <memory>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -14,18 +17,31 @@ namespace lsm {
 namespace sstable {
 
 // File format constants
-constexpr uint64_t kSSTableMagic = 0x53535461626C6531ULL;  // "SSTable1"
-constexpr size_t kFooterSize = 64;
+constexpr uint64_t kSSTableMagic = 0x53535461626C6533ULL;  // "SSTable3"
+constexpr uint32_t kTableFormatVersion = 1;
+constexpr size_t kFooterSize = 32;  // Padded metaindex handle (20) + version (4) + magic (8)
 constexpr size_t kBlockTrailerSize = 5;  // type (1) + crc (4)
 constexpr int kDefaultBlockSize = 4096;
 constexpr int kDefaultRestartInterval = 16;
 
+// Three-way key comparison used to order entries within a block
+using KeyComparator = int (*)(Slice a, Slice b);
+
+inline int BytewiseCompare(Slice a, Slice b) {
+    int r = a.compare(b);
+    return r < 0 ? -1 : (r > 0 ? +1 : 0);
+}
+
 // Block types
 enum class BlockType : uint8_t {
     kData = 0x00,
     kIndex = 0x01,
+    kMetaIndex = 0x02,
+    kProperties = 0x03,
 };
 
+class TailPrefetchStats;  // prefetch_buffer.h
+
 // SSTable options
 struct SSTableOptions {
     size_t block_size = kDefaultBlockSize;
@@ -35,6 +51,40 @@ struct SSTableOptions {
     // Bloom filter settings
     bool use_bloom_filter = true;
     BloomFilterPolicy bloom_policy;  // Default: 10 bits/key, ~1% FPR
+
+    // Auto-tuned iterator readahead (see ReadOptions::readahead_size)
+    size_t initial_readahead_size = 8 * 1024;
+    size_t max_readahead_size = 256 * 1024;
+
+    // Bytes read from the end of the file, in one read, when a table is
+    // opened; its metadata is parsed from them. 0 = the size suggested by
+    // tail_prefetch_stats (TailPrefetchStats::kDefaultSize without one).
+    size_t tail_prefetch_size = 0;
+
+    // Learns the tail size from earlier opens; every DB column family gets
+    // its own unless one is set here
+    std::shared_ptr<TailPrefetchStats> tail_prefetch_stats;
+
+    // Cache for uncompressed data blocks, shared by every table opened with
+    // these options (null = read blocks from the file on every access)
+    std::shared_ptr<Cache> block_cache;
+
+    // Also keep the result of each point lookup served by a table (value,
+    // tombstone or absence) in block_cache, keyed by file number and user
+    // key, so repeated lookups of a hot key skip its index and data blocks.
+    // Absence is only kept when a data block was searched, not when the
+    // filter ruled the key out. Rows and blocks share the cache's capacity.
+    // Only used by the DB's table cache, for reads at a snapshot that sees
+    // the whole table.
+    bool row_cache = false;
+
+    // Charge the index and filter blocks that open tables keep in memory,
+    // and the key hashes buffered while a table's filter is built, to
+    // block_cache's capacity (see Cache::Reserve)
+    bool charge_table_memory = false;
+
+    // Reads and writes table files (and, in a DB, blob files); not owned
+    Env* env = Env::Default();
 };
 
 // Block handle: pointer to a block in the file
@@ -80,124 +130,6 @@ private:
     }
 };
 
-// Footer: stored at the end of the file
-struct Footer {
-    BlockHandle index_handle;
-    BlockHandle bloom_handle;  // Bloom filter location
-    uint64_t num_entries = 0;
-    SequenceNumber min_sequence = 0;
-    SequenceNumber max_sequence = 0;
-    std::string min_key;
-    std::string max_key;
-
-    std::string Encode() const {
-        std::string result;
-        result.reserve(kFooterSize);
-
-        // Index handle
-        std::string handle_enc = index_handle.Encode();
-        PutFixed32(&result, static_cast<uint32_t>(handle_enc.size()));
-        result.append(handle_enc);
-
-        // Bloom filter handle
-        std::string bloom_enc = bloom_handle.Encode();
-        PutFixed32(&result, static_cast<uint32_t>(bloom_enc.size()));
-        result.append(bloom_enc);
-
-        // Metadata
-        PutFixed64(&result, num_entries);
-        PutFixed64(&result, min_sequence);
-        PutFixed64(&result, max_sequence);
-
-        // Keys (length-prefixed)
-        PutFixed32(&result, static_cast<uint32_t>(min_key.size()));
-        result.append(min_key);
-        PutFixed32(&result, static_cast<uint32_t>(max_key.size()));
-        result.append(max_key);
-
-        // Pad to fixed size minus magic
-        while (result.size() < kFooterSize - 8) {
-            result.push_back(0);
-        }
-
-        // Magic number
-        PutFixed64(&result, kSSTableMagic);
-
-        return result;
-    }
-
-    bool Decode(Slice input) {
-        if (input.size() < kFooterSize) return false;
-
-        // Start from the end to find magic
-        const char* p = input.data() + input.size() - 8;
-        uint64_t magic = DecodeFixed64(p);
-        if (magic != kSSTableMagic) return false;
-
-        // Decode from start
-        p = input.data();
-
-        // Index handle
-        uint32_t handle_len = DecodeFixed32(p);
-        p += 4;
-        Slice handle_slice(p, handle_len);
-        if (!index_handle.Decode(&handle_slice)) return false;
-        p += handle_len;
-
-        // Bloom filter handle
-        uint32_t bloom_len = DecodeFixed32(p);
-        p += 4;
-        Slice bloom_slice(p, bloom_len);
-        if (!bloom_handle.Decode(&bloom_slice)) return false;
-        p += bloom_len;
-
-        num_entries = DecodeFixed64(p); p += 8;
-        min_sequence = DecodeFixed64(p); p += 8;
-        max_sequence = DecodeFixed64(p); p += 8;
-
-        uint32_t min_key_len = DecodeFixed32(p); p += 4;
-        min_key.assign(p, min_key_len); p += min_key_len;
-
-        uint32_t max_key_len = DecodeFixed32(p); p += 4;
-        max_key.assign(p, max_key_len);
-
-        return true;
-    }
-
-private:
-    static void PutFixed32(std::string* dst, uint32_t val) {
-        char buf[4];
-        buf[0] = val & 0xff;
-        buf[1] = (val >> 8) & 0xff;
-        buf[2] = (val >> 16) & 0xff;
-        buf[3] = (val >> 24) & 0xff;
-        dst->append(buf, 4);
-    }
-
-    static void PutFixed64(std::string* dst, uint64_t val) {
-        char buf[8];
-        for (int i = 0; i < 8; i++) {
-            buf[i] = (val >> (i * 8)) & 0xff;
-        }
-        dst->append(buf, 8);
-    }
-
-    static uint32_t DecodeFixed32(const char* p) {
-        return static_cast<uint8_t>(p[0]) |
-               (static_cast<uint8_t>(p[1]) << 8) |
-               (static_cast<uint8_t>(p[2]) << 16) |
-               (static_cast<uint8_t>(p[3]) << 24);
-    }
-
-    static uint64_t DecodeFixed64(const char* p) {
-        uint64_t result = 0;
-        for (int i = 0; i < 8; i++) {
-            result |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (i * 8);
-        }
-        return result;
-    }
-};
-
 // Varint encoding utilities
 class Varint {
 public:
@@ -301,5 +233,108 @@ public:
     }
 };
 
+// Footer: the last kFooterSize bytes of the file
+//
+//   metaindex_handle  varint64 offset and size, zero-padded to
+//                     BlockHandle::kMaxEncodedLength
+//   format_version    fixed32
+//   magic             fixed64
+//
+// Everything else a reader needs (index, filter, properties) is located
+// through the metaindex block, so new kinds of metadata never change the
+// footer. See table_properties.h.
+struct Footer {
+    BlockHandle metaindex_handle;
+    uint32_t format_version = kTableFormatVersion;
+
+    std::string Encode() const {
+        std::string result = metaindex_handle.Encode();
+        result.resize(BlockHandle::kMaxEncodedLength, '\0');
+        FixedEncode::PutFixed32(&result, format_version);
+        FixedEncode::PutFixed64(&result, kSSTableMagic);
+        return result;
+    }
+
+    // Decode a footer; `input` must end where the footer ends
+    bool Decode(Slice input) {
+        if (input.size() < kFooterSize) return false;
+        const char* p = input.data() + input.size() - kFooterSize;
+        if (FixedEncode::DecodeFixed64(p + kFooterSize - 8) != kSSTableMagic) return false;
+        format_version = FixedEncode::DecodeFixed32(p + BlockHandle::kMaxEncodedLength);
+        if (format_version == 0 || format_version > kTableFormatVersion) return false;
+        Slice handle(p, BlockHandle::kMaxEncodedLength);
+        return metaindex_handle.Decode(&handle);
+    }
+};
+
+// Internal key encoding: user_key | fixed64((sequence << 8) | type)
+//
+// Internal keys order by user key ascending, then by sequence descending, so
+// the newest version of a key is encountered first.
+constexpr size_t kInternalKeyTrailerSize = 8;
+
+// Largest sequence that fits in the 56 bits of the packed trailer
+constexpr SequenceNumber kMaxInternalSequence = (1ULL << 56) - 1;
+
+// Seek targets use the highest value type so that, for equal sequence
+// numbers, the seek key sorts before every stored entry
+constexpr ValueType kValueTypeForSeek = ValueType::kBlobIndex;
+
+struct ParsedInternalKey {
+    Slice user_key;
+    SequenceNumber sequence = 0;
+    ValueType type = ValueType::kValue;
+};
+
+inline void AppendInternalKey(std::string* dst, Slice user_key,
+                              SequenceNumber seq, ValueType type) {
+    dst->append(user_key.data(), user_key.size());
+    uint64_t packed = (seq << 8) | static_cast<uint8_t>(type);
+    FixedEncode::PutFixed64(dst, packed);
+}
+
+inline std::string EncodeInternalKey(Slice user_key, SequenceNumber seq,
+                                     ValueType type) {
+    std::string result;
+    result.reserve(user_key.size() + kInternalKeyTrailerSize);
+    AppendInternalKey(&result, user_key, seq, type);
+    return result;
+}
+
+// Internal key that sorts before every entry for user_key visible at snapshot
+inline std::string EncodeSeekKey(Slice user_key, SequenceNumber snapshot) {
+    if (snapshot > kMaxInternalSequence) snapshot = kMaxInternalSequence;
+    return EncodeInternalKey(user_key, snapshot, kValueTypeForSeek);
+}
+
+inline Slice ExtractUserKey(Slice internal_key) {
+    if (internal_key.size() < kInternalKeyTrailerSize) return internal_key;
+    return internal_key.substr(0, internal_key.size() - kInternalKeyTrailerSize);
+}
+
+inline bool ParseInternalKey(Slice internal_key, ParsedInternalKey* result) {
+    if (internal_key.size() < kInternalKeyTrailerSize) return false;
+    size_t n = internal_key.size() - kInternalKeyTrailerSize;
+    uint64_t packed = FixedEncode::DecodeFixed64(internal_key.data() + n);
+    result->user_key = internal_key.substr(0, n);
+    result->sequence = packed >> 8;
+    result->type = static_cast<ValueType>(packed & 0xff);
+    return true;
+}
+
+// Compare two encoded internal keys (user key asc, sequence/type desc)
+inline int CompareInternalKeys(Slice a, Slice b) {
+    int r = ExtractUserKey(a).compare(ExtractUserKey(b));
+    if (r != 0) return r < 0 ? -1 : +1;
+    if (a.size() < kInternalKeyTrailerSize || b.size() < kInternalKeyTrailerSize) {
+        return a.size() < b.size() ? -1 : (a.size() > b.size() ? +1 : 0);
+    }
+    uint64_t pa = FixedEncode::DecodeFixed64(a.data() + a.size() - kInternalKeyTrailerSize);
+    uint64_t pb = FixedEncode::DecodeFixed64(b.data() + b.size() - kInternalKeyTrailerSize);
+    if (pa > pb) return -1;
+    if (pa < pb) return +1;
+    return 0;
+}
+
 }  // namespace sstable
 }  // namespace lsm
\ No newline at end of file
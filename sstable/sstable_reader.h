@@ -0,0 +1,521 @@
+// sstable/sstable_reader.h
+// Reads SSTable files: point lookups and ordered iteration
+
+#pragma once
+
+#include "util/types.h"
+#include "util/bloom_filter.h"
+#include "util/file_reader.h"
+#include "util/perf_context.h"
+#include "util/pinnable_slice.h"
+#include "sstable/sstable_format.h"
+#include "sstable/block_builder.h"
+#include "sstable/block.h"
+#include "sstable/prefetch_buffer.h"
+#include "sstable/table_properties.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+namespace lsm {
+namespace sstable {
+
+// Data blocks move to and from a secondary block cache tier as their
+// contents (trailer stripped)
+inline const CacheItemHelper kBlockCacheItemHelper = {
+    [](const void* value) { return static_cast<const Block*>(value)->contents(); },
+    [](std::string contents, size_t* charge) -> std::shared_ptr<void> {
+        auto block = std::make_shared<Block>(std::move(contents));
+        if (!block->ok()) return nullptr;
+        *charge = block->size();
+        return block;
+    },
+};
+
+class SSTableReader {
+public:
+    // Open an SSTable: reads the footer, metaindex, properties, index block
+    // and bloom filter, usually all from one read of the file's tail (see
+    // SSTableOptions::tail_prefetch_size)
+    static Status Open(const std::string& path,
+                       const SSTableOptions& options,
+                       std::unique_ptr<SSTableReader>* reader) {
+        auto file = std::make_unique<RandomAccessFileReader>(path, options.env);
+        Status s = file->Open();
+        if (!s.ok()) return s;
+
+        std::unique_ptr<SSTableReader> table(new SSTableReader(std::move(file), options));
+        s = table->ReadMetadata();
+        if (!s.ok()) return s;
+
+        *reader = std::move(table);
+        return Status::OK();
+    }
+
+    SSTableReader(const SSTableReader&) = delete;
+    SSTableReader& operator=(const SSTableReader&) = delete;
+
+    // Check the bloom filter; false means the key is definitely absent
+    bool KeyMayMatch(Slice user_key) const {
+        if (!has_bloom_) return true;
+        PerfCounterAdd(&PerfContext::bloom_sst_probe_count);
+        if (bloom_.MayContain(user_key)) return true;
+        PerfCounterAdd(&PerfContext::bloom_sst_miss_count);
+        return false;
+    }
+
+    // Check the table's key range against the iterator bounds; false means
+    // no key in this table can fall inside [lower, upper)
+    bool MayOverlapBounds(const ReadOptions& read_options) const {
+        if (properties_.num_entries == 0) return false;
+        if (read_options.BelowLowerBound(properties_.largest_key)) return false;
+        if (read_options.AtOrAboveUpperBound(properties_.smallest_key)) return false;
+        return true;
+    }
+
+    // Look up the newest version of user_key with sequence <= snapshot.
+    // Sets *result to Found/Deleted, or NotFound if the table has no entry.
+    Status Get(const ReadOptions& read_options, Slice user_key,
+               SequenceNumber snapshot, LookupResult* result) const {
+        PinnableSlice value;
+        GetState state;
+        Status s = Get(read_options, user_key, snapshot, &value, &state);
+        if (!s.ok()) return s;
+
+        switch (state) {
+            case GetState::kFound:    *result = LookupResult::Found(value.ToString()); break;
+            // The raw reference; resolving it needs the DB's blob files
+            case GetState::kBlobIndex: *result = LookupResult::Found(value.ToString()); break;
+            case GetState::kDeleted:  *result = LookupResult::Deleted(); break;
+            case GetState::kNotFound: *result = LookupResult::NotFound(); break;
+        }
+        return Status::OK();
+    }
+
+    // Zero-copy variant: on kFound, *value points into the data block and
+    // pins it (through the block cache entry, if any) until released.
+    // Bytes read from the file (block cache misses) are added to
+    // *bytes_read when it is given. *searched_block, when given, is set to
+    // whether a data block was searched; if not, the filter or the index
+    // ruled the key out.
+    Status Get(const ReadOptions& read_options, Slice user_key,
+               SequenceNumber snapshot, PinnableSlice* value, GetState* state,
+               uint64_t* bytes_read = nullptr, bool* searched_block = nullptr) const {
+        *state = GetState::kNotFound;
+        if (searched_block != nullptr) *searched_block = false;
+
+        if (!KeyMayMatch(user_key)) {
+            return Status::OK();
+        }
+
+        std::string seek_key = EncodeSeekKey(user_key, snapshot);
+
+        Block::Iterator index_iter(index_block_.get(), CompareInternalKeys);
+        index_iter.Seek(seek_key);
+        if (!index_iter.Valid()) {
+            return index_iter.status();
+        }
+
+        BlockHandle handle;
+        Slice handle_input = index_iter.value();
+        if (!handle.Decode(&handle_input)) {
+            return Status::Corruption("Bad block handle in index");
+        }
+
+        std::shared_ptr<Block> block;
+        Status s = ReadBlock(read_options, handle, BlockType::kData, nullptr, &block,
+                             bytes_read);
+        if (!s.ok()) return s;
+
+        if (searched_block != nullptr) *searched_block = true;
+        Block::Iterator iter(block.get(), CompareInternalKeys);
+        iter.Seek(seek_key);
+        if (!iter.Valid()) {
+            return iter.status();
+        }
+
+        ParsedInternalKey parsed;
+        if (!ParseInternalKey(iter.key(), &parsed)) {
+            return Status::Corruption("Bad internal key");
+        }
+        if (parsed.user_key == user_key) {
+            if (parsed.type == ValueType::kDeletion) {
+                *state = GetState::kDeleted;
+            } else {
+                *state = parsed.type == ValueType::kBlobIndex ? GetState::kBlobIndex
+                                                              : GetState::kFound;
+                // The release callback owns a block reference; running and
+                // destroying it unpins the block
+                value->PinSlice(iter.value(), [block]() {});
+            }
+        }
+        return Status::OK();
+    }
+
+    // Two-level iterator over the table's internal keys: walks the index
+    // block and loads each data block on demand. Data block reads go through
+    // a FilePrefetchBuffer so that long scans issue large sequential reads.
+    class Iterator {
+    public:
+        Iterator(const SSTableReader* table, const ReadOptions& read_options)
+            : table_(table),
+              read_options_(read_options),
+              index_iter_(table->index_block_.get(), CompareInternalKeys),
+              prefetch_(table->file_.get(), read_options.readahead_size,
+                        table->options_.initial_readahead_size,
+                        table->options_.max_readahead_size) {}
+
+        Iterator(const Iterator&) = delete;
+        Iterator& operator=(const Iterator&) = delete;
+
+        bool Valid() const { return data_iter_ && data_iter_->Valid(); }
+
+        // Internal key (user_key | packed sequence and type)
+        Slice key() const { return data_iter_->key(); }
+        Slice value() const { return data_iter_->value(); }
+
+        Status status() const {
+            if (!status_.ok()) return status_;
+            if (!index_iter_.status().ok()) return index_iter_.status();
+            if (data_iter_ && !data_iter_->status().ok()) return data_iter_->status();
+            return Status::OK();
+        }
+
+        void SeekToFirst() {
+            index_iter_.SeekToFirst();
+            InitDataBlock();
+            if (data_iter_) data_iter_->SeekToFirst();
+            SkipEmptyDataBlocksForward();
+        }
+
+        void SeekToLast() {
+            index_iter_.SeekToLast();
+            InitDataBlock();
+            if (data_iter_) data_iter_->SeekToLast();
+            SkipEmptyDataBlocksBackward();
+        }
+
+        // Position at the first entry with internal key >= target
+        void Seek(Slice target) {
+            index_iter_.Seek(target);
+            InitDataBlock();
+            if (data_iter_) data_iter_->Seek(target);
+            SkipEmptyDataBlocksForward();
+        }
+
+        void Next() {
+            data_iter_->Next();
+            SkipEmptyDataBlocksForward();
+        }
+
+        void Prev() {
+            data_iter_->Prev();
+            SkipEmptyDataBlocksBackward();
+        }
+
+        // Readahead state, for tests and statistics
+        const FilePrefetchBuffer& prefetch_buffer() const { return prefetch_; }
+
+    private:
+        void InitDataBlock() {
+            if (!index_iter_.Valid()) {
+                ResetDataBlock();
+                return;
+            }
+
+            Slice handle_input = index_iter_.value();
+            BlockHandle handle;
+            if (!handle.Decode(&handle_input)) {
+                status_ = Status::Corruption("Bad block handle in index");
+                ResetDataBlock();
+                return;
+            }
+
+            if (data_iter_ && handle.offset == data_block_offset_) {
+                return;  // Already loaded
+            }
+
+            ResetDataBlock();
+            Status s = table_->ReadBlock(read_options_, handle, BlockType::kData,
+                                         &prefetch_, &data_block_);
+            if (!s.ok()) {
+                status_ = s;
+                return;
+            }
+            data_iter_.reset(data_block_->NewIterator(CompareInternalKeys));
+            data_block_offset_ = handle.offset;
+        }
+
+        void ResetDataBlock() {
+            data_iter_.reset();
+            data_block_.reset();
+            data_block_offset_ = UINT64_MAX;
+        }
+
+        void SkipEmptyDataBlocksForward() {
+            while (!data_iter_ || !data_iter_->Valid()) {
+                if (!index_iter_.Valid() || !status_.ok()) {
+                    ResetDataBlock();
+                    return;
+                }
+                // The index key is the block's last key; if it already
+                // reaches the upper bound, every later block lies past it
+                if (read_options_.AtOrAboveUpperBound(ExtractUserKey(index_iter_.key()))) {
+                    ResetDataBlock();
+                    return;
+                }
+                index_iter_.Next();
+                InitDataBlock();
+                if (data_iter_) data_iter_->SeekToFirst();
+            }
+        }
+
+        void SkipEmptyDataBlocksBackward() {
+            while (!data_iter_ || !data_iter_->Valid()) {
+                if (!index_iter_.Valid() || !status_.ok()) {
+                    ResetDataBlock();
+                    return;
+                }
+                index_iter_.Prev();
+                // A previous block whose last key is below the lower bound
+                // holds nothing in range, nor does anything before it
+                if (index_iter_.Valid() &&
+                    read_options_.BelowLowerBound(ExtractUserKey(index_iter_.key()))) {
+                    ResetDataBlock();
+                    return;
+                }
+                InitDataBlock();
+                if (data_iter_) data_iter_->SeekToLast();
+            }
+        }
+
+        const SSTableReader* table_;
+        ReadOptions read_options_;
+        Block::Iterator index_iter_;
+        FilePrefetchBuffer prefetch_;
+
+        std::shared_ptr<Block> data_block_;
+        std::unique_ptr<Block::Iterator> data_iter_;
+        uint64_t data_block_offset_ = UINT64_MAX;
+        Status status_;
+    };
+
+    Iterator* NewIterator(const ReadOptions& read_options = ReadOptions()) const {
+        return new Iterator(this, read_options);
+    }
+
+    // Read every data block and check its checksum, bypassing the block
+    // cache; the metadata blocks were checked when the table was opened
+    Status VerifyChecksums() const {
+        FilePrefetchBuffer prefetch(file_.get(), 0, options_.initial_readahead_size,
+                                    options_.max_readahead_size);
+        Block::Iterator index_iter(index_block_.get(), CompareInternalKeys);
+        std::string contents;
+        for (index_iter.SeekToFirst(); index_iter.Valid(); index_iter.Next()) {
+            BlockHandle handle;
+            Slice handle_input = index_iter.value();
+            if (!handle.Decode(&handle_input)) {
+                return Status::Corruption("Bad block handle in index");
+            }
+            if (handle.size < kBlockTrailerSize ||
+                handle.offset + handle.size > file_->Size()) {
+                return Status::Corruption("Block handle out of range: " + Path());
+            }
+            Status s = prefetch.Read(handle.offset, handle.size, &contents);
+            if (!s.ok()) return s;
+            if (!BlockTrailer::VerifyTrailer(contents, BlockType::kData)) {
+                return Status::Corruption("Block checksum mismatch: " + Path());
+            }
+        }
+        return index_iter.status();
+    }
+
+    // Read the data block at handle into the block cache, unless it is
+    // already there; *bytes_read counts the bytes read from the file
+    Status CacheBlock(const BlockHandle& handle, uint64_t* bytes_read) const {
+        if (!options_.block_cache) return Status::OK();
+        std::shared_ptr<Block> block;
+        return ReadBlock(ReadOptions(), handle, BlockType::kData, nullptr, &block, bytes_read);
+    }
+
+    // Block cache keys are this table's cache id and the block offset
+    uint64_t cache_id() const { return cache_id_; }
+
+    static bool ParseBlockCacheKey(Slice key, uint64_t* cache_id, uint64_t* offset) {
+        if (key.size() != 16) return false;
+        *cache_id = FixedEncode::DecodeFixed64(key.data());
+        *offset = FixedEncode::DecodeFixed64(key.data() + 8);
+        return true;
+    }
+
+    const TableProperties& GetProperties() const { return properties_; }
+    const std::string& Path() const { return file_->Path(); }
+    uint64_t FileSize() const { return file_->Size(); }
+
+    // Underlying file, for I/O accounting
+    const RandomAccessFileReader* file() const { return file_.get(); }
+
+private:
+    SSTableReader(std::unique_ptr<RandomAccessFileReader> file,
+                  const SSTableOptions& options)
+        : file_(std::move(file)),
+          options_(options),
+          cache_id_(options.block_cache ? options.block_cache->NewId() : 0),
+          has_bloom_(false) {}
+
+    Status ReadMetadata() {
+        uint64_t file_size = file_->Size();
+        if (file_size < kFooterSize) {
+            return Status::Corruption("File too short to be an SSTable: " + Path());
+        }
+
+        // One read of the tail usually holds all the metadata below
+        size_t tail_size = options_.tail_prefetch_size;
+        if (tail_size == 0) {
+            tail_size = options_.tail_prefetch_stats
+                ? options_.tail_prefetch_stats->SuggestedPrefetchSize()
+                : TailPrefetchStats::kDefaultSize;
+        }
+        tail_size = static_cast<size_t>(std::min<uint64_t>(
+            std::max(tail_size, kFooterSize), file_size));
+        FilePrefetchBuffer tail(file_.get(), 0);
+        Status s = tail.Prefetch(file_size - tail_size, tail_size);
+        if (!s.ok()) return s;
+
+        // Footer
+        std::string footer_data;
+        s = tail.Read(file_size - kFooterSize, kFooterSize, &footer_data);
+        if (!s.ok()) return s;
+        Footer footer;
+        if (!footer.Decode(footer_data)) {
+            return Status::Corruption("Bad SSTable footer: " + Path());
+        }
+
+        // Metaindex
+        ReadOptions read_options;
+        read_options.verify_checksums = options_.verify_checksums;
+        std::shared_ptr<Block> metaindex;
+        s = ReadBlock(read_options, footer.metaindex_handle, BlockType::kMetaIndex,
+                      &tail, &metaindex);
+        if (!s.ok()) return s;
+        uint64_t metadata_offset = footer.metaindex_handle.offset;
+
+        // Properties
+        BlockHandle handle;
+        s = FindMetaBlock(*metaindex, kPropertiesBlockName, &handle);
+        if (s.IsNotFound()) return Status::Corruption("Missing table properties: " + Path());
+        if (!s.ok()) return s;
+        std::shared_ptr<Block> properties;
+        s = ReadBlock(read_options, handle, BlockType::kProperties, &tail, &properties);
+        if (!s.ok()) return s;
+        s = properties_.Decode(*properties);
+        if (!s.ok()) return s;
+        metadata_offset = std::min(metadata_offset, handle.offset);
+
+        // Index block
+        s = FindMetaBlock(*metaindex, kIndexBlockName, &handle);
+        if (s.IsNotFound()) return Status::Corruption("Missing index block: " + Path());
+        if (!s.ok()) return s;
+        s = ReadBlock(read_options, handle, BlockType::kIndex, &tail, &index_block_);
+        if (!s.ok()) return s;
+        metadata_offset = std::min(metadata_offset, handle.offset);
+
+        // Bloom filter (stored without a block trailer)
+        s = FindMetaBlock(*metaindex, kFilterBlockName, &handle);
+        if (s.ok()) {
+            if (handle.offset + handle.size > file_size) {
+                return Status::Corruption("Block handle out of range: " + Path());
+            }
+            metadata_offset = std::min(metadata_offset, handle.offset);
+            if (options_.use_bloom_filter) {
+                s = tail.Read(handle.offset, handle.size, &bloom_data_);
+                if (!s.ok()) return s;
+                has_bloom_ = bloom_.Init(bloom_data_);
+            }
+        } else if (!s.IsNotFound()) {
+            return s;
+        }
+
+        if (options_.tail_prefetch_stats) {
+            options_.tail_prefetch_stats->RecordMetadataSize(
+                static_cast<size_t>(file_size - metadata_offset));
+        }
+
+        if (options_.charge_table_memory && options_.block_cache) {
+            metadata_reservation_ = std::make_unique<CacheReservation>(options_.block_cache);
+            metadata_reservation_->Update(index_block_->size() + bloom_data_.size());
+        }
+        return Status::OK();
+    }
+
+    // Data blocks are served from the block cache when one is configured;
+    // on a miss the block read from the file is inserted for later readers
+    Status ReadBlock(const ReadOptions& read_options, const BlockHandle& handle,
+                     BlockType type, FilePrefetchBuffer* prefetch,
+                     std::shared_ptr<Block>* block, uint64_t* bytes_read = nullptr) const {
+        if (handle.size < kBlockTrailerSize ||
+            handle.offset + handle.size > file_->Size()) {
+            return Status::Corruption("Block handle out of range: " + Path());
+        }
+
+        Cache* cache = type == BlockType::kData ? options_.block_cache.get() : nullptr;
+        std::string cache_key;
+        if (cache != nullptr) {
+            FixedEncode::PutFixed64(&cache_key, cache_id_);
+            FixedEncode::PutFixed64(&cache_key, handle.offset);
+            *block = cache->Lookup<Block>(cache_key, &kBlockCacheItemHelper);
+            if (*block) {
+                PerfCounterAdd(&PerfContext::block_cache_hit_count);
+                return Status::OK();
+            }
+        }
+
+        std::string contents;
+        {
+            PerfTimer perf_timer(&PerfContext::block_read_nanos);
+            Status s = prefetch != nullptr
+                ? prefetch->Read(handle.offset, handle.size, &contents)
+                : file_->Read(handle.offset, handle.size, &contents);
+            if (!s.ok()) return s;
+        }
+        PerfCounterAdd(&PerfContext::block_read_count);
+        PerfCounterAdd(&PerfContext::block_read_bytes, contents.size());
+        if (bytes_read != nullptr) *bytes_read += contents.size();
+
+        if (read_options.verify_checksums) {
+            PerfTimer perf_timer(&PerfContext::block_checksum_nanos);
+            if (!BlockTrailer::VerifyTrailer(contents, type)) {
+                return Status::Corruption("Block checksum mismatch: " + Path());
+            }
+        }
+
+        contents.resize(contents.size() - kBlockTrailerSize);
+        *block = std::make_shared<Block>(std::move(contents));
+        if (!(*block)->ok()) {
+            block->reset();
+            return Status::Corruption("Bad block contents: " + Path());
+        }
+        if (cache != nullptr) {
+            cache->Insert(cache_key, *block, (*block)->size(), &kBlockCacheItemHelper);
+        }
+        return Status::OK();
+    }
+
+    std::unique_ptr<RandomAccessFileReader> file_;
+    SSTableOptions options_;
+    uint64_t cache_id_;  // Prefix of this table's block cache keys
+    TableProperties properties_;
+    std::shared_ptr<Block> index_block_;
+
+    std::string bloom_data_;
+    BloomFilterReader bloom_;
+    bool has_bloom_;
+
+    // Charges the index and filter above to the block cache while the
+    // table is open (charge_table_memory)
+    std::unique_ptr<CacheReservation> metadata_reservation_;
+};
+
+}  // namespace sstable
+}  // namespace lsm
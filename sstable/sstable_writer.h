@@ -5,14 +5,13 @@
 
 #include "util/types.h"
 #include "util/bloom_filter.h"
+#include "util/env.h"
 #include "sstable/sstable_format.h"
 #include "sstable/block_builder.h"
+#include "sstable/table_properties.h"
 #include "db/memtable.h"
 
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/stat.h>
-
+#include <ctime>
 #include <string>
 #include <memory>
 
@@ -28,8 +27,12 @@ struct SSTableWriteStats {
     size_t num_data_blocks = 0;   // Number of data blocks
     size_t raw_key_size = 0;      // Uncompressed key bytes
     size_t raw_value_size = 0;    // Uncompressed value bytes
+    size_t num_deletions = 0;     // Tombstones written
+    size_t file_size = 0;         // Total bytes written, including footer
     SequenceNumber min_seq = kMaxSequenceNumber;
     SequenceNumber max_seq = 0;
+    std::string smallest_key;     // First user key in the file
+    std::string largest_key;      // Last user key in the file
 };
 
 class SSTableWriter {
@@ -37,9 +40,9 @@ public:
     SSTableWriter(const std::string& path, const SSTableOptions& options = SSTableOptions())
         : path_(path),
           options_(options),
-          fd_(-1),
           offset_(0),
-          data_block_(options.restart_interval),
+          data_block_(options.restart_interval, CompareInternalKeys),
+          index_builder_(CompareInternalKeys),
           bloom_builder_(options.bloom_policy),
           closed_(false),
           num_entries_(0),
@@ -57,8 +60,8 @@ public:
 
     // Open the file for writing
     Status Open() {
-        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
-        if (fd_ < 0) {
+        Status s = options_.env->NewWritableFile(path_, &file_);
+        if (!s.ok()) {
             return Status::IOError("Failed to create SSTable: " + path_);
         }
         return Status::OK();
@@ -66,7 +69,7 @@ public:
 
     // Add a key-value entry (must be called in sorted order)
     Status Add(Slice key, Slice value, SequenceNumber seq, ValueType type) {
-        if (fd_ < 0) {
+        if (!file_) {
             return Status::IOError("SSTable not open");
         }
 
@@ -91,10 +94,20 @@ public:
         // Add user key to bloom filter
         if (options_.use_bloom_filter) {
             bloom_builder_.AddKey(key);
+            if (options_.charge_table_memory && options_.block_cache) {
+                if (!bloom_reservation_) {
+                    bloom_reservation_ = std::make_unique<CacheReservation>(
+                        options_.block_cache, kBloomReservationUnit);
+                }
+                bloom_reservation_->Update(bloom_builder_.MemoryUsage());
+            }
         }
 
         stats_.raw_key_size += key.size();
         stats_.raw_value_size += value.size();
+        if (type == ValueType::kDeletion) {
+            stats_.num_deletions++;
+        }
 
         // Flush block if it's large enough
         if (data_block_.CurrentSizeEstimate() >= options_.block_size) {
@@ -112,7 +125,7 @@ public:
 
     // Finish writing the SSTable
     Status Finish(SSTableWriteStats* stats = nullptr) {
-        if (fd_ < 0) {
+        if (!file_) {
             return Status::IOError("SSTable not open");
         }
 
@@ -132,18 +145,27 @@ public:
         s = WriteBloomFilter(&bloom_handle);
         if (!s.ok()) return s;
 
-        // Write footer
-        s = WriteFooter(index_handle, bloom_handle);
+        // Write properties
+        BlockHandle properties_handle;
+        s = WritePropertiesBlock(&properties_handle);
+        if (!s.ok()) return s;
+
+        // Write metaindex and footer
+        MetaIndexBuilder metaindex;
+        metaindex.Add(kIndexBlockName, index_handle);
+        if (bloom_handle.size > 0) metaindex.Add(kFilterBlockName, bloom_handle);
+        metaindex.Add(kPropertiesBlockName, properties_handle);
+        s = WriteFooter(metaindex);
         if (!s.ok()) return s;
 
         // Sync and close
-        if (::fsync(fd_) != 0) {
+        if (!file_->Sync().ok()) {
             return Status::IOError("Failed to sync SSTable");
         }
-        if (::close(fd_) != 0) {
+        if (!file_->Close().ok()) {
             return Status::IOError("Failed to close SSTable");
         }
-        fd_ = -1;
+        file_.reset();
         closed_ = true;
 
         // Return stats if requested
@@ -153,6 +175,11 @@ public:
             stats->min_seq = min_sequence_;
             stats->max_seq = max_sequence_;
             stats->bloom_size = stats_.bloom_size;
+            stats->file_size = offset_;
+            if (num_entries_ > 0) {
+                stats->smallest_key = std::string(ExtractUserKey(first_key_));
+                stats->largest_key = std::string(ExtractUserKey(last_key_));
+            }
         }
 
         return Status::OK();
@@ -160,10 +187,9 @@ public:
 
     // Abandon the file (delete partial writes)
     void Abandon() {
-        if (fd_ >= 0) {
-            ::close(fd_);
-            fd_ = -1;
-            ::unlink(path_.c_str());
+        if (file_) {
+            file_.reset();
+            options_.env->DeleteFile(path_);
         }
         closed_ = true;
     }
@@ -194,21 +220,10 @@ public:
     const std::string& Path() const { return path_; }
     size_t NumEntries() const { return num_entries_; }
 
-private:
-    std::string EncodeInternalKey(Slice user_key, SequenceNumber seq, ValueType type) {
-        std::string result;
-        result.reserve(user_key.size() + 8);
-        result.append(user_key.data(), user_key.size());
-
-        // Pack sequence and type: (seq << 8) | type
-        uint64_t packed = (seq << 8) | static_cast<uint8_t>(type);
-        char buf[8];
-        FixedEncode::EncodeFixed64(buf, packed);
-        result.append(buf, 8);
-
-        return result;
-    }
+    // Bytes written so far (excludes the block still being built)
+    uint64_t FileSize() const { return offset_; }
 
+private:
     Status FlushDataBlock() {
         if (data_block_.Empty()) {
             return Status::OK();
@@ -263,6 +278,7 @@ private:
         }
 
         std::string bloom_data = bloom_builder_.Finish();
+        bloom_reservation_.reset();
 
         handle->offset = offset_;
         handle->size = bloom_data.size();
@@ -272,58 +288,62 @@ private:
         return WriteRaw(bloom_data);
     }
 
-    Status WriteFooter(const BlockHandle& index_handle, const BlockHandle& bloom_handle) {
-        Footer footer;
-        footer.index_handle = index_handle;
-        footer.bloom_handle = bloom_handle;
-        footer.num_entries = num_entries_;
-        footer.min_sequence = min_sequence_;
-        footer.max_sequence = max_sequence_;
-
-        // Extract user keys from internal keys
-        if (!first_key_.empty()) {
-            footer.min_key = ExtractUserKey(first_key_);
-        }
-        if (!last_key_.empty()) {
-            footer.max_key = ExtractUserKey(last_key_);
+    Status WritePropertiesBlock(BlockHandle* handle) {
+        TableProperties props;
+        props.num_entries = num_entries_;
+        props.num_deletions = stats_.num_deletions;
+        props.num_data_blocks = stats_.num_data_blocks;
+        props.data_size = stats_.data_size;
+        props.index_size = stats_.index_size;
+        props.filter_size = stats_.bloom_size;
+        props.raw_key_size = stats_.raw_key_size;
+        props.raw_value_size = stats_.raw_value_size;
+        if (num_entries_ > 0) {
+            props.min_sequence = min_sequence_;
+            props.max_sequence = max_sequence_;
+            props.smallest_key = std::string(ExtractUserKey(first_key_));
+            props.largest_key = std::string(ExtractUserKey(last_key_));
         }
+        props.creation_time = static_cast<uint64_t>(std::time(nullptr));
 
-        std::string footer_data = footer.Encode();
-        return WriteRaw(footer_data);
+        std::string block = BlockTrailer::AddTrailer(props.Encode(), BlockType::kProperties);
+        handle->offset = offset_;
+        handle->size = block.size();
+        return WriteRaw(block);
     }
 
-    std::string ExtractUserKey(const std::string& internal_key) {
-        if (internal_key.size() < 8) return internal_key;
-        return internal_key.substr(0, internal_key.size() - 8);
+    Status WriteFooter(const MetaIndexBuilder& metaindex) {
+        std::string block = BlockTrailer::AddTrailer(metaindex.Finish(), BlockType::kMetaIndex);
+        Footer footer;
+        footer.metaindex_handle.offset = offset_;
+        footer.metaindex_handle.size = block.size();
+        Status s = WriteRaw(block);
+        if (!s.ok()) return s;
+        return WriteRaw(footer.Encode());
     }
 
     Status WriteRaw(const std::string& data) {
-        const char* ptr = data.data();
-        size_t remaining = data.size();
-
-        while (remaining > 0) {
-            ssize_t written = ::write(fd_, ptr, remaining);
-            if (written < 0) {
-                if (errno == EINTR) continue;
-                return Status::IOError("Failed to write to SSTable");
-            }
-            ptr += written;
-            remaining -= written;
-            offset_ += written;
+        if (!file_->Append(data).ok()) {
+            return Status::IOError("Failed to write to SSTable");
         }
-
+        offset_ += data.size();
         return Status::OK();
     }
 
     std::string path_;
     SSTableOptions options_;
-    int fd_;
+    std::unique_ptr<WritableFile> file_;
     uint64_t offset_;
 
     BlockBuilder data_block_;
     IndexBlockBuilder index_builder_;
     BloomFilterBuilder bloom_builder_;
 
+    // Charges bloom_builder_'s key hashes to the block cache
+    // (charge_table_memory), in steps so the cache is resized rarely
+    static constexpr size_t kBloomReservationUnit = 64 * 1024;
+    std::unique_ptr<CacheReservation> bloom_reservation_;
+
     bool closed_;
     size_t num_entries_;
     std::string first_key_;
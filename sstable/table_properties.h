@@ -0,0 +1,144 @@
+// sstable/table_properties.h
+// Per-table statistics (the properties block) and the metaindex block that
+// locates a table's index, filter and properties
+
+#pragma once
+
+#include "util/types.h"
+#include "sstable/sstable_format.h"
+#include "sstable/block_builder.h"
+#include "sstable/block.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace lsm {
+namespace sstable {
+
+// Metaindex entries: name -> encoded BlockHandle. The index and properties
+// are required; a table without a filter has no filter entry.
+constexpr const char* kIndexBlockName = "lsm.index";
+constexpr const char* kFilterBlockName = "lsm.filter.bloom";
+constexpr const char* kPropertiesBlockName = "lsm.properties";
+
+// Statistics recorded when a table is written, readable without scanning
+// its data blocks. Stored as a block of name -> value entries; readers skip
+// names they do not know, so properties can be added without changing the
+// format version.
+struct TableProperties {
+    uint64_t num_entries = 0;
+    uint64_t num_deletions = 0;       // Tombstones
+    uint64_t num_data_blocks = 0;
+    uint64_t data_size = 0;           // Data block bytes, with trailers
+    uint64_t index_size = 0;
+    uint64_t filter_size = 0;
+    uint64_t raw_key_size = 0;        // User key bytes, before prefix compression
+    uint64_t raw_value_size = 0;
+    SequenceNumber min_sequence = 0;
+    SequenceNumber max_sequence = 0;
+    std::string smallest_key;         // First user key
+    std::string largest_key;          // Last user key
+    uint64_t creation_time = 0;       // Seconds since the epoch
+    std::string compression = "none"; // Data block compression
+
+    // Block contents (without trailer)
+    std::string Encode() const {
+        std::map<std::string, std::string> entries;
+        auto put = [&](const char* name, uint64_t v) {
+            Varint::PutVarint64(&entries[name], v);
+        };
+        put("lsm.num.entries", num_entries);
+        put("lsm.num.deletions", num_deletions);
+        put("lsm.num.data.blocks", num_data_blocks);
+        put("lsm.data.size", data_size);
+        put("lsm.index.size", index_size);
+        put("lsm.filter.size", filter_size);
+        put("lsm.raw.key.size", raw_key_size);
+        put("lsm.raw.value.size", raw_value_size);
+        put("lsm.min.sequence", min_sequence);
+        put("lsm.max.sequence", max_sequence);
+        put("lsm.creation.time", creation_time);
+        entries["lsm.smallest.key"] = smallest_key;
+        entries["lsm.largest.key"] = largest_key;
+        entries["lsm.compression"] = compression;
+
+        BlockBuilder builder;
+        for (const auto& [name, value] : entries) builder.Add(name, value);
+        return std::string(builder.Finish());
+    }
+
+    Status Decode(const Block& block) {
+        Block::Iterator it(&block, BytewiseCompare);
+        for (it.SeekToFirst(); it.Valid(); it.Next()) {
+            Slice name = it.key();
+            Slice value = it.value();
+            uint64_t* field = NumberField(name);
+            if (field != nullptr) {
+                const char* p = value.data();
+                if (!Varint::GetVarint64(&p, value.data() + value.size(), field)) {
+                    return Status::Corruption("Bad table property: " + std::string(name));
+                }
+            } else if (name == "lsm.smallest.key") {
+                smallest_key.assign(value);
+            } else if (name == "lsm.largest.key") {
+                largest_key.assign(value);
+            } else if (name == "lsm.compression") {
+                compression.assign(value);
+            }
+        }
+        return it.status();
+    }
+
+private:
+    uint64_t* NumberField(Slice name) {
+        if (name == "lsm.num.entries") return &num_entries;
+        if (name == "lsm.num.deletions") return &num_deletions;
+        if (name == "lsm.num.data.blocks") return &num_data_blocks;
+        if (name == "lsm.data.size") return &data_size;
+        if (name == "lsm.index.size") return &index_size;
+        if (name == "lsm.filter.size") return &filter_size;
+        if (name == "lsm.raw.key.size") return &raw_key_size;
+        if (name == "lsm.raw.value.size") return &raw_value_size;
+        if (name == "lsm.min.sequence") return &min_sequence;
+        if (name == "lsm.max.sequence") return &max_sequence;
+        if (name == "lsm.creation.time") return &creation_time;
+        return nullptr;
+    }
+};
+
+// Builds the metaindex block; entries may be added in any order
+class MetaIndexBuilder {
+public:
+    void Add(const std::string& name, const BlockHandle& handle) {
+        handles_[name] = handle.Encode();
+    }
+
+    // Block contents (without trailer)
+    std::string Finish() const {
+        BlockBuilder builder;
+        for (const auto& [name, handle] : handles_) builder.Add(name, handle);
+        return std::string(builder.Finish());
+    }
+
+private:
+    std::map<std::string, std::string> handles_;
+};
+
+// Look up name in a metaindex block; NotFound if the table has no such block
+inline Status FindMetaBlock(const Block& metaindex, Slice name, BlockHandle* handle) {
+    Block::Iterator it(&metaindex, BytewiseCompare);
+    it.Seek(name);
+    if (!it.status().ok()) return it.status();
+    if (!it.Valid() || it.key() != name) {
+        return Status::NotFound("No meta block " + std::string(name));
+    }
+    Slice input = it.value();
+    if (!handle->Decode(&input)) {
+        return Status::Corruption("Bad meta block handle: " + std::string(name));
+    }
+    return Status::OK();
+}
+
+}  // namespace sstable
+}  // namespace lsm
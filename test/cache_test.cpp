@@ -0,0 +1,507 @@
+// test/cache_test.cpp
+// Tests for the block cache, its compressed secondary tier and pinned
+// read results
+
+#include "util/types.h"
+#include "util/cache.h"
+#include "util/compressed_secondary_cache.h"
+#include "util/compression.h"
+#include "util/pinnable_slice.h"
+
+#include <cassert>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace lsm;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " #name "..." << std::flush; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT(cond) do { \
+    if (!(cond)) { \
+        std::cerr << "\nAssertion failed: " #cond \
+                  << " at " << __FILE__ << ":" << __LINE__ << "\n"; \
+        std::abort(); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_TRUE(x) ASSERT(x)
+#define ASSERT_FALSE(x) ASSERT(!(x))
+
+static std::shared_ptr<std::string> Value(const std::string& s) {
+    return std::make_shared<std::string>(s);
+}
+
+// ============================================================================
+// Cache Tests
+// ============================================================================
+
+TEST(cache_insert_lookup) {
+    Cache cache(1024, 0);
+
+    ASSERT_TRUE(cache.Lookup("a") == nullptr);
+    cache.Insert("a", Value("va"), 10);
+    cache.Insert("b", Value("vb"), 10);
+
+    auto a = cache.Lookup<std::string>("a");
+    ASSERT_TRUE(a != nullptr);
+    ASSERT_EQ(*a, "va");
+    ASSERT_EQ(cache.GetUsage(), 20u);
+    ASSERT_EQ(cache.Hits(), 1u);
+    ASSERT_EQ(cache.Misses(), 1u);
+
+    // Replacing an entry replaces its charge
+    cache.Insert("a", Value("va2"), 30);
+    ASSERT_EQ(*cache.Lookup<std::string>("a"), "va2");
+    ASSERT_EQ(cache.GetUsage(), 40u);
+
+    cache.Erase("a");
+    ASSERT_TRUE(cache.Lookup("a") == nullptr);
+    ASSERT_EQ(cache.GetUsage(), 10u);
+}
+
+TEST(cache_lru_eviction) {
+    Cache cache(100, 0);  // Single shard so LRU order is global
+
+    for (int i = 0; i < 10; i++) {
+        cache.Insert(std::to_string(i), Value("v"), 10);
+    }
+    ASSERT_EQ(cache.GetUsage(), 100u);
+
+    // Touch "0" so it is most recently used, then overflow
+    ASSERT_TRUE(cache.Lookup("0") != nullptr);
+    cache.Insert("new", Value("v"), 25);
+
+    ASSERT_TRUE(cache.GetUsage() <= 100u);
+    ASSERT_TRUE(cache.Lookup("0") != nullptr);
+    ASSERT_TRUE(cache.Lookup("1") == nullptr);
+    ASSERT_TRUE(cache.Lookup("2") == nullptr);
+    ASSERT_TRUE(cache.Lookup("3") == nullptr);
+    ASSERT_TRUE(cache.Lookup("4") != nullptr);
+    ASSERT_TRUE(cache.Lookup("new") != nullptr);
+
+    // Entries larger than the whole cache are not kept
+    cache.Insert("huge", Value("v"), 1000);
+    ASSERT_TRUE(cache.Lookup("huge") == nullptr);
+}
+
+TEST(cache_pinned_entry_survives_eviction) {
+    Cache cache(10, 0);
+    cache.Insert("a", Value("pinned"), 10);
+
+    auto pinned = cache.Lookup<std::string>("a");
+    cache.Insert("b", Value("other"), 10);  // Evicts "a"
+
+    ASSERT_TRUE(cache.Lookup("a") == nullptr);
+    ASSERT_EQ(*pinned, "pinned");
+    ASSERT_EQ(cache.GetUsage(), 10u);
+}
+
+TEST(cache_set_capacity) {
+    Cache cache(1000);
+    for (int i = 0; i < 100; i++) {
+        cache.Insert(std::to_string(i), Value("v"), 8);
+    }
+    cache.SetCapacity(160);
+    ASSERT_TRUE(cache.GetUsage() <= 160u);
+    ASSERT_EQ(cache.GetCapacity(), 160u);
+}
+
+TEST(cache_apply_to_all_entries) {
+    Cache cache(100, 0);
+    cache.Insert("a", Value("v"), 1);
+    cache.Insert("b", Value("v"), 2);
+    cache.Insert("c", Value("v"), 3);
+    ASSERT_TRUE(cache.Lookup("a") != nullptr);
+
+    // Most recently used first
+    std::vector<std::pair<std::string, size_t>> seen;
+    cache.ApplyToAllEntries([&](Slice key, size_t charge) {
+        seen.emplace_back(std::string(key), charge);
+    });
+    ASSERT_EQ(seen.size(), 3u);
+    ASSERT_EQ(seen[0].first, "a");
+    ASSERT_EQ(seen[1].first, "c");
+    ASSERT_EQ(seen[2].first, "b");
+    ASSERT_EQ(seen[2].second, 2u);
+
+    Cache sharded(1000);
+    for (int i = 0; i < 50; i++) sharded.Insert(std::to_string(i), Value("v"), 1);
+    size_t count = 0;
+    sharded.ApplyToAllEntries([&](Slice, size_t) { count++; });
+    ASSERT_EQ(count, 50u);
+}
+
+TEST(cache_reservations) {
+    Cache cache(100, 0);
+    for (int i = 0; i < 10; i++) cache.Insert(std::to_string(i), Value("v"), 10);
+
+    // Reserving memory evicts entries down to what is left
+    cache.Reserve(45);
+    ASSERT_EQ(cache.GetReserved(), 45u);
+    ASSERT_TRUE(cache.GetUsage() <= 55u);
+    ASSERT_TRUE(cache.Lookup("0") == nullptr);
+    ASSERT_TRUE(cache.Lookup("9") != nullptr);
+
+    // Reserving more than the capacity leaves no room at all
+    cache.Reserve(100);
+    ASSERT_EQ(cache.GetUsage(), 0u);
+    cache.Insert("x", Value("v"), 1);
+    ASSERT_TRUE(cache.Lookup("x") == nullptr);
+
+    cache.Release(145);
+    cache.Insert("x", Value("v"), 100);
+    ASSERT_TRUE(cache.Lookup("x") != nullptr);
+}
+
+TEST(cache_reservation_units) {
+    auto cache = NewLRUCache(1000, 0);
+    {
+        CacheReservation reservation(cache, 64);
+        reservation.Update(1);
+        ASSERT_EQ(reservation.reserved(), 64u);
+        ASSERT_EQ(cache->GetReserved(), 64u);
+        reservation.Update(64);
+        ASSERT_EQ(cache->GetReserved(), 64u);
+        reservation.Update(65);
+        ASSERT_EQ(cache->GetReserved(), 128u);
+        reservation.Update(10);
+        ASSERT_EQ(cache->GetReserved(), 64u);
+
+        CacheReservation exact(cache);
+        exact.Update(7);
+        ASSERT_EQ(cache->GetReserved(), 71u);
+    }
+    // Released on destruction
+    ASSERT_EQ(cache->GetReserved(), 0u);
+}
+
+TEST(cache_new_id_unique) {
+    Cache cache(100);
+    uint64_t a = cache.NewId();
+    uint64_t b = cache.NewId();
+    ASSERT_TRUE(a != b);
+}
+
+TEST(cache_concurrent_access) {
+    Cache cache(64 * 1024);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&cache, t]() {
+            for (int i = 0; i < 5000; i++) {
+                std::string key = std::to_string((i * 7 + t) % 1000);
+                if (i % 3 == 0) {
+                    cache.Insert(key, Value(key), 64);
+                } else if (auto v = cache.Lookup<std::string>(key)) {
+                    ASSERT_EQ(*v, key);
+                }
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    ASSERT_TRUE(cache.GetUsage() <= 64u * 1024);
+}
+
+// ============================================================================
+// PinnableSlice Tests
+// ============================================================================
+
+TEST(pinnable_slice_pin_self) {
+    PinnableSlice slice;
+    ASSERT_TRUE(slice.empty());
+
+    std::string source = "copied value";
+    slice.PinSelf(source);
+    source.assign("changed");
+
+    ASSERT_FALSE(slice.IsPinned());
+    ASSERT_EQ(slice.ToString(), "copied value");
+}
+
+TEST(pinnable_slice_pin_releases_once) {
+    int releases = 0;
+    std::string owner = "owned elsewhere";
+    {
+        PinnableSlice slice;
+        slice.PinSlice(owner, [&releases]() { releases++; });
+        ASSERT_TRUE(slice.IsPinned());
+        ASSERT_EQ(slice.data(), owner.data());  // No copy
+        ASSERT_EQ(slice.slice(), "owned elsewhere");
+
+        slice.Reset();
+        ASSERT_EQ(releases, 1);
+        ASSERT_TRUE(slice.empty());
+
+        slice.PinSlice(owner, [&releases]() { releases++; });
+        // Re-pinning releases the previous pin; destruction the last one
+        slice.PinSlice(owner, [&releases]() { releases++; });
+        ASSERT_EQ(releases, 2);
+    }
+    ASSERT_EQ(releases, 3);
+}
+
+TEST(pinnable_slice_move) {
+    int releases = 0;
+    std::string owner = "pinned";
+
+    PinnableSlice a;
+    a.PinSlice(owner, [&releases]() { releases++; });
+    PinnableSlice b(std::move(a));
+    ASSERT_TRUE(b.IsPinned());
+    ASSERT_EQ(b.slice(), "pinned");
+    a.Reset();
+    ASSERT_EQ(releases, 0);
+
+    // Self-backed short values must point at the new owner's buffer
+    PinnableSlice c;
+    c.PinSelf("short");
+    PinnableSlice d;
+    d = std::move(c);
+    c.PinSelf("overwrite");
+    ASSERT_EQ(d.ToString(), "short");
+
+    b = std::move(d);
+    ASSERT_EQ(releases, 1);
+    ASSERT_EQ(b.ToString(), "short");
+}
+
+// ============================================================================
+// Compression Tests
+// ============================================================================
+
+static std::string RoundTrip(const std::string& input) {
+    std::string compressed;
+    LZCompression::Compress(input, &compressed);
+    std::string output;
+    ASSERT_TRUE(LZCompression::Uncompress(compressed, &output));
+    ASSERT_EQ(output, input);
+    return compressed;
+}
+
+// Sorted keys with shared prefixes and repetitive values, like a data block
+static std::string BlockLike(size_t size) {
+    std::string s;
+    for (int i = 0; s.size() < size; i++) {
+        s += "user:" + std::to_string(100000 + i) + "|status=active;region=eu-west;score=";
+        s += std::to_string(i % 97);
+    }
+    s.resize(size);
+    return s;
+}
+
+TEST(compression_round_trip) {
+    RoundTrip("");
+    RoundTrip("a");
+    RoundTrip("abcdefghijkl");
+    RoundTrip(std::string(100000, 'x'));  // Overlapping matches, long lengths
+    ASSERT_TRUE(RoundTrip(std::string(100000, 'x')).size() < 1000);
+
+    std::mt19937 rng(7);
+    std::string random(5000, '\0');
+    for (char& c : random) c = static_cast<char>(rng());
+    RoundTrip(random);
+
+    // Matches further back than 64KB are not used, but still round trip
+    RoundTrip(random + std::string(70000, 'y') + random);
+
+    std::string block = BlockLike(4096);
+    ASSERT_TRUE(RoundTrip(block).size() < block.size() / 2);
+}
+
+TEST(compression_rejects_corrupt_input) {
+    std::string compressed;
+    LZCompression::Compress(BlockLike(4096), &compressed);
+    std::string output;
+    ASSERT_FALSE(LZCompression::Uncompress("", &output));
+    ASSERT_FALSE(LZCompression::Uncompress(compressed.substr(0, compressed.size() / 2), &output));
+
+    // Every single-byte change either decodes to some output of the stated
+    // length or is rejected; none reads or writes out of bounds
+    for (size_t i = 0; i < compressed.size(); i += 7) {
+        std::string bad = compressed;
+        bad[i] = static_cast<char>(bad[i] ^ 0x5a);
+        if (LZCompression::Uncompress(bad, &output)) ASSERT_EQ(output.size(), 4096u);
+    }
+}
+
+// ============================================================================
+// Secondary Cache Tests
+// ============================================================================
+
+// Test entries: strings that move to the secondary cache as their bytes
+static const CacheItemHelper kStringHelper = {
+    [](const void* value) { return Slice(*static_cast<const std::string*>(value)); },
+    [](std::string contents, size_t* charge) -> std::shared_ptr<void> {
+        *charge = contents.size();
+        return std::make_shared<std::string>(std::move(contents));
+    },
+};
+
+TEST(secondary_cache_admits_on_second_eviction) {
+    CompressedSecondaryCache secondary(64 * 1024, 0);
+    std::string block = BlockLike(4096);
+    std::string contents;
+
+    // The first eviction only leaves a placeholder
+    secondary.Insert("k", block);
+    ASSERT_FALSE(secondary.Lookup("k", &contents));
+    ASSERT_EQ(secondary.Admitted(), 0u);
+    ASSERT_TRUE(secondary.GetUsage() < 100);
+
+    secondary.Insert("k", block);
+    ASSERT_EQ(secondary.Admitted(), 1u);
+    ASSERT_TRUE(secondary.GetUsage() < block.size() / 2);
+    ASSERT_TRUE(secondary.Lookup("k", &contents));
+    ASSERT_EQ(contents, block);
+    ASSERT_EQ(secondary.Hits(), 1u);
+
+    // A hit moves the entry out but remembers it: the next eviction admits
+    // it directly
+    ASSERT_FALSE(secondary.Lookup("k", &contents));
+    secondary.Insert("k", block);
+    ASSERT_TRUE(secondary.Lookup("k", &contents));
+}
+
+TEST(secondary_cache_rejects_incompressible) {
+    CompressedSecondaryCache secondary(64 * 1024, 0);
+    std::mt19937 rng(11);
+    std::string random(4096, '\0');
+    for (char& c : random) c = static_cast<char>(rng());
+
+    secondary.Insert("r", random);
+    secondary.Insert("r", random);
+    ASSERT_EQ(secondary.Admitted(), 0u);
+    ASSERT_EQ(secondary.Rejected(), 1u);
+    std::string contents;
+    ASSERT_FALSE(secondary.Lookup("r", &contents));
+}
+
+TEST(cache_with_secondary_tier) {
+    auto secondary = NewCompressedSecondaryCache(64 * 1024, 0);
+    Cache cache(3 * 4096, 0, secondary);
+    ASSERT_TRUE(cache.secondary_cache() == secondary.get());
+    auto block = [](int i) { return BlockLike(4096 - i); };
+
+    // Cycle 6 blocks through a 3-block cache twice: the second round of
+    // evictions admits them to the secondary tier
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 6; i++) {
+            std::string key = std::to_string(i);
+            if (cache.Lookup(key, &kStringHelper) == nullptr) {
+                cache.Insert(key, std::make_shared<std::string>(block(i)), 4096, &kStringHelper);
+            }
+        }
+    }
+    ASSERT_TRUE(secondary->Admitted() >= 3);
+    ASSERT_EQ(cache.SecondaryHits(), 0u);
+
+    // Misses in the primary come back from the secondary tier, promoted
+    for (int i = 0; i < 3; i++) {
+        auto value = cache.Lookup<std::string>(std::to_string(i), &kStringHelper);
+        ASSERT_TRUE(value != nullptr);
+        ASSERT_EQ(*value, block(i));
+    }
+    ASSERT_EQ(cache.SecondaryHits(), 3u);
+
+    // Entries without a helper, and lookups without one, skip the tier
+    cache.Insert("plain", Value("v"), 4096);
+    ASSERT_TRUE(cache.Lookup("3") == nullptr);
+    uint64_t admitted = secondary->Admitted();
+    cache.SetCapacity(0);
+    ASSERT_EQ(cache.GetUsage(), 0u);
+    ASSERT_TRUE(secondary->Admitted() > admitted);
+    std::string contents;
+    ASSERT_FALSE(secondary->Lookup("plain", &contents));
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+void benchmark_cache_lookup() {
+    Cache cache(64 * 1024 * 1024);
+    const int N = 100000;
+    for (int i = 0; i < N; i++) {
+        cache.Insert(std::to_string(i), Value("value"), 100);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t hits = 0;
+    for (int i = 0; i < N; i++) {
+        if (cache.Lookup(std::to_string(i))) hits++;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    std::cout << "  Cache lookup: " << N << " lookups (" << hits << " hits) in "
+              << us << "us (" << (us * 1000.0 / N) << " ns/op)\n";
+}
+
+void benchmark_compression() {
+    std::string block = BlockLike(4096);
+    const int N = 20000;
+    std::string compressed;
+    std::string output;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < N; i++) LZCompression::Compress(block, &compressed);
+    auto mid = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < N; i++) LZCompression::Uncompress(compressed, &output);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    auto mbps = [&](auto d) {
+        double secs = std::chrono::duration<double>(d).count();
+        return static_cast<int>(N * block.size() / secs / (1024 * 1024));
+    };
+    std::cout << "  LZ 4KB block: ratio " << block.size() * 1.0 / compressed.size()
+              << ", compress " << mbps(mid - start) << " MB/s, uncompress "
+              << mbps(end - mid) << " MB/s\n";
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+    std::cout << "=== Phase 7: Cache Tests ===\n\n";
+
+    std::cout << "--- Cache Tests ---\n";
+    RUN_TEST(cache_insert_lookup);
+    RUN_TEST(cache_lru_eviction);
+    RUN_TEST(cache_pinned_entry_survives_eviction);
+    RUN_TEST(cache_set_capacity);
+    RUN_TEST(cache_apply_to_all_entries);
+    RUN_TEST(cache_reservations);
+    RUN_TEST(cache_reservation_units);
+    RUN_TEST(cache_new_id_unique);
+    RUN_TEST(cache_concurrent_access);
+
+    std::cout << "\n--- Compression Tests ---\n";
+    RUN_TEST(compression_round_trip);
+    RUN_TEST(compression_rejects_corrupt_input);
+
+    std::cout << "\n--- Secondary Cache Tests ---\n";
+    RUN_TEST(secondary_cache_admits_on_second_eviction);
+    RUN_TEST(secondary_cache_rejects_incompressible);
+    RUN_TEST(cache_with_secondary_tier);
+
+    std::cout << "\n--- PinnableSlice Tests ---\n";
+    RUN_TEST(pinnable_slice_pin_self);
+    RUN_TEST(pinnable_slice_pin_releases_once);
+    RUN_TEST(pinnable_slice_move);
+
+    std::cout << "\n--- Benchmarks ---\n";
+    benchmark_cache_lookup();
+    benchmark_compression();
+
+    std::cout << "\n=== All Tests Passed ===\n";
+    return 0;
+}
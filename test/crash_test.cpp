@@ -0,0 +1,464 @@
+// test/crash_test.cpp
+// Tests for the Env layer and fault injection, and crash-recovery stress
+// tests that cut power at chosen points of the WAL, flush and MANIFEST
+
+#include "util/types.h"
+#include "util/env.h"
+#include "util/fault_injection_env.h"
+#include "db/db.h"
+#include "wal/wal_reader.h"
+#include "wal/wal_writer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lsm;
+namespace fs = std::filesystem;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " #name "..." << std::flush; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT(cond) do { \
+    if (!(cond)) { \
+        std::cerr << "\nAssertion failed: " #cond \
+                  << " at " << __FILE__ << ":" << __LINE__ << "\n"; \
+        std::abort(); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_TRUE(x) ASSERT(x)
+#define ASSERT_FALSE(x) ASSERT(!(x))
+#define ASSERT_OK(s) ASSERT((s).ok())
+
+class TestDir {
+public:
+    TestDir(const std::string& name) : path_("/tmp/lsm_test_" + name) {
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+    ~TestDir() { fs::remove_all(path_); }
+    const std::string& path() const { return path_; }
+private:
+    std::string path_;
+};
+
+static std::string MakeKey(int i) {
+    char key[32];
+    snprintf(key, sizeof(key), "key%08d", i);
+    return key;
+}
+
+// Every eighth value is large enough for a blob file
+static std::string MakeValue(int i) {
+    std::string value = "value" + std::to_string(i) + ":";
+    value.resize(i % 8 == 0 ? 1024 : 100, static_cast<char>('a' + i % 26));
+    return value;
+}
+
+static Status WriteFile(Env* env, const std::string& path, const std::string& data,
+                        bool sync) {
+    std::unique_ptr<WritableFile> file;
+    Status s = env->NewWritableFile(path, &file);
+    if (s.ok()) s = file->Append(data);
+    if (s.ok() && sync) s = file->Sync();
+    if (s.ok()) s = file->Close();
+    return s;
+}
+
+static uint64_t FileSize(const std::string& path) {
+    uint64_t size = 0;
+    ASSERT_OK(Env::Default()->GetFileSize(path, &size));
+    return size;
+}
+
+// ============================================================================
+// Env Tests
+// ============================================================================
+
+TEST(posix_env_files) {
+    TestDir dir("env_files");
+    Env* env = Env::Default();
+    std::string path = dir.path() + "/file";
+
+    ASSERT_OK(WriteFile(env, path, "hello", true));
+    std::unique_ptr<WritableFile> appendable;
+    ASSERT_OK(env->NewAppendableFile(path, &appendable));
+    ASSERT_EQ(appendable->GetFileSize(), 5u);
+    ASSERT_OK(appendable->Append(" world"));
+    ASSERT_EQ(appendable->GetFileSize(), 11u);
+    ASSERT_OK(appendable->Close());
+
+    std::string contents;
+    ASSERT_OK(ReadFileToString(env, path, &contents));
+    ASSERT_EQ(contents, "hello world");
+
+    std::unique_ptr<RandomAccessFile> file;
+    ASSERT_OK(env->NewRandomAccessFile(path, &file));
+    ASSERT_EQ(file->Size(), 11u);
+    char buf[16];
+    size_t n = 0;
+    ASSERT_OK(file->Read(6, 16, buf, &n));
+    ASSERT_EQ(std::string(buf, n), "world");
+
+    ASSERT_OK(env->CreateDirIfMissing(dir.path() + "/sub"));
+    ASSERT_OK(env->CreateDirIfMissing(dir.path() + "/sub"));
+    ASSERT_OK(env->RenameFile(path, dir.path() + "/sub/moved"));
+    ASSERT_FALSE(env->FileExists(path));
+    std::vector<std::string> children;
+    ASSERT_OK(env->GetChildren(dir.path() + "/sub", &children));
+    ASSERT_EQ(children, std::vector<std::string>{"moved"});
+
+    ASSERT_OK(WriteFileAtomically(env, dir.path() + "/sub/moved", dir.path() + "/tmp", "new"));
+    ASSERT_OK(ReadFileToString(env, dir.path() + "/sub/moved", &contents));
+    ASSERT_EQ(contents, "new");
+    ASSERT_FALSE(env->FileExists(dir.path() + "/tmp"));
+
+    ASSERT_OK(env->DeleteFile(dir.path() + "/sub/moved"));
+    ASSERT_TRUE(env->DeleteFile(dir.path() + "/sub/moved").IsNotFound());
+    ASSERT_TRUE(ReadFileToString(env, path, &contents).IsNotFound());
+    ASSERT_TRUE(env->GetChildren(dir.path() + "/missing", &children).IsNotFound());
+}
+
+TEST(fault_env_drops_unsynced_data) {
+    TestDir dir("env_unsynced");
+    FaultInjectionEnv env;
+    std::string synced = dir.path() + "/synced";
+    std::string partial = dir.path() + "/partial";
+    std::string renamed = dir.path() + "/renamed";
+
+    ASSERT_OK(WriteFile(&env, synced, std::string(100, 's'), true));
+    std::unique_ptr<WritableFile> file;
+    ASSERT_OK(env.NewWritableFile(partial, &file));
+    ASSERT_OK(file->Append(std::string(100, 'p')));
+    ASSERT_OK(file->Sync());
+    ASSERT_OK(file->Append(std::string(50, 'u')));
+    ASSERT_OK(file->Close());
+    ASSERT_OK(WriteFile(&env, dir.path() + "/tmp", "never synced", false));
+    ASSERT_OK(env.RenameFile(dir.path() + "/tmp", renamed));
+    ASSERT_EQ(FileSize(partial), 150u);
+
+    ASSERT_OK(env.DropUnsyncedData());
+    ASSERT_EQ(FileSize(synced), 100u);
+    ASSERT_EQ(FileSize(partial), 100u);
+    ASSERT_EQ(FileSize(renamed), 0u);
+
+    // A file this Env did not create keeps what it had when first opened
+    std::unique_ptr<WritableFile> appendable;
+    ASSERT_OK(env.NewAppendableFile(synced, &appendable));
+    ASSERT_OK(appendable->Append(std::string(30, 'x')));
+    ASSERT_OK(appendable->Close());
+    ASSERT_OK(env.DropUnsyncedData());
+    ASSERT_EQ(FileSize(synced), 100u);
+
+    // Torn writes keep a random part of the unsynced tail
+    bool saw_torn = false;
+    for (int i = 0; i < 20; i++) {
+        ASSERT_OK(env.NewWritableFile(partial, &file));
+        ASSERT_OK(file->Append(std::string(100, 'p')));
+        ASSERT_OK(file->Sync());
+        ASSERT_OK(file->Append(std::string(100, 'u')));
+        ASSERT_OK(file->Close());
+        ASSERT_OK(env.DropUnsyncedData(/*torn_writes=*/true));
+        uint64_t size = FileSize(partial);
+        ASSERT_TRUE(size >= 100 && size <= 200);
+        saw_torn |= size > 100 && size < 200;
+    }
+    ASSERT_TRUE(saw_torn);
+
+    // After ResetState everything written counts as durable
+    ASSERT_OK(WriteFile(&env, partial, "abc", false));
+    env.ResetState();
+    ASSERT_OK(env.DropUnsyncedData());
+    ASSERT_EQ(FileSize(partial), 3u);
+}
+
+TEST(fault_env_fails_chosen_calls) {
+    TestDir dir("env_faults");
+    FaultInjectionEnv env;
+    std::string path = dir.path() + "/data.log";
+
+    env.FailAt(FaultOp::kSync, ".log", /*skip=*/1);
+    std::unique_ptr<WritableFile> file;
+    ASSERT_OK(env.NewWritableFile(path, &file));
+    ASSERT_OK(file->Append("a"));
+    ASSERT_OK(file->Sync());
+    ASSERT_TRUE(file->Sync().IsIOError());
+    ASSERT_OK(file->Sync());  // Each fault fires once
+    ASSERT_EQ(env.injected_errors(), 1u);
+
+    env.FailAt(FaultOp::kCreate, "other");
+    ASSERT_OK(WriteFile(&env, dir.path() + "/file", "x", true));
+    ASSERT_TRUE(WriteFile(&env, dir.path() + "/other", "x", true).IsIOError());
+
+    env.FailAt(FaultOp::kRead, "data");
+    std::string contents;
+    ASSERT_TRUE(ReadFileToString(&env, path, &contents).IsIOError());
+    ASSERT_OK(ReadFileToString(&env, path, &contents));
+
+    env.FailAt(FaultOp::kRename, "target");
+    ASSERT_TRUE(env.RenameFile(dir.path() + "/file", dir.path() + "/target").IsIOError());
+    env.FailAt(FaultOp::kDelete, "file");
+    ASSERT_TRUE(env.DeleteFile(dir.path() + "/file").IsIOError());
+    ASSERT_TRUE(env.FileExists(dir.path() + "/file"));
+
+    // A crashing append tears: a prefix of its data reaches the file, and
+    // nothing reaches the disk after it
+    env.FailAt(FaultOp::kAppend, ".log", 0, /*crash=*/true);
+    ASSERT_TRUE(file->Append(std::string(1000, 'z')).IsIOError());
+    ASSERT_FALSE(env.filesystem_active());
+    ASSERT_TRUE(file->Append("b").IsIOError());
+    ASSERT_TRUE(file->Sync().IsIOError());
+    ASSERT_TRUE(env.DeleteFile(dir.path() + "/file").IsIOError());
+    ASSERT_TRUE(FileSize(path) < 1001u);
+    ASSERT_OK(ReadFileToString(&env, path, &contents));  // Reads still work
+    ASSERT_OK(file->Close());
+
+    ASSERT_OK(env.DropUnsyncedData());
+    ASSERT_EQ(FileSize(path), 1u);
+    env.SetFilesystemActive(true);
+    ASSERT_OK(env.DeleteFile(dir.path() + "/file"));
+}
+
+// ============================================================================
+// WAL Crash Tests
+// ============================================================================
+
+static std::vector<SequenceNumber> ReadLog(const std::string& path) {
+    wal::WALReader reader(path);
+    ASSERT_OK(reader.Open());
+    std::vector<SequenceNumber> seqs;
+    wal::WALEntry entry;
+    Status s;
+    while (reader.ReadEntry(&entry, &s)) seqs.push_back(entry.sequence);
+    return seqs;  // A torn tail ends the log with Corruption
+}
+
+TEST(wal_crash_keeps_synced_records) {
+    TestDir dir("wal_crash");
+    for (bool sync_each : {true, false}) {
+        FaultInjectionEnv env(Env::Default(), sync_each ? 1 : 2);
+        std::string path = dir.path() + "/log." + (sync_each ? "sync" : "nosync");
+        wal::WALOptions options;
+        options.env = &env;
+        options.sync_policy = sync_each ? wal::SyncPolicy::kSyncPerWrite
+                                        : wal::SyncPolicy::kNoSync;
+        std::string value(200, 'v');
+        uint64_t acked = 0;
+        uint64_t synced = 0;
+        {
+            wal::WALWriter writer(path, options);
+            ASSERT_OK(writer.Open());
+            env.FailAt(FaultOp::kAppend, "log.", /*skip=*/140, /*crash=*/true);
+            for (SequenceNumber seq = 1; seq <= 200; seq++) {
+                if (!writer.AppendPut(seq, "key", value).ok()) break;
+                acked = seq;
+                if (!sync_each && seq % 50 == 0) {
+                    ASSERT_OK(writer.Sync());
+                    synced = seq;
+                }
+            }
+            ASSERT_EQ(acked, 140u);
+        }
+        ASSERT_OK(env.DropUnsyncedData(/*torn_writes=*/true));
+
+        // Recovery reads a gap-free prefix holding every synced record
+        std::vector<SequenceNumber> seqs = ReadLog(path);
+        ASSERT_TRUE(seqs.size() >= (sync_each ? acked : synced));
+        ASSERT_TRUE(seqs.size() <= acked);
+        for (size_t i = 0; i < seqs.size(); i++) ASSERT_EQ(seqs[i], i + 1);
+    }
+}
+
+// ============================================================================
+// DB Crash-Recovery Stress Tests
+// ============================================================================
+
+// Where power is cut in each round of a crash stress test
+struct CrashPoint {
+    const char* name;
+    FaultOp op;
+    const char* pattern;
+    uint64_t max_skip;           // The fault fires after 0..max_skip matching calls
+    wal::SyncPolicy sync_policy;
+    bool sync_writes;            // WriteOptions::sync on every Put
+    bool torn_writes;
+};
+
+// A single writer puts keys 0, 1, 2, ... in order until the injected crash
+// (or the end of the round) cuts power. After every crash the DB must
+// reopen, hold exactly a prefix of the keys with the right values (the WAL
+// is replayed in order, so recovery must never leave a gap), and keep every
+// key acknowledged as durable: with synced writes each acknowledged Put,
+// otherwise whatever an earlier recovery already found.
+static void RunCrashRounds(const CrashPoint& point, int rounds, int puts_per_round,
+                           uint64_t seed) {
+    TestDir dir(std::string("crash_") + point.name);
+    FaultInjectionEnv env(Env::Default(), seed);
+    std::mt19937_64 rng(seed);
+
+    Options options;
+    options.env = &env;
+    options.write_buffer_size = 16 * 1024;
+    options.level0_file_num_compaction_trigger = 2;
+    options.target_file_size_base = 32 * 1024;
+    options.max_bytes_for_level_base = 128 * 1024;
+    options.enable_blob_files = true;
+    options.min_blob_size = 512;
+    options.blob_file_size = 16 * 1024;
+    options.wal_options.sync_policy = point.sync_policy;
+    options.wal_options.sync_batch_size = 8 * 1024;
+    WriteOptions write_options;
+    write_options.sync = point.sync_writes;
+
+    int durable = 0;    // Keys below this must survive
+    int attempted = 0;  // Keys above this were never written
+    int crashes_injected = 0;
+    for (int round = 0; round <= rounds; round++) {
+        DB* raw = nullptr;
+        Status s = DB::Open(options, dir.path() + "/db", &raw);
+        if (!s.ok()) std::cerr << "\nRound " << round << ": " << s.ToString() << "\n";
+        ASSERT_OK(s);
+        std::unique_ptr<DB> db(raw);
+
+        int present = 0;
+        std::string value;
+        while (present < attempted && db->Get(ReadOptions(), MakeKey(present), &value).ok()) {
+            ASSERT_EQ(value, MakeValue(present));
+            present++;
+        }
+        for (int i = present; i < attempted; i++) {
+            if (db->Get(ReadOptions(), MakeKey(i), &value).ok()) {
+                std::cerr << "\nRound " << round << ": key " << i << " survived but key "
+                          << present << " did not\n";
+                ASSERT_TRUE(false);
+            }
+        }
+        if (present < durable) {
+            std::cerr << "\nRound " << round << ": lost durable key " << present << "\n";
+        }
+        ASSERT_TRUE(present >= durable);
+        durable = present;  // Recovery flushed everything it replayed
+        if (round == rounds) break;
+
+        env.FailAt(point.op, point.pattern, rng() % (point.max_skip + 1), /*crash=*/true);
+        int next = present;
+        for (int i = 0; i < puts_per_round; i++) {
+            attempted = std::max(attempted, next + 1);
+            if (!db->Put(write_options, MakeKey(next), MakeValue(next)).ok()) break;
+            next++;
+            if (point.sync_writes) durable = next;
+        }
+        if (env.filesystem_active()) {
+            env.SetFilesystemActive(false);  // Cut power at the end of the round
+        } else {
+            crashes_injected++;
+        }
+        db.reset();
+        env.ClearFaults();
+        ASSERT_OK(env.DropUnsyncedData(point.torn_writes));
+        env.SetFilesystemActive(true);
+    }
+    ASSERT_TRUE(crashes_injected > 0);
+    ASSERT_TRUE(durable > 0);
+}
+
+static const CrashPoint kCrashWalWrite = {
+    "mid_wal_write", FaultOp::kAppend, "/wal/log.", 600,
+    wal::SyncPolicy::kSyncPerWrite, true, true};
+static const CrashPoint kCrashWalSync = {
+    "mid_wal_sync", FaultOp::kSync, "/wal/log.", 60,
+    wal::SyncPolicy::kSyncBatched, false, true};
+static const CrashPoint kCrashTableWrite = {
+    "mid_table_write", FaultOp::kAppend, ".sst", 40,
+    wal::SyncPolicy::kNoSync, false, true};
+static const CrashPoint kCrashBlobWrite = {
+    "mid_blob_write", FaultOp::kAppend, ".blob", 30,
+    wal::SyncPolicy::kNoSync, false, false};
+static const CrashPoint kCrashManifestSync = {
+    "incomplete_manifest", FaultOp::kSync, ".tmp", 6,
+    wal::SyncPolicy::kNoSync, false, true};
+static const CrashPoint kCrashManifestInstall = {
+    "manifest_install", FaultOp::kRename, "MANIFEST", 6,
+    wal::SyncPolicy::kSyncPerWrite, true, false};
+
+TEST(crash_mid_wal_write) { RunCrashRounds(kCrashWalWrite, 12, 800, 11); }
+TEST(crash_mid_wal_sync) { RunCrashRounds(kCrashWalSync, 12, 1500, 12); }
+TEST(crash_mid_table_write) { RunCrashRounds(kCrashTableWrite, 12, 1500, 13); }
+TEST(crash_mid_blob_write) { RunCrashRounds(kCrashBlobWrite, 12, 1500, 14); }
+TEST(crash_incomplete_manifest) { RunCrashRounds(kCrashManifestSync, 12, 1500, 15); }
+TEST(crash_manifest_install) { RunCrashRounds(kCrashManifestInstall, 8, 800, 16); }
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+void benchmark_env_overhead() {
+    TestDir dir("env_bench");
+    const int N = 100000;
+    std::string value(100, 'v');
+
+    auto run = [&](const char* label, Env* env) {
+        Options options;
+        options.env = env;
+        options.write_buffer_size = 256 << 20;  // Keep flushes out of the numbers
+        options.wal_options.sync_policy = wal::SyncPolicy::kNoSync;
+        DB* raw = nullptr;
+        fs::remove_all(dir.path() + "/db");
+        ASSERT_OK(DB::Open(options, dir.path() + "/db", &raw));
+        std::unique_ptr<DB> db(raw);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < N; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        std::cout << "  Put, " << label << ": " << (static_cast<double>(ns) / N) << " ns/op\n";
+    };
+
+    run("posix env", Env::Default());
+    FaultInjectionEnv fault_env;
+    run("fault injection env", &fault_env);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+    std::cout << "=== Phase 12: Crash Recovery Tests ===\n\n";
+
+    std::cout << "--- Env Tests ---\n";
+    RUN_TEST(posix_env_files);
+    RUN_TEST(fault_env_drops_unsynced_data);
+    RUN_TEST(fault_env_fails_chosen_calls);
+
+    std::cout << "\n--- WAL Crash Tests ---\n";
+    RUN_TEST(wal_crash_keeps_synced_records);
+
+    std::cout << "\n--- DB Crash-Recovery Stress Tests ---\n";
+    RUN_TEST(crash_mid_wal_write);
+    RUN_TEST(crash_mid_wal_sync);
+    RUN_TEST(crash_mid_table_write);
+    RUN_TEST(crash_mid_blob_write);
+    RUN_TEST(crash_incomplete_manifest);
+    RUN_TEST(crash_manifest_install);
+
+    std::cout << "\n--- Benchmarks ---\n";
+    benchmark_env_overhead();
+
+    std::cout << "\n=== All Tests Passed ===\n";
+    return 0;
+}
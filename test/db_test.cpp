@@ -0,0 +1,1852 @@
+// test/db_test.cpp
+// Tests for the DB: write path, recovery, iteration, bounds and compaction
+
+#include "util/types.h"
+#include "db/db.h"
+#include "db/db_iter.h"
+#include "db/filename.h"
+#include "db/merging_iterator.h"
+#include "db/options.h"
+
+#include <cassert>
+#include <iostream>
+#include <filesystem>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <set>
+#include <thread>
+
+using namespace lsm;
+namespace fs = std::filesystem;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " #name "..." << std::flush; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT(cond) do { \
+    if (!(cond)) { \
+        std::cerr << "\nAssertion failed: " #cond \
+                  << " at " << __FILE__ << ":" << __LINE__ << "\n"; \
+        std::abort(); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_TRUE(x) ASSERT(x)
+#define ASSERT_FALSE(x) ASSERT(!(x))
+#define ASSERT_OK(s) ASSERT((s).ok())
+
+class TestDir {
+public:
+    TestDir(const std::string& name) : path_("/tmp/lsm_test_" + name) {
+        fs::remove_all(path_);
+    }
+    ~TestDir() { fs::remove_all(path_); }
+    const std::string& path() const { return path_; }
+private:
+    std::string path_;
+};
+
+static std::string MakeKey(int i) {
+    char key[32];
+    snprintf(key, sizeof(key), "key%08d", i);
+    return key;
+}
+
+// Small buffers and files so tests exercise flushes and multiple levels
+static Options SmallOptions() {
+    Options options;
+    options.write_buffer_size = 64 * 1024;
+    options.target_file_size_base = 32 * 1024;
+    options.max_bytes_for_level_base = 256 * 1024;
+    options.table_options.block_size = 1024;
+    options.wal_options.sync_policy = wal::SyncPolicy::kNoSync;
+    return options;
+}
+
+static std::unique_ptr<DB> OpenDB(const std::string& path, const Options& options = SmallOptions()) {
+    DB* db = nullptr;
+    ASSERT_OK(DB::Open(options, path, &db));
+    return std::unique_ptr<DB>(db);
+}
+
+static std::string GetValue(DB* db, Slice key, const ReadOptions& ro = ReadOptions()) {
+    std::string value;
+    Status s = db->Get(ro, key, &value);
+    if (s.IsNotFound()) return "NOT_FOUND";
+    ASSERT_OK(s);
+    return value;
+}
+
+static int TotalFiles(DB* db) {
+    int total = 0;
+    for (int level = 0; level < db->options().max_levels; level++) {
+        total += db->NumFilesAtLevel(level);
+    }
+    return total;
+}
+
+// Collect the iterator's contents as "k=v" pairs in iteration order
+static std::vector<std::string> ScanForward(Iterator* iter) {
+    std::vector<std::string> result;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        result.push_back(std::string(iter->key()) + "=" + std::string(iter->value()));
+    }
+    ASSERT_OK(iter->status());
+    return result;
+}
+
+static std::vector<std::string> ScanBackward(Iterator* iter) {
+    std::vector<std::string> result;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+        result.push_back(std::string(iter->key()) + "=" + std::string(iter->value()));
+    }
+    ASSERT_OK(iter->status());
+    return result;
+}
+
+// ============================================================================
+// Merging Iterator Tests
+// ============================================================================
+
+class VectorIterator : public InternalIterator {
+public:
+    explicit VectorIterator(std::vector<std::pair<std::string, std::string>> entries)
+        : entries_(std::move(entries)), pos_(entries_.size()) {}
+
+    bool Valid() const override { return pos_ < entries_.size(); }
+    void SeekToFirst() override { pos_ = 0; }
+    void SeekToLast() override { pos_ = entries_.empty() ? 0 : entries_.size() - 1; }
+    void Seek(Slice target) override {
+        pos_ = 0;
+        while (pos_ < entries_.size() &&
+               sstable::CompareInternalKeys(entries_[pos_].first, target) < 0) {
+            pos_++;
+        }
+    }
+    void Next() override { pos_++; }
+    void Prev() override { pos_ = pos_ == 0 ? entries_.size() : pos_ - 1; }
+    Slice key() const override { return entries_[pos_].first; }
+    Slice value() const override { return entries_[pos_].second; }
+    Status status() const override { return Status::OK(); }
+
+private:
+    std::vector<std::pair<std::string, std::string>> entries_;
+    size_t pos_;
+};
+
+static std::pair<std::string, std::string> Entry(const char* key, SequenceNumber seq,
+                                                 const char* value) {
+    return {sstable::EncodeInternalKey(key, seq, ValueType::kValue), value};
+}
+
+TEST(merging_iterator_direction_changes) {
+    std::vector<std::unique_ptr<InternalIterator>> children;
+    children.push_back(std::make_unique<VectorIterator>(
+        std::vector<std::pair<std::string, std::string>>{
+            Entry("a", 1, "a1"), Entry("c", 3, "c3"), Entry("e", 5, "e5")}));
+    children.push_back(std::make_unique<VectorIterator>(
+        std::vector<std::pair<std::string, std::string>>{
+            Entry("b", 2, "b2"), Entry("d", 4, "d4")}));
+    MergingIterator iter(std::move(children));
+
+    std::string forward;
+    for (iter.SeekToFirst(); iter.Valid(); iter.Next()) forward += iter.value();
+    ASSERT_EQ(forward, "a1b2c3d4e5");
+
+    std::string backward;
+    for (iter.SeekToLast(); iter.Valid(); iter.Prev()) backward += iter.value();
+    ASSERT_EQ(backward, "e5d4c3b2a1");
+
+    iter.Seek(sstable::EncodeSeekKey("c", kMaxSequenceNumber));
+    ASSERT_EQ(iter.value(), "c3");
+    iter.Prev();
+    ASSERT_EQ(iter.value(), "b2");
+    iter.Next();
+    ASSERT_EQ(iter.value(), "c3");
+    iter.Next();
+    ASSERT_EQ(iter.value(), "d4");
+}
+
+// ============================================================================
+// Basic DB Tests
+// ============================================================================
+
+TEST(db_put_get_delete) {
+    TestDir dir("db_basic");
+    auto db = OpenDB(dir.path());
+
+    ASSERT_OK(db->Put(WriteOptions(), "foo", "v1"));
+    ASSERT_OK(db->Put(WriteOptions(), "bar", "v2"));
+    ASSERT_EQ(GetValue(db.get(), "foo"), "v1");
+    ASSERT_EQ(GetValue(db.get(), "bar"), "v2");
+
+    ASSERT_OK(db->Put(WriteOptions(), "foo", "v3"));
+    ASSERT_EQ(GetValue(db.get(), "foo"), "v3");
+
+    ASSERT_OK(db->Delete(WriteOptions(), "foo"));
+    ASSERT_EQ(GetValue(db.get(), "foo"), "NOT_FOUND");
+    ASSERT_EQ(GetValue(db.get(), "missing"), "NOT_FOUND");
+}
+
+TEST(db_get_across_flushes) {
+    TestDir dir("db_flush");
+    auto db = OpenDB(dir.path());
+
+    const int N = 5000;
+    std::string value(100, 'x');
+    for (int i = 0; i < N; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value + std::to_string(i)));
+    }
+    ASSERT_OK(db->Flush());
+    ASSERT_TRUE(TotalFiles(db.get()) > 0);
+
+    for (int i = 0; i < N; i += 7) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), value + std::to_string(i));
+    }
+}
+
+TEST(db_recovery_from_wal) {
+    TestDir dir("db_recover");
+    {
+        auto db = OpenDB(dir.path());
+        ASSERT_OK(db->Put(WriteOptions(), "a", "1"));
+        ASSERT_OK(db->Put(WriteOptions(), "b", "2"));
+        ASSERT_OK(db->Delete(WriteOptions(), "a"));
+        WriteOptions sync;
+        sync.sync = true;
+        ASSERT_OK(db->Put(WriteOptions(), "c", "3"));
+        ASSERT_OK(db->Put(sync, "d", "4"));
+    }
+    {
+        auto db = OpenDB(dir.path());
+        ASSERT_EQ(GetValue(db.get(), "a"), "NOT_FOUND");
+        ASSERT_EQ(GetValue(db.get(), "b"), "2");
+        ASSERT_EQ(GetValue(db.get(), "c"), "3");
+        ASSERT_EQ(GetValue(db.get(), "d"), "4");
+
+        // New writes after recovery must win over recovered ones
+        ASSERT_OK(db->Put(WriteOptions(), "b", "22"));
+        ASSERT_EQ(GetValue(db.get(), "b"), "22");
+    }
+    {
+        auto db = OpenDB(dir.path());
+        ASSERT_EQ(GetValue(db.get(), "b"), "22");
+    }
+}
+
+TEST(db_recovery_of_large_values) {
+    TestDir dir("db_recover_large");
+    Options options = SmallOptions();
+    options.write_buffer_size = 4 * 1024 * 1024;  // Keep everything in the WAL
+    std::string big(70000, 'b');
+    std::string huge(300000, 'h');
+    {
+        auto db = OpenDB(dir.path(), options);
+        ASSERT_OK(db->Put(WriteOptions(), "big", big));
+        ASSERT_OK(db->Put(WriteOptions(), "after", "1"));
+        ASSERT_OK(db->Put(WriteOptions(), "huge", huge));
+        ASSERT_OK(db->Put(WriteOptions(), "last", "2"));
+    }
+    auto db = OpenDB(dir.path(), options);
+    ASSERT_EQ(GetValue(db.get(), "big"), big);
+    ASSERT_EQ(GetValue(db.get(), "after"), "1");
+    ASSERT_EQ(GetValue(db.get(), "huge"), huge);
+    ASSERT_EQ(GetValue(db.get(), "last"), "2");
+}
+
+TEST(db_recovery_after_compaction) {
+    TestDir dir("db_recover_compact");
+    const int N = 3000;
+    {
+        auto db = OpenDB(dir.path());
+        for (int i = 0; i < N; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::string(100, 'a')));
+        }
+        ASSERT_OK(db->CompactRange(nullptr, nullptr));
+        for (int i = 0; i < N; i += 2) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "even"));
+        }
+    }
+    {
+        auto db = OpenDB(dir.path());
+        for (int i = 0; i < N; i++) {
+            ASSERT_EQ(GetValue(db.get(), MakeKey(i)),
+                      i % 2 == 0 ? std::string("even") : std::string(100, 'a'));
+        }
+    }
+}
+
+TEST(db_error_if_exists) {
+    TestDir dir("db_exists");
+    { auto db = OpenDB(dir.path()); }
+
+    Options options = SmallOptions();
+    options.error_if_exists = true;
+    DB* db = nullptr;
+    Status s = DB::Open(options, dir.path(), &db);
+    ASSERT_TRUE(s.IsInvalidArgument());
+    ASSERT_TRUE(db == nullptr);
+
+    options = SmallOptions();
+    options.create_if_missing = false;
+    s = DB::Open(options, dir.path() + "_missing", &db);
+    ASSERT_TRUE(s.IsInvalidArgument());
+}
+
+TEST(db_snapshots) {
+    TestDir dir("db_snapshot");
+    auto db = OpenDB(dir.path());
+
+    ASSERT_OK(db->Put(WriteOptions(), "k", "old"));
+    SequenceNumber snap = db->GetSnapshot();
+    ASSERT_OK(db->Put(WriteOptions(), "k", "new"));
+    ASSERT_OK(db->Delete(WriteOptions(), "gone"));
+
+    ReadOptions at_snap;
+    at_snap.snapshot = snap;
+    ASSERT_EQ(GetValue(db.get(), "k", at_snap), "old");
+    ASSERT_EQ(GetValue(db.get(), "k"), "new");
+
+    // Snapshot survives flush and compaction
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    ASSERT_EQ(GetValue(db.get(), "k", at_snap), "old");
+    ASSERT_EQ(GetValue(db.get(), "k"), "new");
+
+    db->ReleaseSnapshot(snap);
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    ASSERT_EQ(GetValue(db.get(), "k"), "new");
+}
+
+// ============================================================================
+// Iterator Tests
+// ============================================================================
+
+TEST(db_iterator_merges_sources) {
+    TestDir dir("db_iter");
+    auto db = OpenDB(dir.path());
+
+    // Spread versions over L1, L0 and the memtable
+    ASSERT_OK(db->Put(WriteOptions(), "a", "a1"));
+    ASSERT_OK(db->Put(WriteOptions(), "b", "b1"));
+    ASSERT_OK(db->Put(WriteOptions(), "c", "c1"));
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    ASSERT_OK(db->Put(WriteOptions(), "b", "b2"));
+    ASSERT_OK(db->Delete(WriteOptions(), "c"));
+    ASSERT_OK(db->Flush());
+    ASSERT_OK(db->Put(WriteOptions(), "d", "d1"));
+    ASSERT_OK(db->Put(WriteOptions(), "a", "a2"));
+
+    std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+    std::vector<std::string> expected = {"a=a2", "b=b2", "d=d1"};
+    ASSERT_TRUE(ScanForward(iter.get()) == expected);
+
+    std::vector<std::string> reversed(expected.rbegin(), expected.rend());
+    ASSERT_TRUE(ScanBackward(iter.get()) == reversed);
+
+    // Direction changes mid-scan
+    iter->Seek("b");
+    ASSERT_EQ(iter->key(), "b");
+    iter->Prev();
+    ASSERT_EQ(iter->key(), "a");
+    iter->Next();
+    ASSERT_EQ(iter->key(), "b");
+    iter->Next();
+    ASSERT_EQ(iter->key(), "d");
+    iter->Prev();
+    ASSERT_EQ(iter->key(), "b");
+}
+
+TEST(db_iterator_snapshot_isolation) {
+    TestDir dir("db_iter_snap");
+    auto db = OpenDB(dir.path());
+
+    ASSERT_OK(db->Put(WriteOptions(), "x", "1"));
+    std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+    ASSERT_OK(db->Put(WriteOptions(), "x", "2"));
+    ASSERT_OK(db->Put(WriteOptions(), "y", "1"));
+    ASSERT_OK(db->Flush());
+
+    std::vector<std::string> expected = {"x=1"};
+    ASSERT_TRUE(ScanForward(iter.get()) == expected);
+}
+
+TEST(db_iterator_matches_model) {
+    TestDir dir("db_iter_model");
+    auto db = OpenDB(dir.path());
+
+    std::map<std::string, std::string> model;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 20000; i++) {
+        std::string key = MakeKey(static_cast<int>(rng() % 2000));
+        if (rng() % 4 == 0) {
+            ASSERT_OK(db->Delete(WriteOptions(), key));
+            model.erase(key);
+        } else {
+            std::string value = std::to_string(i) + std::string(40, 'v');
+            ASSERT_OK(db->Put(WriteOptions(), key, value));
+            model[key] = value;
+        }
+    }
+
+    std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+    auto it = model.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+        ASSERT_TRUE(it != model.end());
+        ASSERT_EQ(iter->key(), it->first);
+        ASSERT_EQ(iter->value(), it->second);
+    }
+    ASSERT_TRUE(it == model.end());
+
+    auto rit = model.rbegin();
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev(), ++rit) {
+        ASSERT_TRUE(rit != model.rend());
+        ASSERT_EQ(iter->key(), rit->first);
+    }
+    ASSERT_TRUE(rit == model.rend());
+}
+
+// ============================================================================
+// Iterator Bounds Tests
+// ============================================================================
+
+TEST(db_iterator_bounds) {
+    TestDir dir("db_bounds");
+    auto db = OpenDB(dir.path());
+
+    for (const char* k : {"a", "b", "c", "d", "e", "f"}) {
+        ASSERT_OK(db->Put(WriteOptions(), k, k));
+    }
+    ASSERT_OK(db->Flush());
+    ASSERT_OK(db->Put(WriteOptions(), "bb", "bb"));
+
+    ReadOptions ro;
+    ro.iterate_lower_bound = "b";
+    ro.iterate_upper_bound = "e";
+    std::unique_ptr<Iterator> iter(db->NewIterator(ro));
+
+    std::vector<std::string> expected = {"b=b", "bb=bb", "c=c", "d=d"};
+    ASSERT_TRUE(ScanForward(iter.get()) == expected);
+
+    std::vector<std::string> reversed(expected.rbegin(), expected.rend());
+    ASSERT_TRUE(ScanBackward(iter.get()) == reversed);
+
+    // Seek below the lower bound clamps to it; at the upper bound is empty
+    iter->Seek("a");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->key(), "b");
+    iter->Seek("e");
+    ASSERT_FALSE(iter->Valid());
+}
+
+TEST(db_iterator_bounds_prune_files) {
+    TestDir dir("db_bounds_prune");
+    const int N = 20000;
+    {
+        auto db = OpenDB(dir.path());
+        std::string value(100, 'p');
+        for (int i = 0; i < N; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+        }
+        ASSERT_OK(db->CompactRange(nullptr, nullptr));
+        ASSERT_TRUE(TotalFiles(db.get()) > 10);
+    }
+
+    // Fresh open without preloading: nothing is in the table cache yet
+    Options options = SmallOptions();
+    options.max_file_opening_threads = 0;
+    auto db = OpenDB(dir.path(), options);
+    ASSERT_EQ(db->table_cache()->Size(), 0u);
+
+    ReadOptions ro;
+    ro.iterate_lower_bound = MakeKey(100);
+    ro.iterate_upper_bound = MakeKey(150);
+    std::unique_ptr<Iterator> iter(db->NewIterator(ro));
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) count++;
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(count, 50);
+
+    // Only the file holding the range was opened
+    ASSERT_EQ(db->table_cache()->Size(), 1u);
+
+    // Within that file, only blocks up to the upper bound were read
+    std::shared_ptr<sstable::SSTableReader> table;
+    uint64_t number = 0;
+    for (const auto& entry : fs::directory_iterator(dir.path())) {
+        if (ParseTableFileName(entry.path().filename().string(), &number)) {
+            Status s = db->table_cache()->FindTable(number, &table);
+            if (s.ok() && table->GetProperties().smallest_key <= MakeKey(100) &&
+                table->GetProperties().largest_key >= MakeKey(100)) {
+                break;
+            }
+        }
+    }
+    ASSERT_TRUE(table != nullptr);
+    uint64_t reads_before = table->file()->NumReads();
+    std::unique_ptr<Iterator> again(db->NewIterator(ro));
+    for (again->SeekToFirst(); again->Valid(); again->Next()) {}
+    uint64_t data_reads = table->file()->NumReads() - reads_before;
+    // 50 x ~115 byte entries span ~6 blocks of 1KB; the table has far more
+    ASSERT_TRUE(data_reads <= 8);
+}
+
+// ============================================================================
+// Table Loading Tests
+// ============================================================================
+
+// Fill a DB with at least 10 tables; returns the number of keys
+static int FillTables(const std::string& path) {
+    const int N = 20000;
+    auto db = OpenDB(path);
+    std::string value(100, 'p');
+    for (int i = 0; i < N; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    ASSERT_TRUE(TotalFiles(db.get()) > 10);
+    return N;
+}
+
+TEST(db_open_preloads_tables) {
+    TestDir dir("db_open_preload");
+    int n = FillTables(dir.path());
+
+    auto db = OpenDB(dir.path());
+    ASSERT_EQ(db->table_cache()->Size(), static_cast<size_t>(TotalFiles(db.get())));
+    db.reset();
+
+    // Only as many as the table cache holds; the rest open on first use
+    Options options = SmallOptions();
+    options.max_open_files = 4;
+    db = OpenDB(dir.path(), options);
+    ASSERT_EQ(db->table_cache()->Size(), 4u);
+    for (int i = 0; i < n; i += 97) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), std::string(100, 'p'));
+    }
+}
+
+TEST(db_open_verifies_tables) {
+    TestDir dir("db_open_verify");
+    FillTables(dir.path());
+
+    // Damage a data block of every table; the metadata is intact
+    for (const auto& entry : fs::directory_iterator(dir.path())) {
+        uint64_t number;
+        if (!ParseTableFileName(entry.path().filename().string(), &number)) continue;
+        std::fstream f(entry.path(), std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(100);
+        f.put('X');
+    }
+
+    DB* raw = nullptr;
+    Options options = SmallOptions();
+    ASSERT_OK(DB::Open(options, dir.path(), &raw));
+    delete raw;
+
+    // Tables beyond the preload budget are verified too
+    options.verify_tables_on_open = true;
+    options.max_open_files = 1;
+    ASSERT_TRUE(DB::Open(options, dir.path(), &raw).IsCorruption());
+    ASSERT_TRUE(raw == nullptr);
+}
+
+TEST(db_open_detects_truncated_table) {
+    TestDir dir("db_open_truncated");
+    FillTables(dir.path());
+
+    for (const auto& entry : fs::directory_iterator(dir.path())) {
+        uint64_t number;
+        if (!ParseTableFileName(entry.path().filename().string(), &number)) continue;
+        fs::resize_file(entry.path(), fs::file_size(entry.path()) - 1);
+        break;
+    }
+
+    DB* raw = nullptr;
+    ASSERT_TRUE(DB::Open(SmallOptions(), dir.path(), &raw).IsCorruption());
+}
+
+// ============================================================================
+// Compaction Tests
+// ============================================================================
+
+TEST(db_level0_compaction_trigger) {
+    TestDir dir("db_l0_trigger");
+    Options options = SmallOptions();
+    options.level0_file_num_compaction_trigger = 2;
+    auto db = OpenDB(dir.path(), options);
+
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 200; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::to_string(round)));
+        }
+        ASSERT_OK(db->Flush());
+    }
+    ASSERT_OK(db->WaitForCompact());
+
+    ASSERT_TRUE(db->NumFilesAtLevel(0) < 2);
+    ASSERT_TRUE(db->NumFilesAtLevel(1) > 0);
+    for (int i = 0; i < 200; i++) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), "3");
+    }
+}
+
+TEST(db_compact_range_drops_tombstones) {
+    TestDir dir("db_compact_tombstones");
+    auto db = OpenDB(dir.path());
+
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::string(50, 'z')));
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    ASSERT_TRUE(TotalFiles(db.get()) > 0);
+
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_OK(db->Delete(WriteOptions(), MakeKey(i)));
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+
+    // Values and tombstones cancel out at the base level
+    ASSERT_EQ(TotalFiles(db.get()), 0);
+    std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+    iter->SeekToFirst();
+    ASSERT_FALSE(iter->Valid());
+}
+
+TEST(db_scan_tombstones_trigger_compaction) {
+    TestDir dir("db_tombstone_scan");
+    Options options = SmallOptions();
+    options.scan_tombstone_compaction_trigger = 500;
+    options.write_buffer_size = 1024 * 1024;  // Keep L0 below its trigger
+    auto db = OpenDB(dir.path(), options);
+
+    // Queue-like workload: produce keys, consume them, delete them
+    const int N = 2000;
+    for (int i = 0; i < N; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "job"));
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    for (int i = 0; i < N - 1; i++) {
+        ASSERT_OK(db->Delete(WriteOptions(), MakeKey(i)));
+    }
+    ASSERT_OK(db->Flush());
+    ASSERT_OK(db->WaitForCompact());
+
+    // The head of the queue sits behind N - 1 tombstones
+    {
+        std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+        iter->SeekToFirst();
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(iter->key(), MakeKey(N - 1));
+        ASSERT_TRUE(static_cast<DBIter*>(iter.get())->TombstonesSkipped() >= 500);
+    }
+    ASSERT_OK(db->WaitForCompact());
+
+    // The scan marked the range; compaction removed the tombstones
+    std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->key(), MakeKey(N - 1));
+    ASSERT_EQ(static_cast<DBIter*>(iter.get())->TombstonesSkipped(), 0u);
+}
+
+TEST(db_obsolete_files_deleted) {
+    TestDir dir("db_obsolete");
+    auto db = OpenDB(dir.path());
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 2000; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::string(100, 'a' + round)));
+        }
+        ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    }
+    ASSERT_OK(db->WaitForCompact());
+
+    int sst_files = 0;
+    for (const auto& entry : fs::directory_iterator(dir.path())) {
+        uint64_t number;
+        if (ParseTableFileName(entry.path().filename().string(), &number)) sst_files++;
+    }
+    ASSERT_EQ(sst_files, TotalFiles(db.get()));
+}
+
+// ============================================================================
+// Pinned Get Tests
+// ============================================================================
+
+TEST(db_pinned_get_from_memtable) {
+    TestDir dir("db_pinned_mem");
+    auto db = OpenDB(dir.path());
+    std::string big(64 * 1024, 'm');
+    ASSERT_OK(db->Put(WriteOptions(), "key", big));
+
+    PinnableSlice value;
+    ASSERT_OK(db->Get(ReadOptions(), "key", &value));
+    ASSERT_TRUE(value.IsPinned());
+
+    // The pin keeps the memtable alive across a flush and overwrite
+    ASSERT_OK(db->Put(WriteOptions(), "key", "new"));
+    ASSERT_OK(db->Flush());
+    ASSERT_EQ(value.ToString(), big);
+
+    ASSERT_TRUE(db->Get(ReadOptions(), "missing", &value).IsNotFound());
+    ASSERT_TRUE(value.empty());
+}
+
+TEST(db_pinned_get_from_block_cache) {
+    TestDir dir("db_pinned_sst");
+    Options options = SmallOptions();
+    options.block_cache_size = 32 * 1024;  // 2KB per shard
+    auto db = OpenDB(dir.path(), options);
+
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::string(200, 'a' + i % 26)));
+    }
+    ASSERT_OK(db->Flush());
+
+    auto cache = db->options().table_options.block_cache;
+    ASSERT_TRUE(cache != nullptr);
+
+    PinnableSlice first;
+    ASSERT_OK(db->Get(ReadOptions(), MakeKey(0), &first));
+    ASSERT_TRUE(first.IsPinned());
+
+    uint64_t hits = cache->Hits();
+    PinnableSlice again;
+    ASSERT_OK(db->Get(ReadOptions(), MakeKey(1), &again));
+    ASSERT_TRUE(cache->Hits() > hits);
+
+    // Touch every block so the first one is evicted; the pin keeps it valid
+    for (int i = 0; i < 1000; i++) GetValue(db.get(), MakeKey(i));
+    ASSERT_TRUE(cache->GetUsage() <= 32u * 1024);
+    ASSERT_EQ(first.ToString(), std::string(200, 'a'));
+    ASSERT_EQ(again.ToString(), std::string(200, 'b'));
+}
+
+TEST(db_pinned_get_without_block_cache) {
+    TestDir dir("db_pinned_nocache");
+    Options options = SmallOptions();
+    options.block_cache_size = 0;
+    auto db = OpenDB(dir.path(), options);
+    ASSERT_TRUE(db->options().table_options.block_cache == nullptr);
+
+    ASSERT_OK(db->Put(WriteOptions(), "a", "1"));
+    ASSERT_OK(db->Delete(WriteOptions(), "b"));
+    ASSERT_OK(db->Flush());
+
+    PinnableSlice value;
+    ASSERT_OK(db->Get(ReadOptions(), "a", &value));
+    ASSERT_EQ(value.ToString(), "1");
+    ASSERT_TRUE(db->Get(ReadOptions(), "b", &value).IsNotFound());
+    ASSERT_TRUE(value.empty());
+}
+
+TEST(db_pinned_release_during_flush) {
+    // Readers drop the last pins on a memtable while the flush drops the
+    // DB's reference to it; it must be freed exactly once
+    TestDir dir("db_pinned_flush");
+    auto db = OpenDB(dir.path());
+    const int kThreads = 8;
+    for (int round = 0; round < 50; round++) {
+        std::string value = std::to_string(round) + std::string(100, 'p');
+        ASSERT_OK(db->Put(WriteOptions(), "key", value));
+
+        std::atomic<int> ready{0};
+        std::atomic<bool> release{false};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; t++) {
+            threads.emplace_back([&] {
+                std::vector<PinnableSlice> pins(16);
+                for (auto& pin : pins) ASSERT_OK(db->Get(ReadOptions(), "key", &pin));
+                ready.fetch_add(1);
+                while (!release.load()) std::this_thread::yield();
+                for (auto& pin : pins) {
+                    ASSERT_EQ(pin.ToString(), value);
+                    pin.Reset();
+                }
+            });
+        }
+        while (ready.load() < kThreads) std::this_thread::yield();
+        release.store(true);
+        ASSERT_OK(db->Flush());
+        for (auto& t : threads) t.join();
+    }
+    ASSERT_EQ(GetValue(db.get(), "key"), "49" + std::string(100, 'p'));
+}
+
+// ============================================================================
+// Memtable Filter Tests
+// ============================================================================
+
+TEST(db_memtable_bloom_filter) {
+    TestDir dir("db_memtable_bloom");
+    Options options = SmallOptions();
+    options.write_buffer_size = 1024 * 1024;
+    options.memtable_bloom_size_ratio = 0.1;
+    auto db = OpenDB(dir.path(), options);
+    for (int i = 0; i < 1000; i += 2) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "v" + std::to_string(i)));
+    }
+    ASSERT_OK(db->Delete(WriteOptions(), MakeKey(10)));
+
+    SetPerfLevel(PerfLevel::kEnableCount);
+    GetPerfContext()->Reset();
+    for (int i = 1; i < 998; i += 2) ASSERT_EQ(GetValue(db.get(), MakeKey(i)), "NOT_FOUND");
+    ASSERT_EQ(GetPerfContext()->bloom_memtable_probe_count, 499u);
+    ASSERT_TRUE(GetPerfContext()->bloom_memtable_miss_count >= 489);
+
+    // Outside the memtable's key range: no filter probe
+    GetPerfContext()->Reset();
+    ASSERT_EQ(GetValue(db.get(), "a"), "NOT_FOUND");
+    ASSERT_EQ(GetValue(db.get(), "z"), "NOT_FOUND");
+    ASSERT_EQ(GetPerfContext()->memtable_key_range_miss_count, 2u);
+    ASSERT_EQ(GetPerfContext()->bloom_memtable_probe_count, 0u);
+    SetPerfLevel(PerfLevel::kDisable);
+
+    // The filter never hides a write, before or after the flush
+    for (int i = 0; i < 1000; i += 2) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), i == 10 ? "NOT_FOUND" : "v" + std::to_string(i));
+    }
+    ASSERT_OK(db->Flush());
+    for (int i = 0; i < 1000; i += 2) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), i == 10 ? "NOT_FOUND" : "v" + std::to_string(i));
+    }
+}
+
+// ============================================================================
+// Row Cache Tests
+// ============================================================================
+
+static Options RowCacheOptions() {
+    Options options = SmallOptions();
+    options.block_cache_size = 1024 * 1024;
+    options.table_options.row_cache = true;
+    return options;
+}
+
+TEST(db_row_cache_serves_hot_gets) {
+    TestDir dir("db_row_cache");
+    auto db = OpenDB(dir.path(), RowCacheOptions());
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::string(100, 'a' + i % 26)));
+    }
+    // The snapshot keeps the tombstone through the compaction to the
+    // bottom level
+    SequenceNumber snap = db->GetSnapshot();
+    ASSERT_OK(db->Delete(WriteOptions(), MakeKey(500)));
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+
+    SetPerfLevel(PerfLevel::kEnableCount);
+    GetPerfContext()->Reset();
+    ASSERT_EQ(GetValue(db.get(), MakeKey(7)), std::string(100, 'h'));
+    ASSERT_EQ(GetPerfContext()->row_cache_miss_count, 1u);
+    ASSERT_EQ(GetPerfContext()->row_cache_hit_count, 0u);
+
+    // Served from the row: no filter probe and no block access
+    GetPerfContext()->Reset();
+    PinnableSlice value;
+    ASSERT_OK(db->Get(ReadOptions(), MakeKey(7), &value));
+    ASSERT_EQ(value.ToString(), std::string(100, 'h'));
+    ASSERT_TRUE(value.IsPinned());
+    ASSERT_EQ(GetPerfContext()->row_cache_hit_count, 1u);
+    ASSERT_EQ(GetPerfContext()->bloom_sst_probe_count, 0u);
+    ASSERT_EQ(GetPerfContext()->block_cache_hit_count, 0u);
+    ASSERT_EQ(GetPerfContext()->block_read_count, 0u);
+
+    // Tombstones are cached too
+    ASSERT_EQ(GetValue(db.get(), MakeKey(500)), "NOT_FOUND");
+    GetPerfContext()->Reset();
+    ASSERT_EQ(GetValue(db.get(), MakeKey(500)), "NOT_FOUND");
+    ASSERT_EQ(GetPerfContext()->row_cache_hit_count, 1u);
+    ASSERT_EQ(GetPerfContext()->block_read_count, 0u);
+
+    // And so are absent keys the filter let through (about 1% of them)
+    std::string false_positive;
+    for (int i = 0; i < 10000 && false_positive.empty(); i++) {
+        std::string key = MakeKey(7) + "x" + std::to_string(i);
+        GetPerfContext()->Reset();
+        ASSERT_EQ(GetValue(db.get(), key), "NOT_FOUND");
+        if (GetPerfContext()->bloom_sst_miss_count == 0) false_positive = key;
+    }
+    ASSERT_FALSE(false_positive.empty());  // No filter false positive found
+    GetPerfContext()->Reset();
+    ASSERT_EQ(GetValue(db.get(), false_positive), "NOT_FOUND");
+    ASSERT_EQ(GetPerfContext()->row_cache_hit_count, 1u);
+    ASSERT_EQ(GetPerfContext()->block_read_count, 0u);
+    SetPerfLevel(PerfLevel::kDisable);
+    db->ReleaseSnapshot(snap);
+
+    // Rows share the block cache's capacity
+    ASSERT_TRUE(db->options().table_options.block_cache->GetUsage() <= 1024u * 1024);
+}
+
+TEST(db_row_cache_skips_filtered_misses) {
+    TestDir dir("db_row_cache_filtered");
+    auto db = OpenDB(dir.path(), RowCacheOptions());
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::string(100, 'f')));
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    auto cache = db->options().table_options.block_cache;
+
+    // A miss the filter rules out reads no block and inserts no row
+    SetPerfLevel(PerfLevel::kEnableCount);
+    for (int i = 0; i < 100; i++) {
+        std::string key = "absent" + std::to_string(i);
+        GetPerfContext()->Reset();
+        size_t usage = cache->GetUsage();
+        ASSERT_EQ(GetValue(db.get(), key), "NOT_FOUND");
+        if (GetPerfContext()->bloom_sst_miss_count == 0) continue;  // False positive
+        ASSERT_EQ(GetPerfContext()->block_cache_hit_count, 0u);
+        ASSERT_EQ(GetPerfContext()->block_read_count, 0u);
+        ASSERT_EQ(cache->GetUsage(), usage);
+
+        GetPerfContext()->Reset();
+        ASSERT_EQ(GetValue(db.get(), key), "NOT_FOUND");
+        ASSERT_EQ(GetPerfContext()->row_cache_hit_count, 0u);
+    }
+    SetPerfLevel(PerfLevel::kDisable);
+}
+
+TEST(db_row_cache_sees_new_writes) {
+    TestDir dir("db_row_cache_writes");
+    auto db = OpenDB(dir.path(), RowCacheOptions());
+    ASSERT_OK(db->Put(WriteOptions(), "k", "v1"));
+    ASSERT_OK(db->Flush());
+    ASSERT_EQ(GetValue(db.get(), "k"), "v1");
+    ASSERT_EQ(GetValue(db.get(), "k"), "v1");
+
+    // Newer tables are searched first; their rows are keyed by their own
+    // file numbers
+    SequenceNumber snap = db->GetSnapshot();
+    ASSERT_OK(db->Put(WriteOptions(), "k", "v2"));
+    ASSERT_OK(db->Flush());
+    ASSERT_EQ(GetValue(db.get(), "k"), "v2");
+    ASSERT_EQ(GetValue(db.get(), "k"), "v2");
+
+    ASSERT_OK(db->Delete(WriteOptions(), "k"));
+    ASSERT_OK(db->Flush());
+    ASSERT_EQ(GetValue(db.get(), "k"), "NOT_FOUND");
+
+    // A snapshot older than a table bypasses its rows
+    ReadOptions at_snap;
+    at_snap.snapshot = snap;
+    ASSERT_EQ(GetValue(db.get(), "k", at_snap), "v1");
+    ASSERT_EQ(GetValue(db.get(), "k", at_snap), "v1");
+
+    // Compaction writes new tables; their rows start empty
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    ASSERT_EQ(GetValue(db.get(), "k", at_snap), "v1");
+    ASSERT_EQ(GetValue(db.get(), "k"), "NOT_FOUND");
+    ASSERT_OK(db->Put(WriteOptions(), "k", "v3"));
+    ASSERT_EQ(GetValue(db.get(), "k"), "v3");
+    db->ReleaseSnapshot(snap);
+}
+
+// ============================================================================
+// Secondary Cache Tests
+// ============================================================================
+
+TEST(db_compressed_secondary_cache) {
+    TestDir dir("db_secondary_cache");
+    {
+        auto db = OpenDB(dir.path());
+        for (int i = 0; i < 4000; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "value-" + std::string(60, 'v')));
+        }
+        ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    }
+
+    // ~300KB of blocks through a 64KB block cache; the compressed tier
+    // holds them all once each block has been evicted twice
+    auto blocks_read_in_pass = [&](size_t secondary_size) {
+        Options options = SmallOptions();
+        options.block_cache_size = 64 * 1024;
+        options.compressed_secondary_cache_size = secondary_size;
+        auto db = OpenDB(dir.path(), options);
+        SetPerfLevel(PerfLevel::kEnableCount);
+        uint64_t reads = 0;
+        for (int pass = 0; pass < 3; pass++) {
+            GetPerfContext()->Reset();
+            for (int i = 0; i < 4000; i++) {
+                ASSERT_EQ(GetValue(db.get(), MakeKey(i)), "value-" + std::string(60, 'v'));
+            }
+            reads = GetPerfContext()->block_read_count;
+        }
+        SetPerfLevel(PerfLevel::kDisable);
+        auto cache = db->options().table_options.block_cache;
+        ASSERT_EQ(cache->secondary_cache() != nullptr, secondary_size > 0);
+        if (secondary_size > 0) ASSERT_TRUE(cache->SecondaryHits() > 0);
+        return reads;
+    };
+
+    uint64_t without = blocks_read_in_pass(0);
+    uint64_t with = blocks_read_in_pass(256 * 1024);
+    ASSERT_TRUE(without > 200);
+    ASSERT_TRUE(with < without / 10);
+}
+
+// ============================================================================
+// Memory Budget Tests
+// ============================================================================
+
+TEST(write_buffer_manager_ignores_memory_being_flushed) {
+    WriteBufferManager wbm(1000);
+    wbm.ReserveMem(800);
+    ASSERT_FALSE(wbm.ShouldFlush());
+    wbm.ReserveMem(100);  // Mutable memory past 7/8 of the budget
+    ASSERT_TRUE(wbm.ShouldFlush());
+
+    // Once that memtable is immutable, other writers over the budget are
+    // not forced to flush until their own memory is a large share of it
+    wbm.ScheduleFreeMem(900);
+    wbm.ReserveMem(200);
+    ASSERT_EQ(wbm.memory_usage(), 1100u);
+    ASSERT_FALSE(wbm.ShouldFlush());
+    wbm.ReserveMem(300);
+    ASSERT_TRUE(wbm.ShouldFlush());
+
+    wbm.FreeMem(900);
+    ASSERT_FALSE(wbm.ShouldFlush());
+    wbm.ScheduleFreeMem(500);
+    wbm.FreeMem(500);
+    ASSERT_EQ(wbm.memory_usage(), 0u);
+    ASSERT_EQ(wbm.mutable_memtable_memory_usage(), 0u);
+}
+
+TEST(db_write_buffer_manager_shared) {
+    TestDir dir1("db_wbm_1");
+    TestDir dir2("db_wbm_2");
+    auto cache = NewLRUCache(8 * 1024 * 1024);
+    auto wbm = std::make_shared<WriteBufferManager>(1024 * 1024, cache);
+
+    Options options = SmallOptions();
+    options.write_buffer_size = 64 * 1024 * 1024;  // Never full on its own
+    options.table_options.block_cache = cache;
+    options.write_buffer_manager = wbm;
+    {
+        auto db1 = OpenDB(dir1.path(), options);
+        auto db2 = OpenDB(dir2.path(), options);
+        std::string value(100, 'm');
+        size_t peak = 0;
+        for (int i = 0; i < 40000; i++) {
+            DB* db = i % 2 == 0 ? db1.get() : db2.get();
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+            peak = std::max(peak, wbm->memory_usage());
+            if (i == 100) {
+                // Memtable memory is charged to the cache, in whole units
+                ASSERT_TRUE(wbm->memory_usage() > 0);
+                ASSERT_EQ(cache->GetReserved(), WriteBufferManager::kReservationUnit);
+            }
+        }
+        // Both DBs flushed early to stay within the shared budget
+        ASSERT_TRUE(TotalFiles(db1.get()) > 0);
+        ASSERT_TRUE(TotalFiles(db2.get()) > 0);
+        // Writers wait for in-flight flushes once the budget is spent
+        ASSERT_TRUE(peak < 2 * 1024 * 1024);
+        ASSERT_TRUE(cache->GetReserved() >= wbm->memory_usage());
+        ASSERT_TRUE(cache->GetUsage() + cache->GetReserved() <= 8u * 1024 * 1024 +
+                                                                 WriteBufferManager::kReservationUnit);
+        for (int i = 0; i < 40000; i += 997) {
+            ASSERT_EQ(GetValue(i % 2 == 0 ? db1.get() : db2.get(), MakeKey(i)), value);
+        }
+    }
+    // Closing the DBs frees their memtables and the reservation
+    ASSERT_EQ(wbm->memory_usage(), 0u);
+    ASSERT_EQ(cache->GetReserved(), 0u);
+}
+
+TEST(db_charge_table_memory) {
+    TestDir dir("db_charge_tables");
+    Options options = SmallOptions();
+    options.block_cache_size = 1024 * 1024;
+    options.table_options.charge_table_memory = true;
+    std::shared_ptr<Cache> cache;
+    {
+        auto db = OpenDB(dir.path(), options);
+        cache = db->options().table_options.block_cache;
+        for (int i = 0; i < 5000; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::string(50, 't')));
+        }
+        ASSERT_OK(db->Flush());
+        GetValue(db.get(), MakeKey(0));
+
+        // Open tables' index and filter blocks are charged while open
+        ASSERT_TRUE(TotalFiles(db.get()) > 0);
+        ASSERT_TRUE(cache->GetReserved() > 0);
+        ASSERT_TRUE(cache->GetUsage() + cache->GetReserved() <= 1024u * 1024);
+    }
+    ASSERT_EQ(cache->GetReserved(), 0u);
+}
+
+// ============================================================================
+// Block Cache Warm-up Tests
+// ============================================================================
+
+// A DB of ~2MB whose block cache has served reads of keys [0, hot)
+static void FillAndReadHot(const std::string& path, const Options& options, int hot) {
+    auto db = OpenDB(path, options);
+    std::string value(100, 'w');
+    for (int i = 0; i < 20000; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    for (int i = 0; i < hot; i++) ASSERT_EQ(GetValue(db.get(), MakeKey(i)), value);
+}
+
+TEST(db_block_cache_warmup_after_reopen) {
+    TestDir dir("db_cache_warmup");
+    Options options = SmallOptions();
+    options.block_cache_dump_period_sec = 3600;  // Only the dump at close
+    FillAndReadHot(dir.path(), options, 2000);
+    ASSERT_TRUE(fs::exists(BlockCacheWarmupFileName(dir.path())));
+
+    auto db = OpenDB(dir.path(), options);
+    uint64_t warmed = db->WaitForBlockCacheWarmup();
+    ASSERT_TRUE(warmed > 0);
+
+    // The hot keys are served from the cache without a single miss
+    auto cache = db->options().table_options.block_cache;
+    uint64_t misses = cache->Misses();
+    for (int i = 0; i < 2000; i++) GetValue(db.get(), MakeKey(i));
+    ASSERT_EQ(cache->Misses(), misses);
+
+    // Without warm-up, the same reads miss
+    db.reset();
+    options.block_cache_warmup_bytes_per_sec = 0;
+    db = OpenDB(dir.path(), options);
+    ASSERT_EQ(db->WaitForBlockCacheWarmup(), 0u);
+    cache = db->options().table_options.block_cache;
+    misses = cache->Misses();
+    for (int i = 0; i < 2000; i++) GetValue(db.get(), MakeKey(i));
+    ASSERT_TRUE(cache->Misses() > misses);
+    std::cout << " [warmed " << warmed / 1024 << "KB]";
+}
+
+TEST(db_block_cache_warmup_bounded) {
+    TestDir dir("db_cache_warmup_bounded");
+    Options options = SmallOptions();
+    options.block_cache_dump_period_sec = 3600;
+    FillAndReadHot(dir.path(), options, 20000);
+
+    // Stops once the cache is full: colder blocks would evict hotter ones.
+    // (No dumps from here on, so every open reloads the same list.)
+    options.block_cache_dump_period_sec = 0;
+    options.block_cache_size = 64 * 1024;
+    auto db = OpenDB(dir.path(), options);
+    ASSERT_TRUE(db->WaitForBlockCacheWarmup() <= 64 * 1024 + 2 * 1024);
+    db.reset();
+
+    // Paced at the configured rate
+    options.block_cache_size = 8 * 1024 * 1024;
+    options.block_cache_warmup_bytes_per_sec = 1024 * 1024;
+    auto start = std::chrono::steady_clock::now();
+    db = OpenDB(dir.path(), options);
+    uint64_t warmed = db->WaitForBlockCacheWarmup();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_TRUE(warmed > 1024 * 1024);
+    ASSERT_TRUE(secs >= static_cast<double>(warmed - 2 * 1024) / (1024 * 1024));
+    db.reset();
+
+    // Closing does not wait for a slow warm-up
+    options.block_cache_warmup_bytes_per_sec = 1;
+    db = OpenDB(dir.path(), options);
+    start = std::chrono::steady_clock::now();
+    db.reset();
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+}
+
+// ============================================================================
+// Blob File Tests
+// ============================================================================
+
+static Options BlobOptions() {
+    Options options = SmallOptions();
+    options.enable_blob_files = true;
+    options.min_blob_size = 1024;
+    options.blob_file_size = 256 * 1024;
+    return options;
+}
+
+static std::string BlobValue(int i, char c) {
+    return std::string(4000, c) + std::to_string(i);
+}
+
+static std::set<std::string> BlobFiles(const std::string& path) {
+    std::set<std::string> names;
+    for (const auto& entry : fs::directory_iterator(path)) {
+        uint64_t number;
+        std::string name = entry.path().filename().string();
+        if (ParseBlobFileName(name, &number)) names.insert(name);
+    }
+    return names;
+}
+
+TEST(db_blob_separates_large_values) {
+    TestDir dir("db_blob_separate");
+    auto db = OpenDB(dir.path(), BlobOptions());
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), BlobValue(i, 'a')));
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i) + "small", "inline"));
+    }
+    ASSERT_OK(db->Flush());
+    ASSERT_TRUE(db->NumBlobFiles() > 0);
+
+    // Tables hold only references: far smaller than the values
+    uint64_t table_bytes = 0;
+    for (const auto& entry : fs::directory_iterator(dir.path())) {
+        uint64_t number;
+        if (ParseTableFileName(entry.path().filename().string(), &number)) {
+            table_bytes += fs::file_size(entry.path());
+        }
+    }
+    ASSERT_TRUE(table_bytes < 100 * 4000 / 10);
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), BlobValue(i, 'a'));
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i) + "small"), "inline");
+    }
+
+    PinnableSlice pinned;
+    ASSERT_OK(db->Get(ReadOptions(), MakeKey(7), &pinned));
+    ASSERT_EQ(pinned.ToString(), BlobValue(7, 'a'));
+
+    // Both directions resolve references
+    std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+    auto forward = ScanForward(iter.get());
+    auto backward = ScanBackward(iter.get());
+    ASSERT_EQ(forward.size(), 200u);
+    ASSERT_EQ(forward[0], MakeKey(0) + "=" + BlobValue(0, 'a'));
+    std::reverse(backward.begin(), backward.end());
+    ASSERT_TRUE(forward == backward);
+}
+
+TEST(db_blob_compaction_keeps_values_in_place) {
+    TestDir dir("db_blob_compact");
+    Options options = BlobOptions();
+    options.enable_blob_garbage_collection = false;
+    auto db = OpenDB(dir.path(), options);
+
+    for (int i = 0; i < 200; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), BlobValue(i, 'a')));
+    }
+    ASSERT_OK(db->Flush());
+    auto blob_files = BlobFiles(dir.path());
+    ASSERT_FALSE(blob_files.empty());
+
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    ASSERT_TRUE(BlobFiles(dir.path()) == blob_files);
+    for (int i = 0; i < 200; i += 7) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), BlobValue(i, 'a'));
+    }
+}
+
+TEST(db_blob_overwritten_files_deleted) {
+    TestDir dir("db_blob_overwrite");
+    Options options = BlobOptions();
+    options.enable_blob_garbage_collection = false;
+    auto db = OpenDB(dir.path(), options);
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), BlobValue(i, 'a')));
+    }
+    ASSERT_OK(db->Flush());
+    auto first_round = BlobFiles(dir.path());
+
+    // Overwrite and delete everything: the old records all become garbage
+    for (int i = 0; i < 100; i++) {
+        if (i % 2 == 0) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), BlobValue(i, 'b')));
+        } else {
+            ASSERT_OK(db->Delete(WriteOptions(), MakeKey(i)));
+        }
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+
+    auto remaining = BlobFiles(dir.path());
+    for (const auto& name : first_round) ASSERT_EQ(remaining.count(name), 0u);
+    ASSERT_EQ(static_cast<int>(remaining.size()), db->NumBlobFiles());
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)),
+                  i % 2 == 0 ? BlobValue(i, 'b') : "NOT_FOUND");
+    }
+}
+
+TEST(db_blob_garbage_collection_relocates) {
+    TestDir dir("db_blob_gc");
+    Options options = BlobOptions();
+    options.blob_garbage_collection_age_cutoff = 1.0;
+    auto db = OpenDB(dir.path(), options);
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), BlobValue(i, 'a')));
+    }
+    ASSERT_OK(db->Flush());
+    auto old_files = BlobFiles(dir.path());
+    ASSERT_FALSE(old_files.empty());
+
+    // Overwrite a quarter; the other values are still live in old files
+    for (int i = 0; i < 100; i += 4) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), BlobValue(i, 'b')));
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+
+    // Live values were moved out, so the original files are gone
+    for (const auto& name : old_files) {
+        ASSERT_FALSE(fs::exists(dir.path() + "/" + name));
+    }
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), BlobValue(i, i % 4 == 0 ? 'b' : 'a'));
+    }
+}
+
+TEST(db_blob_garbage_collection_cutoff_validated) {
+    TestDir dir("db_blob_gc_cutoff");
+    DB* raw = nullptr;
+    for (double cutoff : {-0.5, 1.5}) {
+        Options options = BlobOptions();
+        options.blob_garbage_collection_age_cutoff = cutoff;
+        ASSERT_TRUE(DB::Open(options, dir.path(), &raw).IsInvalidArgument());
+        ASSERT_TRUE(raw == nullptr);
+    }
+
+    auto db = OpenDB(dir.path(), BlobOptions());
+    ColumnFamilyOptions cf_options = BlobOptions();
+    cf_options.blob_garbage_collection_age_cutoff = 2.0;
+    ColumnFamilyHandle* handle = nullptr;
+    ASSERT_TRUE(db->CreateColumnFamily(cf_options, "blobs", &handle).IsInvalidArgument());
+}
+
+TEST(db_blob_snapshot_keeps_old_values) {
+    TestDir dir("db_blob_snapshot");
+    Options options = BlobOptions();
+    options.blob_garbage_collection_age_cutoff = 1.0;
+    auto db = OpenDB(dir.path(), options);
+
+    ASSERT_OK(db->Put(WriteOptions(), "k", BlobValue(1, 'a')));
+    ASSERT_OK(db->Flush());
+    SequenceNumber snap = db->GetSnapshot();
+    ASSERT_OK(db->Put(WriteOptions(), "k", BlobValue(2, 'b')));
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+
+    ReadOptions ro;
+    ro.snapshot = snap;
+    ASSERT_EQ(GetValue(db.get(), "k", ro), BlobValue(1, 'a'));
+    ASSERT_EQ(GetValue(db.get(), "k"), BlobValue(2, 'b'));
+    db->ReleaseSnapshot(snap);
+}
+
+TEST(db_blob_recovery) {
+    TestDir dir("db_blob_recovery");
+    {
+        auto db = OpenDB(dir.path(), BlobOptions());
+        for (int i = 0; i < 50; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), BlobValue(i, 'a')));
+        }
+        ASSERT_OK(db->Flush());
+        for (int i = 50; i < 100; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), BlobValue(i, 'a')));
+        }
+        // Left in the WAL; separated when recovery flushes it
+    }
+    auto db = OpenDB(dir.path(), BlobOptions());
+    ASSERT_TRUE(db->NumBlobFiles() >= 2);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), BlobValue(i, 'a'));
+    }
+}
+
+TEST(db_blob_corruption_detected) {
+    TestDir dir("db_blob_corrupt");
+    auto db = OpenDB(dir.path(), BlobOptions());
+    ASSERT_OK(db->Put(WriteOptions(), "k", BlobValue(1, 'a')));
+    ASSERT_OK(db->Flush());
+
+    for (const auto& entry : fs::directory_iterator(dir.path())) {
+        uint64_t number;
+        if (!ParseBlobFileName(entry.path().filename().string(), &number)) continue;
+        std::fstream f(entry.path(), std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(100);
+        f.put('X');
+    }
+    std::string value;
+    ASSERT_TRUE(db->Get(ReadOptions(), "k", &value).IsCorruption());
+}
+
+// ============================================================================
+// Column Family Tests
+// ============================================================================
+
+static std::unique_ptr<DB> OpenDBWithFamilies(const std::string& path,
+                                              const std::vector<ColumnFamilyDescriptor>& families,
+                                              std::vector<ColumnFamilyHandle*>* handles,
+                                              Options options = SmallOptions()) {
+    options.create_missing_column_families = true;
+    DB* db = nullptr;
+    ASSERT_OK(DB::Open(options, path, families, handles, &db));
+    return std::unique_ptr<DB>(db);
+}
+
+static std::string GetValue(DB* db, ColumnFamilyHandle* cf, Slice key) {
+    std::string value;
+    Status s = db->Get(ReadOptions(), cf, key, &value);
+    if (s.IsNotFound()) return "NOT_FOUND";
+    ASSERT_OK(s);
+    return value;
+}
+
+static int NumWalFiles(const std::string& path) {
+    int count = 0;
+    for (const auto& entry : fs::directory_iterator(path + "/wal")) {
+        if (entry.is_regular_file()) count++;
+    }
+    return count;
+}
+
+TEST(db_column_family_isolation) {
+    TestDir dir("db_cf_isolation");
+    auto db = OpenDB(dir.path());
+    ColumnFamilyHandle* users = nullptr;
+    ASSERT_OK(db->CreateColumnFamily(SmallOptions(), "users", &users));
+    ASSERT_EQ(users->GetName(), "users");
+    ASSERT_TRUE(users->GetID() != db->DefaultColumnFamily()->GetID());
+    ColumnFamilyHandle* duplicate = nullptr;
+    ASSERT_TRUE(db->CreateColumnFamily(SmallOptions(), "users", &duplicate).IsInvalidArgument());
+
+    ASSERT_OK(db->Put(WriteOptions(), "k", "default"));
+    ASSERT_OK(db->Put(WriteOptions(), users, "k", "users"));
+    ASSERT_OK(db->Put(WriteOptions(), users, "only_users", "v"));
+    ASSERT_EQ(GetValue(db.get(), "k"), "default");
+    ASSERT_EQ(GetValue(db.get(), users, "k"), "users");
+    ASSERT_EQ(GetValue(db.get(), "only_users"), "NOT_FOUND");
+
+    ASSERT_OK(db->Delete(WriteOptions(), "k"));
+    ASSERT_EQ(GetValue(db.get(), "k"), "NOT_FOUND");
+    ASSERT_EQ(GetValue(db.get(), users, "k"), "users");
+
+    ASSERT_OK(db->Flush(users));
+    ASSERT_EQ(db->NumFilesAtLevel(users, 0), 1);
+    ASSERT_EQ(db->NumFilesAtLevel(0), 0);
+
+    std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions(), users));
+    ASSERT_EQ(ScanForward(iter.get()), (std::vector<std::string>{"k=users", "only_users=v"}));
+}
+
+TEST(db_column_family_options) {
+    TestDir dir("db_cf_options");
+    auto db = OpenDB(dir.path());
+
+    ColumnFamilyOptions blob_options = BlobOptions();
+    blob_options.table_options.block_size = 16 * 1024;
+    ColumnFamilyHandle* blobs = nullptr;
+    ASSERT_OK(db->CreateColumnFamily(blob_options, "blobs", &blobs));
+
+    for (int i = 0; i < 20; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), BlobValue(i, 'a')));
+        ASSERT_OK(db->Put(WriteOptions(), blobs, MakeKey(i), BlobValue(i, 'b')));
+    }
+    ASSERT_OK(db->Flush());
+    ASSERT_OK(db->Flush(blobs));
+
+    // Only the family configured for it separates values
+    ASSERT_EQ(db->NumBlobFiles(), 0);
+    ASSERT_TRUE(db->NumBlobFiles(blobs) > 0);
+    for (int i = 0; i < 20; i++) {
+        ASSERT_EQ(GetValue(db.get(), MakeKey(i)), BlobValue(i, 'a'));
+        ASSERT_EQ(GetValue(db.get(), blobs, MakeKey(i)), BlobValue(i, 'b'));
+    }
+
+    // Families keep their files in separate directories
+    ASSERT_TRUE(BlobFiles(dir.path()).empty());
+    ASSERT_FALSE(BlobFiles(ColumnFamilyDirName(dir.path(), blobs->GetID())).empty());
+}
+
+TEST(db_column_family_recovery) {
+    TestDir dir("db_cf_recovery");
+    std::vector<ColumnFamilyDescriptor> families = {
+        {kDefaultColumnFamilyName, SmallOptions()}, {"a", SmallOptions()}, {"b", SmallOptions()}};
+    {
+        std::vector<ColumnFamilyHandle*> handles;
+        auto db = OpenDBWithFamilies(dir.path(), families, &handles);
+        ASSERT_EQ(handles.size(), 3u);
+        for (int i = 0; i < 300; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), handles[i % 3], MakeKey(i), "v" + std::to_string(i)));
+        }
+        ASSERT_OK(db->Flush(handles[1]));
+        ASSERT_OK(db->Delete(WriteOptions(), handles[1], MakeKey(1)));
+        // Default and "b" are only in the WAL
+    }
+
+    // Every family the DB has must be opened
+    DB* raw = nullptr;
+    ASSERT_TRUE(DB::Open(SmallOptions(), dir.path(), &raw).IsInvalidArgument());
+    std::vector<ColumnFamilyHandle*> handles;
+    ASSERT_TRUE(DB::Open(SmallOptions(), dir.path(), {families[0], families[1]}, &handles, &raw)
+                    .IsInvalidArgument());
+    ASSERT_TRUE(DB::Open(SmallOptions(), dir.path(),
+                         {families[0], families[1], families[2], {"c", SmallOptions()}},
+                         &handles, &raw)
+                    .IsInvalidArgument());
+
+    // Descriptor order decides handle order, not creation order
+    auto db = OpenDBWithFamilies(dir.path(), {families[2], families[0], families[1]}, &handles);
+    ASSERT_EQ(handles[0]->GetName(), "b");
+    ASSERT_EQ(handles[2]->GetName(), "a");
+    std::map<std::string, ColumnFamilyHandle*> by_name;
+    for (auto* h : handles) by_name[h->GetName()] = h;
+
+    const char* names[] = {kDefaultColumnFamilyName, "a", "b"};
+    for (int i = 0; i < 300; i++) {
+        ColumnFamilyHandle* cf = by_name[names[i % 3]];
+        std::string expected = (i == 1) ? "NOT_FOUND" : "v" + std::to_string(i);
+        ASSERT_EQ(GetValue(db.get(), cf, MakeKey(i)), expected);
+        for (const char* other : names) {
+            if (by_name[other] != cf) {
+                ASSERT_EQ(GetValue(db.get(), by_name[other], MakeKey(i)), "NOT_FOUND");
+            }
+        }
+    }
+
+    // New writes get sequence numbers past every family's recovered data
+    SequenceNumber snap = db->GetSnapshot();
+    ASSERT_OK(db->Put(WriteOptions(), by_name["b"], MakeKey(2), "new"));
+    ReadOptions ro;
+    ro.snapshot = snap;
+    std::string value;
+    ASSERT_OK(db->Get(ro, by_name["b"], MakeKey(2), &value));
+    ASSERT_EQ(value, "v2");
+    db->ReleaseSnapshot(snap);
+}
+
+TEST(db_column_family_wal_kept_until_all_flushed) {
+    TestDir dir("db_cf_wal");
+    {
+        auto db = OpenDB(dir.path());
+        ColumnFamilyHandle* cold = nullptr;
+        ASSERT_OK(db->CreateColumnFamily(SmallOptions(), "cold", &cold));
+
+        ASSERT_OK(db->Put(WriteOptions(), cold, "cold_key", "cold_value"));
+        for (int round = 0; round < 3; round++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(round), "hot"));
+            ASSERT_OK(db->Flush());
+        }
+        // "cold" has not flushed, so the log holding its write stays
+        ASSERT_TRUE(NumWalFiles(dir.path()) > 1);
+    }
+    {
+        std::vector<ColumnFamilyHandle*> handles;
+        auto db = OpenDBWithFamilies(
+            dir.path(), {{kDefaultColumnFamilyName, SmallOptions()}, {"cold", SmallOptions()}},
+            &handles);
+        ASSERT_EQ(GetValue(db.get(), handles[1], "cold_key"), "cold_value");
+        ASSERT_EQ(GetValue(db.get(), MakeKey(2)), "hot");
+
+        // Recovery flushed everything; once both families flush again only
+        // the live log remains
+        ASSERT_OK(db->Put(WriteOptions(), handles[1], "cold_key", "v2"));
+        ASSERT_OK(db->Put(WriteOptions(), "hot_key", "v2"));
+        ASSERT_OK(db->Flush(handles[1]));
+        ASSERT_TRUE(NumWalFiles(dir.path()) > 1);
+        ASSERT_OK(db->Flush());
+        ASSERT_EQ(NumWalFiles(dir.path()), 1);
+    }
+}
+
+TEST(db_column_family_idle_family_does_not_pin_wal) {
+    TestDir dir("db_cf_idle");
+    auto db = OpenDB(dir.path());
+    ColumnFamilyHandle* idle = nullptr;
+    ColumnFamilyHandle* pinned = nullptr;
+    ASSERT_OK(db->CreateColumnFamily(SmallOptions(), "idle", &idle));
+    ASSERT_OK(db->CreateColumnFamily(SmallOptions(), "pinned", &pinned));
+    ASSERT_OK(db->Put(WriteOptions(), idle, "k", "v"));
+    ASSERT_OK(db->Flush(idle));
+
+    // "pinned" holds every log from here on while default keeps rotating
+    ASSERT_OK(db->Put(WriteOptions(), pinned, "k", "v"));
+    for (int round = 0; round < 3; round++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(round), "v"));
+        ASSERT_OK(db->Flush());
+    }
+    ASSERT_EQ(NumWalFiles(dir.path()), 4);
+
+    // "idle" had nothing unflushed while those logs were written, so its
+    // new write does not keep them alive despite its old MANIFEST log number
+    ASSERT_OK(db->Put(WriteOptions(), idle, "k2", "v"));
+    ASSERT_OK(db->Flush(pinned));
+    ASSERT_EQ(NumWalFiles(dir.path()), 2);
+    ASSERT_OK(db->Flush(idle));
+    ASSERT_EQ(NumWalFiles(dir.path()), 1);
+}
+
+TEST(db_group_commit_concurrent_writers) {
+    TestDir dir("db_group_commit");
+    const int kThreads = 8;
+    const int kPerThread = 2000;
+    {
+        auto db = OpenDB(dir.path());
+        ColumnFamilyHandle* other = nullptr;
+        ASSERT_OK(db->CreateColumnFamily(SmallOptions(), "other", &other));
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; t++) {
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < kPerThread; i++) {
+                    WriteOptions wo;
+                    wo.sync = (i % 500 == 0);
+                    std::string key = MakeKey(t * kPerThread + i);
+                    ColumnFamilyHandle* cf = (i % 2 == 0) ? db->DefaultColumnFamily() : other;
+                    ASSERT_OK(db->Put(wo, cf, key, key));
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+    }
+
+    std::vector<ColumnFamilyHandle*> handles;
+    auto db = OpenDBWithFamilies(
+        dir.path(), {{kDefaultColumnFamilyName, SmallOptions()}, {"other", SmallOptions()}},
+        &handles);
+    for (int t = 0; t < kThreads; t++) {
+        for (int i = 0; i < kPerThread; i++) {
+            std::string key = MakeKey(t * kPerThread + i);
+            ColumnFamilyHandle* cf = handles[i % 2];
+            ASSERT_EQ(GetValue(db.get(), cf, key), key);
+            ASSERT_EQ(GetValue(db.get(), handles[1 - i % 2], key), "NOT_FOUND");
+        }
+    }
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+void benchmark_fill_and_scan() {
+    TestDir dir("db_bench");
+    Options options;
+    options.wal_options.sync_policy = wal::SyncPolicy::kNoSync;
+    auto db = OpenDB(dir.path(), options);
+
+    const int N = 200000;
+    std::string value(100, 'v');
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < N; i++) {
+        db->Put(WriteOptions(), MakeKey(i), value);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << "  Fill: " << N << " puts in " << ms << "ms ("
+              << (N * 1000LL / (ms + 1)) << " ops/sec)\n";
+
+    db->Flush();
+    start = std::chrono::high_resolution_clock::now();
+    std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) count++;
+    end = std::chrono::high_resolution_clock::now();
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << "  Scan: " << count << " entries in " << ms << "ms\n";
+}
+
+void benchmark_open_many_tables() {
+    TestDir dir("db_bench_open");
+    int n = FillTables(dir.path());
+
+    for (int threads : {0, 1, 16}) {
+        Options options = SmallOptions();
+        options.max_file_opening_threads = threads;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto db = OpenDB(dir.path(), options);
+        auto opened = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < n; i += n / 200) GetValue(db.get(), MakeKey(i));
+        auto end = std::chrono::high_resolution_clock::now();
+        auto us = [](auto d) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        };
+        std::cout << "  Open " << TotalFiles(db.get()) << " tables, " << threads
+                  << " loading threads: open " << us(opened - start) << "us, then 200 gets "
+                  << us(end - opened) << "us\n";
+    }
+}
+
+void benchmark_row_cache_hot_gets() {
+    TestDir dir("db_bench_row_cache");
+    {
+        auto db = OpenDB(dir.path());
+        for (int i = 0; i < 20000; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::string(100, 'r')));
+        }
+        ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    }
+
+    // 60% of gets go to the hottest 1% of keys
+    for (bool row_cache : {false, true}) {
+        Options options = SmallOptions();
+        options.table_options.row_cache = row_cache;
+        auto db = OpenDB(dir.path(), options);
+        std::mt19937 rng(42);
+        const int kGets = 200000;
+        PinnableSlice value;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < kGets; i++) {
+            int key = rng() % 10 < 6 ? static_cast<int>(rng() % 200)
+                                     : static_cast<int>(rng() % 20000);
+            ASSERT_OK(db->Get(ReadOptions(), MakeKey(key), &value));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double secs = std::chrono::duration<double>(end - start).count();
+        std::cout << "  Skewed gets, row cache " << (row_cache ? "on:  " : "off: ")
+                  << static_cast<int>(kGets / secs) << " gets/sec\n";
+    }
+}
+
+void benchmark_scan_over_tombstones() {
+    TestDir dir("db_bench_tombstones");
+    Options options = SmallOptions();
+    options.scan_tombstone_compaction_trigger = 0;  // Measure the raw cost
+    auto db = OpenDB(dir.path(), options);
+
+    const int N = 50000;
+    for (int i = 0; i < N; i++) db->Put(WriteOptions(), MakeKey(i), "job");
+    for (int i = 0; i < N - 1; i++) db->Delete(WriteOptions(), MakeKey(i));
+    db->Flush();
+
+    auto time_seek = [&]() {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+        for (int i = 0; i < 10; i++) iter->SeekToFirst();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 10;
+    };
+
+    auto before = time_seek();
+    db->CompactRange(nullptr, nullptr);
+    auto after = time_seek();
+    std::cout << "  Seek past " << (N - 1) << " tombstones: " << before
+              << "us, after compaction: " << after << "us\n";
+}
+
+void benchmark_large_value_compaction() {
+    for (bool blobs : {false, true}) {
+        TestDir dir("db_bench_blob");
+        Options options;
+        options.wal_options.sync_policy = wal::SyncPolicy::kNoSync;
+        options.write_buffer_size = 4 * 1024 * 1024;
+        options.enable_blob_files = blobs;
+        auto db = OpenDB(dir.path(), options);
+
+        const int N = 5000;
+        std::string value(10 * 1024, 'v');
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int round = 0; round < 2; round++) {
+            for (int i = 0; i < N; i++) db->Put(WriteOptions(), MakeKey(i), value);
+            db->CompactRange(nullptr, nullptr);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "  10KB values, 2x fill + compact (" << (blobs ? "blob files" : "inline")
+                  << "): " << ms << "ms\n";
+    }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+    std::cout << "=== Phase 6: DB Tests ===\n\n";
+
+    std::cout << "--- Merging Iterator Tests ---\n";
+    RUN_TEST(merging_iterator_direction_changes);
+
+    std::cout << "\n--- Basic DB Tests ---\n";
+    RUN_TEST(db_put_get_delete);
+    RUN_TEST(db_get_across_flushes);
+    RUN_TEST(db_recovery_from_wal);
+    RUN_TEST(db_recovery_of_large_values);
+    RUN_TEST(db_recovery_after_compaction);
+    RUN_TEST(db_error_if_exists);
+    RUN_TEST(db_snapshots);
+
+    std::cout << "\n--- Iterator Tests ---\n";
+    RUN_TEST(db_iterator_merges_sources);
+    RUN_TEST(db_iterator_snapshot_isolation);
+    RUN_TEST(db_iterator_matches_model);
+
+    std::cout << "\n--- Iterator Bounds Tests ---\n";
+    RUN_TEST(db_iterator_bounds);
+    RUN_TEST(db_iterator_bounds_prune_files);
+
+    std::cout << "\n--- Table Loading Tests ---\n";
+    RUN_TEST(db_open_preloads_tables);
+    RUN_TEST(db_open_verifies_tables);
+    RUN_TEST(db_open_detects_truncated_table);
+
+    std::cout << "\n--- Compaction Tests ---\n";
+    RUN_TEST(db_level0_compaction_trigger);
+    RUN_TEST(db_compact_range_drops_tombstones);
+    RUN_TEST(db_scan_tombstones_trigger_compaction);
+    RUN_TEST(db_obsolete_files_deleted);
+
+    std::cout << "\n--- Pinned Get Tests ---\n";
+    RUN_TEST(db_pinned_get_from_memtable);
+    RUN_TEST(db_pinned_get_from_block_cache);
+    RUN_TEST(db_pinned_get_without_block_cache);
+    RUN_TEST(db_pinned_release_during_flush);
+
+    std::cout << "\n--- Memtable Filter Tests ---\n";
+    RUN_TEST(db_memtable_bloom_filter);
+
+    std::cout << "\n--- Row Cache Tests ---\n";
+    RUN_TEST(db_row_cache_serves_hot_gets);
+    RUN_TEST(db_row_cache_skips_filtered_misses);
+    RUN_TEST(db_row_cache_sees_new_writes);
+
+    std::cout << "\n--- Secondary Cache Tests ---\n";
+    RUN_TEST(db_compressed_secondary_cache);
+
+    std::cout << "\n--- Memory Budget Tests ---\n";
+    RUN_TEST(write_buffer_manager_ignores_memory_being_flushed);
+    RUN_TEST(db_write_buffer_manager_shared);
+    RUN_TEST(db_charge_table_memory);
+
+    std::cout << "\n--- Block Cache Warm-up Tests ---\n";
+    RUN_TEST(db_block_cache_warmup_after_reopen);
+    RUN_TEST(db_block_cache_warmup_bounded);
+
+    std::cout << "\n--- Blob File Tests ---\n";
+    RUN_TEST(db_blob_separates_large_values);
+    RUN_TEST(db_blob_compaction_keeps_values_in_place);
+    RUN_TEST(db_blob_overwritten_files_deleted);
+    RUN_TEST(db_blob_garbage_collection_relocates);
+    RUN_TEST(db_blob_garbage_collection_cutoff_validated);
+    RUN_TEST(db_blob_snapshot_keeps_old_values);
+    RUN_TEST(db_blob_recovery);
+    RUN_TEST(db_blob_corruption_detected);
+
+    std::cout << "\n--- Column Family Tests ---\n";
+    RUN_TEST(db_column_family_isolation);
+    RUN_TEST(db_column_family_options);
+    RUN_TEST(db_column_family_recovery);
+    RUN_TEST(db_column_family_wal_kept_until_all_flushed);
+    RUN_TEST(db_column_family_idle_family_does_not_pin_wal);
+    RUN_TEST(db_group_commit_concurrent_writers);
+
+    std::cout << "\n--- Benchmarks ---\n";
+    benchmark_fill_and_scan();
+    benchmark_open_many_tables();
+    benchmark_row_cache_hot_gets();
+    benchmark_scan_over_tombstones();
+    benchmark_large_value_compaction();
+
+    std::cout << "\n=== All Tests Passed ===\n";
+    return 0;
+}
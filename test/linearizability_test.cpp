@@ -0,0 +1,400 @@
+// test/linearizability_test.cpp
+// Tests for the history recorder and linearizability checker, and
+// concurrent histories of the memtable manager and the DB checked with them
+
+#include "util/types.h"
+#include "util/linearizability.h"
+#include "db/db.h"
+#include "db/memtable_manager.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lsm;
+namespace fs = std::filesystem;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " #name "..." << std::flush; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT(cond) do { \
+    if (!(cond)) { \
+        std::cerr << "\nAssertion failed: " #cond \
+                  << " at " << __FILE__ << ":" << __LINE__ << "\n"; \
+        std::abort(); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_TRUE(x) ASSERT(x)
+#define ASSERT_FALSE(x) ASSERT(!(x))
+#define ASSERT_OK(s) ASSERT((s).ok())
+
+class TestDir {
+public:
+    TestDir(const std::string& name) : path_("/tmp/lsm_test_" + name) {
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+    ~TestDir() { fs::remove_all(path_); }
+    const std::string& path() const { return path_; }
+private:
+    std::string path_;
+};
+
+static HistoryOp Put(int thread, const std::string& key, const std::string& value,
+                     uint64_t invoke, uint64_t ret) {
+    HistoryOp op;
+    op.thread = thread;
+    op.type = HistoryOpType::kPut;
+    op.key = key;
+    op.value = value;
+    op.invoke = invoke;
+    op.ret = ret;
+    return op;
+}
+
+static HistoryOp Delete(int thread, const std::string& key, uint64_t invoke, uint64_t ret) {
+    HistoryOp op;
+    op.thread = thread;
+    op.type = HistoryOpType::kDelete;
+    op.key = key;
+    op.invoke = invoke;
+    op.ret = ret;
+    return op;
+}
+
+// value "" means the get found nothing
+static HistoryOp Get(int thread, const std::string& key, const std::string& value,
+                     uint64_t invoke, uint64_t ret) {
+    HistoryOp op;
+    op.thread = thread;
+    op.type = HistoryOpType::kGet;
+    op.key = key;
+    op.value = value;
+    op.found = !value.empty();
+    op.invoke = invoke;
+    op.ret = ret;
+    return op;
+}
+
+static bool Linearizable(const std::vector<HistoryOp>& history) {
+    return CheckLinearizability(history).linearizable;
+}
+
+static HistoryTarget MemTableTarget(MemTableManager* mgr) {
+    HistoryTarget target;
+    target.put = [mgr](Slice key, Slice value) { return mgr->Put(key, value); };
+    target.del = [mgr](Slice key) { return mgr->Delete(key); };
+    target.get = [mgr](Slice key, std::string* value) {
+        LookupResult r = mgr->Get(key);
+        if (!r.found || r.is_deleted) return Status::NotFound();
+        *value = r.value;
+        return Status::OK();
+    };
+    return target;
+}
+
+// ============================================================================
+// Checker Tests
+// ============================================================================
+
+TEST(check_sequential) {
+    std::vector<HistoryOp> h = {
+        Get(0, "a", "", 1, 2),
+        Put(0, "a", "x", 3, 4),
+        Get(0, "a", "x", 5, 6),
+        Put(0, "a", "y", 7, 8),
+        Get(0, "a", "y", 9, 10),
+    };
+    LinearizabilityResult r = CheckLinearizability(h);
+    ASSERT_TRUE(r.linearizable);
+    ASSERT_EQ(r.keys, 1u);
+    ASSERT_EQ(r.ops, 5u);
+
+    // Reading the overwritten value after the overwrite returned
+    h.push_back(Get(0, "a", "x", 11, 12));
+    r = CheckLinearizability(h);
+    ASSERT_FALSE(r.linearizable);
+    ASSERT_EQ(r.key, "a");
+    ASSERT_FALSE(r.message.empty());
+}
+
+TEST(check_concurrent) {
+    // Both reads overlap both writes: either order of the writes explains them
+    std::vector<HistoryOp> h = {
+        Put(0, "a", "x", 0, 10),
+        Put(1, "a", "y", 0, 10),
+        Get(2, "a", "y", 1, 9),
+        Get(3, "a", "x", 2, 11),
+    };
+    ASSERT_TRUE(Linearizable(h));
+
+    // ...but no order explains reads of y, then x, then y again
+    ASSERT_FALSE(Linearizable({Put(0, "a", "x", 0, 10), Put(1, "a", "y", 0, 10),
+                               Get(2, "a", "y", 1, 3), Get(3, "a", "x", 4, 5),
+                               Get(2, "a", "y", 12, 13)}));
+
+    // A read overlapping a write may see the old or new value
+    ASSERT_TRUE(Linearizable({Put(0, "b", "x", 0, 10), Get(1, "b", "", 1, 2)}));
+    ASSERT_TRUE(Linearizable({Put(0, "b", "x", 0, 10), Get(1, "b", "x", 1, 2)}));
+    // Once a read saw the new value, a later read must too
+    ASSERT_FALSE(Linearizable({Put(0, "b", "x", 0, 10), Get(1, "b", "x", 1, 2),
+                               Get(2, "b", "", 3, 4)}));
+}
+
+TEST(check_rejects_unwritten_value) {
+    ASSERT_FALSE(Linearizable({Get(0, "a", "x", 1, 2)}));
+    ASSERT_FALSE(Linearizable({Put(0, "a", "x", 1, 2), Get(1, "a", "z", 3, 4)}));
+    // A read cannot see a write invoked after it returned
+    ASSERT_FALSE(Linearizable({Get(0, "a", "x", 1, 2), Put(1, "a", "x", 3, 4)}));
+}
+
+TEST(check_delete) {
+    ASSERT_TRUE(Linearizable({Put(0, "a", "x", 1, 2), Delete(0, "a", 3, 4),
+                              Get(1, "a", "", 5, 6), Put(1, "a", "y", 7, 8),
+                              Get(0, "a", "y", 9, 10)}));
+    ASSERT_FALSE(Linearizable({Put(0, "a", "x", 1, 2), Delete(0, "a", 3, 4),
+                               Get(1, "a", "x", 5, 6)}));
+    ASSERT_TRUE(Linearizable({Put(0, "a", "x", 1, 2), Delete(0, "a", 3, 10),
+                              Get(1, "a", "x", 4, 5), Get(1, "a", "", 6, 7)}));
+}
+
+TEST(check_pending) {
+    // A write that never returned may have taken effect...
+    ASSERT_TRUE(Linearizable({Put(0, "a", "x", 1, kPendingReturn), Get(1, "a", "x", 5, 6)}));
+    // ...or not
+    ASSERT_TRUE(Linearizable({Put(0, "a", "x", 1, kPendingReturn), Get(1, "a", "", 5, 6)}));
+    // but not both, in that order
+    ASSERT_FALSE(Linearizable({Put(0, "a", "x", 1, kPendingReturn), Get(1, "a", "x", 5, 6),
+                               Get(1, "a", "", 7, 8)}));
+    // A get that never returned constrains nothing
+    ASSERT_TRUE(Linearizable({Get(0, "a", "zzz", 1, kPendingReturn)}));
+}
+
+TEST(check_keys_independent) {
+    std::vector<HistoryOp> h;
+    for (int k = 0; k < 50; k++) {
+        std::string key = "k" + std::to_string(k);
+        uint64_t t = static_cast<uint64_t>(k) * 10;
+        h.push_back(Put(0, key, "v" + key, t, t + 5));
+        h.push_back(Get(1, key, "v" + key, t + 6, t + 7));
+    }
+    LinearizabilityResult r = CheckLinearizability(h, 4);
+    ASSERT_TRUE(r.linearizable);
+    ASSERT_EQ(r.keys, 50u);
+
+    h.push_back(Get(2, "k17", "vk16", 1000, 1001));
+    r = CheckLinearizability(h, 4);
+    ASSERT_FALSE(r.linearizable);
+    ASSERT_EQ(r.key, "k17");
+}
+
+TEST(history_save_load) {
+    TestDir dir("lin_history");
+    std::string path = dir.path() + "/history";
+    std::vector<HistoryOp> h = {
+        Put(0, "a", std::string("x\0\xff", 3), 1, 2),
+        Get(1, "a", "", 3, 4),
+        Delete(2, std::string("\n b", 3), 5, kPendingReturn),
+        Get(3, "a", "y", 6, kPendingReturn),
+    };
+    h[3].found = false;  // Never returned
+    h[3].value.clear();
+    ASSERT_OK(SaveHistory(path, h));
+
+    std::vector<HistoryOp> loaded;
+    ASSERT_OK(LoadHistory(path, &loaded));
+    ASSERT_EQ(loaded.size(), h.size());
+    for (size_t i = 0; i < h.size(); i++) {
+        ASSERT_EQ(loaded[i].thread, h[i].thread);
+        ASSERT_TRUE(loaded[i].type == h[i].type);
+        ASSERT_EQ(loaded[i].key, h[i].key);
+        ASSERT_EQ(loaded[i].value, h[i].value);
+        ASSERT_EQ(loaded[i].found, h[i].found);
+        ASSERT_EQ(loaded[i].invoke, h[i].invoke);
+        ASSERT_EQ(loaded[i].ret, h[i].ret);
+    }
+
+    {
+        std::ofstream out(path, std::ios::app);
+        out << "0 q 1 2 0 61 -\n";
+    }
+    Status s = LoadHistory(path, &loaded);
+    ASSERT_TRUE(s.IsCorruption());
+    ASSERT_TRUE(LoadHistory(dir.path() + "/missing", &loaded).IsIOError());
+}
+
+// ============================================================================
+// Harness Tests
+// ============================================================================
+
+TEST(recorder_timestamps) {
+    HistoryRecorder recorder(2);
+    size_t a = recorder.Invoke(0, HistoryOpType::kPut, "k", "v");
+    recorder.Return(0, a);
+    size_t b = recorder.Invoke(1, HistoryOpType::kGet, "k");
+    recorder.Return(1, b, true, "v");
+    recorder.Invoke(1, HistoryOpType::kDelete, "k");
+
+    std::vector<HistoryOp> h = recorder.History();
+    ASSERT_EQ(h.size(), 3u);
+    ASSERT_TRUE(h[0].invoke <= h[0].ret);
+    ASSERT_TRUE(h[0].ret <= h[1].invoke);
+    ASSERT_TRUE(h[1].found);
+    ASSERT_EQ(h[1].value, "v");
+    ASSERT_EQ(h[2].ret, kPendingReturn);
+    ASSERT_TRUE(Linearizable(h));
+}
+
+TEST(memtable_manager_linearizable) {
+    MemTableOptions opts;
+    opts.max_size = 16 * 1024;  // Rotate, so reads cross immutable memtables
+    MemTableManager mgr(opts);
+    HistoryWorkloadOptions options;
+    options.threads = 8;
+    options.ops_per_thread = 2000;
+
+    std::vector<HistoryOp> h = RunHistoryWorkload(MemTableTarget(&mgr), options);
+    ASSERT_EQ(h.size(), 16000u);
+    LinearizabilityResult r = CheckLinearizability(h, 4);
+    if (!r.linearizable) std::cerr << "\n" << r.key << ": " << r.message << "\n";
+    ASSERT_TRUE(r.linearizable);
+    ASSERT_EQ(r.keys, 4u);
+}
+
+TEST(db_linearizable) {
+    TestDir dir("lin_db");
+    Options options;
+    options.write_buffer_size = 16 * 1024;  // Flush and compact during the run
+    options.wal_options.sync_policy = wal::SyncPolicy::kNoSync;
+    DB* raw = nullptr;
+    ASSERT_OK(DB::Open(options, dir.path() + "/db", &raw));
+    std::unique_ptr<DB> db(raw);
+
+    HistoryTarget target;
+    target.put = [&](Slice key, Slice value) { return db->Put(WriteOptions(), key, value); };
+    target.del = [&](Slice key) { return db->Delete(WriteOptions(), key); };
+    target.get = [&](Slice key, std::string* value) {
+        return db->Get(ReadOptions(), key, value);
+    };
+    HistoryWorkloadOptions workload;
+    workload.threads = 8;
+    workload.ops_per_thread = 1000;
+    workload.num_keys = 8;
+
+    std::vector<HistoryOp> h = RunHistoryWorkload(target, workload);
+    ASSERT_EQ(h.size(), 8000u);
+    LinearizabilityResult r = CheckLinearizability(h, 4);
+    if (!r.linearizable) std::cerr << "\n" << r.key << ": " << r.message << "\n";
+    ASSERT_TRUE(r.linearizable);
+    ASSERT_EQ(r.keys, 8u);
+}
+
+TEST(detects_stale_reads) {
+    // Each thread reads through a cache of its own that it refreshes only
+    // every few reads, so it can miss its own writes
+    std::mutex mutex;
+    std::map<std::string, std::string> store;
+    struct Cache {
+        std::map<std::string, std::string> copy;
+        int reads = 0;
+    };
+    std::map<std::thread::id, Cache> caches;  // Guarded by mutex; entries are per thread
+
+    HistoryTarget target;
+    target.put = [&](Slice key, Slice value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        store[std::string(key)] = std::string(value);
+        return Status::OK();
+    };
+    target.del = [&](Slice key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        store.erase(std::string(key));
+        return Status::OK();
+    };
+    target.get = [&](Slice key, std::string* value) {
+        Cache* cache;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cache = &caches[std::this_thread::get_id()];
+            if (cache->reads++ % 8 == 0) cache->copy = store;
+        }
+        auto it = cache->copy.find(std::string(key));
+        if (it == cache->copy.end()) return Status::NotFound();
+        *value = it->second;
+        return Status::OK();
+    };
+    HistoryWorkloadOptions options;
+    options.threads = 2;
+    options.ops_per_thread = 500;
+
+    LinearizabilityResult r = CheckLinearizability(RunHistoryWorkload(target, options));
+    ASSERT_FALSE(r.linearizable);
+    ASSERT_FALSE(r.key.empty());
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+void benchmark_checker() {
+    MemTableManager mgr;
+    HistoryWorkloadOptions options;
+    options.threads = 8;
+    options.ops_per_thread = 20000;
+    options.num_keys = 64;
+    std::vector<HistoryOp> h = RunHistoryWorkload(MemTableTarget(&mgr), options);
+
+    for (int threads : {1, 4}) {
+        auto start = std::chrono::high_resolution_clock::now();
+        LinearizabilityResult r = CheckLinearizability(h, threads);
+        auto end = std::chrono::high_resolution_clock::now();
+        ASSERT_TRUE(r.linearizable);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "  Check " << h.size() << " ops on " << r.keys << " keys, " << threads
+                  << " thread(s): " << ms << " ms\n";
+    }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+    std::cout << "=== Phase 11: Linearizability Tests ===\n\n";
+
+    std::cout << "--- Checker Tests ---\n";
+    RUN_TEST(check_sequential);
+    RUN_TEST(check_concurrent);
+    RUN_TEST(check_rejects_unwritten_value);
+    RUN_TEST(check_delete);
+    RUN_TEST(check_pending);
+    RUN_TEST(check_keys_independent);
+    RUN_TEST(history_save_load);
+
+    std::cout << "\n--- Harness Tests ---\n";
+    RUN_TEST(recorder_timestamps);
+    RUN_TEST(memtable_manager_linearizable);
+    RUN_TEST(db_linearizable);
+    RUN_TEST(detects_stale_reads);
+
+    std::cout << "\n--- Benchmarks ---\n";
+    benchmark_checker();
+
+    std::cout << "\n=== All Tests Passed ===\n";
+    return 0;
+}
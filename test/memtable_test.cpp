@@ -4,10 +4,14 @@
 #include "util/types.h"
 #include "util/arena.h"
 #include "memtable/skiplist.h"
+#include "memtable/dynamic_bloom.h"
+#include "util/perf_context.h"
 #include "db/memtable.h"
 #include "db/memtable_manager.h"
 
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <thread>
 #include <vector>
@@ -135,6 +139,164 @@ TEST(skiplist_iterator) {
     ASSERT_EQ(idx, values.size());
 }
 
+// Bloom Tests
+TEST(dynamic_bloom_basic) {
+    DynamicBloom bloom(10000 * 16);
+    for (int i = 0; i < 10000; i++) bloom.Add("key" + std::to_string(i));
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_TRUE(bloom.MayContain("key" + std::to_string(i)));
+    }
+    int false_positives = 0;
+    for (int i = 0; i < 10000; i++) {
+        if (bloom.MayContain("absent" + std::to_string(i))) false_positives++;
+    }
+    ASSERT_TRUE(false_positives < 200);
+    ASSERT_EQ(bloom.MemoryUsage(), 20032u);  // Rounded up to 64-byte lines
+}
+
+TEST(dynamic_bloom_concurrent_add) {
+    DynamicBloom bloom(4 * 5000 * 16);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&bloom, t] {
+            for (int i = 0; i < 5000; i++) {
+                bloom.Add(std::to_string(t) + ":" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (int t = 0; t < 4; t++) {
+        for (int i = 0; i < 5000; i++) {
+            ASSERT_TRUE(bloom.MayContain(std::to_string(t) + ":" + std::to_string(i)));
+        }
+    }
+}
+
+static void CheckSkipListOrder(const SkipList<int, IntComparator>& list, std::vector<int> values) {
+    std::sort(values.begin(), values.end());
+    SkipList<int, IntComparator>::Iterator iter(&list);
+    iter.SeekToFirst();
+    for (int v : values) {
+        ASSERT_TRUE(iter.Valid());
+        ASSERT_EQ(iter.key(), v);
+        iter.Next();
+    }
+    ASSERT_FALSE(iter.Valid());
+}
+
+TEST(skiplist_insert_with_hint) {
+    // Ascending, descending, random and mixed with plain inserts
+    std::vector<int> ascending, descending, random, mixed;
+    for (int i = 0; i < 2000; i++) {
+        ascending.push_back(i);
+        descending.push_back(2000 - i);
+        random.push_back(i * 7919 % 2003);
+        mixed.push_back(i % 3 == 0 ? 100000 - i : i);
+    }
+    for (const auto* values : {&ascending, &descending, &random, &mixed}) {
+        Arena arena;
+        SkipList<int, IntComparator> list(IntComparator(), &arena);
+        SkipList<int, IntComparator>::InsertHint hint;
+        for (size_t i = 0; i < values->size(); i++) {
+            int v = (*values)[i];
+            const int& stored = i % 5 == 4 ? list.Insert(v) : list.InsertWithHint(v, &hint);
+            ASSERT_EQ(stored, v);
+        }
+        for (int v : *values) ASSERT_TRUE(list.Contains(v));
+        CheckSkipListOrder(list, *values);
+    }
+}
+
+struct CountingIntComparator {
+    int* count;
+    int operator()(int a, int b) const {
+        ++*count;
+        return a < b ? -1 : (a > b ? +1 : 0);
+    }
+};
+
+TEST(skiplist_insert_with_hint_appends_in_constant_time) {
+    int count = 0;
+    Arena arena;
+    SkipList<int, CountingIntComparator> list(CountingIntComparator{&count}, &arena);
+    SkipList<int, CountingIntComparator>::InsertHint hint;
+    const int n = 100000;
+    for (int i = 0; i < n; i++) list.InsertWithHint(i, &hint);
+    // A search from head_ takes about 2*log2(n) = 33 comparisons per insert
+    ASSERT_TRUE(count < 4 * n);
+
+    count = 0;
+    list.InsertWithHint(-1, &hint);  // Falls back to a full search
+    list.InsertWithHint(n, &hint);
+    ASSERT_TRUE(count < 100);
+    ASSERT_TRUE(list.Contains(-1));
+}
+
+// Counts live instances, so a test can see whether the list destroys its keys
+struct TrackedInt {
+    static int live;
+    int v = 0;
+    TrackedInt() { ++live; }
+    TrackedInt(int x) : v(x) { ++live; }
+    TrackedInt(const TrackedInt& o) : v(o.v) { ++live; }
+    ~TrackedInt() { --live; }
+};
+int TrackedInt::live = 0;
+
+struct TrackedIntComparator {
+    int operator()(const TrackedInt& a, const TrackedInt& b) const {
+        return a.v < b.v ? -1 : (a.v > b.v ? +1 : 0);
+    }
+};
+
+TEST(skiplist_destroys_keys) {
+    Arena arena;
+    {
+        SkipList<TrackedInt, TrackedIntComparator> list(TrackedIntComparator(), &arena);
+        for (int i = 0; i < 1000; i++) list.Insert(TrackedInt(i * 7919 % 1009));
+        ASSERT_EQ(TrackedInt::live, 1001);  // Plus the head node's key
+    }
+    ASSERT_EQ(TrackedInt::live, 0);
+}
+
+TEST(skiplist_reverse_iteration) {
+    int count = 0;
+    Arena arena;
+    SkipList<int, CountingIntComparator> list(CountingIntComparator{&count}, &arena);
+    SkipList<int, CountingIntComparator>::InsertHint hint;
+    std::vector<int> values;
+    for (int i = 0; i < 5000; i++) values.push_back(i * 7919 % 5003);
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i % 2 == 0) {
+            list.Insert(values[i]);
+        } else {
+            list.InsertWithHint(values[i], &hint);
+        }
+    }
+    std::sort(values.begin(), values.end());
+
+    SkipList<int, CountingIntComparator>::Iterator iter(&list);
+    iter.SeekToLast();
+    count = 0;
+    for (size_t i = values.size(); i-- > 0;) {
+        ASSERT_TRUE(iter.Valid());
+        ASSERT_EQ(iter.key(), values[i]);
+        iter.Prev();
+    }
+    ASSERT_FALSE(iter.Valid());
+    ASSERT_EQ(count, 0);  // Back links: no searches
+
+    // Back and forth
+    iter.Seek(values[100]);
+    iter.Prev();
+    ASSERT_EQ(iter.key(), values[99]);
+    iter.Next();
+    iter.Next();
+    ASSERT_EQ(iter.key(), values[101]);
+    iter.Prev();
+    ASSERT_EQ(iter.key(), values[100]);
+}
+
 // MemTable Tests
 TEST(memtable_put_get) {
     MemTable* mem = new MemTable();
@@ -181,6 +343,62 @@ TEST(memtable_snapshot_isolation) {
     mem->Unref();
 }
 
+TEST(memtable_key_range_check) {
+    MemTable* mem = new MemTable();
+    mem->Ref();
+    SetPerfLevel(PerfLevel::kEnableCount);
+    GetPerfContext()->Reset();
+    ASSERT_FALSE(mem->Get("key", 10).found);  // Empty
+    mem->Put(1, "m", "v1");
+    mem->Put(2, "c", "v2");
+    mem->Put(3, "t", "v3");
+    ASSERT_EQ(GetPerfContext()->memtable_key_range_miss_count, 1u);
+
+    GetPerfContext()->Reset();
+    ASSERT_FALSE(mem->Get("b", 10).found);
+    ASSERT_FALSE(mem->Get("u", 10).found);
+    ASSERT_EQ(GetPerfContext()->memtable_key_range_miss_count, 2u);
+    ASSERT_EQ(GetPerfContext()->user_key_comparison_count, 0u);
+
+    ASSERT_EQ(mem->Get("c", 10).value, "v2");
+    ASSERT_EQ(mem->Get("t", 10).value, "v3");
+    ASSERT_FALSE(mem->Get("d", 10).found);  // In range: searched
+    ASSERT_EQ(GetPerfContext()->memtable_key_range_miss_count, 2u);
+    SetPerfLevel(PerfLevel::kDisable);
+    mem->Unref();
+}
+
+TEST(memtable_bloom_filter) {
+    MemTableOptions opts;
+    opts.bloom_bits = 1000 * 16;
+    MemTable* mem = new MemTable(opts);
+    mem->Ref();
+    for (int i = 0; i < 1000; i++) {
+        mem->Put(i + 1, "key" + std::to_string(i), "value" + std::to_string(i));
+    }
+    mem->Delete(2000, "key7");
+
+    SetPerfLevel(PerfLevel::kEnableCount);
+    GetPerfContext()->Reset();
+    for (int i = 0; i < 1000; i++) {
+        auto r = mem->Get("key" + std::to_string(i), 1000);
+        ASSERT_TRUE(r.found);
+        ASSERT_EQ(r.value, "value" + std::to_string(i));
+    }
+    ASSERT_TRUE(mem->Get("key7", 3000).is_deleted);
+    ASSERT_EQ(GetPerfContext()->bloom_memtable_miss_count, 0u);
+
+    // Absent keys inside the memtable's key range ("key0" .. "key999")
+    GetPerfContext()->Reset();
+    for (int i = 1000; i < 2000; i++) {
+        ASSERT_FALSE(mem->Get("key" + std::to_string(i), 3000).found);
+    }
+    ASSERT_EQ(GetPerfContext()->bloom_memtable_probe_count, 1000u);
+    ASSERT_TRUE(GetPerfContext()->bloom_memtable_miss_count >= 980);
+    SetPerfLevel(PerfLevel::kDisable);
+    mem->Unref();
+}
+
 // Manager Tests
 TEST(manager_basic_operations) {
     MemTableManager mgr;
@@ -270,6 +488,74 @@ TEST(concurrent_write_read) {
     }
 }
 
+TEST(concurrent_bloom_write_read) {
+    MemTableOptions opts;
+    opts.bloom_bits = 5000 * 16;
+    MemTableManager mgr(opts);
+    std::atomic<bool> done{false};
+    std::atomic<int> writes{0};
+    std::thread writer([&]() {
+        for (int i = 0; i < 5000; i++) {
+            mgr.Put("key" + std::to_string(i), "value" + std::to_string(i));
+            writes++;
+        }
+        done = true;
+    });
+    // Every completed write must be visible: the filter and the key range
+    // never hide a key a reader's snapshot covers
+    auto reader = [&]() {
+        std::mt19937 rng(std::random_device{}());
+        while (!done) {
+            int max = writes.load();
+            if (max > 0) ASSERT_TRUE(mgr.Get("key" + std::to_string(rng() % max)).found);
+            std::this_thread::yield();
+        }
+    };
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) readers.emplace_back(reader);
+    writer.join();
+    for (auto& t : readers) t.join();
+}
+
+TEST(concurrent_reverse_scan) {
+    MemTable* mem = new MemTable();
+    mem->Ref();
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        std::mt19937 rng(7);
+        for (int i = 0; i < 5000; i++) {
+            mem->Put(i + 1, "key" + std::to_string(rng() % 2000), "v");
+        }
+        done = true;
+    });
+    // Backward scans racing inserts see entries in strictly descending order
+    auto reader = [&]() {
+        MemTableKeyComparator cmp;
+        while (!done) {
+            MemTable::Iterator iter(mem);
+            iter.SeekToLast();
+            if (!iter.Valid()) continue;
+            MemTableEntry last(iter.InternalKey(), "");
+            for (iter.Prev(); iter.Valid(); iter.Prev()) {
+                MemTableEntry entry(iter.InternalKey(), "");
+                ASSERT_TRUE(cmp(entry, last) < 0);
+                last = entry;
+            }
+            std::this_thread::yield();
+        }
+    };
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; t++) readers.emplace_back(reader);
+    writer.join();
+    for (auto& t : readers) t.join();
+
+    MemTable::Iterator iter(mem);
+    size_t n = 0;
+    for (iter.SeekToLast(); iter.Valid(); iter.Prev()) n++;
+    ASSERT_EQ(n, 5000u);
+    mem->Unref();
+}
+
 // Benchmarks
 void benchmark_writes() {
     MemTableManager mgr;
@@ -301,6 +587,85 @@ void benchmark_reads() {
               << (N * 1000 / (ms + 1)) << " ops/sec)\n";
 }
 
+// Full memtable scans forward and backward
+void benchmark_memtable_reverse_scan() {
+    const int N = 200000;
+    MemTable* mem = new MemTable();
+    mem->Ref();
+    std::mt19937 rng(42);
+    for (int i = 0; i < N; i++) mem->Put(i + 1, "key" + std::to_string(rng()), "v");
+    for (bool forward : {true, false}) {
+        MemTable::Iterator iter(mem);
+        size_t count = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        if (forward) {
+            for (iter.SeekToFirst(); iter.Valid(); iter.Next()) count++;
+        } else {
+            for (iter.SeekToLast(); iter.Valid(); iter.Prev()) count++;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "MemTable scan, " << (forward ? "forward" : "backward") << ": "
+                  << count << " entries in " << ms << "ms\n";
+    }
+    mem->Unref();
+}
+
+// Memtable inserts of ascending (time-ordered) and random keys
+void benchmark_memtable_insert_order() {
+    const int N = 200000;
+    std::string val(100, 'x');
+    std::vector<std::string> keys;
+    for (int i = 0; i < N; i++) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "event%012d", i);
+        keys.push_back(buf);
+    }
+    for (bool ordered : {true, false}) {
+        if (!ordered) std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+        MemTableOptions opts;
+        opts.max_size = size_t{1} << 30;
+        MemTable* mem = new MemTable(opts);
+        mem->Ref();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < N; i++) mem->Put(i + 1, keys[i], val);
+        auto end = std::chrono::high_resolution_clock::now();
+        mem->Unref();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "MemTable inserts, " << (ordered ? "ascending" : "random") << " keys: "
+                  << N << " ops in " << ms << "ms (" << (N * 1000 / (ms + 1)) << " ops/sec)\n";
+    }
+}
+
+// Lookups of absent keys with four immutable memtables queued, with and
+// without memtable bloom filters
+void benchmark_memtable_bloom_misses() {
+    const int kPerMemTable = 25000;
+    const int N = 100000;
+    std::string val(100, 'x');
+    for (size_t bloom_bits : {size_t{0}, size_t{kPerMemTable} * 16}) {
+        MemTableOptions opts;
+        opts.bloom_bits = bloom_bits;
+        MemTableManager mgr(opts);
+        for (int m = 0; m < 5; m++) {
+            for (int i = 0; i < kPerMemTable; i++) {
+                mgr.Put("key" + std::to_string(i * 5 + m), val);
+            }
+            if (m < 4) mgr.ForceRotation();
+        }
+        std::mt19937 rng(42);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < N; i++) {
+            mgr.Get("key" + std::to_string(rng() % (kPerMemTable * 5)) + "x");
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "Miss reads, 5 memtables, " << (bloom_bits ? "bloom" : "no bloom")
+                  << ": " << N << " ops in " << ms << "ms ("
+                  << (N * 1000 / (ms + 1)) << " ops/sec)\n";
+    }
+}
+
 int main() {
     std::cout << "=== Phase 1: Core Data Structures Tests ===\n\n";
 
@@ -314,11 +679,21 @@ int main() {
     RUN_TEST(skiplist_insert_sequential);
     RUN_TEST(skiplist_insert_random);
     RUN_TEST(skiplist_iterator);
+    RUN_TEST(skiplist_insert_with_hint);
+    RUN_TEST(skiplist_insert_with_hint_appends_in_constant_time);
+    RUN_TEST(skiplist_reverse_iteration);
+    RUN_TEST(skiplist_destroys_keys);
+
+    std::cout << "\n--- Bloom Tests ---\n";
+    RUN_TEST(dynamic_bloom_basic);
+    RUN_TEST(dynamic_bloom_concurrent_add);
 
     std::cout << "\n--- MemTable Tests ---\n";
     RUN_TEST(memtable_put_get);
     RUN_TEST(memtable_delete);
     RUN_TEST(memtable_snapshot_isolation);
+    RUN_TEST(memtable_key_range_check);
+    RUN_TEST(memtable_bloom_filter);
 
     std::cout << "\n--- Manager Tests ---\n";
     RUN_TEST(manager_basic_operations);
@@ -328,10 +703,15 @@ int main() {
     std::cout << "\n--- Concurrent Tests ---\n";
     RUN_TEST(concurrent_reads);
     RUN_TEST(concurrent_write_read);
+    RUN_TEST(concurrent_bloom_write_read);
+    RUN_TEST(concurrent_reverse_scan);
 
     std::cout << "\n--- Benchmarks ---\n";
     benchmark_writes();
     benchmark_reads();
+    benchmark_memtable_insert_order();
+    benchmark_memtable_reverse_scan();
+    benchmark_memtable_bloom_misses();
 
     std::cout << "\n=== All Tests Passed ===\n";
     return 0;
@@ -0,0 +1,704 @@
+// test/sstable_reader_test.cpp
+// Tests for SSTable reader components
+
+#include "util/types.h"
+#include "util/file_reader.h"
+#include "sstable/sstable_format.h"
+#include "sstable/block_builder.h"
+#include "sstable/block.h"
+#include "sstable/prefetch_buffer.h"
+#include "sstable/sstable_writer.h"
+#include "sstable/sstable_reader.h"
+#include "sstable/table_properties.h"
+#include "db/memtable.h"
+
+#include <cassert>
+#include <iostream>
+#include <filesystem>
+#include <random>
+#include <chrono>
+#include <fstream>
+
+using namespace lsm;
+using namespace lsm::sstable;
+namespace fs = std::filesystem;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " #name "..." << std::flush; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT(cond) do { \
+    if (!(cond)) { \
+        std::cerr << "\nAssertion failed: " #cond \
+                  << " at " << __FILE__ << ":" << __LINE__ << "\n"; \
+        std::abort(); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_TRUE(x) ASSERT(x)
+#define ASSERT_FALSE(x) ASSERT(!(x))
+#define ASSERT_OK(s) ASSERT((s).ok())
+
+class TestDir {
+public:
+    TestDir(const std::string& name) : path_("/tmp/lsm_test_" + name) {
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+    ~TestDir() { fs::remove_all(path_); }
+    const std::string& path() const { return path_; }
+private:
+    std::string path_;
+};
+
+static std::string MakeKey(int i) {
+    char key[32];
+    snprintf(key, sizeof(key), "key%08d", i);
+    return key;
+}
+
+// Write N sequential keys with 100-byte values
+static void BuildTable(const std::string& path, int n,
+                       const SSTableOptions& opts = SSTableOptions()) {
+    SSTableWriter writer(path, opts);
+    ASSERT_OK(writer.Open());
+    std::string value(100, 'v');
+    for (int i = 0; i < n; i++) {
+        ASSERT_OK(writer.Add(MakeKey(i), value, i + 1, ValueType::kValue));
+    }
+    ASSERT_OK(writer.Finish());
+}
+
+// ============================================================================
+// Internal Key Tests
+// ============================================================================
+
+TEST(internal_key_ordering) {
+    std::string a1 = EncodeInternalKey("a", 1, ValueType::kValue);
+    std::string a5 = EncodeInternalKey("a", 5, ValueType::kValue);
+    std::string b1 = EncodeInternalKey("b", 1, ValueType::kValue);
+
+    // Same user key: newer sequence first
+    ASSERT_TRUE(CompareInternalKeys(a5, a1) < 0);
+    ASSERT_TRUE(CompareInternalKeys(a1, b1) < 0);
+    ASSERT_EQ(CompareInternalKeys(a1, a1), 0);
+
+    // Seek key sorts before every visible entry
+    std::string seek = EncodeSeekKey("a", 5);
+    ASSERT_TRUE(CompareInternalKeys(seek, a5) < 0);
+
+    ParsedInternalKey parsed;
+    ASSERT_TRUE(ParseInternalKey(a5, &parsed));
+    ASSERT_EQ(parsed.user_key, "a");
+    ASSERT_EQ(parsed.sequence, 5u);
+    ASSERT_TRUE(parsed.type == ValueType::kValue);
+}
+
+// ============================================================================
+// Properties Tests
+// ============================================================================
+
+TEST(properties_encode_decode) {
+    TableProperties original;
+    original.num_entries = 42;
+    original.num_deletions = 7;
+    original.raw_key_size = 1234;
+    original.max_sequence = kMaxInternalSequence;
+    original.smallest_key = std::string(100, 'a');  // Keys of any length fit
+    original.largest_key = std::string(100, 'z');
+    original.creation_time = 1700000000;
+
+    Block block(original.Encode());
+    ASSERT_TRUE(block.ok());
+    TableProperties decoded;
+    ASSERT_OK(decoded.Decode(block));
+    ASSERT_EQ(decoded.num_entries, 42u);
+    ASSERT_EQ(decoded.num_deletions, 7u);
+    ASSERT_EQ(decoded.raw_key_size, 1234u);
+    ASSERT_EQ(decoded.max_sequence, kMaxInternalSequence);
+    ASSERT_EQ(decoded.smallest_key, original.smallest_key);
+    ASSERT_EQ(decoded.largest_key, original.largest_key);
+    ASSERT_EQ(decoded.creation_time, 1700000000u);
+    ASSERT_EQ(decoded.compression, "none");
+
+    // Readers skip properties they do not know
+    BlockBuilder builder;
+    builder.Add("lsm.from.the.future", "x");
+    builder.Add("lsm.num.entries", std::string(1, '\x05'));
+    Block extended{std::string(builder.Finish())};
+    TableProperties partial;
+    ASSERT_OK(partial.Decode(extended));
+    ASSERT_EQ(partial.num_entries, 5u);
+}
+
+TEST(metaindex_find) {
+    MetaIndexBuilder builder;
+    builder.Add(kPropertiesBlockName, {300, 40});
+    builder.Add(kIndexBlockName, {100, 200});
+    Block block(builder.Finish());
+
+    BlockHandle handle;
+    ASSERT_OK(FindMetaBlock(block, kIndexBlockName, &handle));
+    ASSERT_EQ(handle.offset, 100u);
+    ASSERT_EQ(handle.size, 200u);
+    ASSERT_OK(FindMetaBlock(block, kPropertiesBlockName, &handle));
+    ASSERT_EQ(handle.offset, 300u);
+    ASSERT_TRUE(FindMetaBlock(block, kFilterBlockName, &handle).IsNotFound());
+}
+
+// ============================================================================
+// Block Tests
+// ============================================================================
+
+TEST(block_iterate_forward_backward) {
+    BlockBuilder builder(4);
+    for (int i = 0; i < 100; i++) {
+        builder.Add(MakeKey(i), "value" + std::to_string(i));
+    }
+    Block block{std::string(builder.Finish())};
+    ASSERT_TRUE(block.ok());
+
+    std::unique_ptr<Block::Iterator> iter(block.NewIterator());
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+        ASSERT_EQ(iter->key(), MakeKey(i));
+        ASSERT_EQ(iter->value(), "value" + std::to_string(i));
+    }
+    ASSERT_EQ(i, 100);
+
+    i = 99;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev(), i--) {
+        ASSERT_EQ(iter->key(), MakeKey(i));
+    }
+    ASSERT_EQ(i, -1);
+}
+
+TEST(block_prev_mixed_with_other_moves) {
+    BlockBuilder builder(16);
+    for (int i = 0; i < 200; i++) {
+        builder.Add(MakeKey(i), "value" + std::to_string(i));
+    }
+    Block block{std::string(builder.Finish())};
+    std::unique_ptr<Block::Iterator> iter(block.NewIterator());
+
+    // Random walk checked against the expected position
+    std::mt19937 rng(301);
+    int pos = 199;
+    iter->SeekToLast();
+    for (int step = 0; step < 5000; step++) {
+        int op = static_cast<int>(rng() % 10);
+        if (op < 6) {
+            iter->Prev();
+            pos--;
+        } else if (op < 8) {
+            iter->Next();
+            pos++;
+        } else {
+            pos = static_cast<int>(rng() % 200);
+            iter->Seek(MakeKey(pos));
+        }
+        if (pos < 0 || pos >= 200) {
+            ASSERT_FALSE(iter->Valid());
+            pos = 199;
+            iter->SeekToLast();
+        }
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(iter->key(), MakeKey(pos));
+        ASSERT_EQ(iter->value(), "value" + std::to_string(pos));
+    }
+    ASSERT_OK(iter->status());
+}
+
+TEST(block_seek) {
+    BlockBuilder builder(16);
+    for (int i = 0; i < 200; i += 2) {
+        builder.Add(MakeKey(i), "v");
+    }
+    Block block{std::string(builder.Finish())};
+
+    std::unique_ptr<Block::Iterator> iter(block.NewIterator());
+    iter->Seek(MakeKey(50));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->key(), MakeKey(50));
+
+    iter->Seek(MakeKey(51));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->key(), MakeKey(52));
+
+    iter->Seek(MakeKey(500));
+    ASSERT_FALSE(iter->Valid());
+    ASSERT_OK(iter->status());
+}
+
+TEST(block_malformed) {
+    Block block{std::string("\x01\x02", 2)};
+    ASSERT_FALSE(block.ok());
+    std::unique_ptr<Block::Iterator> iter(block.NewIterator());
+    iter->SeekToFirst();
+    ASSERT_FALSE(iter->Valid());
+    ASSERT_FALSE(iter->status().ok());
+}
+
+// ============================================================================
+// SSTableReader Tests
+// ============================================================================
+
+TEST(reader_open_and_get) {
+    TestDir dir("reader_get");
+    std::string path = dir.path() + "/test.sst";
+    BuildTable(path, 5000);
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+    ASSERT_EQ(reader->GetProperties().num_entries, 5000u);
+    ASSERT_EQ(reader->GetProperties().smallest_key, MakeKey(0));
+    ASSERT_EQ(reader->GetProperties().largest_key, MakeKey(4999));
+
+    for (int i = 0; i < 5000; i += 37) {
+        LookupResult result;
+        ASSERT_OK(reader->Get(ReadOptions(), MakeKey(i), kMaxSequenceNumber, &result));
+        ASSERT_TRUE(result.found);
+        ASSERT_EQ(result.value, std::string(100, 'v'));
+    }
+
+    LookupResult missing;
+    ASSERT_OK(reader->Get(ReadOptions(), "nope", kMaxSequenceNumber, &missing));
+    ASSERT_FALSE(missing.found);
+}
+
+TEST(reader_versions_and_deletes) {
+    TestDir dir("reader_versions");
+    std::string path = dir.path() + "/test.sst";
+
+    MemTable* mem = new MemTable();
+    mem->Ref();
+    mem->Put(1, "apple", "red");
+    mem->Put(2, "banana", "yellow");
+    mem->Put(3, "apple", "green");
+    mem->Delete(4, "banana");
+    ASSERT_OK(SSTableWriter::FlushMemTable(path, mem));
+    mem->Unref();
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+
+    LookupResult r;
+    ASSERT_OK(reader->Get(ReadOptions(), "apple", 10, &r));
+    ASSERT_TRUE(r.found && !r.is_deleted);
+    ASSERT_EQ(r.value, "green");
+
+    ASSERT_OK(reader->Get(ReadOptions(), "apple", 2, &r));
+    ASSERT_EQ(r.value, "red");
+
+    ASSERT_OK(reader->Get(ReadOptions(), "banana", 10, &r));
+    ASSERT_TRUE(r.found && r.is_deleted);
+
+    ASSERT_OK(reader->Get(ReadOptions(), "banana", 3, &r));
+    ASSERT_EQ(r.value, "yellow");
+
+    ASSERT_OK(reader->Get(ReadOptions(), "apple", 0, &r));
+    ASSERT_FALSE(r.found);
+}
+
+TEST(reader_long_keys) {
+    TestDir dir("reader_long_keys");
+    std::string path = dir.path() + "/test.sst";
+
+    SSTableWriter writer(path);
+    ASSERT_OK(writer.Open());
+    std::string prefix(200, 'p');
+    for (int i = 0; i < 100; i++) {
+        ASSERT_OK(writer.Add(prefix + MakeKey(i), "v", i + 1, ValueType::kValue));
+    }
+    ASSERT_OK(writer.Finish());
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+    ASSERT_EQ(reader->GetProperties().largest_key, prefix + MakeKey(99));
+}
+
+TEST(reader_table_properties) {
+    TestDir dir("reader_properties");
+    std::string path = dir.path() + "/test.sst";
+
+    SSTableOptions options;
+    options.use_bloom_filter = false;
+    SSTableWriter writer(path, options);
+    ASSERT_OK(writer.Open());
+    for (int i = 0; i < 1000; i++) {
+        ValueType type = i % 10 == 0 ? ValueType::kDeletion : ValueType::kValue;
+        ASSERT_OK(writer.Add(MakeKey(i), type == ValueType::kValue ? "value" : "",
+                             i + 5, type));
+    }
+    SSTableWriteStats stats;
+    ASSERT_OK(writer.Finish(&stats));
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, options, &reader));
+    const TableProperties& props = reader->GetProperties();
+    ASSERT_EQ(props.num_entries, 1000u);
+    ASSERT_EQ(props.num_deletions, 100u);
+    ASSERT_EQ(props.num_data_blocks, stats.num_data_blocks);
+    ASSERT_EQ(props.data_size, stats.data_size);
+    ASSERT_EQ(props.index_size, stats.index_size);
+    ASSERT_EQ(props.filter_size, 0u);
+    ASSERT_EQ(props.raw_key_size, stats.raw_key_size);
+    ASSERT_EQ(props.raw_value_size, 900u * 5);
+    ASSERT_EQ(props.min_sequence, 5u);
+    ASSERT_EQ(props.max_sequence, 1004u);
+    ASSERT_TRUE(props.creation_time > 0);
+
+    // A table written without a filter has no filter entry, and still reads
+    options.use_bloom_filter = true;
+    ASSERT_OK(SSTableReader::Open(path, options, &reader));
+    LookupResult result;
+    ASSERT_OK(reader->Get(ReadOptions(), MakeKey(11), kMaxSequenceNumber, &result));
+    ASSERT_EQ(result.value, "value");
+}
+
+TEST(reader_iterator) {
+    TestDir dir("reader_iter");
+    std::string path = dir.path() + "/test.sst";
+    BuildTable(path, 3000);
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+
+    std::unique_ptr<SSTableReader::Iterator> iter(reader->NewIterator());
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+        ASSERT_EQ(ExtractUserKey(iter->key()), MakeKey(i));
+    }
+    ASSERT_EQ(i, 3000);
+    ASSERT_OK(iter->status());
+
+    i = 2999;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev(), i--) {
+        ASSERT_EQ(ExtractUserKey(iter->key()), MakeKey(i));
+    }
+    ASSERT_EQ(i, -1);
+
+    iter->Seek(EncodeSeekKey(MakeKey(1234), kMaxSequenceNumber));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(ExtractUserKey(iter->key()), MakeKey(1234));
+}
+
+TEST(reader_corruption_detected) {
+    TestDir dir("reader_corrupt");
+    std::string path = dir.path() + "/test.sst";
+    BuildTable(path, 1000);
+
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(100);
+        f.put('\x7f');
+    }
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+
+    LookupResult r;
+    ASSERT_TRUE(reader->Get(ReadOptions(), MakeKey(0), kMaxSequenceNumber, &r).IsCorruption());
+
+    std::unique_ptr<SSTableReader::Iterator> iter(reader->NewIterator());
+    iter->SeekToFirst();
+    ASSERT_FALSE(iter->Valid());
+    ASSERT_TRUE(iter->status().IsCorruption());
+}
+
+// ============================================================================
+// Readahead Tests
+// ============================================================================
+
+TEST(readahead_auto_tunes) {
+    TestDir dir("readahead_auto");
+    std::string path = dir.path() + "/test.sst";
+    BuildTable(path, 20000);
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+    uint64_t reads_before = reader->file()->NumReads();
+
+    std::unique_ptr<SSTableReader::Iterator> iter(reader->NewIterator());
+    size_t count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) count++;
+    ASSERT_EQ(count, 20000u);
+
+    uint64_t scan_reads = reader->file()->NumReads() - reads_before;
+    size_t num_blocks = reader->FileSize() / kDefaultBlockSize;
+
+    // Far fewer reads than blocks, and the window grew to its cap
+    ASSERT_TRUE(scan_reads * 8 < num_blocks);
+    ASSERT_EQ(iter->prefetch_buffer().ReadaheadSize(),
+              FilePrefetchBuffer::kDefaultMaxReadaheadSize);
+
+    std::cout << " [blocks~" << num_blocks << " reads=" << scan_reads << "]";
+}
+
+TEST(readahead_fixed_size) {
+    TestDir dir("readahead_fixed");
+    std::string path = dir.path() + "/test.sst";
+    BuildTable(path, 5000);
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+
+    ReadOptions ro;
+    ro.readahead_size = 64 * 1024;
+    uint64_t reads_before = reader->file()->NumReads();
+
+    std::unique_ptr<SSTableReader::Iterator> iter(reader->NewIterator(ro));
+    size_t count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) count++;
+    ASSERT_EQ(count, 5000u);
+
+    uint64_t scan_reads = reader->file()->NumReads() - reads_before;
+    uint64_t expected = reader->FileSize() / ro.readahead_size + 1;
+    ASSERT_TRUE(scan_reads <= expected);
+    ASSERT_EQ(iter->prefetch_buffer().ReadaheadSize(), ro.readahead_size);
+}
+
+TEST(readahead_resets_on_random_access) {
+    TestDir dir("readahead_random");
+    std::string path = dir.path() + "/test.sst";
+    BuildTable(path, 5000);
+
+    RandomAccessFileReader file(path);
+    ASSERT_OK(file.Open());
+    FilePrefetchBuffer buffer(&file, 0, 4096, 64 * 1024);
+
+    std::string out;
+    for (uint64_t off = 0; off < 8 * 1024; off += 1024) {
+        ASSERT_OK(buffer.Read(off, 1024, &out));
+    }
+    ASSERT_TRUE(buffer.ReadaheadSize() > 4096);
+
+    // A jump elsewhere in the file drops back to the initial window
+    ASSERT_OK(buffer.Read(file.Size() / 2, 1024, &out));
+    ASSERT_EQ(buffer.ReadaheadSize(), 4096u);
+}
+
+// ============================================================================
+// Tail Prefetch Tests
+// ============================================================================
+
+TEST(tail_prefetch_single_read) {
+    TestDir dir("tail_single");
+    std::string path = dir.path() + "/test.sst";
+    BuildTable(path, 5000);
+
+    // Footer, metaindex, properties, index and filter from one read
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+    ASSERT_EQ(reader->file()->NumReads(), 1u);
+
+    // A tail holding only the footer still opens, with a read per block
+    SSTableOptions options;
+    options.tail_prefetch_size = kFooterSize;
+    ASSERT_OK(SSTableReader::Open(path, options, &reader));
+    ASSERT_EQ(reader->file()->NumReads(), 5u);
+    LookupResult result;
+    ASSERT_OK(reader->Get(ReadOptions(), MakeKey(1234), kMaxSequenceNumber, &result));
+    ASSERT_TRUE(result.found);
+}
+
+TEST(tail_prefetch_learns_size) {
+    TestDir dir("tail_learn");
+
+    // ~120KB of filter: more metadata than the default tail
+    SSTableOptions options;
+    options.tail_prefetch_stats = std::make_shared<TailPrefetchStats>();
+    for (int t = 0; t < 2; t++) {
+        SSTableWriter writer(dir.path() + "/" + std::to_string(t) + ".sst", options);
+        ASSERT_OK(writer.Open());
+        for (int i = 0; i < 100000; i++) {
+            ASSERT_OK(writer.Add(MakeKey(i), "v", i + 1, ValueType::kValue));
+        }
+        ASSERT_OK(writer.Finish());
+    }
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(dir.path() + "/0.sst", options, &reader));
+    ASSERT_TRUE(reader->file()->NumReads() > 1);
+    size_t learned = options.tail_prefetch_stats->SuggestedPrefetchSize();
+    ASSERT_TRUE(learned > TailPrefetchStats::kDefaultSize);
+
+    ASSERT_OK(SSTableReader::Open(dir.path() + "/1.sst", options, &reader));
+    ASSERT_EQ(reader->file()->NumReads(), 1u);
+    std::cout << " [learned=" << learned / 1024 << "KB]";
+}
+
+TEST(tail_prefetch_stats_ignore_outliers) {
+    TailPrefetchStats stats;
+    ASSERT_EQ(stats.SuggestedPrefetchSize(), TailPrefetchStats::kDefaultSize);
+
+    for (int i = 0; i < 31; i++) stats.RecordMetadataSize(10000 + i);
+    stats.RecordMetadataSize(400000);
+    ASSERT_EQ(stats.SuggestedPrefetchSize(), 10030u);
+
+    // Older samples age out
+    for (size_t i = 0; i < TailPrefetchStats::kNumSamples; i++) {
+        stats.RecordMetadataSize(20000);
+    }
+    ASSERT_EQ(stats.SuggestedPrefetchSize(), 20000u);
+
+    stats.RecordMetadataSize(10 * TailPrefetchStats::kMaxSize);
+    for (int i = 0; i < 40; i++) stats.RecordMetadataSize(10 * TailPrefetchStats::kMaxSize);
+    ASSERT_EQ(stats.SuggestedPrefetchSize(), TailPrefetchStats::kMaxSize);
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+void benchmark_scan(size_t readahead_size, const char* label) {
+    TestDir dir("bench_reader_scan");
+    std::string path = dir.path() + "/bench.sst";
+    const int N = 100000;
+    BuildTable(path, N);
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+
+    ReadOptions ro;
+    ro.readahead_size = readahead_size;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t reads_before = reader->file()->NumReads();
+    std::unique_ptr<SSTableReader::Iterator> iter(reader->NewIterator(ro));
+    size_t count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) count++;
+    auto end = std::chrono::high_resolution_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    std::cout << "  Scan (" << label << "): " << count << " entries in " << ms
+              << "ms, " << (reader->file()->NumReads() - reads_before) << " reads\n";
+}
+
+// Full scans of one block, forward and backward
+void benchmark_block_reverse_scan() {
+    BlockBuilder builder(16);
+    for (int i = 0; i < 4096; i++) builder.Add(MakeKey(i), "value");
+    Block block{std::string(builder.Finish())};
+    std::unique_ptr<Block::Iterator> iter(block.NewIterator());
+    const int kRounds = 200;
+    for (bool forward : {true, false}) {
+        size_t count = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < kRounds; r++) {
+            if (forward) {
+                for (iter->SeekToFirst(); iter->Valid(); iter->Next()) count++;
+            } else {
+                for (iter->SeekToLast(); iter->Valid(); iter->Prev()) count++;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        std::cout << "  Block scan (" << (forward ? "forward" : "backward") << "): "
+                  << (ns / static_cast<int64_t>(count)) << " ns/entry\n";
+    }
+}
+
+void benchmark_random_get() {
+    TestDir dir("bench_reader_get");
+    std::string path = dir.path() + "/bench.sst";
+    const int N = 100000;
+    BuildTable(path, N);
+
+    std::unique_ptr<SSTableReader> reader;
+    ASSERT_OK(SSTableReader::Open(path, SSTableOptions(), &reader));
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(0, N - 1);
+
+    const int kLookups = 50000;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < kLookups; i++) {
+        LookupResult r;
+        reader->Get(ReadOptions(), MakeKey(dist(rng)), kMaxSequenceNumber, &r);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    std::cout << "  Random Get: " << kLookups << " lookups in " << ms << "ms ("
+              << (kLookups * 1000 / (ms + 1)) << " ops/sec)\n";
+}
+
+void benchmark_open(size_t tail_prefetch_size, const char* label) {
+    TestDir dir("bench_reader_open");
+    const int kTables = 200;
+    for (int t = 0; t < kTables; t++) {
+        BuildTable(dir.path() + "/" + std::to_string(t) + ".sst", 2000);
+    }
+
+    SSTableOptions options;
+    options.tail_prefetch_size = tail_prefetch_size;
+    options.tail_prefetch_stats = std::make_shared<TailPrefetchStats>();
+    uint64_t reads = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < kTables; t++) {
+        std::unique_ptr<SSTableReader> reader;
+        ASSERT_OK(SSTableReader::Open(dir.path() + "/" + std::to_string(t) + ".sst",
+                                      options, &reader));
+        reads += reader->file()->NumReads();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    std::cout << "  Open (" << label << "): " << (us / kTables) << " us/table, "
+              << static_cast<double>(reads) / kTables << " reads/table\n";
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+    std::cout << "=== Phase 5: SSTable Reader Tests ===\n\n";
+
+    std::cout << "--- Internal Key Tests ---\n";
+    RUN_TEST(internal_key_ordering);
+
+    std::cout << "\n--- Properties Tests ---\n";
+    RUN_TEST(properties_encode_decode);
+    RUN_TEST(metaindex_find);
+
+    std::cout << "\n--- Block Tests ---\n";
+    RUN_TEST(block_iterate_forward_backward);
+    RUN_TEST(block_prev_mixed_with_other_moves);
+    RUN_TEST(block_seek);
+    RUN_TEST(block_malformed);
+
+    std::cout << "\n--- SSTableReader Tests ---\n";
+    RUN_TEST(reader_open_and_get);
+    RUN_TEST(reader_versions_and_deletes);
+    RUN_TEST(reader_long_keys);
+    RUN_TEST(reader_table_properties);
+    RUN_TEST(reader_iterator);
+    RUN_TEST(reader_corruption_detected);
+
+    std::cout << "\n--- Readahead Tests ---\n";
+    RUN_TEST(readahead_auto_tunes);
+    RUN_TEST(readahead_fixed_size);
+    RUN_TEST(readahead_resets_on_random_access);
+
+    std::cout << "\n--- Tail Prefetch Tests ---\n";
+    RUN_TEST(tail_prefetch_single_read);
+    RUN_TEST(tail_prefetch_learns_size);
+    RUN_TEST(tail_prefetch_stats_ignore_outliers);
+
+    std::cout << "\n--- Benchmarks ---\n";
+    benchmark_scan(0, "auto readahead");
+    benchmark_scan(2 * 1024 * 1024, "2MB readahead");
+    benchmark_block_reverse_scan();
+    benchmark_random_get();
+    benchmark_open(0, "learned tail prefetch");
+    benchmark_open(kFooterSize, "footer only");
+
+    std::cout << "\n=== All Tests Passed ===\n";
+    return 0;
+}
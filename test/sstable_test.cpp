@@ -120,35 +120,30 @@ TEST(block_handle_encode_decode) {
 
 TEST(footer_encode_decode) {
     Footer original;
-    original.index_handle.offset = 100000;
-    original.index_handle.size = 5000;
-    original.num_entries = 50000;
-    original.min_sequence = 1;
-    original.max_sequence = 50000;
-    original.min_key = "aaa";
-    original.max_key = "zzz";
+    original.metaindex_handle.offset = 100000;
+    original.metaindex_handle.size = 5000;
 
     std::string encoded = original.Encode();
     ASSERT_EQ(encoded.size(), kFooterSize);
 
     Footer decoded;
     ASSERT_TRUE(decoded.Decode(encoded));
-    ASSERT_EQ(decoded.index_handle.offset, original.index_handle.offset);
-    ASSERT_EQ(decoded.index_handle.size, original.index_handle.size);
-    ASSERT_EQ(decoded.num_entries, original.num_entries);
-    ASSERT_EQ(decoded.min_sequence, original.min_sequence);
-    ASSERT_EQ(decoded.max_sequence, original.max_sequence);
-    ASSERT_EQ(decoded.min_key, original.min_key);
-    ASSERT_EQ(decoded.max_key, original.max_key);
+    ASSERT_EQ(decoded.metaindex_handle.offset, original.metaindex_handle.offset);
+    ASSERT_EQ(decoded.metaindex_handle.size, original.metaindex_handle.size);
+    ASSERT_EQ(decoded.format_version, kTableFormatVersion);
+
+    // The largest handles still fit the fixed size
+    original.metaindex_handle = {UINT64_MAX, UINT64_MAX};
+    encoded = original.Encode();
+    ASSERT_EQ(encoded.size(), kFooterSize);
+    ASSERT_TRUE(decoded.Decode(encoded));
+    ASSERT_EQ(decoded.metaindex_handle.offset, UINT64_MAX);
 }
 
 TEST(footer_magic_validation) {
     Footer footer;
-    footer.index_handle.offset = 100;
-    footer.index_handle.size = 50;
-    footer.num_entries = 10;
-    footer.min_key = "a";
-    footer.max_key = "z";
+    footer.metaindex_handle.offset = 100;
+    footer.metaindex_handle.size = 50;
 
     std::string encoded = footer.Encode();
 
@@ -157,6 +152,10 @@ TEST(footer_magic_validation) {
 
     Footer decoded;
     ASSERT_FALSE(decoded.Decode(encoded));
+
+    // Versions newer than this reader are rejected
+    footer.format_version = kTableFormatVersion + 1;
+    ASSERT_FALSE(decoded.Decode(footer.Encode()));
 }
 
 // ============================================================================
@@ -345,8 +344,9 @@ TEST(sstable_writer_with_deletes) {
     SSTableWriter writer(path);
     ASSERT_OK(writer.Open());
 
-    ASSERT_OK(writer.Add("key1", "value1", 1, ValueType::kValue));
+    // Versions of a key are stored newest first
     ASSERT_OK(writer.Add("key1", "", 2, ValueType::kDeletion));  // Delete
+    ASSERT_OK(writer.Add("key1", "value1", 1, ValueType::kValue));
     ASSERT_OK(writer.Add("key2", "value2", 3, ValueType::kValue));
 
     SSTableWriteStats stats;
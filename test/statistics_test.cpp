@@ -0,0 +1,840 @@
+// test/statistics_test.cpp
+// Tests for DB statistics (tickers, latency histograms), the per-thread
+// PerfContext, the amplification properties and event listeners
+
+#include "util/types.h"
+#include "util/perf_context.h"
+#include "util/statistics.h"
+#include "db/db.h"
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace lsm;
+namespace fs = std::filesystem;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " #name "..." << std::flush; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT(cond) do { \
+    if (!(cond)) { \
+        std::cerr << "\nAssertion failed: " #cond \
+                  << " at " << __FILE__ << ":" << __LINE__ << "\n"; \
+        std::abort(); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_TRUE(x) ASSERT(x)
+#define ASSERT_FALSE(x) ASSERT(!(x))
+#define ASSERT_OK(s) ASSERT((s).ok())
+
+class TestDir {
+public:
+    TestDir(const std::string& name) : path_("/tmp/lsm_test_" + name) {
+        fs::remove_all(path_);
+    }
+    ~TestDir() { fs::remove_all(path_); }
+    const std::string& path() const { return path_; }
+private:
+    std::string path_;
+};
+
+static std::string MakeKey(int i) {
+    char key[32];
+    snprintf(key, sizeof(key), "key%08d", i);
+    return key;
+}
+
+static Options StatsOptions() {
+    Options options;
+    options.write_buffer_size = 64 * 1024;
+    options.target_file_size_base = 32 * 1024;
+    options.max_bytes_for_level_base = 256 * 1024;
+    options.table_options.block_size = 1024;
+    options.wal_options.sync_policy = wal::SyncPolicy::kNoSync;
+    options.statistics = CreateDBStatistics();
+    return options;
+}
+
+static std::unique_ptr<DB> OpenDB(const std::string& path, const Options& options) {
+    DB* db = nullptr;
+    ASSERT_OK(DB::Open(options, path, &db));
+    return std::unique_ptr<DB>(db);
+}
+
+// ============================================================================
+// Histogram Tests
+// ============================================================================
+
+TEST(histogram_bucket_index) {
+    // Small values get exact buckets
+    for (uint64_t v = 0; v < HistogramBuckets::kSubCount; v++) {
+        ASSERT_EQ(HistogramBuckets::Index(v), v);
+        ASSERT_EQ(HistogramBuckets::LowerBound(v), v);
+    }
+    // Every value falls between its bucket's lower bound and the next one's,
+    // and buckets are at most 1/16 of their values wide
+    for (uint64_t v = 1; v < (uint64_t{1} << 39); v = v * 3 + 1) {
+        size_t i = HistogramBuckets::Index(v);
+        ASSERT_TRUE(HistogramBuckets::LowerBound(i) <= v);
+        ASSERT_TRUE(v < HistogramBuckets::LowerBound(i + 1));
+        uint64_t width = HistogramBuckets::LowerBound(i + 1) - HistogramBuckets::LowerBound(i);
+        ASSERT_TRUE(width * 16 <= std::max<uint64_t>(v, 16) * 2);
+    }
+    // Indexes are monotonic across powers of two
+    for (int e = 4; e < 39; e++) {
+        uint64_t p = uint64_t{1} << e;
+        ASSERT_EQ(HistogramBuckets::Index(p - 1) + 1, HistogramBuckets::Index(p));
+    }
+    ASSERT_EQ(HistogramBuckets::Index(~uint64_t{0}), HistogramBuckets::kNumBuckets - 1);
+}
+
+TEST(histogram_percentiles) {
+    AtomicHistogram h;
+    for (uint64_t v = 1; v <= 100000; v++) h.Add(v);
+    HistogramSnapshot s;
+    h.MergeInto(&s);
+
+    ASSERT_EQ(s.Count(), 100000u);
+    ASSERT_EQ(s.Min(), 1u);
+    ASSERT_EQ(s.Max(), 100000u);
+    ASSERT_EQ(s.Sum(), 100000ull * 100001 / 2);
+    // Log-linear buckets keep the relative error of any percentile small
+    const double kPercentiles[] = {50, 90, 99, 99.9};
+    for (double p : kPercentiles) {
+        double expected = 100000 * p / 100;
+        double got = s.Percentile(p);
+        ASSERT_TRUE(got >= expected * 0.94 && got <= expected * 1.06);
+    }
+    ASSERT_EQ(s.Percentile(100), 100000.0);
+
+    h.Clear();
+    HistogramSnapshot empty;
+    h.MergeInto(&empty);
+    ASSERT_EQ(empty.Count(), 0u);
+    ASSERT_EQ(empty.Percentile(99), 0.0);
+    ASSERT_EQ(empty.Min(), 0u);
+}
+
+// ============================================================================
+// Statistics Tests
+// ============================================================================
+
+TEST(statistics_tickers) {
+    Statistics stats;
+    ASSERT_EQ(stats.GetTickerCount(kNumberKeysWritten), 0u);
+    stats.RecordTick(kNumberKeysWritten);
+    stats.RecordTick(kBytesWritten, 100);
+    RecordTick(&stats, kBytesWritten, 23);
+    RecordTick(nullptr, kBytesWritten, 1000);  // no-op
+    ASSERT_EQ(stats.GetTickerCount(kNumberKeysWritten), 1u);
+    ASSERT_EQ(stats.GetTickerCount(kBytesWritten), 123u);
+
+    stats.Reset();
+    ASSERT_EQ(stats.GetTickerCount(kBytesWritten), 0u);
+
+    // Every ticker and histogram has a name
+    for (uint32_t t = 0; t < kTickerCount; t++) {
+        ASSERT_TRUE(std::string(TickerName(static_cast<Ticker>(t))).rfind("lsm.", 0) == 0);
+    }
+    for (uint32_t h = 0; h < kHistogramCount; h++) {
+        ASSERT_TRUE(std::string(HistogramName(static_cast<HistogramType>(h))).rfind("lsm.", 0) == 0);
+    }
+}
+
+TEST(statistics_concurrent_recording) {
+    Statistics stats;
+    const int kThreads = 8;
+    const int kOps = 20000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&stats, t] {
+            for (int i = 0; i < kOps; i++) {
+                stats.RecordTick(kNumberKeysRead);
+                stats.RecordInHistogram(kDbGet, static_cast<uint64_t>(t * 1000 + 1));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    ASSERT_EQ(stats.GetTickerCount(kNumberKeysRead), uint64_t{kThreads} * kOps);
+    HistogramSnapshot s = stats.GetHistogram(kDbGet);
+    ASSERT_EQ(s.Count(), uint64_t{kThreads} * kOps);
+    ASSERT_EQ(s.Min(), 1u);
+    ASSERT_EQ(s.Max(), uint64_t{(kThreads - 1) * 1000 + 1});
+}
+
+TEST(statistics_stopwatch) {
+    Statistics stats;
+    {
+        StopWatch sw(&stats, kWalSync);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    HistogramSnapshot s = stats.GetHistogram(kWalSync);
+    ASSERT_EQ(s.Count(), 1u);
+    ASSERT_TRUE(s.Min() >= 2000000u);
+
+    // Stop records once; the destructor then does nothing
+    {
+        StopWatch sw(&stats, kWalSync);
+        ASSERT_TRUE(sw.Stop() > 0);
+    }
+    ASSERT_EQ(stats.GetHistogram(kWalSync).Count(), 2u);
+
+    // Timers off: no histogram samples, tickers still count
+    stats.set_level(StatsLevel::kExceptTimers);
+    {
+        StopWatch sw(&stats, kWalSync);
+        ASSERT_EQ(sw.Stop(), 0u);
+    }
+    ASSERT_EQ(stats.GetHistogram(kWalSync).Count(), 2u);
+    StopWatch null_sw(nullptr, kWalSync);
+    ASSERT_EQ(null_sw.Stop(), 0u);
+}
+
+// ============================================================================
+// DB Integration Tests
+// ============================================================================
+
+TEST(db_statistics_reads_and_writes) {
+    TestDir dir("stats_rw");
+    Options options = StatsOptions();
+    Statistics* stats = options.statistics.get();
+    auto db = OpenDB(dir.path(), options);
+
+    const int N = 200;
+    for (int i = 0; i < N; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "value"));
+    }
+    ASSERT_EQ(stats->GetTickerCount(kNumberKeysWritten), uint64_t{N});
+    ASSERT_EQ(stats->GetTickerCount(kBytesWritten), uint64_t{N} * (11 + 5));
+    ASSERT_TRUE(stats->GetTickerCount(kWalWrites) > 0);
+    ASSERT_TRUE(stats->GetTickerCount(kWalWrites) <= uint64_t{N});
+    ASSERT_TRUE(stats->GetTickerCount(kWalBytes) > 0);
+    ASSERT_EQ(stats->GetHistogram(kDbWrite).Count(), uint64_t{N});
+    ASSERT_EQ(stats->GetHistogram(kWalAppend).Count(), stats->GetTickerCount(kWalWrites));
+
+    std::string value;
+    for (int i = 0; i < N; i++) {
+        ASSERT_OK(db->Get(ReadOptions(), MakeKey(i), &value));
+    }
+    ASSERT_TRUE(db->Get(ReadOptions(), "missing", &value).IsNotFound());
+    ASSERT_EQ(stats->GetTickerCount(kNumberKeysRead), uint64_t{N} + 1);
+    ASSERT_EQ(stats->GetTickerCount(kNumberKeysFound), uint64_t{N});
+    ASSERT_EQ(stats->GetTickerCount(kBytesRead), uint64_t{N} * 5);
+    ASSERT_EQ(stats->GetTickerCount(kMemtableHit), uint64_t{N});
+    ASSERT_EQ(stats->GetTickerCount(kMemtableMiss), 1u);
+    ASSERT_EQ(stats->GetHistogram(kDbGet).Count(), uint64_t{N} + 1);
+
+    // Reads served from a table count as memtable misses
+    ASSERT_OK(db->Flush());
+    ASSERT_OK(db->Get(ReadOptions(), MakeKey(0), &value));
+    ASSERT_EQ(stats->GetTickerCount(kMemtableMiss), 2u);
+    ASSERT_EQ(stats->GetTickerCount(kNumberKeysFound), uint64_t{N} + 1);
+}
+
+TEST(db_statistics_sync_writes) {
+    TestDir dir("stats_sync");
+    Options options = StatsOptions();
+    Statistics* stats = options.statistics.get();
+    auto db = OpenDB(dir.path(), options);
+
+    WriteOptions sync;
+    sync.sync = true;
+    for (int i = 0; i < 5; i++) {
+        ASSERT_OK(db->Put(sync, MakeKey(i), "v"));
+    }
+    ASSERT_TRUE(stats->GetTickerCount(kWalSyncs) >= 5);
+    ASSERT_EQ(stats->GetHistogram(kWalSync).Count(), stats->GetTickerCount(kWalSyncs));
+}
+
+TEST(db_statistics_flush_and_compaction) {
+    TestDir dir("stats_bg");
+    Options options = StatsOptions();
+    Statistics* stats = options.statistics.get();
+    auto db = OpenDB(dir.path(), options);
+
+    std::string value(100, 'x');
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 2000; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+        }
+        ASSERT_OK(db->Flush());
+    }
+    ASSERT_TRUE(stats->GetTickerCount(kFlushCount) >= 3);
+    ASSERT_TRUE(stats->GetTickerCount(kFlushBytes) > 0);
+    ASSERT_EQ(stats->GetHistogram(kFlushTime).Count(), stats->GetTickerCount(kFlushCount));
+
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    ASSERT_TRUE(stats->GetTickerCount(kCompactionCount) > 0);
+    ASSERT_TRUE(stats->GetTickerCount(kCompactionBytesRead) > 0);
+    ASSERT_TRUE(stats->GetTickerCount(kCompactionBytesWritten) > 0);
+    // Two of every three versions were overwritten
+    ASSERT_TRUE(stats->GetTickerCount(kCompactionKeysDropped) >= 2 * 2000);
+    ASSERT_TRUE(stats->GetHistogram(kCompactionTime).Count() >=
+                stats->GetTickerCount(kCompactionCount));
+
+    std::string dump = stats->ToString();
+    ASSERT_TRUE(dump.find("lsm.flush.count COUNT : ") != std::string::npos);
+    ASSERT_TRUE(dump.find("lsm.db.write.nanos P50 : ") != std::string::npos);
+}
+
+TEST(db_statistics_shared_by_two_dbs) {
+    TestDir dir1("stats_shared1");
+    TestDir dir2("stats_shared2");
+    Options options = StatsOptions();
+    auto db1 = OpenDB(dir1.path(), options);
+    auto db2 = OpenDB(dir2.path(), options);
+    ASSERT_OK(db1->Put(WriteOptions(), "a", "1"));
+    ASSERT_OK(db2->Put(WriteOptions(), "b", "2"));
+    ASSERT_EQ(options.statistics->GetTickerCount(kNumberKeysWritten), 2u);
+}
+
+// ============================================================================
+// PerfContext Tests
+// ============================================================================
+
+// Restores the default (disabled) level when a test ends
+class PerfLevelGuard {
+public:
+    explicit PerfLevelGuard(PerfLevel level) {
+        SetPerfLevel(level);
+        GetPerfContext()->Reset();
+    }
+    ~PerfLevelGuard() { SetPerfLevel(PerfLevel::kDisable); }
+};
+
+TEST(perf_context_disabled_by_default) {
+    TestDir dir("perf_disabled");
+    auto db = OpenDB(dir.path(), StatsOptions());
+    ASSERT_TRUE(GetPerfLevel() == PerfLevel::kDisable);
+    GetPerfContext()->Reset();
+    ASSERT_OK(db->Put(WriteOptions(), "a", "1"));
+    std::string value;
+    ASSERT_OK(db->Get(ReadOptions(), "a", &value));
+    ASSERT_EQ(GetPerfContext()->ToString(true), "");
+}
+
+TEST(perf_context_memtable_get) {
+    TestDir dir("perf_memtable");
+    Options options = StatsOptions();
+    options.write_buffer_size = 4 << 20;  // One memtable
+    auto db = OpenDB(dir.path(), options);
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "v"));
+    }
+
+    PerfLevelGuard guard(PerfLevel::kEnableCount);
+    std::string value;
+    ASSERT_OK(db->Get(ReadOptions(), MakeKey(500), &value));
+    const PerfContext* ctx = GetPerfContext();
+    ASSERT_EQ(ctx->get_from_memtable_count, 1u);
+    // A skip list search over 1000 entries takes a few dozen comparisons
+    ASSERT_TRUE(ctx->user_key_comparison_count >= 5);
+    ASSERT_TRUE(ctx->user_key_comparison_count < 200);
+    ASSERT_EQ(ctx->block_read_count, 0u);
+    // Counters only: no timers
+    ASSERT_EQ(ctx->get_from_memtable_nanos, 0u);
+}
+
+TEST(perf_context_table_get) {
+    TestDir dir("perf_table");
+    Options options = StatsOptions();
+    options.write_buffer_size = 4 << 20;  // Flush to a single table
+    auto db = OpenDB(dir.path(), options);
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "value"));
+    }
+    ASSERT_OK(db->Flush());
+
+    // Open the table first; opening reads its index block
+    std::string value;
+    ASSERT_OK(db->Get(ReadOptions(), MakeKey(900), &value));
+
+    PerfLevelGuard guard(PerfLevel::kEnableTime);
+    ASSERT_OK(db->Get(ReadOptions(), MakeKey(10), &value));
+    PerfContext first = *GetPerfContext();
+    ASSERT_EQ(first.bloom_sst_probe_count, 1u);
+    ASSERT_EQ(first.bloom_sst_miss_count, 0u);
+    ASSERT_EQ(first.block_read_count, 1u);
+    ASSERT_TRUE(first.block_read_bytes > 0);
+    ASSERT_EQ(first.block_cache_hit_count, 0u);
+    ASSERT_TRUE(first.block_read_nanos > 0);
+    ASSERT_TRUE(first.block_checksum_nanos > 0);
+    ASSERT_TRUE(first.get_from_output_files_nanos >= first.block_read_nanos);
+    ASSERT_TRUE(first.get_from_memtable_nanos > 0);
+
+    // The same block again comes from the block cache
+    GetPerfContext()->Reset();
+    ASSERT_OK(db->Get(ReadOptions(), MakeKey(11), &value));
+    ASSERT_EQ(GetPerfContext()->block_cache_hit_count, 1u);
+    ASSERT_EQ(GetPerfContext()->block_read_count, 0u);
+
+    // Absent keys inside the table's range are mostly ruled out by the bloom filter
+    GetPerfContext()->Reset();
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(db->Get(ReadOptions(), MakeKey(i) + "x", &value).IsNotFound());
+    }
+    ASSERT_EQ(GetPerfContext()->bloom_sst_probe_count, 100u);
+    ASSERT_TRUE(GetPerfContext()->bloom_sst_miss_count >= 90);
+}
+
+TEST(perf_context_write) {
+    TestDir dir("perf_write");
+    auto db = OpenDB(dir.path(), StatsOptions());
+
+    PerfLevelGuard guard(PerfLevel::kEnableTime);
+    WriteOptions sync;
+    sync.sync = true;
+    ASSERT_OK(db->Put(sync, "a", "1"));
+    const PerfContext* ctx = GetPerfContext();
+    ASSERT_TRUE(ctx->write_wal_nanos > 0);
+    ASSERT_TRUE(ctx->wal_sync_nanos > 0);
+    ASSERT_TRUE(ctx->write_memtable_nanos > 0);
+    ASSERT_TRUE(ctx->user_key_comparison_count <= 1);  // Empty memtable
+
+    std::string dump = ctx->ToString(true);
+    ASSERT_TRUE(dump.find("wal_sync_nanos = ") != std::string::npos);
+    ASSERT_TRUE(dump.find("block_read_count") == std::string::npos);
+    ASSERT_TRUE(ctx->ToString().find("block_read_count = 0") != std::string::npos);
+}
+
+TEST(perf_context_per_thread) {
+    TestDir dir("perf_threads");
+    auto db = OpenDB(dir.path(), StatsOptions());
+    ASSERT_OK(db->Put(WriteOptions(), "a", "1"));
+
+    PerfLevelGuard guard(PerfLevel::kEnableCount);
+    uint64_t other_count = 0;
+    PerfLevel other_level = PerfLevel::kEnableTime;
+    std::thread t([&] {
+        // A new thread starts disabled with an empty context
+        other_level = GetPerfLevel();
+        SetPerfLevel(PerfLevel::kEnableCount);
+        std::string value;
+        for (int i = 0; i < 10; i++) ASSERT_OK(db->Get(ReadOptions(), "a", &value));
+        other_count = GetPerfContext()->get_from_memtable_count;
+    });
+    t.join();
+    ASSERT_TRUE(other_level == PerfLevel::kDisable);
+    ASSERT_EQ(other_count, 10u);
+    ASSERT_EQ(GetPerfContext()->get_from_memtable_count, 0u);
+}
+
+// ============================================================================
+// Property Tests
+// ============================================================================
+
+static std::string Property(DB* db, const std::string& name) {
+    std::string value;
+    ASSERT_TRUE(db->GetProperty(name, &value));
+    return value;
+}
+
+TEST(property_levels_and_sizes) {
+    TestDir dir("prop_levels");
+    auto db = OpenDB(dir.path(), StatsOptions());
+    std::string value;
+    ASSERT_FALSE(db->GetProperty("lsm.no-such-property", &value));
+    ASSERT_FALSE(db->GetProperty("lsm.num-files-at-level", &value));
+    ASSERT_FALSE(db->GetProperty("lsm.num-files-at-level99", &value));
+    ASSERT_EQ(Property(db.get(), "lsm.num-files-at-level0"), "0");
+    ASSERT_EQ(Property(db.get(), "lsm.total-sst-files-size"), "0");
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "value"));
+    }
+    ASSERT_OK(db->Flush());
+    ASSERT_EQ(Property(db.get(), "lsm.num-files-at-level0"),
+              std::to_string(db->NumFilesAtLevel(0)));
+    uint64_t total = std::stoull(Property(db.get(), "lsm.total-sst-files-size"));
+    ASSERT_TRUE(total > 0);
+    // One file holds everything
+    ASSERT_EQ(std::stoull(Property(db.get(), "lsm.estimate-live-data-size")), total);
+}
+
+TEST(property_write_amplification) {
+    TestDir dir("prop_wamp");
+    auto db = OpenDB(dir.path(), StatsOptions());
+    const InternalStats& stats = db->DefaultColumnFamily()->cfd()->internal_stats;
+
+    std::string value(100, 'v');
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 2000; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+        }
+    }
+    ASSERT_OK(db->Flush());
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+
+    ASSERT_EQ(stats.user_bytes_written(), 4u * 2000 * (11 + 100));
+    LevelCompactionStats flushes = stats.GetCompactionStats(0);
+    ASSERT_TRUE(flushes.count > 0);
+    ASSERT_TRUE(flushes.bytes_written > 0);
+    ASSERT_EQ(flushes.bytes_read_input, 0u);
+    LevelCompactionStats l1 = stats.GetCompactionStats(1);
+    ASSERT_TRUE(l1.count > 0);
+    ASSERT_TRUE(l1.bytes_read_input > 0);
+    ASSERT_TRUE(l1.bytes_written > 0);
+    ASSERT_TRUE(l1.keys_dropped > 0);
+
+    // Every byte was flushed, and some were compacted again
+    double w_amp = std::stod(Property(db.get(), "lsm.write-amplification"));
+    ASSERT_TRUE(w_amp > 0.5);
+    ASSERT_TRUE(std::abs(w_amp - stats.WriteAmplification()) < 1e-3);
+
+    std::string cfstats = Property(db.get(), "lsm.cfstats");
+    ASSERT_TRUE(cfstats.find("** Compaction Stats [default] **") != std::string::npos);
+    ASSERT_TRUE(cfstats.find("\nL0 ") != std::string::npos);
+    ASSERT_TRUE(cfstats.find("\nSum ") != std::string::npos);
+    ASSERT_TRUE(cfstats.find("Write amplification: ") != std::string::npos);
+    ASSERT_TRUE(cfstats.find("Space amplification: ") != std::string::npos);
+
+    std::string dbstats = Property(db.get(), "lsm.dbstats");
+    ASSERT_TRUE(dbstats.find("User writes: ") != std::string::npos);
+    ASSERT_TRUE(dbstats.find("Write amplification (WAL + tables): ") != std::string::npos);
+    std::string all = Property(db.get(), "lsm.stats");
+    ASSERT_TRUE(all.find("** Compaction Stats [default] **") == 0);
+    ASSERT_TRUE(all.find("** DB Stats **") != std::string::npos);
+}
+
+TEST(property_space_amplification) {
+    TestDir dir("prop_samp");
+    Options options = StatsOptions();
+    options.write_buffer_size = 4 << 20;
+    options.level0_file_num_compaction_trigger = 100;  // Keep the L0 files
+    auto db = OpenDB(dir.path(), options);
+
+    // Three overlapping L0 files with the same keys: one file's worth is live
+    std::string value(100, 'v');
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 1000; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+        }
+        ASSERT_OK(db->Flush());
+    }
+    ASSERT_EQ(db->NumFilesAtLevel(0), 3);
+    double before = std::stod(Property(db.get(), "lsm.space-amplification"));
+    ASSERT_TRUE(before > 2.5 && before < 3.5);
+
+    // Compacted into one sorted level, everything is live
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    double after = std::stod(Property(db.get(), "lsm.space-amplification"));
+    ASSERT_TRUE(std::abs(after - 1.0) < 1e-3);
+    ASSERT_EQ(Property(db.get(), "lsm.estimate-live-data-size"),
+              Property(db.get(), "lsm.total-sst-files-size"));
+}
+
+TEST(property_get_bytes_read_per_level) {
+    TestDir dir("prop_get_read");
+    Options options = StatsOptions();
+    options.block_cache_size = 0;
+    auto db = OpenDB(dir.path(), options);
+    const InternalStats& stats = db->DefaultColumnFamily()->cfd()->internal_stats;
+
+    for (int i = 0; i < 2000; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), std::string(100, 'v')));
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+    ASSERT_EQ(db->NumFilesAtLevel(0), 0);
+
+    std::string value;
+    for (int i = 0; i < 100; i++) {
+        ASSERT_OK(db->Get(ReadOptions(), MakeKey(i * 20), &value));
+    }
+    uint64_t below_l0 = 0;
+    for (int level = 1; level < stats.num_levels(); level++) {
+        below_l0 += stats.get_bytes_read(level);
+    }
+    ASSERT_EQ(stats.get_bytes_read(0), 0u);
+    // One data block (about block_size) per Get
+    ASSERT_TRUE(below_l0 >= 100 * 512);
+}
+
+TEST(property_periodic_dump) {
+    TestDir dir("prop_dump");
+    Options options = StatsOptions();
+    options.stats_dump_period_sec = 1;
+    auto db = OpenDB(dir.path(), options);
+    ASSERT_OK(db->Put(WriteOptions(), "a", "1"));
+
+    std::string log;
+    for (int i = 0; i < 50 && log.find("DUMPING STATS") == std::string::npos; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::ifstream in(dir.path() + "/LOG");
+        std::stringstream ss;
+        ss << in.rdbuf();
+        log = ss.str();
+    }
+    ASSERT_TRUE(log.find("DUMPING STATS") != std::string::npos);
+    ASSERT_TRUE(log.find("** Compaction Stats [default] **") != std::string::npos);
+    ASSERT_TRUE(log.find("** DB Stats **") != std::string::npos);
+
+    // The dump does not get in the way of background work
+    ASSERT_OK(db->Flush());
+    ASSERT_EQ(db->NumFilesAtLevel(0), 1);
+}
+
+// ============================================================================
+// EventListener Tests
+// ============================================================================
+
+class RecordingListener : public EventListener {
+public:
+    void OnFlushBegin(DB* /*db*/, const FlushJobInfo& info) override {
+        if (flush_delay_ms > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(flush_delay_ms));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        flushes_begun.push_back(info);
+    }
+    void OnFlushCompleted(DB* /*db*/, const FlushJobInfo& info) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushes.push_back(info);
+    }
+    void OnCompactionCompleted(DB* /*db*/, const CompactionJobInfo& info) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        compactions.push_back(info);
+    }
+    void OnStallConditionsChanged(const WriteStallInfo& info) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        stalls.push_back(info);
+    }
+    void OnWALRotated(const WALRotationInfo& info) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        rotations.push_back(info);
+    }
+
+    int flush_delay_ms = 0;
+    std::mutex mutex;
+    std::vector<FlushJobInfo> flushes_begun;
+    std::vector<FlushJobInfo> flushes;
+    std::vector<CompactionJobInfo> compactions;
+    std::vector<WriteStallInfo> stalls;
+    std::vector<WALRotationInfo> rotations;
+};
+
+TEST(listener_flush) {
+    TestDir dir("listener_flush");
+    auto listener = std::make_shared<RecordingListener>();
+    Options options = StatsOptions();
+    options.listeners.push_back(listener);
+    auto db = OpenDB(dir.path(), options);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "value"));
+    }
+    ASSERT_OK(db->Flush());
+
+    std::lock_guard<std::mutex> lock(listener->mutex);
+    ASSERT_EQ(listener->flushes_begun.size(), 1u);
+    ASSERT_EQ(listener->flushes.size(), 1u);
+    const FlushJobInfo& begun = listener->flushes_begun[0];
+    ASSERT_EQ(begun.cf_name, "default");
+    ASSERT_EQ(begun.num_entries, 100u);
+    ASSERT_EQ(begun.smallest_seqno, 1u);
+    ASSERT_EQ(begun.largest_seqno, 100u);
+    ASSERT_EQ(begun.file_number, 0u);
+
+    const FlushJobInfo& done = listener->flushes[0];
+    ASSERT_TRUE(done.file_number > 0);
+    ASSERT_EQ(done.file_path, TableFileName(dir.path(), done.file_number));
+    ASSERT_TRUE(fs::exists(done.file_path));
+    ASSERT_EQ(done.file_size, fs::file_size(done.file_path));
+}
+
+TEST(listener_manual_compaction) {
+    TestDir dir("listener_compaction");
+    auto listener = std::make_shared<RecordingListener>();
+    Options options = StatsOptions();
+    options.listeners.push_back(listener);
+    auto db = OpenDB(dir.path(), options);
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 200; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "value" + std::to_string(round)));
+        }
+        ASSERT_OK(db->Flush());
+    }
+    ASSERT_OK(db->CompactRange(nullptr, nullptr));
+
+    std::lock_guard<std::mutex> lock(listener->mutex);
+    ASSERT_FALSE(listener->compactions.empty());
+    const CompactionJobInfo& info = listener->compactions.back();
+    ASSERT_OK(info.status);
+    ASSERT_TRUE(info.manual);
+    ASSERT_EQ(info.cf_name, "default");
+    ASSERT_EQ(info.base_input_level, 0);
+    ASSERT_EQ(info.output_level, 1);
+    ASSERT_EQ(info.input_files.size(), 2u);
+    ASSERT_FALSE(info.output_files.empty());
+    ASSERT_TRUE(info.input_bytes_base_level > 0);
+    ASSERT_EQ(info.stats.entries_read, 400u);
+    ASSERT_EQ(info.stats.entries_dropped, 200u);
+    ASSERT_TRUE(info.stats.bytes_written > 0);
+    for (uint64_t number : info.output_files) {
+        ASSERT_TRUE(fs::exists(TableFileName(dir.path(), number)));
+    }
+}
+
+TEST(listener_wal_rotation) {
+    TestDir dir("listener_wal");
+    auto listener = std::make_shared<RecordingListener>();
+    Options options = StatsOptions();
+    options.listeners.push_back(listener);
+    auto db = OpenDB(dir.path(), options);
+    ASSERT_OK(db->Put(WriteOptions(), "a", "1"));
+    ASSERT_OK(db->Flush());
+    ASSERT_OK(db->Put(WriteOptions(), "b", "2"));
+    ASSERT_OK(db->Flush());
+    // Rotations are delivered by the next background run
+    ASSERT_OK(db->WaitForCompact());
+
+    std::lock_guard<std::mutex> lock(listener->mutex);
+    ASSERT_EQ(listener->rotations.size(), 2u);
+    ASSERT_TRUE(listener->rotations[0].new_log_number > listener->rotations[0].old_log_number);
+    ASSERT_EQ(listener->rotations[1].old_log_number, listener->rotations[0].new_log_number);
+    ASSERT_EQ(listener->rotations[1].cf_name, "default");
+}
+
+TEST(listener_write_stall) {
+    TestDir dir("listener_stall");
+    auto listener = std::make_shared<RecordingListener>();
+    listener->flush_delay_ms = 20;  // Let writers outrun the flushes
+    Options options = StatsOptions();
+    options.max_write_buffer_number = 2;
+    options.listeners.push_back(listener);
+    auto db = OpenDB(dir.path(), options);
+    std::string value(1000, 'v');
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+    }
+    ASSERT_OK(db->WaitForCompact());
+
+    std::lock_guard<std::mutex> lock(listener->mutex);
+    ASSERT_FALSE(listener->stalls.empty());
+    ASSERT_EQ(listener->stalls[0].cur, WriteStallCondition::kStopped);
+    ASSERT_EQ(listener->stalls[0].prev, WriteStallCondition::kNormal);
+    ASSERT_EQ(listener->stalls[0].cause, WriteStallCause::kMemtableLimit);
+    for (size_t i = 1; i < listener->stalls.size(); i++) {
+        ASSERT_TRUE(listener->stalls[i].cur != listener->stalls[i].prev);
+        ASSERT_EQ(listener->stalls[i].prev, listener->stalls[i - 1].cur);
+    }
+    // Writers are not stalled once the background thread caught up
+    ASSERT_EQ(listener->stalls.back().cur, WriteStallCondition::kNormal);
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+void benchmark_statistics_record() {
+    Statistics stats;
+    const int N = 1000000;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < N; i++) {
+        stats.RecordTick(kNumberKeysRead);
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < N; i++) {
+        stats.RecordInHistogram(kDbGet, static_cast<uint64_t>(i & 0xffff));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto tick_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count();
+    auto hist_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count();
+
+    std::cout << "  RecordTick: " << (static_cast<double>(tick_ns) / N) << " ns/op\n";
+    std::cout << "  RecordInHistogram: " << (static_cast<double>(hist_ns) / N) << " ns/op\n";
+}
+
+void benchmark_perf_context_get() {
+    TestDir dir("perf_bench");
+    Options options = StatsOptions();
+    options.write_buffer_size = 64 << 20;
+    auto db = OpenDB(dir.path(), options);
+    const int N = 100000;
+    for (int i = 0; i < N; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "value"));
+    }
+
+    const PerfLevel kLevels[] = {PerfLevel::kDisable, PerfLevel::kEnableCount,
+                                 PerfLevel::kEnableTime};
+    const char* const kNames[] = {"disabled", "counters", "timers"};
+    std::string value;
+    for (int l = 0; l < 3; l++) {
+        SetPerfLevel(kLevels[l]);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < N; i++) {
+            ASSERT_OK(db->Get(ReadOptions(), MakeKey(i), &value));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        std::cout << "  Memtable Get, perf " << kNames[l] << ": "
+                  << (static_cast<double>(ns) / N) << " ns/op\n";
+    }
+    SetPerfLevel(PerfLevel::kDisable);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+    std::cout << "=== Phase 9: Statistics Tests ===\n\n";
+
+    std::cout << "--- Histogram Tests ---\n";
+    RUN_TEST(histogram_bucket_index);
+    RUN_TEST(histogram_percentiles);
+
+    std::cout << "\n--- Statistics Tests ---\n";
+    RUN_TEST(statistics_tickers);
+    RUN_TEST(statistics_concurrent_recording);
+    RUN_TEST(statistics_stopwatch);
+
+    std::cout << "\n--- DB Integration Tests ---\n";
+    RUN_TEST(db_statistics_reads_and_writes);
+    RUN_TEST(db_statistics_sync_writes);
+    RUN_TEST(db_statistics_flush_and_compaction);
+    RUN_TEST(db_statistics_shared_by_two_dbs);
+
+    std::cout << "\n--- PerfContext Tests ---\n";
+    RUN_TEST(perf_context_disabled_by_default);
+    RUN_TEST(perf_context_memtable_get);
+    RUN_TEST(perf_context_table_get);
+    RUN_TEST(perf_context_write);
+    RUN_TEST(perf_context_per_thread);
+
+    std::cout << "\n--- Property Tests ---\n";
+    RUN_TEST(property_levels_and_sizes);
+    RUN_TEST(property_write_amplification);
+    RUN_TEST(property_space_amplification);
+    RUN_TEST(property_get_bytes_read_per_level);
+    RUN_TEST(property_periodic_dump);
+
+    std::cout << "\n--- EventListener Tests ---\n";
+    RUN_TEST(listener_flush);
+    RUN_TEST(listener_manual_compaction);
+    RUN_TEST(listener_wal_rotation);
+    RUN_TEST(listener_write_stall);
+
+    std::cout << "\n--- Benchmarks ---\n";
+    benchmark_statistics_record();
+    benchmark_perf_context_get();
+
+    std::cout << "\n=== All Tests Passed ===\n";
+    return 0;
+}
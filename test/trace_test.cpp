@@ -0,0 +1,415 @@
+// test/trace_test.cpp
+// Tests for the operation tracer, trace reader and replayer
+
+#include "util/types.h"
+#include "db/db.h"
+#include "db/trace.h"
+#include "db/trace_replayer.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lsm;
+namespace fs = std::filesystem;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " #name "..." << std::flush; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT(cond) do { \
+    if (!(cond)) { \
+        std::cerr << "\nAssertion failed: " #cond \
+                  << " at " << __FILE__ << ":" << __LINE__ << "\n"; \
+        std::abort(); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_TRUE(x) ASSERT(x)
+#define ASSERT_FALSE(x) ASSERT(!(x))
+#define ASSERT_OK(s) ASSERT((s).ok())
+
+class TestDir {
+public:
+    TestDir(const std::string& name) : path_("/tmp/lsm_test_" + name) {
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+    ~TestDir() { fs::remove_all(path_); }
+    const std::string& path() const { return path_; }
+private:
+    std::string path_;
+};
+
+static std::string MakeKey(int i) {
+    char key[32];
+    snprintf(key, sizeof(key), "key%08d", i);
+    return key;
+}
+
+static std::vector<TraceRecord> ReadTrace(const std::string& path) {
+    std::unique_ptr<TraceReader> reader;
+    ASSERT_OK(TraceReader::Open(path, &reader));
+    std::vector<TraceRecord> records;
+    TraceRecord record;
+    while (reader->Next(&record)) records.push_back(record);
+    ASSERT_OK(reader->status());
+    return records;
+}
+
+static std::unique_ptr<DB> OpenDB(const std::string& path) {
+    Options options;
+    options.write_buffer_size = 64 * 1024;
+    options.wal_options.sync_policy = wal::SyncPolicy::kNoSync;
+    DB* db = nullptr;
+    ASSERT_OK(DB::Open(options, path, &db));
+    return std::unique_ptr<DB>(db);
+}
+
+static std::string GetValue(DB* db, ColumnFamilyHandle* cf, const std::string& key) {
+    std::string value;
+    Status s = db->Get(ReadOptions(), cf, key, &value);
+    if (s.IsNotFound()) return "NOT_FOUND";
+    ASSERT_OK(s);
+    return value;
+}
+
+// ============================================================================
+// Trace File Tests
+// ============================================================================
+
+TEST(trace_round_trip) {
+    TestDir dir("trace_round_trip");
+    std::string path = dir.path() + "/trace";
+    Tracer tracer;
+    ASSERT_FALSE(tracer.active());
+    ASSERT_OK(tracer.Start(path, TraceOptions()));
+    ASSERT_TRUE(tracer.active());
+    ASSERT_TRUE(tracer.Start(path, TraceOptions()).IsInvalidArgument());
+    tracer.Record(TraceType::kPut, 0, "a", 100);
+    tracer.Record(TraceType::kGet, 0, "a", 0);
+    tracer.Record(TraceType::kDelete, 3, "b", 0);
+    tracer.Record(TraceType::kPut, 300, std::string(1000, 'k'), 1 << 20);
+    ASSERT_EQ(tracer.records(), 4u);
+    ASSERT_OK(tracer.End());
+    ASSERT_FALSE(tracer.active());
+    tracer.Record(TraceType::kGet, 0, "ignored", 0);
+
+    auto records = ReadTrace(path);
+    ASSERT_EQ(records.size(), 4u);
+    ASSERT_TRUE(records[0].type == TraceType::kPut);
+    ASSERT_EQ(records[0].key, "a");
+    ASSERT_EQ(records[0].value_size, 100u);
+    ASSERT_TRUE(records[1].type == TraceType::kGet);
+    ASSERT_TRUE(records[2].type == TraceType::kDelete);
+    ASSERT_EQ(records[2].cf_id, 3u);
+    ASSERT_EQ(records[2].key, "b");
+    ASSERT_EQ(records[3].cf_id, 300u);
+    ASSERT_EQ(records[3].key, std::string(1000, 'k'));
+    ASSERT_EQ(records[3].value_size, 1u << 20);
+    for (size_t i = 1; i < records.size(); i++) {
+        ASSERT_TRUE(records[i].timestamp >= records[i - 1].timestamp);
+    }
+    // Small records: a byte of type and a few of varints around the key
+    ASSERT_TRUE(fs::file_size(path) < kTraceHeaderSize + 4 * 8 + 1003);
+}
+
+TEST(trace_many_records_concurrently) {
+    TestDir dir("trace_concurrent");
+    std::string path = dir.path() + "/trace";
+    Tracer tracer;
+    ASSERT_OK(tracer.Start(path, TraceOptions()));
+    const int kThreads = 4;
+    const int N = 50000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < N; i++) {
+                tracer.Record(TraceType::kPut, static_cast<uint32_t>(t), MakeKey(i), 10);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    ASSERT_OK(tracer.End());
+
+    auto records = ReadTrace(path);
+    ASSERT_EQ(records.size() + tracer.dropped(), static_cast<size_t>(kThreads * N));
+    // Each thread's records stay in its order
+    std::vector<int> next(kThreads, 0);
+    for (const auto& r : records) {
+        ASSERT_TRUE(r.cf_id < static_cast<uint32_t>(kThreads));
+        ASSERT_TRUE(r.key >= MakeKey(next[r.cf_id]));
+        next[r.cf_id]++;
+    }
+}
+
+TEST(trace_sampling) {
+    TestDir dir("trace_sampling");
+    std::string path = dir.path() + "/trace";
+    Tracer tracer;
+    TraceOptions options;
+    options.sampling_frequency = 10;
+    ASSERT_OK(tracer.Start(path, options));
+    for (int i = 0; i < 1000; i++) tracer.Record(TraceType::kGet, 0, MakeKey(i), 0);
+    ASSERT_OK(tracer.End());
+
+    auto records = ReadTrace(path);
+    ASSERT_EQ(records.size(), 100u);
+    ASSERT_EQ(records[0].key, MakeKey(0));
+    ASSERT_EQ(records[1].key, MakeKey(10));
+
+    std::unique_ptr<TraceReader> reader;
+    ASSERT_OK(TraceReader::Open(path, &reader));
+    ASSERT_EQ(reader->sampling_frequency(), 10u);
+    ASSERT_TRUE(reader->start_time() > 0);
+
+    // Frequencies past 32 bits survive the header
+    options.sampling_frequency = uint64_t{1} << 40;
+    ASSERT_OK(tracer.Start(path, options));
+    tracer.Record(TraceType::kGet, 0, MakeKey(0), 0);
+    ASSERT_OK(tracer.End());
+    ASSERT_OK(TraceReader::Open(path, &reader));
+    ASSERT_EQ(reader->sampling_frequency(), uint64_t{1} << 40);
+    ASSERT_EQ(ReadTrace(path).size(), 1u);
+
+    options.sampling_frequency = 0;
+    ASSERT_TRUE(tracer.Start(path, options).IsInvalidArgument());
+}
+
+TEST(trace_max_file_size) {
+    TestDir dir("trace_max_size");
+    std::string path = dir.path() + "/trace";
+    Tracer tracer;
+    TraceOptions options;
+    options.max_trace_file_size = 4096;
+    ASSERT_OK(tracer.Start(path, options));
+    for (int i = 0; i < 10000; i++) tracer.Record(TraceType::kGet, 0, MakeKey(i), 0);
+    ASSERT_FALSE(tracer.active());
+    ASSERT_OK(tracer.End());
+
+    ASSERT_TRUE(fs::file_size(path) <= 4096u);
+    auto records = ReadTrace(path);
+    ASSERT_TRUE(records.size() > 100);
+    ASSERT_EQ(records.back().key, MakeKey(static_cast<int>(records.size()) - 1));
+}
+
+TEST(trace_truncated_and_corrupt) {
+    TestDir dir("trace_corrupt");
+    std::string path = dir.path() + "/trace";
+    Tracer tracer;
+    ASSERT_OK(tracer.Start(path, TraceOptions()));
+    for (int i = 0; i < 10; i++) tracer.Record(TraceType::kPut, 0, MakeKey(i), 100);
+    ASSERT_OK(tracer.End());
+
+    // A record cut short ends the trace
+    fs::resize_file(path, fs::file_size(path) - 3);
+    auto records = ReadTrace(path);
+    ASSERT_EQ(records.size(), 9u);
+
+    // A bad record type is corruption
+    {
+        FILE* f = std::fopen(path.c_str(), "r+b");
+        std::fseek(f, static_cast<long>(kTraceHeaderSize), SEEK_SET);
+        std::fputc(0x7f, f);
+        std::fclose(f);
+    }
+    std::unique_ptr<TraceReader> reader;
+    ASSERT_OK(TraceReader::Open(path, &reader));
+    TraceRecord record;
+    ASSERT_FALSE(reader->Next(&record));
+    ASSERT_TRUE(reader->status().IsCorruption());
+
+    // Not a trace at all
+    {
+        FILE* f = std::fopen(path.c_str(), "r+b");
+        std::fputs("nope", f);
+        std::fclose(f);
+    }
+    ASSERT_TRUE(TraceReader::Open(path, &reader).IsCorruption());
+    ASSERT_TRUE(TraceReader::Open(dir.path() + "/missing", &reader).IsIOError());
+}
+
+// ============================================================================
+// DB Trace and Replay Tests
+// ============================================================================
+
+TEST(db_trace_records_operations) {
+    TestDir dir("db_trace_ops");
+    std::string path = dir.path() + "/trace";
+    auto db = OpenDB(dir.path() + "/db");
+    ASSERT_OK(db->Put(WriteOptions(), "before", "x"));
+
+    ASSERT_OK(db->StartTrace(TraceOptions(), path));
+    ASSERT_OK(db->Put(WriteOptions(), "a", "12345"));
+    std::string value;
+    ASSERT_OK(db->Get(ReadOptions(), "a", &value));
+    ASSERT_TRUE(db->Get(ReadOptions(), "missing", &value).IsNotFound());
+    ASSERT_OK(db->Delete(WriteOptions(), "a"));
+    ASSERT_OK(db->EndTrace());
+    ASSERT_OK(db->Put(WriteOptions(), "after", "x"));
+
+    auto records = ReadTrace(path);
+    ASSERT_EQ(records.size(), 4u);
+    ASSERT_TRUE(records[0].type == TraceType::kPut);
+    ASSERT_EQ(records[0].key, "a");
+    ASSERT_EQ(records[0].value_size, 5u);
+    ASSERT_TRUE(records[1].type == TraceType::kGet);
+    ASSERT_TRUE(records[2].type == TraceType::kGet);
+    ASSERT_EQ(records[2].key, "missing");
+    ASSERT_TRUE(records[3].type == TraceType::kDelete);
+    ASSERT_EQ(records[3].cf_id, db->DefaultColumnFamily()->GetID());
+}
+
+TEST(db_replay_reproduces_state) {
+    TestDir dir("db_replay");
+    std::string path = dir.path() + "/trace";
+    const int N = 5000;
+    auto source = OpenDB(dir.path() + "/source");
+    ColumnFamilyHandle* source_users = nullptr;
+    ASSERT_OK(source->CreateColumnFamily(ColumnFamilyOptions(), "users", &source_users));
+    ASSERT_OK(source->StartTrace(TraceOptions(), path));
+    std::string value;
+    for (int i = 0; i < N; i++) {
+        std::string v(static_cast<size_t>(i % 50), 'x');
+        ASSERT_OK(source->Put(WriteOptions(), MakeKey(i), v));
+        if (i % 5 == 0) ASSERT_OK(source->Put(WriteOptions(), source_users, MakeKey(i), "u"));
+        if (i % 7 == 0) ASSERT_OK(source->Delete(WriteOptions(), MakeKey(i / 2)));
+        source->Get(ReadOptions(), MakeKey(i / 3), &value);
+    }
+    ASSERT_OK(source->EndTrace());
+
+    auto db = OpenDB(dir.path() + "/target");
+    ColumnFamilyHandle* users = nullptr;
+    ASSERT_OK(db->CreateColumnFamily(ColumnFamilyOptions(), "users", &users));
+    ReplayOptions options;
+    options.num_threads = 4;
+    options.speed = 0;
+    ReplayStats stats;
+    ASSERT_OK(Replayer(db.get(), {db->DefaultColumnFamily(), users}).Replay(path, options, &stats));
+    ASSERT_OK(stats.first_error);
+    ASSERT_EQ(stats.errors, 0u);
+    ASSERT_EQ(stats.skipped, 0u);
+    ASSERT_EQ(stats.ops[static_cast<int>(TraceType::kPut) - 1], static_cast<uint64_t>(N + N / 5));
+    ASSERT_EQ(stats.ops[static_cast<int>(TraceType::kDelete) - 1],
+              static_cast<uint64_t>((N + 6) / 7));
+    ASSERT_EQ(stats.ops[static_cast<int>(TraceType::kGet) - 1], static_cast<uint64_t>(N));
+    ASSERT_EQ(stats.latency[static_cast<int>(TraceType::kGet) - 1].Count(),
+              static_cast<uint64_t>(N));
+    ASSERT_TRUE(stats.gets_found > 0);
+
+    // Operations on a key ran in recorded order, so deletes and the puts
+    // they follow or precede land the same way; value sizes carry over
+    for (int i = 0; i < N; i += 37) {
+        std::string expected = GetValue(source.get(), source->DefaultColumnFamily(), MakeKey(i));
+        std::string actual = GetValue(db.get(), db->DefaultColumnFamily(), MakeKey(i));
+        if (expected == "NOT_FOUND") {
+            ASSERT_EQ(actual, "NOT_FOUND");
+        } else {
+            ASSERT_EQ(actual.size(), expected.size());
+        }
+    }
+    ASSERT_EQ(GetValue(db.get(), users, MakeKey(5)).size(), 1u);
+    ASSERT_EQ(GetValue(db.get(), users, MakeKey(6)), "NOT_FOUND");
+
+    // Without the users handle its records are skipped
+    ASSERT_OK(Replayer(db.get()).Replay(path, options, &stats));
+    ASSERT_EQ(stats.skipped, static_cast<uint64_t>(N / 5));
+}
+
+TEST(db_replay_paced) {
+    TestDir dir("db_replay_paced");
+    std::string path = dir.path() + "/trace";
+    auto db = OpenDB(dir.path() + "/db");
+    ASSERT_OK(db->StartTrace(TraceOptions(), path));
+    for (int i = 0; i < 10; i++) {
+        ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), "v"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_OK(db->EndTrace());
+
+    ReplayOptions options;
+    ReplayStats stats;
+    ASSERT_OK(Replayer(db.get()).Replay(path, options, &stats));
+    ASSERT_TRUE(stats.trace_micros >= 90000);
+    ASSERT_TRUE(stats.replay_micros >= stats.trace_micros);
+
+    options.speed = 4;
+    ASSERT_OK(Replayer(db.get()).Replay(path, options, &stats));
+    ASSERT_TRUE(stats.replay_micros >= stats.trace_micros / 4);
+    ASSERT_TRUE(stats.replay_micros < stats.trace_micros);
+
+    options.speed = -1;
+    ASSERT_TRUE(Replayer(db.get()).Replay(path, options, &stats).IsInvalidArgument());
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+void benchmark_trace_overhead() {
+    TestDir dir("trace_bench");
+    Options options;
+    options.write_buffer_size = 256 << 20;  // Keep flushes out of the numbers
+    options.wal_options.sync_policy = wal::SyncPolicy::kNoSync;
+    DB* raw = nullptr;
+    ASSERT_OK(DB::Open(options, dir.path() + "/db", &raw));
+    std::unique_ptr<DB> db(raw);
+    const int N = 200000;
+    std::string value(100, 'v');
+
+    auto run = [&](const char* label) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < N; i++) {
+            ASSERT_OK(db->Put(WriteOptions(), MakeKey(i), value));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        std::cout << "  Put, " << label << ": " << (static_cast<double>(ns) / N) << " ns/op\n";
+    };
+
+    run("tracing off");
+    ASSERT_OK(db->StartTrace(TraceOptions(), dir.path() + "/trace"));
+    run("tracing on");
+    ASSERT_OK(db->EndTrace());
+    TraceOptions sampled;
+    sampled.sampling_frequency = 100;
+    ASSERT_OK(db->StartTrace(sampled, dir.path() + "/trace"));
+    run("tracing 1 in 100");
+    ASSERT_OK(db->EndTrace());
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+    std::cout << "=== Phase 10: Trace Tests ===\n\n";
+
+    std::cout << "--- Trace File Tests ---\n";
+    RUN_TEST(trace_round_trip);
+    RUN_TEST(trace_many_records_concurrently);
+    RUN_TEST(trace_sampling);
+    RUN_TEST(trace_max_file_size);
+    RUN_TEST(trace_truncated_and_corrupt);
+
+    std::cout << "\n--- DB Trace and Replay Tests ---\n";
+    RUN_TEST(db_trace_records_operations);
+    RUN_TEST(db_replay_reproduces_state);
+    RUN_TEST(db_replay_paced);
+
+    std::cout << "\n--- Benchmarks ---\n";
+    benchmark_trace_overhead();
+
+    std::cout << "\n=== All Tests Passed ===\n";
+    return 0;
+}
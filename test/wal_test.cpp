@@ -159,6 +159,38 @@ TEST(wal_entry_delete) {
     ASSERT_TRUE(decoded.value.empty());
 }
 
+TEST(wal_entry_column_family) {
+    WALEntry original;
+    original.type = WALEntryType::kPut;
+    original.sequence = 7;
+    original.key = "k";
+    original.value = "v";
+    original.column_family = 3;
+
+    // Non-default families are tagged; the default keeps the old layout
+    std::string encoded = EncodeWALEntry(original);
+    ASSERT_EQ(static_cast<uint8_t>(encoded[0]),
+              static_cast<uint8_t>(WALEntryType::kColumnFamilyPut));
+    ASSERT_EQ(encoded.size(), original.EncodedSize());
+
+    WALEntry decoded;
+    ASSERT_TRUE(DecodeWALEntry(encoded, &decoded));
+    ASSERT_TRUE(decoded.IsPut());
+    ASSERT_EQ(decoded.column_family, 3u);
+    ASSERT_EQ(decoded.key, "k");
+    ASSERT_EQ(decoded.value, "v");
+
+    original.type = WALEntryType::kDelete;
+    original.value.clear();
+    ASSERT_TRUE(DecodeWALEntry(EncodeWALEntry(original), &decoded));
+    ASSERT_TRUE(decoded.IsDelete());
+    ASSERT_EQ(decoded.column_family, 3u);
+
+    original.column_family = 0;
+    ASSERT_EQ(static_cast<uint8_t>(EncodeWALEntry(original)[0]),
+              static_cast<uint8_t>(WALEntryType::kDelete));
+}
+
 // ============================================================================
 // WAL Writer Tests
 // ============================================================================
@@ -205,6 +237,47 @@ TEST(wal_writer_large_values) {
     ASSERT_EQ(entry.value.size(), 10000u);
 }
 
+TEST(wal_writer_fragmented_records) {
+    TestDir dir("wal_writer_fragmented");
+    std::string path = dir.path() + "/test.wal";
+
+    // Payloads around and well over the 64KB record limit
+    std::vector<size_t> sizes = {10, kMaxRecordSize - 20, kMaxRecordSize, 200000, 10};
+    {
+        WALWriter writer(path);
+        ASSERT_OK(writer.Open());
+        for (size_t i = 0; i < sizes.size(); i++) {
+            ASSERT_OK(writer.AppendPut(i + 1, "key" + std::to_string(i),
+                                       std::string(sizes[i], static_cast<char>('a' + i))));
+        }
+        writer.Close();
+    }
+
+    WALReader reader(path);
+    ASSERT_OK(reader.Open());
+    WALEntry entry;
+    Status s;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        ASSERT_TRUE(reader.ReadEntry(&entry, &s));
+        ASSERT_OK(s);
+        ASSERT_EQ(entry.sequence, i + 1);
+        ASSERT_EQ(entry.value, std::string(sizes[i], static_cast<char>('a' + i)));
+    }
+    ASSERT_FALSE(reader.ReadEntry(&entry, &s));
+    ASSERT_OK(s);
+
+    // A log cut inside a fragmented record keeps the records before it
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 100000);
+    WALReader truncated(path);
+    ASSERT_OK(truncated.Open());
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_TRUE(truncated.ReadEntry(&entry, &s));
+        ASSERT_EQ(entry.sequence, i + 1);
+    }
+    ASSERT_FALSE(truncated.ReadEntry(&entry, &s));
+    ASSERT_TRUE(s.IsCorruption());
+}
+
 TEST(wal_writer_sync_policies) {
     TestDir dir("wal_sync_policies");
 
@@ -345,7 +418,7 @@ TEST(wal_reader_corruption_detection) {
         FILE* f = fopen(path.c_str(), "r+b");
         ASSERT(f != nullptr);
         fseek(f, 10, SEEK_SET);  // Corrupt somewhere in the middle
-        char garbage = 0xFF;
+        char garbage = static_cast<char>(0xFF);
         fwrite(&garbage, 1, 1, f);
         fclose(f);
     }
@@ -426,6 +499,38 @@ TEST(wal_manager_recovery) {
     }
 }
 
+TEST(wal_manager_append_batch) {
+    TestDir dir("wal_manager_batch");
+    {
+        WALManager mgr(dir.path());
+        ASSERT_OK(mgr.Open());
+        std::vector<WALEntry> batch;
+        for (int i = 0; i < 100; i++) {
+            batch.push_back(WALEntry{WALEntryType::kPut, static_cast<SequenceNumber>(i + 1),
+                                     "key" + std::to_string(i), "value",
+                                     static_cast<uint32_t>(i % 3)});
+        }
+        ASSERT_OK(mgr.AppendBatch(batch));
+        ASSERT_OK(mgr.AppendDelete(101, "key0", 2));
+        mgr.Close();
+    }
+
+    WALManager mgr(dir.path());
+    ASSERT_OK(mgr.Open());
+    std::vector<WALEntry> replayed;
+    RecoveryStats stats;
+    ASSERT_OK(mgr.Recover([&](uint64_t, const WALEntry& entry) { replayed.push_back(entry); },
+                          &stats));
+    ASSERT_EQ(replayed.size(), 101u);
+    ASSERT_EQ(stats.max_sequence, 101u);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(replayed[i].sequence, static_cast<SequenceNumber>(i + 1));
+        ASSERT_EQ(replayed[i].column_family, static_cast<uint32_t>(i % 3));
+    }
+    ASSERT_TRUE(replayed[100].IsDelete());
+    ASSERT_EQ(replayed[100].column_family, 2u);
+}
+
 TEST(wal_manager_rotation) {
     TestDir dir("wal_manager_rotation");
 
@@ -647,10 +752,12 @@ int main() {
     RUN_TEST(encoder_decoder_basic);
     RUN_TEST(wal_entry_encoding);
     RUN_TEST(wal_entry_delete);
+    RUN_TEST(wal_entry_column_family);
 
     std::cout << "\n--- WAL Writer Tests ---\n";
     RUN_TEST(wal_writer_basic);
     RUN_TEST(wal_writer_large_values);
+    RUN_TEST(wal_writer_fragmented_records);
     RUN_TEST(wal_writer_sync_policies);
 
     std::cout << "\n--- WAL Reader Tests ---\n";
@@ -662,6 +769,7 @@ int main() {
     std::cout << "\n--- WAL Manager Tests ---\n";
     RUN_TEST(wal_manager_basic);
     RUN_TEST(wal_manager_recovery);
+    RUN_TEST(wal_manager_append_batch);
     RUN_TEST(wal_manager_rotation);
     RUN_TEST(wal_manager_truncate);
 
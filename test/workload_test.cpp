@@ -0,0 +1,388 @@
+// test/workload_test.cpp
+// Tests for the YCSB workload generator: key choosers, mixes and parsing
+
+#include "util/types.h"
+#include "benchmarks/ycsb.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <set>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace lsm;
+using namespace lsm::ycsb;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " #name "..." << std::flush; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT(cond) do { \
+    if (!(cond)) { \
+        std::cerr << "\nAssertion failed: " #cond \
+                  << " at " << __FILE__ << ":" << __LINE__ << "\n"; \
+        std::abort(); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_TRUE(x) ASSERT(x)
+#define ASSERT_FALSE(x) ASSERT(!(x))
+
+constexpr int kSamples = 200000;
+
+// Count of samples landing on each key
+static std::vector<int> Sample(KeyChooser* chooser, uint64_t items, uint64_t seed = 1) {
+    Random rng(seed);
+    std::vector<int> counts(items, 0);
+    for (int i = 0; i < kSamples; i++) {
+        uint64_t k = chooser->Next(&rng, items);
+        ASSERT_TRUE(k < items);
+        counts[k]++;
+    }
+    return counts;
+}
+
+// Share of samples going to the most popular `top` keys
+static double TopShare(std::vector<int> counts, size_t top) {
+    std::sort(counts.rbegin(), counts.rend());
+    double sum = 0;
+    for (size_t i = 0; i < top && i < counts.size(); i++) sum += counts[i];
+    return sum / kSamples;
+}
+
+// ============================================================================
+// Key Chooser Tests
+// ============================================================================
+
+TEST(uniform_chooser_is_flat) {
+    UniformChooser chooser;
+    std::vector<int> counts = Sample(&chooser, 100);
+    for (int c : counts) {
+        ASSERT_TRUE(c > kSamples / 100 * 0.8 && c < kSamples / 100 * 1.2);
+    }
+}
+
+TEST(zipfian_chooser_is_skewed) {
+    const uint64_t items = 1000;
+    ZipfianChooser chooser(items);
+    std::vector<int> counts = Sample(&chooser, items);
+
+    // Popularity falls with rank: p(0)/p(1) is about 2^0.99
+    ASSERT_TRUE(counts[0] > counts[1]);
+    ASSERT_TRUE(counts[1] > counts[10]);
+    double ratio = static_cast<double>(counts[0]) / counts[1];
+    ASSERT_TRUE(ratio > 1.7 && ratio < 2.3);
+
+    // With theta 0.99 over 1000 keys the top 1% take about a third
+    double top = TopShare(counts, 10);
+    ASSERT_TRUE(top > 0.30 && top < 0.45);
+}
+
+TEST(zipfian_chooser_grows) {
+    ZipfianChooser chooser(10);
+    Random rng(7);
+    uint64_t max_seen = 0;
+    for (int i = 0; i < kSamples; i++) {
+        uint64_t k = chooser.Next(&rng, 100000);
+        ASSERT_TRUE(k < 100000);
+        max_seen = std::max(max_seen, k);
+    }
+    ASSERT_TRUE(max_seen >= 10);  // Keys past the initial item count appear
+
+    // A smaller count than seen before still stays in range
+    for (int i = 0; i < 1000; i++) ASSERT_TRUE(chooser.Next(&rng, 5) < 5);
+}
+
+TEST(zipfian_chooser_concurrent_growth) {
+    ZipfianChooser chooser(10);
+    std::atomic<uint64_t> items{10};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            Random rng(static_cast<uint64_t>(t) + 1);
+            for (int i = 0; i < 20000; i++) {
+                // Inserting threads grow the count while others read
+                uint64_t n = t % 2 == 0 ? items.fetch_add(1) + 1 : items.load();
+                ASSERT_TRUE(chooser.Next(&rng, n) < n);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+}
+
+TEST(scrambled_zipfian_spreads_hot_keys) {
+    const uint64_t items = 1000;
+    ScrambledZipfianChooser chooser(items);
+    std::vector<int> counts = Sample(&chooser, items);
+
+    // Same skew as zipfian...
+    ASSERT_TRUE(TopShare(counts, 10) > 0.25);
+
+    // ...but the hot keys are not clustered at the start of the key space
+    int hot_in_low_range = 0;
+    std::vector<int> sorted = counts;
+    std::sort(sorted.rbegin(), sorted.rend());
+    for (uint64_t k = 0; k < items; k++) {
+        if (counts[k] >= sorted[9] && k < 100) hot_in_low_range++;
+    }
+    ASSERT_TRUE(hot_in_low_range < 8);
+}
+
+TEST(latest_chooser_favors_recent) {
+    LatestChooser chooser(1000);
+    std::vector<int> counts = Sample(&chooser, 1000);
+    ASSERT_TRUE(counts[999] > counts[998]);
+    ASSERT_TRUE(counts[998] > counts[900]);
+    ASSERT_TRUE(counts[999] > counts[0] * 100);
+
+    // The hottest key follows the item count as it grows
+    Random rng(3);
+    std::map<uint64_t, int> grown;
+    for (int i = 0; i < 10000; i++) grown[chooser.Next(&rng, 2000)]++;
+    ASSERT_TRUE(grown[1999] > grown[999]);
+}
+
+TEST(hotspot_chooser_fractions) {
+    HotspotChooser chooser(0.2, 0.8);
+    std::vector<int> counts = Sample(&chooser, 1000);
+    double hot = 0;
+    for (int k = 0; k < 200; k++) hot += counts[k];
+    hot /= kSamples;
+    ASSERT_TRUE(hot > 0.78 && hot < 0.82);
+
+    // Every key is reachable
+    for (int c : counts) ASSERT_TRUE(c > 0);
+}
+
+// ============================================================================
+// Workload Tests
+// ============================================================================
+
+TEST(presets_match_ycsb) {
+    WorkloadSpec spec;
+    ASSERT_TRUE(PresetWorkload("a", &spec));
+    ASSERT_EQ(spec.read_proportion, 0.5);
+    ASSERT_EQ(spec.update_proportion, 0.5);
+    ASSERT_TRUE(spec.request_distribution == Distribution::kZipfian);
+
+    ASSERT_TRUE(PresetWorkload("workloadd", &spec));
+    ASSERT_EQ(spec.insert_proportion, 0.05);
+    ASSERT_TRUE(spec.request_distribution == Distribution::kLatest);
+
+    ASSERT_TRUE(PresetWorkload("E", &spec));
+    ASSERT_EQ(spec.scan_proportion, 0.95);
+    ASSERT_EQ(spec.name, "workloade");
+
+    ASSERT_TRUE(PresetWorkload("f", &spec));
+    ASSERT_EQ(spec.read_modify_write_proportion, 0.5);
+
+    ASSERT_FALSE(PresetWorkload("g", &spec));
+}
+
+TEST(operation_mix_proportions) {
+    WorkloadSpec spec;
+    spec.read_proportion = 0.5;
+    spec.update_proportion = 0.2;
+    spec.insert_proportion = 0.1;
+    spec.scan_proportion = 0.1;
+    spec.read_modify_write_proportion = 0.1;
+    spec.record_count = 100;
+    Workload workload(spec);
+
+    Random rng(11);
+    int counts[kNumOperations] = {};
+    for (int i = 0; i < kSamples; i++) {
+        counts[static_cast<int>(workload.NextOperation(&rng))]++;
+    }
+    const double expected[kNumOperations] = {0.5, 0.2, 0.1, 0.1, 0.1};
+    for (int i = 0; i < kNumOperations; i++) {
+        ASSERT_TRUE(std::abs(static_cast<double>(counts[i]) / kSamples - expected[i]) < 0.01);
+    }
+}
+
+TEST(workload_inserts_extend_key_range) {
+    WorkloadSpec spec;
+    spec.record_count = 10;
+    spec.request_distribution = Distribution::kLatest;
+    Workload workload(spec);
+
+    ASSERT_EQ(workload.NextInsertKeyNum(), 10u);
+    ASSERT_EQ(workload.NextInsertKeyNum(), 11u);
+
+    // Keys are only chosen among completed inserts
+    Random rng(5);
+    for (int i = 0; i < 1000; i++) ASSERT_TRUE(workload.NextKeyNum(&rng) < 10);
+    workload.InsertDone();
+    workload.InsertDone();
+    bool saw_new = false;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t k = workload.NextKeyNum(&rng);
+        ASSERT_TRUE(k < 12);
+        if (k >= 10) saw_new = true;
+    }
+    ASSERT_TRUE(saw_new);
+}
+
+TEST(workload_key_names) {
+    WorkloadSpec spec;
+    Workload hashed(spec);
+    spec.ordered_inserts = true;
+    Workload ordered(spec);
+
+    ASSERT_EQ(ordered.KeyName(42), "user00000000000000000042");
+    ASSERT_TRUE(ordered.KeyName(9) < ordered.KeyName(10));
+
+    std::set<std::string> names;
+    for (uint64_t k = 0; k < 10000; k++) names.insert(hashed.KeyName(k));
+    ASSERT_EQ(names.size(), 10000u);
+    ASSERT_EQ(hashed.KeyName(1).size(), 24u);
+}
+
+// ============================================================================
+// Parser Tests
+// ============================================================================
+
+TEST(parse_workload_yaml) {
+    const char* text =
+        "# benchmarks/workloads/write_heavy.yaml\n"
+        "workload:\n"
+        "  name: \"write_heavy\"\n"
+        "  record_count: 10000000\n"
+        "  operation_count: 5000000   # run phase\n"
+        "  read_proportion: 0.2\n"
+        "  write_proportion: 0.8\n"
+        "  key_distribution: \"zipfian\"\n"
+        "  value_size: 100\n"
+        "  threads: 16\n";
+    WorkloadSpec spec;
+    Status s = ParseWorkload(text, &spec);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(spec.name, "write_heavy");
+    ASSERT_EQ(spec.record_count, 10000000u);
+    ASSERT_EQ(spec.operation_count, 5000000u);
+    ASSERT_EQ(spec.read_proportion, 0.2);
+    ASSERT_EQ(spec.update_proportion, 0.8);
+    ASSERT_TRUE(spec.request_distribution == Distribution::kZipfian);
+    ASSERT_EQ(spec.value_size, 100u);
+    ASSERT_EQ(spec.threads, 16);
+}
+
+TEST(parse_workload_base_preset) {
+    WorkloadSpec spec;
+    Status s = ParseWorkload("name: mine\nbase: e\nmax_scan_length: 10\n"
+                             "insert_order: ordered\nkey_distribution: hotspot\n", &spec);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(spec.name, "mine");
+    ASSERT_EQ(spec.scan_proportion, 0.95);
+    ASSERT_EQ(spec.max_scan_length, 10u);
+    ASSERT_TRUE(spec.ordered_inserts);
+    ASSERT_TRUE(spec.request_distribution == Distribution::kHotspot);
+}
+
+TEST(parse_workload_errors) {
+    WorkloadSpec spec;
+    ASSERT_FALSE(ParseWorkload("read_proportion 0.5\n", &spec).ok());
+    ASSERT_FALSE(ParseWorkload("bogus_key: 1\n", &spec).ok());
+    ASSERT_FALSE(ParseWorkload("key_distribution: pareto\n", &spec).ok());
+    ASSERT_FALSE(ParseWorkload("record_count: lots\n", &spec).ok());
+    ASSERT_FALSE(ParseWorkload("zipfian_constant: 1.5\n", &spec).ok());
+
+    WorkloadSpec empty;
+    Status s = ParseWorkload("read_proportion: 0\nupdate_proportion: 0\n", &empty);
+    ASSERT_FALSE(s.ok());
+}
+
+TEST(load_workload_file) {
+    std::string path = "/tmp/lsm_test_workload_" + std::to_string(::getpid()) + ".yaml";
+    FILE* f = std::fopen(path.c_str(), "w");
+    ASSERT_TRUE(f != nullptr);
+    std::fputs("workload:\n  base: b\n  record_count: 500\n", f);
+    std::fclose(f);
+
+    WorkloadSpec spec;
+    ASSERT_TRUE(LoadWorkload(path, &spec).ok());
+    ASSERT_EQ(spec.record_count, 500u);
+    ASSERT_EQ(spec.read_proportion, 0.95);
+    std::remove(path.c_str());
+
+    ASSERT_TRUE(LoadWorkload("c", &spec).ok());
+    ASSERT_EQ(spec.read_proportion, 1.0);
+    ASSERT_FALSE(LoadWorkload("/nonexistent/workload.yaml", &spec).ok());
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+static volatile uint64_t g_sink;
+
+void benchmark_key_choosers() {
+    const uint64_t items = 10000000;
+    ZipfianChooser zipfian(items);
+    ScrambledZipfianChooser scrambled(items);
+    LatestChooser latest(items);
+    HotspotChooser hotspot(0.2, 0.8);
+    UniformChooser uniform;
+
+    std::pair<const char*, KeyChooser*> choosers[] = {
+        {"uniform", &uniform}, {"zipfian", &zipfian}, {"scrambled", &scrambled},
+        {"latest", &latest}, {"hotspot", &hotspot},
+    };
+    Random rng(1);
+    const int N = 1000000;
+    for (auto& [name, chooser] : choosers) {
+        uint64_t sink = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < N; i++) sink += chooser->Next(&rng, items);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        g_sink = sink;
+        std::cout << "  " << name << ": " << N << " keys in " << us << "us ("
+                  << (us * 1000.0 / N) << " ns/op)\n";
+    }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+    std::cout << "=== Phase 8: Workload Generator Tests ===\n\n";
+
+    std::cout << "--- Key Chooser Tests ---\n";
+    RUN_TEST(uniform_chooser_is_flat);
+    RUN_TEST(zipfian_chooser_is_skewed);
+    RUN_TEST(zipfian_chooser_grows);
+    RUN_TEST(zipfian_chooser_concurrent_growth);
+    RUN_TEST(scrambled_zipfian_spreads_hot_keys);
+    RUN_TEST(latest_chooser_favors_recent);
+    RUN_TEST(hotspot_chooser_fractions);
+
+    std::cout << "\n--- Workload Tests ---\n";
+    RUN_TEST(presets_match_ycsb);
+    RUN_TEST(operation_mix_proportions);
+    RUN_TEST(workload_inserts_extend_key_range);
+    RUN_TEST(workload_key_names);
+
+    std::cout << "\n--- Parser Tests ---\n";
+    RUN_TEST(parse_workload_yaml);
+    RUN_TEST(parse_workload_base_preset);
+    RUN_TEST(parse_workload_errors);
+    RUN_TEST(load_workload_file);
+
+    std::cout << "\n--- Benchmarks ---\n";
+    benchmark_key_choosers();
+
+    std::cout << "\n=== All Tests Passed ===\n";
+    return 0;
+}
@@ -129,6 +129,9 @@ public:
 
     size_t NumKeys() const { return num_keys_; }
 
+    // Bytes buffered for the keys added so far
+    size_t MemoryUsage() const { return hashes_.capacity() * sizeof(hashes_[0]); }
+
 private:
     std::string CreateFilter(size_t num_bits) {
         size_t num_bytes = num_bits / 8;
@@ -0,0 +1,357 @@
+// util/cache.h
+// Sharded LRU cache with charge-based capacity, used as the block cache,
+// the interface of a secondary tier behind it, and reservations charging
+// other memory to its capacity
+
+#pragma once
+
+#include "util/types.h"
+#include "util/bloom_filter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsm {
+
+// A second, usually denser, cache tier (e.g. CompressedSecondaryCache).
+// Entries evicted from a Cache that has one are offered to it; primary
+// misses are looked up in it and promoted back. Implementations decide
+// what to admit and must be safe for concurrent use.
+class SecondaryCache {
+public:
+    virtual ~SecondaryCache() = default;
+
+    // Offer the saved contents of an entry evicted from the primary cache
+    virtual void Insert(Slice key, Slice contents) = 0;
+
+    // Copy the contents saved for key to *contents; false on a miss
+    virtual bool Lookup(Slice key, std::string* contents) = 0;
+};
+
+// How a type of cache entry moves to and from a secondary cache. Entries
+// inserted without a helper are simply dropped when evicted.
+struct CacheItemHelper {
+    // Bytes to save for value
+    Slice (*contents)(const void* value);
+
+    // Rebuild a value from saved bytes and set its charge; null if they
+    // are unusable
+    std::shared_ptr<void> (*create)(std::string contents, size_t* charge);
+};
+
+// Cache maps keys to shared, immutable values. Each entry has a charge
+// (usually its size in bytes); inserting past capacity evicts the least
+// recently used entries.
+//
+// Values are shared_ptrs: a Lookup result keeps the value alive after it is
+// evicted, so callers can pin an entry (e.g. a data block backing a
+// PinnableSlice) for as long as they need it. Usage counts resident entries
+// only.
+//
+// The key space is split into 2^num_shard_bits shards, each with its own
+// mutex and LRU list, so concurrent readers rarely contend.
+//
+// With a secondary cache, entries inserted with a CacheItemHelper are
+// offered to it when evicted for space (not when erased or replaced), and
+// Lookup with the same helper falls back to it on a miss.
+class Cache {
+public:
+    explicit Cache(size_t capacity, int num_shard_bits = 4,
+                   std::shared_ptr<SecondaryCache> secondary_cache = nullptr)
+        : shards_(size_t{1} << num_shard_bits),
+          shard_mask_((size_t{1} << num_shard_bits) - 1),
+          secondary_cache_(std::move(secondary_cache)),
+          capacity_(capacity),
+          next_id_(1),
+          hits_(0),
+          misses_(0) {
+        SetShardCapacity();
+    }
+
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+
+    // Insert (or replace) an entry. An entry whose charge exceeds the
+    // shard capacity is not kept.
+    void Insert(Slice key, std::shared_ptr<void> value, size_t charge,
+                const CacheItemHelper* helper = nullptr) {
+        std::vector<Evicted> evicted;
+        GetShard(key).Insert(key, std::move(value), charge, helper,
+                             secondary_cache_ ? &evicted : nullptr);
+        Demote(evicted);
+    }
+
+    // Return the value for key, or null on a miss. Given a helper, a miss
+    // is looked up in the secondary cache and a hit there is promoted.
+    std::shared_ptr<void> Lookup(Slice key, const CacheItemHelper* helper = nullptr) {
+        std::shared_ptr<void> value = GetShard(key).Lookup(key);
+        (value ? hits_ : misses_).fetch_add(1, std::memory_order_relaxed);
+        if (value || helper == nullptr || !secondary_cache_) return value;
+
+        std::string contents;
+        if (!secondary_cache_->Lookup(key, &contents)) return nullptr;
+        size_t charge = 0;
+        value = helper->create(std::move(contents), &charge);
+        if (!value) return nullptr;
+        secondary_hits_.fetch_add(1, std::memory_order_relaxed);
+        Insert(key, value, charge, helper);
+        return value;
+    }
+
+    template <typename T>
+    std::shared_ptr<T> Lookup(Slice key, const CacheItemHelper* helper = nullptr) {
+        return std::static_pointer_cast<T>(Lookup(key, helper));
+    }
+
+    void Erase(Slice key) {
+        GetShard(key).Erase(key);
+    }
+
+    // Id unique to this cache, for partitioning the key space among
+    // clients that share the cache (e.g. one per open SSTable)
+    uint64_t NewId() {
+        return next_id_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t GetCapacity() const {
+        std::lock_guard<std::mutex> lock(capacity_mutex_);
+        return capacity_;
+    }
+
+    void SetCapacity(size_t capacity) {
+        std::vector<Evicted> evicted;
+        {
+            std::lock_guard<std::mutex> lock(capacity_mutex_);
+            capacity_ = capacity;
+            SetShardCapacity(secondary_cache_ ? &evicted : nullptr);
+        }
+        Demote(evicted);
+    }
+
+    // Charge memory held outside the cache (memtables, open tables'
+    // metadata) to its capacity: entries are evicted until they fit in
+    // what is left. Reservations beyond the capacity leave no room for
+    // entries. See CacheReservation.
+    void Reserve(size_t bytes) { AdjustReserved(static_cast<int64_t>(bytes)); }
+    void Release(size_t bytes) { AdjustReserved(-static_cast<int64_t>(bytes)); }
+
+    size_t GetReserved() const {
+        std::lock_guard<std::mutex> lock(capacity_mutex_);
+        return reserved_;
+    }
+
+    // Total charge of resident entries, without reservations
+    size_t GetUsage() const {
+        size_t usage = 0;
+        for (const auto& shard : shards_) usage += shard.Usage();
+        return usage;
+    }
+
+    // Call fn(key, charge) for every resident entry, most recently used
+    // first. Shards are interleaved, so across shards the order is only
+    // approximate. Each shard is copied under its lock; fn runs unlocked.
+    void ApplyToAllEntries(const std::function<void(Slice key, size_t charge)>& fn) const {
+        std::vector<std::vector<std::pair<std::string, size_t>>> entries;
+        size_t longest = 0;
+        for (const auto& shard : shards_) {
+            entries.push_back(shard.Entries());
+            longest = std::max(longest, entries.back().size());
+        }
+        for (size_t i = 0; i < longest; i++) {
+            for (const auto& shard_entries : entries) {
+                if (i < shard_entries.size()) fn(shard_entries[i].first, shard_entries[i].second);
+            }
+        }
+    }
+
+    uint64_t Hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t Misses() const { return misses_.load(std::memory_order_relaxed); }
+
+    // Misses (counted above) served by the secondary cache
+    uint64_t SecondaryHits() const { return secondary_hits_.load(std::memory_order_relaxed); }
+
+    SecondaryCache* secondary_cache() const { return secondary_cache_.get(); }
+
+private:
+    // An entry evicted for space, on its way to the secondary cache
+    struct Evicted {
+        std::string key;
+        std::shared_ptr<void> value;
+        const CacheItemHelper* helper;
+    };
+
+    class Shard {
+    public:
+        void SetCapacity(size_t capacity, std::vector<Evicted>* evicted) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = capacity;
+            EvictLocked(evicted);
+        }
+
+        void Insert(Slice key, std::shared_ptr<void> value, size_t charge,
+                    const CacheItemHelper* helper, std::vector<Evicted>* evicted) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            EraseLocked(key);
+            if (charge > capacity_) return;
+            lru_.push_front(Entry{std::string(key), std::move(value), charge, helper});
+            map_.emplace(lru_.front().key, lru_.begin());
+            usage_ += charge;
+            EvictLocked(evicted);
+        }
+
+        std::shared_ptr<void> Lookup(Slice key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = map_.find(key);
+            if (it == map_.end()) return nullptr;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->value;
+        }
+
+        void Erase(Slice key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            EraseLocked(key);
+        }
+
+        size_t Usage() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return usage_;
+        }
+
+        // Keys and charges, most recently used first
+        std::vector<std::pair<std::string, size_t>> Entries() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<std::pair<std::string, size_t>> result;
+            result.reserve(lru_.size());
+            for (const Entry& e : lru_) result.emplace_back(e.key, e.charge);
+            return result;
+        }
+
+    private:
+        struct Entry {
+            std::string key;
+            std::shared_ptr<void> value;
+            size_t charge;
+            const CacheItemHelper* helper;
+        };
+
+        void EraseLocked(Slice key) {
+            auto it = map_.find(key);
+            if (it == map_.end()) return;
+            usage_ -= it->second->charge;
+            auto entry = it->second;
+            map_.erase(it);
+            lru_.erase(entry);
+        }
+
+        // Victims with a helper are moved to *evicted, if given
+        void EvictLocked(std::vector<Evicted>* evicted) {
+            while (usage_ > capacity_ && !lru_.empty()) {
+                Entry& victim = lru_.back();
+                usage_ -= victim.charge;
+                map_.erase(Slice(victim.key));
+                if (evicted != nullptr && victim.helper != nullptr) {
+                    evicted->push_back(
+                        Evicted{std::move(victim.key), std::move(victim.value), victim.helper});
+                }
+                lru_.pop_back();
+            }
+        }
+
+        mutable std::mutex mutex_;
+        size_t capacity_ = 0;
+        size_t usage_ = 0;
+        std::list<Entry> lru_;
+        // Keys view the strings owned by lru_ entries
+        std::unordered_map<Slice, std::list<Entry>::iterator> map_;
+    };
+
+    Shard& GetShard(Slice key) {
+        uint64_t h = MurmurHash::Hash64(key.data(), key.size());
+        return shards_[h & shard_mask_];
+    }
+
+    void AdjustReserved(int64_t delta) {
+        std::vector<Evicted> evicted;
+        {
+            std::lock_guard<std::mutex> lock(capacity_mutex_);
+            reserved_ = static_cast<size_t>(static_cast<int64_t>(reserved_) + delta);
+            SetShardCapacity(secondary_cache_ ? &evicted : nullptr);
+        }
+        Demote(evicted);
+    }
+
+    // Split what reservations leave of the capacity among the shards.
+    // REQUIRES: capacity_mutex_ held, or called from the constructor
+    void SetShardCapacity(std::vector<Evicted>* evicted = nullptr) {
+        size_t available = capacity_ - std::min(reserved_, capacity_);
+        size_t per_shard = (available + shards_.size() - 1) / shards_.size();
+        for (auto& shard : shards_) shard.SetCapacity(per_shard, evicted);
+    }
+
+    // Offer evicted entries to the secondary cache, outside the shard locks
+    void Demote(const std::vector<Evicted>& evicted) {
+        for (const Evicted& e : evicted) {
+            secondary_cache_->Insert(e.key, e.helper->contents(e.value.get()));
+        }
+    }
+
+    std::vector<Shard> shards_;
+    const size_t shard_mask_;
+    const std::shared_ptr<SecondaryCache> secondary_cache_;
+
+    mutable std::mutex capacity_mutex_;
+    size_t capacity_;
+    size_t reserved_ = 0;
+
+    std::atomic<uint64_t> next_id_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> secondary_hits_{0};
+};
+
+// Memory charged to a cache's capacity by one holder, kept in steps of
+// unit bytes so that a growing holder (e.g. memtables) resizes the cache
+// rarely. Everything is released on destruction. Not thread-safe.
+class CacheReservation {
+public:
+    CacheReservation(std::shared_ptr<Cache> cache, size_t unit = 1)
+        : cache_(std::move(cache)), unit_(unit > 0 ? unit : 1) {}
+
+    ~CacheReservation() { Update(0); }
+
+    CacheReservation(const CacheReservation&) = delete;
+    CacheReservation& operator=(const CacheReservation&) = delete;
+
+    // Charge bytes, rounded up to a multiple of the unit, in total
+    void Update(size_t bytes) {
+        size_t target = (bytes + unit_ - 1) / unit_ * unit_;
+        if (target > reserved_) {
+            cache_->Reserve(target - reserved_);
+        } else if (target < reserved_) {
+            cache_->Release(reserved_ - target);
+        }
+        reserved_ = target;
+    }
+
+    size_t reserved() const { return reserved_; }
+
+private:
+    std::shared_ptr<Cache> cache_;
+    const size_t unit_;
+    size_t reserved_ = 0;
+};
+
+inline std::shared_ptr<Cache> NewLRUCache(size_t capacity, int num_shard_bits = 4,
+                                          std::shared_ptr<SecondaryCache> secondary_cache =
+                                              nullptr) {
+    return std::make_shared<Cache>(capacity, num_shard_bits, std::move(secondary_cache));
+}
+
+}  // namespace lsm
@@ -0,0 +1,107 @@
+// util/compressed_secondary_cache.h
+// Secondary cache tier keeping blocks evicted from the block cache
+// compressed in memory
+
+#pragma once
+
+#include "util/types.h"
+#include "util/cache.h"
+#include "util/compression.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace lsm {
+
+// Holds LZ-compressed copies of entries evicted from a primary Cache, so a
+// primary miss on a recently evicted block costs a decompression instead
+// of a file read. Compressed blocks are typically a third of their size,
+// so the same memory holds about three times as many blocks.
+//
+// Admission, to keep one-off reads (scans, compaction-sized working sets)
+// from churning the tier:
+//  - An entry is only stored the second time it is evicted while the tier
+//    still remembers the first; the first eviction leaves a small
+//    placeholder holding just the key.
+//  - Entries that compress by less than 1/8 are not stored.
+// A hit leaves a placeholder behind (the entry moves back to the primary),
+// so the next eviction of a hot block stores it again directly.
+class CompressedSecondaryCache : public SecondaryCache {
+public:
+    explicit CompressedSecondaryCache(size_t capacity, int num_shard_bits = 4)
+        : cache_(capacity, num_shard_bits) {}
+
+    void Insert(Slice key, Slice contents) override {
+        std::shared_ptr<Item> item = cache_.Lookup<Item>(key);
+        if (!item) {
+            cache_.Insert(key, std::make_shared<Item>(), Charge(key, 0));
+            return;
+        }
+
+        auto compressed = std::make_shared<Item>();
+        LZCompression::Compress(contents, &compressed->data);
+        if (compressed->data.size() > contents.size() - contents.size() / 8) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        size_t charge = Charge(key, compressed->data.size());
+        cache_.Insert(key, std::move(compressed), charge);
+        admitted_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool Lookup(Slice key, std::string* contents) override {
+        std::shared_ptr<Item> item = cache_.Lookup<Item>(key);
+        if (!item || item->data.empty()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!LZCompression::Uncompress(item->data, contents)) {
+            cache_.Erase(key);
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        cache_.Insert(key, std::make_shared<Item>(), Charge(key, 0));
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t GetCapacity() const { return cache_.GetCapacity(); }
+    void SetCapacity(size_t capacity) { cache_.SetCapacity(capacity); }
+
+    // Compressed bytes and placeholders held
+    size_t GetUsage() const { return cache_.GetUsage(); }
+
+    uint64_t Hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t Misses() const { return misses_.load(std::memory_order_relaxed); }
+
+    // Evicted entries stored compressed, and those refused for compressing
+    // poorly (first evictions, which only leave a placeholder, count as
+    // neither)
+    uint64_t Admitted() const { return admitted_.load(std::memory_order_relaxed); }
+    uint64_t Rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+private:
+    // Compressed contents; empty for a placeholder
+    struct Item {
+        std::string data;
+    };
+
+    static size_t Charge(Slice key, size_t compressed_size) {
+        return sizeof(Item) + key.size() + compressed_size;
+    }
+
+    Cache cache_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> admitted_{0};
+    std::atomic<uint64_t> rejected_{0};
+};
+
+inline std::shared_ptr<CompressedSecondaryCache> NewCompressedSecondaryCache(
+    size_t capacity, int num_shard_bits = 4) {
+    return std::make_shared<CompressedSecondaryCache>(capacity, num_shard_bits);
+}
+
+}  // namespace lsm
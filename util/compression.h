@@ -0,0 +1,159 @@
+// util/compression.h
+// Fast LZ77 block compression for in-memory caches
+
+#pragma once
+
+#include "util/types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace lsm {
+
+// LZ4-style byte-oriented compression, written for speed rather than
+// ratio: one hash probe per position and no entropy coding. Typical data
+// blocks (prefix-compressed keys, repetitive values) shrink 2-4x.
+//
+// Format: uncompressed length (fixed32), then sequences of
+//   token | [literal length bytes] | literals | offset (2 bytes) | [match length bytes]
+// The token's high nibble is the literal count and its low nibble the
+// match length minus 4; a nibble of 15 continues in following bytes, each
+// added until one is below 255. The last sequence has literals only.
+class LZCompression {
+public:
+    static void Compress(Slice input, std::string* output) {
+        output->clear();
+        const auto* in = reinterpret_cast<const uint8_t*>(input.data());
+        const size_t n = input.size();
+        PutFixed32(output, static_cast<uint32_t>(n));
+        output->reserve(4 + n + n / 255 + 16);
+
+        // Positions + 1 of recent 4-byte sequences, by hash (0 = none)
+        std::vector<uint32_t> table(size_t{1} << kHashBits, 0);
+        size_t anchor = 0;  // Start of pending literals
+        size_t i = 0;
+        // Matches start kMatchStartLimit bytes before the end at the latest
+        // and leave kLastLiterals bytes as literals
+        const size_t limit = n > kMatchStartLimit ? n - kMatchStartLimit : 0;
+        while (i < limit) {
+            uint32_t seq = Load32(in + i);
+            uint32_t& slot = table[Hash(seq)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(i + 1);
+            if (candidate == 0 || i - (candidate - 1) > kMaxOffset ||
+                Load32(in + candidate - 1) != seq) {
+                i++;
+                continue;
+            }
+            size_t ref = candidate - 1;
+            size_t len = kMinMatch;
+            const size_t max_len = n - kLastLiterals - i;
+            while (len < max_len && in[ref + len] == in[i + len]) len++;
+
+            EmitSequence(output, in + anchor, i - anchor, i - ref, len);
+            i += len;
+            anchor = i;
+        }
+        EmitSequence(output, in + anchor, n - anchor, 0, 0);
+    }
+
+    // False if input is not a valid compressed block
+    static bool Uncompress(Slice input, std::string* output) {
+        output->clear();
+        if (input.size() < 4) return false;
+        const auto* p = reinterpret_cast<const uint8_t*>(input.data());
+        const uint8_t* end = p + input.size();
+        const size_t length = GetFixed32(p);
+        p += 4;
+        // A sequence byte expands to at most 255 output bytes
+        if (length > (input.size() - 4) * 255) return false;
+        output->resize(length);
+        char* out = output->data();
+        size_t op = 0;
+
+        while (p < end) {
+            uint8_t token = *p++;
+            size_t literals = token >> 4;
+            if (literals == 15 && !GetLength(&p, end, &literals)) return false;
+            if (literals > static_cast<size_t>(end - p) || literals > length - op) return false;
+            std::memcpy(out + op, p, literals);
+            p += literals;
+            op += literals;
+            if (p == end) break;  // Last sequence
+
+            if (end - p < 2) return false;
+            size_t offset = static_cast<size_t>(p[0]) | (static_cast<size_t>(p[1]) << 8);
+            p += 2;
+            size_t len = token & 15;
+            if (len == 15 && !GetLength(&p, end, &len)) return false;
+            len += kMinMatch;
+            if (offset == 0 || offset > op || len > length - op) return false;
+            // Byte by byte: the match may overlap the bytes it produces
+            for (size_t k = 0; k < len; k++) out[op + k] = out[op - offset + k];
+            op += len;
+        }
+        return op == length;
+    }
+
+private:
+    static constexpr int kHashBits = 12;
+    static constexpr size_t kMinMatch = 4;
+    static constexpr size_t kLastLiterals = 5;
+    static constexpr size_t kMatchStartLimit = 12;
+    static constexpr size_t kMaxOffset = 65535;
+
+    static uint32_t Load32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint32_t Hash(uint32_t seq) {
+        return (seq * 2654435761u) >> (32 - kHashBits);
+    }
+
+    static void PutFixed32(std::string* dst, uint32_t v) {
+        for (int i = 0; i < 4; i++) dst->push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+
+    static uint32_t GetFixed32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    static void PutLength(std::string* dst, size_t v) {
+        for (; v >= 255; v -= 255) dst->push_back(static_cast<char>(255));
+        dst->push_back(static_cast<char>(v));
+    }
+
+    // Adds the continuation bytes of a length nibble to *v
+    static bool GetLength(const uint8_t** p, const uint8_t* end, size_t* v) {
+        uint8_t b;
+        do {
+            if (*p == end) return false;
+            b = *(*p)++;
+            *v += b;
+        } while (b == 255);
+        return true;
+    }
+
+    // match_len 0 = literals only (the last sequence)
+    static void EmitSequence(std::string* dst, const uint8_t* literals, size_t literal_len,
+                             size_t offset, size_t match_len) {
+        size_t match_code = match_len > 0 ? match_len - kMinMatch : 0;
+        uint8_t token = static_cast<uint8_t>((std::min<size_t>(literal_len, 15) << 4) |
+                                             std::min<size_t>(match_code, 15));
+        dst->push_back(static_cast<char>(token));
+        if (literal_len >= 15) PutLength(dst, literal_len - 15);
+        dst->append(reinterpret_cast<const char*>(literals), literal_len);
+        if (match_len == 0) return;
+        dst->push_back(static_cast<char>(offset & 0xff));
+        dst->push_back(static_cast<char>(offset >> 8));
+        if (match_code >= 15) PutLength(dst, match_code - 15);
+    }
+};
+
+}  // namespace lsm
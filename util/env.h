@@ -0,0 +1,363 @@
+// util/env.h
+// File system access used by the WAL, tables, blob files and MANIFESTs
+
+#pragma once
+
+#include "util/types.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lsm {
+
+// A file being written from start to end
+class WritableFile {
+public:
+    virtual ~WritableFile() = default;
+
+    virtual Status Append(Slice data) = 0;
+
+    // Make everything appended so far durable
+    virtual Status Sync() = 0;
+
+    // Further calls fail; the destructor closes an open file too
+    virtual Status Close() = 0;
+
+    // Bytes in the file, including those appended by this handle
+    virtual uint64_t GetFileSize() const = 0;
+};
+
+// A file read from start to end
+class SequentialFile {
+public:
+    virtual ~SequentialFile() = default;
+
+    // Read up to n bytes into scratch; *bytes_read is 0 at end of file
+    virtual Status Read(size_t n, char* scratch, size_t* bytes_read) = 0;
+};
+
+// A file read at arbitrary offsets; safe for concurrent use
+class RandomAccessFile {
+public:
+    virtual ~RandomAccessFile() = default;
+
+    // Read up to n bytes at offset into scratch; fewer only at end of file
+    virtual Status Read(uint64_t offset, size_t n, char* scratch,
+                        size_t* bytes_read) const = 0;
+
+    // Hint that [offset, offset + n) will be read soon; must not block
+    virtual void Prefetch(uint64_t /*offset*/, size_t /*n*/) const {}
+
+    virtual uint64_t Size() const = 0;
+};
+
+// Every file and directory operation of the DB goes through an Env, so
+// tests can substitute one that injects faults (see FaultInjectionEnv).
+// Opening a file that does not exist fails with NotFound; other failures
+// are IOErrors. Implementations must be safe for concurrent use.
+class Env {
+public:
+    virtual ~Env() = default;
+
+    // The POSIX file system; never deleted
+    static Env* Default();
+
+    // Create or truncate path
+    virtual Status NewWritableFile(const std::string& path,
+                                   std::unique_ptr<WritableFile>* result) = 0;
+
+    // Open path for appending, creating it if missing
+    virtual Status NewAppendableFile(const std::string& path,
+                                     std::unique_ptr<WritableFile>* result) = 0;
+
+    virtual Status NewSequentialFile(const std::string& path,
+                                     std::unique_ptr<SequentialFile>* result) = 0;
+
+    virtual Status NewRandomAccessFile(const std::string& path,
+                                       std::unique_ptr<RandomAccessFile>* result) = 0;
+
+    virtual bool FileExists(const std::string& path) = 0;
+
+    virtual Status GetFileSize(const std::string& path, uint64_t* size) = 0;
+
+    // Names of the entries of dir, without "." and ".."
+    virtual Status GetChildren(const std::string& dir, std::vector<std::string>* result) = 0;
+
+    // Succeeds if dir already exists
+    virtual Status CreateDirIfMissing(const std::string& dir) = 0;
+
+    virtual Status DeleteFile(const std::string& path) = 0;
+
+    // Atomically replace dst with src
+    virtual Status RenameFile(const std::string& src, const std::string& dst) = 0;
+};
+
+namespace env_internal {
+
+inline Status PosixError(const std::string& context, int err) {
+    if (err == ENOENT) return Status::NotFound(context + ": " + std::strerror(err));
+    return Status::IOError(context + ": " + std::strerror(err));
+}
+
+}  // namespace env_internal
+
+class PosixWritableFile : public WritableFile {
+public:
+    PosixWritableFile(std::string path, int fd, uint64_t size)
+        : path_(std::move(path)), fd_(fd), size_(size) {}
+
+    ~PosixWritableFile() override {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    Status Append(Slice data) override {
+        const char* ptr = data.data();
+        size_t remaining = data.size();
+        while (remaining > 0) {
+            ssize_t written = ::write(fd_, ptr, remaining);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return env_internal::PosixError("Failed to write " + path_, errno);
+            }
+            ptr += written;
+            remaining -= static_cast<size_t>(written);
+            size_ += static_cast<uint64_t>(written);
+        }
+        return Status::OK();
+    }
+
+    Status Sync() override {
+        if (::fsync(fd_) != 0) return env_internal::PosixError("Failed to sync " + path_, errno);
+        return Status::OK();
+    }
+
+    Status Close() override {
+        if (fd_ < 0) return Status::OK();
+        int r = ::close(fd_);
+        fd_ = -1;
+        if (r != 0) return env_internal::PosixError("Failed to close " + path_, errno);
+        return Status::OK();
+    }
+
+    uint64_t GetFileSize() const override { return size_; }
+
+private:
+    std::string path_;
+    int fd_;
+    uint64_t size_;
+};
+
+class PosixSequentialFile : public SequentialFile {
+public:
+    PosixSequentialFile(std::string path, int fd) : path_(std::move(path)), fd_(fd) {}
+
+    ~PosixSequentialFile() override { ::close(fd_); }
+
+    Status Read(size_t n, char* scratch, size_t* bytes_read) override {
+        while (true) {
+            ssize_t r = ::read(fd_, scratch, n);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                *bytes_read = 0;
+                return env_internal::PosixError("Failed to read " + path_, errno);
+            }
+            *bytes_read = static_cast<size_t>(r);
+            return Status::OK();
+        }
+    }
+
+private:
+    std::string path_;
+    int fd_;
+};
+
+class PosixRandomAccessFile : public RandomAccessFile {
+public:
+    PosixRandomAccessFile(std::string path, int fd, uint64_t size)
+        : path_(std::move(path)), fd_(fd), size_(size) {}
+
+    ~PosixRandomAccessFile() override { ::close(fd_); }
+
+    Status Read(uint64_t offset, size_t n, char* scratch, size_t* bytes_read) const override {
+        size_t done = 0;
+        while (done < n) {
+            ssize_t r = ::pread(fd_, scratch + done, n - done,
+                                static_cast<off_t>(offset + done));
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                *bytes_read = done;
+                return env_internal::PosixError("Failed to read " + path_, errno);
+            }
+            if (r == 0) break;
+            done += static_cast<size_t>(r);
+        }
+        *bytes_read = done;
+        return Status::OK();
+    }
+
+    void Prefetch(uint64_t offset, size_t n) const override {
+#ifdef POSIX_FADV_WILLNEED
+        if (n > 0) {
+            ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(n),
+                            POSIX_FADV_WILLNEED);
+        }
+#else
+        (void)offset;
+        (void)n;
+#endif
+    }
+
+    uint64_t Size() const override { return size_; }
+
+private:
+    std::string path_;
+    int fd_;
+    uint64_t size_;
+};
+
+class PosixEnv : public Env {
+public:
+    Status NewWritableFile(const std::string& path,
+                           std::unique_ptr<WritableFile>* result) override {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return env_internal::PosixError("Failed to create " + path, errno);
+        *result = std::make_unique<PosixWritableFile>(path, fd, 0);
+        return Status::OK();
+    }
+
+    Status NewAppendableFile(const std::string& path,
+                             std::unique_ptr<WritableFile>* result) override {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) return env_internal::PosixError("Failed to open " + path, errno);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            return env_internal::PosixError("Failed to stat " + path, err);
+        }
+        *result = std::make_unique<PosixWritableFile>(path, fd,
+                                                      static_cast<uint64_t>(st.st_size));
+        return Status::OK();
+    }
+
+    Status NewSequentialFile(const std::string& path,
+                             std::unique_ptr<SequentialFile>* result) override {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return env_internal::PosixError("Failed to open " + path, errno);
+        *result = std::make_unique<PosixSequentialFile>(path, fd);
+        return Status::OK();
+    }
+
+    Status NewRandomAccessFile(const std::string& path,
+                               std::unique_ptr<RandomAccessFile>* result) override {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return env_internal::PosixError("Failed to open " + path, errno);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            return env_internal::PosixError("Failed to stat " + path, err);
+        }
+        *result = std::make_unique<PosixRandomAccessFile>(path, fd,
+                                                          static_cast<uint64_t>(st.st_size));
+        return Status::OK();
+    }
+
+    bool FileExists(const std::string& path) override {
+        return ::access(path.c_str(), F_OK) == 0;
+    }
+
+    Status GetFileSize(const std::string& path, uint64_t* size) override {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0) {
+            *size = 0;
+            return env_internal::PosixError("Failed to stat " + path, errno);
+        }
+        *size = static_cast<uint64_t>(st.st_size);
+        return Status::OK();
+    }
+
+    Status GetChildren(const std::string& dir, std::vector<std::string>* result) override {
+        result->clear();
+        DIR* d = ::opendir(dir.c_str());
+        if (d == nullptr) return env_internal::PosixError("Failed to open " + dir, errno);
+        struct dirent* entry;
+        while ((entry = ::readdir(d)) != nullptr) {
+            if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            result->push_back(entry->d_name);
+        }
+        ::closedir(d);
+        return Status::OK();
+    }
+
+    Status CreateDirIfMissing(const std::string& dir) override {
+        if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            return env_internal::PosixError("Failed to create directory " + dir, errno);
+        }
+        return Status::OK();
+    }
+
+    Status DeleteFile(const std::string& path) override {
+        if (::unlink(path.c_str()) != 0) {
+            return env_internal::PosixError("Failed to delete " + path, errno);
+        }
+        return Status::OK();
+    }
+
+    Status RenameFile(const std::string& src, const std::string& dst) override {
+        if (::rename(src.c_str(), dst.c_str()) != 0) {
+            return env_internal::PosixError("Failed to rename " + src + " to " + dst, errno);
+        }
+        return Status::OK();
+    }
+};
+
+inline Env* Env::Default() {
+    static PosixEnv env;
+    return &env;
+}
+
+// Read the whole of path into *data
+inline Status ReadFileToString(Env* env, const std::string& path, std::string* data) {
+    data->clear();
+    std::unique_ptr<SequentialFile> file;
+    Status s = env->NewSequentialFile(path, &file);
+    if (!s.ok()) return s;
+    char buf[8192];
+    while (true) {
+        size_t n = 0;
+        s = file->Read(sizeof(buf), buf, &n);
+        if (!s.ok()) return s;
+        if (n == 0) return Status::OK();
+        data->append(buf, n);
+    }
+}
+
+// Replace path with data: write and sync tmp, then rename it over path.
+// Readers see the old contents or the new, never a mix.
+inline Status WriteFileAtomically(Env* env, const std::string& path, const std::string& tmp,
+                                  Slice data) {
+    std::unique_ptr<WritableFile> file;
+    Status s = env->NewWritableFile(tmp, &file);
+    if (!s.ok()) return s;
+    s = file->Append(data);
+    if (s.ok()) s = file->Sync();
+    if (s.ok()) s = file->Close();
+    file.reset();
+    if (s.ok()) s = env->RenameFile(tmp, path);
+    if (!s.ok()) env->DeleteFile(tmp);
+    return s;
+}
+
+}  // namespace lsm
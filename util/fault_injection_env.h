@@ -0,0 +1,363 @@
+// util/fault_injection_env.h
+// An Env that simulates power loss and fails file operations on demand,
+// for crash-recovery tests
+
+#pragma once
+
+#include "util/types.h"
+#include "util/env.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace lsm {
+
+enum class FaultOp {
+    kCreate,  // NewWritableFile, NewAppendableFile
+    kAppend,
+    kSync,
+    kRename,  // Matched against the source and destination paths
+    kDelete,
+    kRead,    // Reads through sequential and random-access files
+};
+
+// Wraps another Env, remembering how much of each file it writes has been
+// synced. Two kinds of fault:
+//
+//  - Power loss: SetFilesystemActive(false) makes every later create,
+//    append, sync, rename and delete fail, so nothing the DB does after
+//    that point reaches the disk. With the DB closed, DropUnsyncedData()
+//    then cuts each file back to what a real crash could leave: its synced
+//    bytes, plus (torn_writes) a random part of the unsynced tail.
+//  - Failed calls: FailAt() makes one chosen later call fail, optionally
+//    as the moment power is lost.
+//
+// Renames and deletes are treated as durable once they return; the DB
+// does not sync directories and this Env does not model losing them.
+class FaultInjectionEnv : public Env {
+public:
+    explicit FaultInjectionEnv(Env* base = Env::Default(), uint64_t seed = 301)
+        : base_(base), rng_(seed) {}
+
+    // Fail the (skip + 1)th later op on a path containing pattern ("" =
+    // any path), once. With crash the failure is a power loss: a failed
+    // append first writes a random prefix of its data (a torn write), and
+    // the file system becomes inactive.
+    void FailAt(FaultOp op, const std::string& pattern, uint64_t skip = 0, bool crash = false) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        faults_.push_back({op, pattern, skip, crash});
+    }
+
+    void ClearFaults() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        faults_.clear();
+    }
+
+    void SetFilesystemActive(bool active) { active_.store(active, std::memory_order_release); }
+    bool filesystem_active() const { return active_.load(std::memory_order_acquire); }
+
+    // Calls failed by FailAt or by the inactive file system
+    uint64_t injected_errors() const { return injected_errors_.load(std::memory_order_relaxed); }
+
+    // Cut every file written since the last ResetState back to its synced
+    // length (with torn_writes, to a random length between that and its
+    // current one). Files are rewritten through the base Env, so call this
+    // with the DB closed and the file system in any state.
+    Status DropUnsyncedData(bool torn_writes = false) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [path, state] : files_) {
+            if (state.size <= state.synced) continue;
+            uint64_t keep = state.synced;
+            if (torn_writes) {
+                keep += std::uniform_int_distribution<uint64_t>(0, state.size - state.synced)(rng_);
+            }
+            Status s = Truncate(path, keep);
+            if (!s.ok()) return s;
+            state.size = keep;
+            state.synced = keep;
+        }
+        return Status::OK();
+    }
+
+    // Forget which writes are unsynced, as after a clean shutdown
+    void ResetState() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_.clear();
+    }
+
+    Status NewWritableFile(const std::string& path,
+                           std::unique_ptr<WritableFile>* result) override {
+        Status s = CheckFault(FaultOp::kCreate, path);
+        if (!s.ok()) return s;
+        std::unique_ptr<WritableFile> file;
+        s = base_->NewWritableFile(path, &file);
+        if (!s.ok()) return s;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            files_[path] = FileState{};
+        }
+        *result = std::make_unique<FaultWritableFile>(this, path, std::move(file));
+        return Status::OK();
+    }
+
+    Status NewAppendableFile(const std::string& path,
+                             std::unique_ptr<WritableFile>* result) override {
+        Status s = CheckFault(FaultOp::kCreate, path);
+        if (!s.ok()) return s;
+        std::unique_ptr<WritableFile> file;
+        s = base_->NewAppendableFile(path, &file);
+        if (!s.ok()) return s;
+        {
+            // Bytes already in a file this Env has not written are durable
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (files_.count(path) == 0) {
+                files_[path] = FileState{file->GetFileSize(), file->GetFileSize()};
+            }
+        }
+        *result = std::make_unique<FaultWritableFile>(this, path, std::move(file));
+        return Status::OK();
+    }
+
+    Status NewSequentialFile(const std::string& path,
+                             std::unique_ptr<SequentialFile>* result) override {
+        std::unique_ptr<SequentialFile> file;
+        Status s = base_->NewSequentialFile(path, &file);
+        if (!s.ok()) return s;
+        *result = std::make_unique<FaultSequentialFile>(this, path, std::move(file));
+        return Status::OK();
+    }
+
+    Status NewRandomAccessFile(const std::string& path,
+                               std::unique_ptr<RandomAccessFile>* result) override {
+        std::unique_ptr<RandomAccessFile> file;
+        Status s = base_->NewRandomAccessFile(path, &file);
+        if (!s.ok()) return s;
+        *result = std::make_unique<FaultRandomAccessFile>(this, path, std::move(file));
+        return Status::OK();
+    }
+
+    bool FileExists(const std::string& path) override { return base_->FileExists(path); }
+
+    Status GetFileSize(const std::string& path, uint64_t* size) override {
+        return base_->GetFileSize(path, size);
+    }
+
+    Status GetChildren(const std::string& dir, std::vector<std::string>* result) override {
+        return base_->GetChildren(dir, result);
+    }
+
+    Status CreateDirIfMissing(const std::string& dir) override {
+        if (!filesystem_active()) return Inactive(dir);
+        return base_->CreateDirIfMissing(dir);
+    }
+
+    Status DeleteFile(const std::string& path) override {
+        Status s = CheckFault(FaultOp::kDelete, path);
+        if (!s.ok()) return s;
+        s = base_->DeleteFile(path);
+        if (s.ok()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            files_.erase(path);
+        }
+        return s;
+    }
+
+    Status RenameFile(const std::string& src, const std::string& dst) override {
+        Status s = CheckFault(FaultOp::kRename, src, dst);
+        if (!s.ok()) return s;
+        s = base_->RenameFile(src, dst);
+        if (s.ok()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = files_.find(src);
+            if (it != files_.end()) {
+                files_[dst] = it->second;
+                files_.erase(src);
+            } else {
+                files_.erase(dst);
+            }
+        }
+        return s;
+    }
+
+private:
+    struct FileState {
+        uint64_t size = 0;    // Bytes written
+        uint64_t synced = 0;  // Bytes that would survive a crash
+    };
+
+    struct Fault {
+        FaultOp op;
+        std::string pattern;
+        uint64_t skip;
+        bool crash;
+    };
+
+    class FaultWritableFile : public WritableFile {
+    public:
+        FaultWritableFile(FaultInjectionEnv* env, std::string path,
+                          std::unique_ptr<WritableFile> base)
+            : env_(env), path_(std::move(path)), base_(std::move(base)) {}
+
+        Status Append(Slice data) override {
+            bool crash = false;
+            Status s = env_->CheckFault(FaultOp::kAppend, path_, "", &crash);
+            if (!s.ok()) {
+                if (crash && !data.empty()) {
+                    size_t torn = env_->RandomBelow(data.size());
+                    if (base_->Append(data.substr(0, torn)).ok()) env_->OnAppend(path_, torn);
+                }
+                return s;
+            }
+            s = base_->Append(data);
+            if (s.ok()) env_->OnAppend(path_, data.size());
+            return s;
+        }
+
+        Status Sync() override {
+            Status s = env_->CheckFault(FaultOp::kSync, path_);
+            if (!s.ok()) return s;
+            s = base_->Sync();
+            if (s.ok()) env_->OnSync(path_);
+            return s;
+        }
+
+        Status Close() override { return base_->Close(); }
+
+        uint64_t GetFileSize() const override { return base_->GetFileSize(); }
+
+    private:
+        FaultInjectionEnv* env_;
+        std::string path_;
+        std::unique_ptr<WritableFile> base_;
+    };
+
+    class FaultSequentialFile : public SequentialFile {
+    public:
+        FaultSequentialFile(FaultInjectionEnv* env, std::string path,
+                            std::unique_ptr<SequentialFile> base)
+            : env_(env), path_(std::move(path)), base_(std::move(base)) {}
+
+        Status Read(size_t n, char* scratch, size_t* bytes_read) override {
+            Status s = env_->CheckFault(FaultOp::kRead, path_);
+            if (!s.ok()) {
+                *bytes_read = 0;
+                return s;
+            }
+            return base_->Read(n, scratch, bytes_read);
+        }
+
+    private:
+        FaultInjectionEnv* env_;
+        std::string path_;
+        std::unique_ptr<SequentialFile> base_;
+    };
+
+    class FaultRandomAccessFile : public RandomAccessFile {
+    public:
+        FaultRandomAccessFile(FaultInjectionEnv* env, std::string path,
+                              std::unique_ptr<RandomAccessFile> base)
+            : env_(env), path_(std::move(path)), base_(std::move(base)) {}
+
+        Status Read(uint64_t offset, size_t n, char* scratch,
+                    size_t* bytes_read) const override {
+            Status s = env_->CheckFault(FaultOp::kRead, path_);
+            if (!s.ok()) {
+                *bytes_read = 0;
+                return s;
+            }
+            return base_->Read(offset, n, scratch, bytes_read);
+        }
+
+        void Prefetch(uint64_t offset, size_t n) const override { base_->Prefetch(offset, n); }
+
+        uint64_t Size() const override { return base_->Size(); }
+
+    private:
+        FaultInjectionEnv* env_;
+        std::string path_;
+        std::unique_ptr<RandomAccessFile> base_;
+    };
+
+    static Status Inactive(const std::string& path) {
+        return Status::IOError("File system inactive (simulated crash): " + path);
+    }
+
+    // Fail if a fault matches op on path (or other_path), or if op changes
+    // the disk while the file system is inactive. Reads work while inactive.
+    Status CheckFault(FaultOp op, const std::string& path, const std::string& other_path = "",
+                      bool* crash = nullptr) {
+        if (crash != nullptr) *crash = false;
+        if (op != FaultOp::kRead && !filesystem_active()) {
+            injected_errors_.fetch_add(1, std::memory_order_relaxed);
+            return Inactive(path);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = faults_.begin(); it != faults_.end(); ++it) {
+            if (it->op != op) continue;
+            if (path.find(it->pattern) == std::string::npos &&
+                (other_path.empty() || other_path.find(it->pattern) == std::string::npos)) {
+                continue;
+            }
+            if (it->skip > 0) {
+                it->skip--;
+                continue;
+            }
+            bool crashed = it->crash;
+            faults_.erase(it);
+            injected_errors_.fetch_add(1, std::memory_order_relaxed);
+            if (crashed) active_.store(false, std::memory_order_release);
+            if (crash != nullptr) *crash = crashed;
+            return Status::IOError("Injected fault: " + path);
+        }
+        return Status::OK();
+    }
+
+    void OnAppend(const std::string& path, uint64_t n) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_[path].size += n;
+    }
+
+    void OnSync(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FileState& state = files_[path];
+        state.synced = state.size;
+    }
+
+    size_t RandomBelow(size_t n) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<size_t>(rng_() % n);
+    }
+
+    // REQUIRES: mutex_ held
+    Status Truncate(const std::string& path, uint64_t size) {
+        std::string contents;
+        Status s = ReadFileToString(base_, path, &contents);
+        if (s.IsNotFound()) return Status::OK();
+        if (!s.ok()) return s;
+        if (contents.size() <= size) return Status::OK();
+        std::unique_ptr<WritableFile> file;
+        s = base_->NewWritableFile(path, &file);
+        if (s.ok()) s = file->Append(Slice(contents.data(), static_cast<size_t>(size)));
+        if (s.ok()) s = file->Sync();
+        if (s.ok()) s = file->Close();
+        return s;
+    }
+
+    Env* const base_;
+    std::atomic<bool> active_{true};
+    std::atomic<uint64_t> injected_errors_{0};
+
+    std::mutex mutex_;
+    std::map<std::string, FileState> files_;
+    std::vector<Fault> faults_;
+    std::mt19937_64 rng_;
+};
+
+}  // namespace lsm
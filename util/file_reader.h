@@ -0,0 +1,78 @@
+// util/file_reader.h
+// Positional reads from immutable files (SSTables)
+
+#pragma once
+
+#include "util/types.h"
+#include "util/env.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace lsm {
+
+class RandomAccessFileReader {
+public:
+    explicit RandomAccessFileReader(const std::string& path, Env* env = Env::Default())
+        : path_(path), env_(env), size_(0), num_reads_(0), bytes_read_(0) {}
+
+    ~RandomAccessFileReader() {
+        Close();
+    }
+
+    RandomAccessFileReader(const RandomAccessFileReader&) = delete;
+    RandomAccessFileReader& operator=(const RandomAccessFileReader&) = delete;
+
+    Status Open() {
+        Status s = env_->NewRandomAccessFile(path_, &file_);
+        if (!s.ok()) {
+            return Status::IOError("Failed to open file: " + path_);
+        }
+        size_ = file_->Size();
+        return Status::OK();
+    }
+
+    void Close() {
+        file_.reset();
+    }
+
+    // Read exactly n bytes at offset into *result (short reads are errors)
+    Status Read(uint64_t offset, size_t n, std::string* result) const {
+        result->resize(n);
+        size_t done = 0;
+        if (!file_->Read(offset, n, &(*result)[0], &done).ok()) {
+            return Status::IOError("Failed to read file: " + path_);
+        }
+        if (done < n) {
+            return Status::Corruption("Unexpected end of file: " + path_);
+        }
+
+        num_reads_.fetch_add(1, std::memory_order_relaxed);
+        bytes_read_.fetch_add(n, std::memory_order_relaxed);
+        return Status::OK();
+    }
+
+    // Hint that [offset, offset + n) will be read soon. The kernel starts
+    // fetching the range asynchronously; the call never blocks on I/O.
+    void Prefetch(uint64_t offset, size_t n) const {
+        if (file_) file_->Prefetch(offset, n);
+    }
+
+    uint64_t Size() const { return size_; }
+    const std::string& Path() const { return path_; }
+
+    // Number of read syscalls issued (for I/O accounting and tests)
+    uint64_t NumReads() const { return num_reads_.load(std::memory_order_relaxed); }
+    uint64_t BytesRead() const { return bytes_read_.load(std::memory_order_relaxed); }
+
+private:
+    std::string path_;
+    Env* env_;
+    std::unique_ptr<RandomAccessFile> file_;
+    uint64_t size_;
+    mutable std::atomic<uint64_t> num_reads_;
+    mutable std::atomic<uint64_t> bytes_read_;
+};
+
+}  // namespace lsm
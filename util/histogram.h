@@ -0,0 +1,154 @@
+// util/histogram.h
+// Bucketed latency histogram with percentile estimates
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace lsm {
+
+// Histogram of non-negative values (typically microseconds). Bucket limits
+// grow roughly geometrically (1, 1.2, 1.4, ... 9, 10, 12, ...), so relative
+// error stays bounded over many orders of magnitude. Percentiles are
+// interpolated inside the bucket holding the requested rank.
+//
+// Not thread-safe: give each thread its own and Merge them.
+class Histogram {
+public:
+    Histogram() : buckets_(Limits().size(), 0) { Clear(); }
+
+    void Clear() {
+        std::fill(buckets_.begin(), buckets_.end(), 0);
+        min_ = std::numeric_limits<double>::max();
+        max_ = 0;
+        num_ = 0;
+        sum_ = 0;
+        sum_squares_ = 0;
+    }
+
+    void Add(double value) {
+        const std::vector<double>& limits = Limits();
+        size_t b = std::upper_bound(limits.begin(), limits.end(), value) - limits.begin();
+        if (b >= buckets_.size()) b = buckets_.size() - 1;
+        buckets_[b]++;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        num_++;
+        sum_ += value;
+        sum_squares_ += value * value;
+    }
+
+    void Merge(const Histogram& other) {
+        for (size_t b = 0; b < buckets_.size(); b++) {
+            buckets_[b] += other.buckets_[b];
+        }
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        num_ += other.num_;
+        sum_ += other.sum_;
+        sum_squares_ += other.sum_squares_;
+    }
+
+    uint64_t Count() const { return num_; }
+    double Min() const { return num_ == 0 ? 0 : min_; }
+    double Max() const { return max_; }
+    double Average() const { return num_ == 0 ? 0 : sum_ / static_cast<double>(num_); }
+
+    double StandardDeviation() const {
+        if (num_ == 0) return 0;
+        double n = static_cast<double>(num_);
+        double variance = (sum_squares_ * n - sum_ * sum_) / (n * n);
+        return std::sqrt(std::max(variance, 0.0));
+    }
+
+    double Median() const { return Percentile(50.0); }
+
+    // Estimated value below which p percent of the samples fall
+    double Percentile(double p) const {
+        if (num_ == 0) return 0;
+        const std::vector<double>& limits = Limits();
+        double threshold = static_cast<double>(num_) * (p / 100.0);
+        double sum = 0;
+        for (size_t b = 0; b < buckets_.size(); b++) {
+            sum += static_cast<double>(buckets_[b]);
+            if (sum >= threshold && buckets_[b] > 0) {
+                double left_point = (b == 0) ? 0 : limits[b - 1];
+                double right_point = limits[b];
+                double left_sum = sum - static_cast<double>(buckets_[b]);
+                double pos = (threshold - left_sum) / static_cast<double>(buckets_[b]);
+                double r = left_point + (right_point - left_point) * pos;
+                return std::clamp(r, Min(), max_);
+            }
+        }
+        return max_;
+    }
+
+    // Summary plus one line per non-empty bucket with a bar chart
+    std::string ToString() const {
+        std::string r;
+        char buf[256];
+        snprintf(buf, sizeof(buf), "Count: %llu  Average: %.4f  StdDev: %.2f\n",
+                 static_cast<unsigned long long>(num_), Average(), StandardDeviation());
+        r.append(buf);
+        snprintf(buf, sizeof(buf), "Min: %.4f  Median: %.4f  Max: %.4f\n", Min(), Median(),
+                 max_);
+        r.append(buf);
+        snprintf(buf, sizeof(buf),
+                 "Percentiles: P50: %.2f P75: %.2f P99: %.2f P99.9: %.2f P99.99: %.2f\n",
+                 Percentile(50), Percentile(75), Percentile(99), Percentile(99.9),
+                 Percentile(99.99));
+        r.append(buf);
+        r.append("------------------------------------------------------\n");
+        if (num_ == 0) return r;
+
+        const std::vector<double>& limits = Limits();
+        const double mult = 100.0 / static_cast<double>(num_);
+        double sum = 0;
+        for (size_t b = 0; b < buckets_.size(); b++) {
+            if (buckets_[b] == 0) continue;
+            sum += static_cast<double>(buckets_[b]);
+            snprintf(buf, sizeof(buf), "[ %8.1f, %8.1f ) %7llu %7.3f%% %7.3f%% ",
+                     (b == 0) ? 0.0 : limits[b - 1], limits[b],
+                     static_cast<unsigned long long>(buckets_[b]),
+                     mult * static_cast<double>(buckets_[b]), mult * sum);
+            r.append(buf);
+            // 20 marks = 100%
+            int marks = static_cast<int>(20 * (static_cast<double>(buckets_[b]) /
+                                               static_cast<double>(num_)) + 0.5);
+            r.append(static_cast<size_t>(marks), '#');
+            r.push_back('\n');
+        }
+        return r;
+    }
+
+private:
+    // Upper (exclusive) bucket limits; the last bucket catches everything
+    static const std::vector<double>& Limits() {
+        static const std::vector<double> limits = [] {
+            static const double kSteps[] = {1.0, 1.2, 1.4, 1.6, 1.8, 2.0, 2.5, 3.0,
+                                            3.5, 4.0, 4.5, 5.0, 6.0, 7.0, 8.0, 9.0};
+            std::vector<double> v;
+            for (double decade = 1; decade <= 1e12; decade *= 10) {
+                for (double step : kSteps) v.push_back(step * decade);
+            }
+            v.push_back(std::numeric_limits<double>::max());
+            return v;
+        }();
+        return limits;
+    }
+
+    std::vector<uint64_t> buckets_;
+    double min_;
+    double max_;
+    uint64_t num_;
+    double sum_;
+    double sum_squares_;
+};
+
+}  // namespace lsm
@@ -0,0 +1,467 @@
+// util/linearizability.h
+// Recording concurrent key-value histories and checking them for
+// linearizability
+
+#pragma once
+
+#include "util/types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace lsm {
+
+enum class HistoryOpType : uint8_t {
+    kPut,
+    kGet,
+    kDelete,
+};
+
+constexpr uint64_t kPendingReturn = UINT64_MAX;
+
+// One operation of a history: invoked at `invoke` and returned at `ret`
+// (nanoseconds on one monotonic clock). kPendingReturn marks an operation
+// that never returned, which may or may not have taken effect.
+struct HistoryOp {
+    int thread = 0;
+    HistoryOpType type = HistoryOpType::kGet;
+    std::string key;
+    std::string value;   // Written by kPut; read by kGet if found
+    bool found = false;  // kGet only
+    uint64_t invoke = 0;
+    uint64_t ret = kPendingReturn;
+
+    std::string ToString() const {
+        std::string r = "thread " + std::to_string(thread) + " ";
+        switch (type) {
+            case HistoryOpType::kPut: r += "put(" + key + ", " + value + ")"; break;
+            case HistoryOpType::kDelete: r += "delete(" + key + ")"; break;
+            case HistoryOpType::kGet:
+                r += "get(" + key + ") -> " + (found ? value : std::string("not found"));
+                break;
+        }
+        r += " [" + std::to_string(invoke) + ", " +
+             (ret == kPendingReturn ? std::string("pending") : std::to_string(ret)) + "]";
+        return r;
+    }
+};
+
+// Logs the invocation and return of every operation. Each thread appends
+// to a log of its own, so recording adds no contention between threads.
+class HistoryRecorder {
+public:
+    explicit HistoryRecorder(int num_threads) : logs_(static_cast<size_t>(num_threads)) {}
+
+    static uint64_t NowNanos() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Call just before issuing the operation; returns its index for Return
+    size_t Invoke(int thread, HistoryOpType type, Slice key, Slice value = Slice()) {
+        std::vector<HistoryOp>& log = logs_[static_cast<size_t>(thread)];
+        HistoryOp op;
+        op.thread = thread;
+        op.type = type;
+        op.key.assign(key.data(), key.size());
+        op.value.assign(value.data(), value.size());
+        log.push_back(std::move(op));
+        log.back().invoke = NowNanos();
+        return log.size() - 1;
+    }
+
+    // Call as soon as the operation returns. For a kGet, found and value
+    // are what it read.
+    void Return(int thread, size_t index, bool found = false, Slice value = Slice()) {
+        uint64_t now = NowNanos();
+        HistoryOp& op = logs_[static_cast<size_t>(thread)][index];
+        op.ret = now;
+        if (op.type == HistoryOpType::kGet) {
+            op.found = found;
+            op.value.assign(value.data(), value.size());
+        }
+    }
+
+    // Every thread's operations. REQUIRES: no thread is recording
+    std::vector<HistoryOp> History() const {
+        std::vector<HistoryOp> history;
+        for (const auto& log : logs_) history.insert(history.end(), log.begin(), log.end());
+        return history;
+    }
+
+private:
+    std::vector<std::vector<HistoryOp>> logs_;  // By thread
+};
+
+// History files hold one operation per line:
+//   thread type invoke return found key value
+// type is p, g or d; return is "-" while pending; key and value are hex
+// ("-" when empty).
+inline Status SaveHistory(const std::string& path, const std::vector<HistoryOp>& history) {
+    auto hex = [](const std::string& s) {
+        if (s.empty()) return std::string("-");
+        std::string r;
+        char buf[3];
+        for (unsigned char c : s) {
+            std::snprintf(buf, sizeof(buf), "%02x", c);
+            r += buf;
+        }
+        return r;
+    };
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return Status::IOError("Failed to create history file: " + path);
+    for (const HistoryOp& op : history) {
+        char type = op.type == HistoryOpType::kPut ? 'p'
+                    : op.type == HistoryOpType::kGet ? 'g' : 'd';
+        out << op.thread << ' ' << type << ' ' << op.invoke << ' ';
+        if (op.ret == kPendingReturn) {
+            out << '-';
+        } else {
+            out << op.ret;
+        }
+        out << ' ' << (op.found ? 1 : 0) << ' ' << hex(op.key) << ' ' << hex(op.value) << '\n';
+    }
+    out.close();
+    if (!out) return Status::IOError("Failed to write history file: " + path);
+    return Status::OK();
+}
+
+inline Status LoadHistory(const std::string& path, std::vector<HistoryOp>* history) {
+    auto unhex = [](const std::string& s, std::string* r) {
+        r->clear();
+        if (s == "-") return true;
+        if (s.size() % 2 != 0) return false;
+        for (size_t i = 0; i < s.size(); i += 2) {
+            char* end = nullptr;
+            std::string byte = s.substr(i, 2);
+            long v = std::strtol(byte.c_str(), &end, 16);
+            if (*end != '\0') return false;
+            r->push_back(static_cast<char>(v));
+        }
+        return true;
+    };
+    std::ifstream in(path);
+    if (!in) return Status::IOError("Failed to open history file: " + path);
+    history->clear();
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        if (line.empty()) continue;
+        std::istringstream fields(line);
+        HistoryOp op;
+        std::string type, ret, key, value;
+        int found = 0;
+        fields >> op.thread >> type >> op.invoke >> ret >> found >> key >> value;
+        bool ok = !fields.fail() && type.size() == 1 && unhex(key, &op.key) &&
+                  unhex(value, &op.value);
+        if (ok) {
+            if (type[0] == 'p') op.type = HistoryOpType::kPut;
+            else if (type[0] == 'g') op.type = HistoryOpType::kGet;
+            else if (type[0] == 'd') op.type = HistoryOpType::kDelete;
+            else ok = false;
+        }
+        if (ok && ret != "-") {
+            char* end = nullptr;
+            op.ret = std::strtoull(ret.c_str(), &end, 10);
+            ok = *end == '\0' && op.ret >= op.invoke;
+        }
+        if (!ok) {
+            return Status::Corruption("Bad history line " + std::to_string(line_number) +
+                                      " in " + path);
+        }
+        op.found = found != 0;
+        history->push_back(std::move(op));
+    }
+    return Status::OK();
+}
+
+namespace linearizability_internal {
+
+// The model: one key's value, or absent
+struct ModelState {
+    bool present = false;
+    std::string value;
+};
+
+// Apply op to state; false if op's result contradicts the state
+inline bool Step(const ModelState& state, const HistoryOp& op, ModelState* next) {
+    switch (op.type) {
+        case HistoryOpType::kPut:
+            next->present = true;
+            next->value = op.value;
+            return true;
+        case HistoryOpType::kDelete:
+            next->present = false;
+            next->value.clear();
+            return true;
+        case HistoryOpType::kGet:
+            if (op.found != state.present || (op.found && op.value != state.value)) {
+                return false;
+            }
+            *next = state;
+            return true;
+    }
+    return false;
+}
+
+// Call and return events in time order, as a doubly linked list that
+// linearized operations are unlinked from and relinked into on backtrack
+struct Event {
+    bool is_call;
+    size_t op;
+    uint64_t time;
+    int match = -1;  // The call's return event; -1 if pending
+    int prev = -1;
+    int next = -1;
+};
+
+inline void Unlink(std::vector<Event>* events, int e) {
+    Event& ev = (*events)[static_cast<size_t>(e)];
+    (*events)[static_cast<size_t>(ev.prev)].next = ev.next;
+    if (ev.next >= 0) (*events)[static_cast<size_t>(ev.next)].prev = ev.prev;
+}
+
+inline void Relink(std::vector<Event>* events, int e) {
+    Event& ev = (*events)[static_cast<size_t>(e)];
+    (*events)[static_cast<size_t>(ev.prev)].next = e;
+    if (ev.next >= 0) (*events)[static_cast<size_t>(ev.next)].prev = e;
+}
+
+// Checks the operations on one key; on failure sets *message
+inline bool CheckKey(const std::vector<const HistoryOp*>& all_ops, std::string* message) {
+    // A get that never returned read nothing anyone saw
+    std::vector<const HistoryOp*> ops;
+    for (const HistoryOp* op : all_ops) {
+        if (op->type != HistoryOpType::kGet || op->ret != kPendingReturn) ops.push_back(op);
+    }
+
+    std::vector<Event> events;
+    for (size_t i = 0; i < ops.size(); i++) {
+        events.push_back({true, i, ops[i]->invoke});
+        if (ops[i]->ret != kPendingReturn) events.push_back({false, i, ops[i]->ret});
+    }
+    // At equal times calls go first: such operations count as overlapping
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        if (a.time != b.time) return a.time < b.time;
+        return a.is_call && !b.is_call;
+    });
+    std::vector<int> call_of(ops.size(), -1);
+    for (size_t e = 0; e < events.size(); e++) {
+        if (events[e].is_call) {
+            call_of[events[e].op] = static_cast<int>(e);
+        } else {
+            events[static_cast<size_t>(call_of[events[e].op])].match = static_cast<int>(e);
+        }
+    }
+    const int head = static_cast<int>(events.size());
+    events.push_back({true, 0, 0});
+    for (int e = 0; e < head; e++) {
+        events[static_cast<size_t>(e)].prev = e == 0 ? head : e - 1;
+        events[static_cast<size_t>(e)].next = e + 1 < head ? e + 1 : -1;
+    }
+    events[static_cast<size_t>(head)].next = head > 0 ? 0 : -1;
+
+    size_t returns_left = 0;
+    for (const HistoryOp* op : ops) returns_left += op->ret != kPendingReturn ? 1 : 0;
+
+    struct Frame {
+        int call;
+        ModelState state;
+    };
+    std::vector<Frame> stack;
+    std::vector<uint64_t> linearized((ops.size() + 63) / 64, 0);
+    std::unordered_set<std::string> seen;
+    ModelState state;
+    size_t deepest = 0;
+    std::string stuck_at;
+
+    int e = events[static_cast<size_t>(head)].next;
+    while (returns_left > 0) {
+        if (e >= 0 && events[static_cast<size_t>(e)].is_call) {
+            const Event& call = events[static_cast<size_t>(e)];
+            ModelState next;
+            if (Step(state, *ops[call.op], &next)) {
+                linearized[call.op / 64] |= uint64_t{1} << (call.op % 64);
+                std::string config(reinterpret_cast<const char*>(linearized.data()),
+                                   linearized.size() * sizeof(uint64_t));
+                config.push_back(next.present ? '\1' : '\0');
+                config.append(next.value);
+                if (seen.insert(std::move(config)).second) {
+                    stack.push_back({e, std::move(state)});
+                    state = std::move(next);
+                    Unlink(&events, e);
+                    if (call.match >= 0) {
+                        Unlink(&events, call.match);
+                        returns_left--;
+                    }
+                    e = events[static_cast<size_t>(head)].next;
+                    continue;
+                }
+                linearized[call.op / 64] &= ~(uint64_t{1} << (call.op % 64));
+            }
+            e = call.next;
+            continue;
+        }
+
+        // An operation returned before it could be linearized (or nothing
+        // more can be): undo the last choice
+        if (e >= 0 && stack.size() >= deepest) {
+            deepest = stack.size();
+            stuck_at = ops[events[static_cast<size_t>(e)].op]->ToString();
+        }
+        if (stack.empty()) {
+            *message = "No linearization of " + std::to_string(ops.size()) +
+                       " operations; at most " + std::to_string(deepest) +
+                       " linearize before " + stuck_at;
+            return false;
+        }
+        Frame frame = std::move(stack.back());
+        stack.pop_back();
+        const Event& call = events[static_cast<size_t>(frame.call)];
+        if (call.match >= 0) {
+            Relink(&events, call.match);
+            returns_left++;
+        }
+        Relink(&events, frame.call);
+        linearized[call.op / 64] &= ~(uint64_t{1} << (call.op % 64));
+        state = std::move(frame.state);
+        e = call.next;
+    }
+    return true;
+}
+
+}  // namespace linearizability_internal
+
+struct LinearizabilityResult {
+    bool linearizable = true;
+    size_t keys = 0;
+    size_t ops = 0;
+    // For the first key found not linearizable
+    std::string key;
+    std::string message;
+};
+
+// Checks that a history of puts, gets and deletes is linearizable against
+// a map from keys to values (absent until put). Linearizability is local,
+// so each key's operations are checked on their own, by num_threads
+// threads; a history is linearizable iff every key's is.
+//
+// Each key uses the Wing-Gong search with Lowe's memoization: operations
+// are linearized one at a time in any order consistent with real time
+// (one op precedes another only if it returned before the other was
+// invoked), backtracking when a read disagrees with the model, and never
+// revisiting a (set of linearized ops, value) configuration. Search cost
+// grows with the number of overlapping operations, not the history length.
+inline LinearizabilityResult CheckLinearizability(const std::vector<HistoryOp>& history,
+                                                  int num_threads = 1) {
+    std::map<std::string, std::vector<const HistoryOp*>> by_key;
+    for (const HistoryOp& op : history) by_key[op.key].push_back(&op);
+
+    std::vector<const std::vector<const HistoryOp*>*> partitions;
+    for (const auto& [key, ops] : by_key) partitions.push_back(&ops);
+
+    LinearizabilityResult result;
+    result.keys = partitions.size();
+    result.ops = history.size();
+
+    std::vector<std::string> messages(partitions.size());
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    auto work = [&] {
+        size_t i;
+        while (!failed.load(std::memory_order_relaxed) &&
+               (i = next.fetch_add(1, std::memory_order_relaxed)) < partitions.size()) {
+            if (!linearizability_internal::CheckKey(*partitions[i], &messages[i])) {
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t++) threads.emplace_back(work);
+    work();
+    for (auto& t : threads) t.join();
+
+    for (size_t i = 0; i < partitions.size(); i++) {
+        if (!messages[i].empty()) {
+            result.linearizable = false;
+            result.key = partitions[i]->front()->key;
+            result.message = messages[i];
+            break;
+        }
+    }
+    return result;
+}
+
+// Adapts the store under test to the map CheckLinearizability models
+struct HistoryTarget {
+    std::function<Status(Slice key, Slice value)> put;
+    std::function<Status(Slice key)> del;
+    std::function<Status(Slice key, std::string* value)> get;  // NotFound if absent
+};
+
+struct HistoryWorkloadOptions {
+    int threads = 4;
+    int ops_per_thread = 1000;
+    int num_keys = 4;             // Few keys, so operations on each overlap
+    double put_fraction = 0.4;
+    double delete_fraction = 0.1; // The rest are gets
+    uint64_t seed = 301;
+};
+
+// Run random puts, gets and deletes from several threads at once and
+// return their history. Every put writes a value no other put writes, so
+// each read names the write it saw. An operation that fails stays pending:
+// it may or may not have taken effect.
+inline std::vector<HistoryOp> RunHistoryWorkload(const HistoryTarget& target,
+                                                 const HistoryWorkloadOptions& options) {
+    HistoryRecorder recorder(options.threads);
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < options.threads; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 rng(options.seed + static_cast<uint64_t>(t));
+            std::uniform_real_distribution<double> coin(0.0, 1.0);
+            std::string value;
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (int i = 0; i < options.ops_per_thread; i++) {
+                std::string key = "k" + std::to_string(rng() % static_cast<uint64_t>(
+                                                          std::max(options.num_keys, 1)));
+                double r = coin(rng);
+                if (r < options.put_fraction) {
+                    std::string v = "t" + std::to_string(t) + "." + std::to_string(i);
+                    size_t index = recorder.Invoke(t, HistoryOpType::kPut, key, v);
+                    if (target.put(key, v).ok()) recorder.Return(t, index);
+                } else if (r < options.put_fraction + options.delete_fraction) {
+                    size_t index = recorder.Invoke(t, HistoryOpType::kDelete, key);
+                    if (target.del(key).ok()) recorder.Return(t, index);
+                } else {
+                    size_t index = recorder.Invoke(t, HistoryOpType::kGet, key);
+                    Status s = target.get(key, &value);
+                    if (s.ok()) {
+                        recorder.Return(t, index, true, value);
+                    } else if (s.IsNotFound()) {
+                        recorder.Return(t, index, false);
+                    }
+                }
+            }
+        });
+    }
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) t.join();
+    return recorder.History();
+}
+
+}  // namespace lsm
@@ -0,0 +1,139 @@
+// util/perf_context.h
+// Thread-local, per-operation counters and timers for latency debugging
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace lsm {
+
+// How much the current thread records into its PerfContext
+enum class PerfLevel : uint8_t {
+    kDisable,      // Nothing (the default)
+    kEnableCount,  // Counters only: no clock reads
+    kEnableTime,   // Counters and nanosecond timers
+};
+
+// What one thread's operations did, broken down by stage. Reset it before
+// the operation of interest and read it afterwards:
+//
+//   SetPerfLevel(PerfLevel::kEnableTime);
+//   GetPerfContext()->Reset();
+//   db->Get(ReadOptions(), key, &value);
+//   std::cout << GetPerfContext()->ToString(true);
+//
+// Work a write-group leader does on behalf of other writers (the WAL write
+// and sync, memtable inserts) is charged to the leader's thread.
+struct PerfContext {
+    // Memtables
+    uint64_t user_key_comparison_count = 0;  // Memtable skip list comparisons
+    uint64_t get_from_memtable_count = 0;    // Memtables searched by Get
+    uint64_t get_from_memtable_nanos = 0;
+    uint64_t memtable_key_range_miss_count = 0;  // Memtables skipped: key outside their range
+    uint64_t bloom_memtable_probe_count = 0;     // Memtable bloom filters checked
+    uint64_t bloom_memtable_miss_count = 0;      // ... that ruled the memtable out
+
+    // SSTables
+    uint64_t get_from_output_files_nanos = 0;  // Get time spent below the memtables
+    uint64_t bloom_sst_probe_count = 0;        // Table bloom filters checked
+    uint64_t bloom_sst_miss_count = 0;         // ... that ruled the table out
+    uint64_t block_cache_hit_count = 0;
+    uint64_t row_cache_hit_count = 0;          // Table lookups answered by the row cache
+    uint64_t row_cache_miss_count = 0;
+    uint64_t block_read_count = 0;             // Blocks read from files
+    uint64_t block_read_bytes = 0;
+    uint64_t block_read_nanos = 0;
+    uint64_t block_checksum_nanos = 0;         // CRC verification of blocks read
+
+    // Writes
+    uint64_t write_wait_nanos = 0;      // Queued behind another write group
+    uint64_t write_wal_nanos = 0;       // WAL append, with any sync the policy makes
+    uint64_t wal_sync_nanos = 0;
+    uint64_t write_memtable_nanos = 0;
+
+    void Reset() { *this = PerfContext(); }
+
+    // "name = value" pairs separated by ", "
+    std::string ToString(bool exclude_zero_counters = false) const {
+        std::string r;
+        auto add = [&](const char* name, uint64_t v) {
+            if (exclude_zero_counters && v == 0) return;
+            char buf[96];
+            std::snprintf(buf, sizeof(buf), "%s%s = %llu", r.empty() ? "" : ", ", name,
+                          static_cast<unsigned long long>(v));
+            r.append(buf);
+        };
+        add("user_key_comparison_count", user_key_comparison_count);
+        add("get_from_memtable_count", get_from_memtable_count);
+        add("get_from_memtable_nanos", get_from_memtable_nanos);
+        add("memtable_key_range_miss_count", memtable_key_range_miss_count);
+        add("bloom_memtable_probe_count", bloom_memtable_probe_count);
+        add("bloom_memtable_miss_count", bloom_memtable_miss_count);
+        add("get_from_output_files_nanos", get_from_output_files_nanos);
+        add("bloom_sst_probe_count", bloom_sst_probe_count);
+        add("bloom_sst_miss_count", bloom_sst_miss_count);
+        add("block_cache_hit_count", block_cache_hit_count);
+        add("row_cache_hit_count", row_cache_hit_count);
+        add("row_cache_miss_count", row_cache_miss_count);
+        add("block_read_count", block_read_count);
+        add("block_read_bytes", block_read_bytes);
+        add("block_read_nanos", block_read_nanos);
+        add("block_checksum_nanos", block_checksum_nanos);
+        add("write_wait_nanos", write_wait_nanos);
+        add("write_wal_nanos", write_wal_nanos);
+        add("wal_sync_nanos", wal_sync_nanos);
+        add("write_memtable_nanos", write_memtable_nanos);
+        return r;
+    }
+};
+
+namespace perf_internal {
+// Constant-initialized, so access needs no thread_local init guard
+inline thread_local PerfLevel level = PerfLevel::kDisable;
+inline thread_local PerfContext context;
+}  // namespace perf_internal
+
+inline void SetPerfLevel(PerfLevel level) { perf_internal::level = level; }
+inline PerfLevel GetPerfLevel() { return perf_internal::level; }
+
+// The calling thread's context
+inline PerfContext* GetPerfContext() { return &perf_internal::context; }
+
+// Add n to a counter of the calling thread's context, unless disabled
+inline void PerfCounterAdd(uint64_t PerfContext::*counter, uint64_t n = 1) {
+    if (perf_internal::level >= PerfLevel::kEnableCount) {
+        perf_internal::context.*counter += n;
+    }
+}
+
+// Adds the nanoseconds from construction to destruction (or Stop) to a
+// timer of the calling thread's context. Reads no clock below kEnableTime.
+class PerfTimer {
+public:
+    explicit PerfTimer(uint64_t PerfContext::*timer)
+        : timer_(perf_internal::level >= PerfLevel::kEnableTime ? timer : nullptr) {
+        if (timer_) start_ = std::chrono::steady_clock::now();
+    }
+
+    ~PerfTimer() { Stop(); }
+
+    PerfTimer(const PerfTimer&) = delete;
+    PerfTimer& operator=(const PerfTimer&) = delete;
+
+    void Stop() {
+        if (!timer_) return;
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        if (elapsed > 0) perf_internal::context.*timer_ += static_cast<uint64_t>(elapsed);
+        timer_ = nullptr;
+    }
+
+private:
+    uint64_t PerfContext::*timer_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace lsm
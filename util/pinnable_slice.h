@@ -0,0 +1,97 @@
+// util/pinnable_slice.h
+// Read result that can point into engine-owned memory without copying
+
+#pragma once
+
+#include "util/types.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+
+namespace lsm {
+
+// PinnableSlice holds a Get result. Either:
+//  - pinned: data() points into memory owned elsewhere (a memtable entry or
+//    a cached block) and the slice holds a reference that keeps that memory
+//    alive until Reset() or destruction, or
+//  - self-backed: the value was copied into the slice's own buffer.
+//
+// Pinned values cost no copy, but hold their owner (a whole memtable or
+// block) in memory; Reset() them once the value is no longer needed.
+class PinnableSlice {
+public:
+    PinnableSlice() = default;
+    ~PinnableSlice() { Reset(); }
+
+    PinnableSlice(const PinnableSlice&) = delete;
+    PinnableSlice& operator=(const PinnableSlice&) = delete;
+
+    PinnableSlice(PinnableSlice&& other) noexcept { MoveFrom(std::move(other)); }
+
+    PinnableSlice& operator=(PinnableSlice&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            MoveFrom(std::move(other));
+        }
+        return *this;
+    }
+
+    // Point at s; release runs when this slice lets go of it
+    void PinSlice(Slice s, std::function<void()> release) {
+        Reset();
+        data_ = s;
+        release_ = std::move(release);
+        pinned_ = true;
+    }
+
+    // Copy s into the slice's own buffer
+    void PinSelf(Slice s) {
+        Reset();
+        buf_.assign(s.data(), s.size());
+        data_ = buf_;
+    }
+
+    void Reset() {
+        if (release_) {
+            std::function<void()> release = std::move(release_);
+            release_ = nullptr;
+            release();
+        }
+        pinned_ = false;
+        data_ = Slice();
+    }
+
+    bool IsPinned() const { return pinned_; }
+
+    const char* data() const { return data_.data(); }
+    size_t size() const { return data_.size(); }
+    bool empty() const { return data_.empty(); }
+
+    Slice slice() const { return data_; }
+    operator Slice() const { return data_; }
+    std::string ToString() const { return std::string(data_); }
+
+private:
+    void MoveFrom(PinnableSlice&& other) {
+        pinned_ = other.pinned_;
+        release_ = std::move(other.release_);
+        other.release_ = nullptr;
+        if (pinned_) {
+            data_ = other.data_;
+        } else {
+            // The buffer may be small-string-optimized; re-point at our copy
+            buf_ = std::move(other.buf_);
+            data_ = Slice(buf_.data(), other.data_.size());
+        }
+        other.pinned_ = false;
+        other.data_ = Slice();
+    }
+
+    Slice data_;
+    std::string buf_;
+    std::function<void()> release_;
+    bool pinned_ = false;
+};
+
+}  // namespace lsm
@@ -0,0 +1,348 @@
+// util/statistics.h
+// DB-wide tickers and latency histograms, cheap enough to leave on
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lsm {
+
+// Event counters. Append new tickers before kTickerCount and name them in
+// TickerName.
+enum Ticker : uint32_t {
+    kNumberKeysWritten,
+    kBytesWritten,          // Key + value bytes of writes
+    kNumberKeysRead,
+    kNumberKeysFound,
+    kBytesRead,             // Value bytes returned by Get
+    kMemtableHit,
+    kMemtableMiss,
+    kWalWrites,             // Write groups appended to the WAL
+    kWalBytes,
+    kWalSyncs,
+    kStallMicros,           // Writers waiting on flushes or L0 compaction
+    kFlushCount,
+    kFlushBytes,
+    kCompactionCount,
+    kCompactionBytesRead,
+    kCompactionBytesWritten,
+    kCompactionKeysDropped,
+    kTickerCount
+};
+
+// Latency histograms, recorded in nanoseconds
+enum HistogramType : uint32_t {
+    kDbGet,
+    kDbWrite,               // Put/Delete, including queueing behind the group leader
+    kWalAppend,
+    kWalSync,
+    kFlushTime,
+    kCompactionTime,
+    kHistogramCount
+};
+
+inline const char* TickerName(Ticker t) {
+    static const char* const kNames[kTickerCount] = {
+        "lsm.keys.written",
+        "lsm.bytes.written",
+        "lsm.keys.read",
+        "lsm.keys.found",
+        "lsm.bytes.read",
+        "lsm.memtable.hit",
+        "lsm.memtable.miss",
+        "lsm.wal.writes",
+        "lsm.wal.bytes",
+        "lsm.wal.syncs",
+        "lsm.stall.micros",
+        "lsm.flush.count",
+        "lsm.flush.bytes",
+        "lsm.compaction.count",
+        "lsm.compaction.bytes.read",
+        "lsm.compaction.bytes.written",
+        "lsm.compaction.keys.dropped",
+    };
+    return t < kTickerCount ? kNames[t] : "unknown";
+}
+
+inline const char* HistogramName(HistogramType h) {
+    static const char* const kNames[kHistogramCount] = {
+        "lsm.db.get.nanos",
+        "lsm.db.write.nanos",
+        "lsm.wal.append.nanos",
+        "lsm.wal.sync.nanos",
+        "lsm.flush.nanos",
+        "lsm.compaction.nanos",
+    };
+    return h < kHistogramCount ? kNames[h] : "unknown";
+}
+
+// Log-linear buckets in the style of HdrHistogram: values below 16 get a
+// bucket each; above, every power of two is split into 16 equal buckets,
+// so a bucket is at most 1/16 of its values wide. Indexing is a few
+// instructions (no search), and values up to 2^40 (about 18 minutes in
+// nanoseconds) are covered; larger ones land in the last bucket.
+struct HistogramBuckets {
+    static constexpr int kSubBits = 4;
+    static constexpr uint64_t kSubCount = 1 << kSubBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr size_t kNumBuckets = kSubCount + (kMaxExponent - kSubBits) * kSubCount;
+
+    static size_t Index(uint64_t v) {
+        if (v < kSubCount) return static_cast<size_t>(v);
+        int e = 63 - __builtin_clzll(v);  // e >= kSubBits
+        if (e >= kMaxExponent) return kNumBuckets - 1;
+        uint64_t sub = (v >> (e - kSubBits)) & (kSubCount - 1);
+        return static_cast<size_t>(kSubCount + (e - kSubBits) * kSubCount + sub);
+    }
+
+    // Smallest value in bucket i
+    static uint64_t LowerBound(size_t i) {
+        if (i < kSubCount) return i;
+        size_t e = (i - kSubCount) / kSubCount + kSubBits;
+        uint64_t sub = (i - kSubCount) % kSubCount;
+        return (uint64_t{1} << e) + (sub << (e - kSubBits));
+    }
+};
+
+// Merged, point-in-time view of a histogram
+class HistogramSnapshot {
+public:
+    HistogramSnapshot() : buckets_(HistogramBuckets::kNumBuckets, 0) {}
+
+    uint64_t Count() const { return count_; }
+    uint64_t Sum() const { return sum_; }
+    uint64_t Min() const { return count_ == 0 ? 0 : min_; }
+    uint64_t Max() const { return max_; }
+    double Average() const {
+        return count_ == 0 ? 0 : static_cast<double>(sum_) / static_cast<double>(count_);
+    }
+
+    // Estimated value below which p percent of the samples fall,
+    // interpolated inside the bucket holding the rank
+    double Percentile(double p) const {
+        if (count_ == 0) return 0;
+        double threshold = static_cast<double>(count_) * (p / 100.0);
+        double cumulative = 0;
+        for (size_t b = 0; b < buckets_.size(); b++) {
+            if (buckets_[b] == 0) continue;
+            double in_bucket = static_cast<double>(buckets_[b]);
+            if (cumulative + in_bucket >= threshold) {
+                double lo = static_cast<double>(HistogramBuckets::LowerBound(b));
+                double hi = b + 1 < buckets_.size()
+                                ? static_cast<double>(HistogramBuckets::LowerBound(b + 1))
+                                : static_cast<double>(max_);
+                double r = lo + (hi - lo) * ((threshold - cumulative) / in_bucket);
+                return std::clamp(r, static_cast<double>(Min()), static_cast<double>(max_));
+            }
+            cumulative += in_bucket;
+        }
+        return static_cast<double>(max_);
+    }
+
+private:
+    friend class AtomicHistogram;
+
+    std::vector<uint64_t> buckets_;
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+};
+
+// Lock-free histogram: recording is a few relaxed atomic adds
+class AtomicHistogram {
+public:
+    AtomicHistogram() { Clear(); }
+
+    void Add(uint64_t v) {
+        buckets_[HistogramBuckets::Index(v)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(v, std::memory_order_relaxed);
+        uint64_t cur = min_.load(std::memory_order_relaxed);
+        while (v < cur && !min_.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+        }
+        cur = max_.load(std::memory_order_relaxed);
+        while (v > cur && !max_.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Add this histogram's samples to *out. Samples recorded concurrently
+    // may be partly counted.
+    void MergeInto(HistogramSnapshot* out) const {
+        for (size_t b = 0; b < HistogramBuckets::kNumBuckets; b++) {
+            out->buckets_[b] += buckets_[b].load(std::memory_order_relaxed);
+        }
+        out->count_ += count_.load(std::memory_order_relaxed);
+        out->sum_ += sum_.load(std::memory_order_relaxed);
+        out->min_ = std::min(out->min_, min_.load(std::memory_order_relaxed));
+        out->max_ = std::max(out->max_, max_.load(std::memory_order_relaxed));
+    }
+
+    void Clear() {
+        for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[HistogramBuckets::kNumBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+};
+
+enum class StatsLevel {
+    kExceptTimers,  // Tickers only: no clock reads on the hot paths
+    kAll,           // Tickers and latency histograms
+};
+
+// Collects tickers and histograms from every thread of a DB (set
+// Options::statistics); one object may be shared by several DBs.
+//
+// Counters are spread over cache-line-aligned shards, and each thread
+// records into one shard chosen when it first records, so threads rarely
+// touch the same lines and recording takes no locks. Reads sum the shards.
+class Statistics {
+public:
+    explicit Statistics(StatsLevel level = StatsLevel::kAll)
+        : level_(level), shards_(NumShards()) {}
+
+    Statistics(const Statistics&) = delete;
+    Statistics& operator=(const Statistics&) = delete;
+
+    StatsLevel level() const { return level_.load(std::memory_order_relaxed); }
+    void set_level(StatsLevel level) { level_.store(level, std::memory_order_relaxed); }
+    bool TimersEnabled() const { return level() == StatsLevel::kAll; }
+
+    void RecordTick(Ticker t, uint64_t n = 1) {
+        MyShard().tickers[t].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void RecordInHistogram(HistogramType h, uint64_t nanos) {
+        MyShard().histograms[h].Add(nanos);
+    }
+
+    uint64_t GetTickerCount(Ticker t) const {
+        uint64_t sum = 0;
+        for (const Shard& s : shards_) sum += s.tickers[t].load(std::memory_order_relaxed);
+        return sum;
+    }
+
+    HistogramSnapshot GetHistogram(HistogramType h) const {
+        HistogramSnapshot snapshot;
+        for (const Shard& s : shards_) s.histograms[h].MergeInto(&snapshot);
+        return snapshot;
+    }
+
+    // Zero everything. Samples recorded concurrently may survive.
+    void Reset() {
+        for (Shard& s : shards_) {
+            for (auto& t : s.tickers) t.store(0, std::memory_order_relaxed);
+            for (auto& h : s.histograms) h.Clear();
+        }
+    }
+
+    // One line per ticker, then count, average and percentiles (in
+    // nanoseconds, as the names say) of every non-empty histogram
+    std::string ToString() const {
+        std::string r;
+        char buf[256];
+        for (uint32_t t = 0; t < kTickerCount; t++) {
+            std::snprintf(buf, sizeof(buf), "%s COUNT : %llu\n",
+                          TickerName(static_cast<Ticker>(t)),
+                          static_cast<unsigned long long>(GetTickerCount(static_cast<Ticker>(t))));
+            r.append(buf);
+        }
+        for (uint32_t h = 0; h < kHistogramCount; h++) {
+            HistogramSnapshot s = GetHistogram(static_cast<HistogramType>(h));
+            if (s.Count() == 0) continue;
+            std::snprintf(buf, sizeof(buf),
+                          "%s P50 : %.0f P99 : %.0f P99.9 : %.0f MAX : %llu"
+                          " AVG : %.0f COUNT : %llu\n",
+                          HistogramName(static_cast<HistogramType>(h)),
+                          s.Percentile(50), s.Percentile(99), s.Percentile(99.9),
+                          static_cast<unsigned long long>(s.Max()), s.Average(),
+                          static_cast<unsigned long long>(s.Count()));
+            r.append(buf);
+        }
+        return r;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> tickers[kTickerCount] = {};
+        AtomicHistogram histograms[kHistogramCount];
+    };
+
+    // Enough shards that concurrent threads rarely share one; a power of two
+    static size_t NumShards() {
+        size_t cpus = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        size_t n = 4;
+        while (n < cpus && n < 32) n *= 2;
+        return n;
+    }
+
+    Shard& MyShard() {
+        static std::atomic<uint32_t> next_thread{0};
+        thread_local uint32_t thread_index = next_thread.fetch_add(1, std::memory_order_relaxed);
+        return shards_[thread_index & (shards_.size() - 1)];
+    }
+
+    std::atomic<StatsLevel> level_;
+    std::vector<Shard> shards_;
+};
+
+// Records the time from construction to destruction (or Stop) into a
+// histogram. Does nothing, not even read the clock, without statistics or
+// when timers are off.
+class StopWatch {
+public:
+    StopWatch(Statistics* statistics, HistogramType histogram)
+        : statistics_(statistics && statistics->TimersEnabled() ? statistics : nullptr),
+          histogram_(histogram) {
+        if (statistics_) start_ = std::chrono::steady_clock::now();
+    }
+
+    ~StopWatch() { Stop(); }
+
+    StopWatch(const StopWatch&) = delete;
+    StopWatch& operator=(const StopWatch&) = delete;
+
+    // Record now; returns the elapsed nanoseconds (0 when not timing)
+    uint64_t Stop() {
+        if (!statistics_) return 0;
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        uint64_t nanos = static_cast<uint64_t>(std::max<int64_t>(elapsed, 0));
+        statistics_->RecordInHistogram(histogram_, nanos);
+        statistics_ = nullptr;
+        return nanos;
+    }
+
+private:
+    Statistics* statistics_;
+    HistogramType histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline void RecordTick(Statistics* statistics, Ticker t, uint64_t n = 1) {
+    if (statistics) statistics->RecordTick(t, n);
+}
+
+inline std::shared_ptr<Statistics> CreateDBStatistics(StatsLevel level = StatsLevel::kAll) {
+    return std::make_shared<Statistics>(level);
+}
+
+}  // namespace lsm
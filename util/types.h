@@ -24,6 +24,7 @@ using Slice = std::string_view;
 enum class ValueType : uint8_t {
     kValue = 0x01,      // Regular key-value entry
     kDeletion = 0x02,   // Tombstone marker
+    kBlobIndex = 0x03,  // Reference to a value stored in a blob file
 };
 
 // Internal key format: user_key + sequence_number + value_type
@@ -70,6 +71,14 @@ struct LookupResult {
     }
 };
 
+// Outcome of a point lookup in a single memtable or table
+enum class GetState : uint8_t {
+    kNotFound,  // No entry for the key; keep searching older data
+    kFound,     // Live value found
+    kDeleted,   // Tombstone found; the key is absent
+    kBlobIndex, // Live entry whose value is a reference into a blob file
+};
+
 // Status codes for operations
 enum class StatusCode {
     kOk = 0,
@@ -101,11 +110,19 @@ public:
     static Status MemoryLimit(std::string msg = "") {
         return Status(StatusCode::kMemoryLimit, std::move(msg));
     }
+    static Status NotSupported(std::string msg = "") {
+        return Status(StatusCode::kNotSupported, std::move(msg));
+    }
+    static Status InvalidArgument(std::string msg = "") {
+        return Status(StatusCode::kInvalidArgument, std::move(msg));
+    }
 
     bool ok() const { return code_ == StatusCode::kOk; }
     bool IsNotFound() const { return code_ == StatusCode::kNotFound; }
     bool IsCorruption() const { return code_ == StatusCode::kCorruption; }
     bool IsMemoryLimit() const { return code_ == StatusCode::kMemoryLimit; }
+    bool IsIOError() const { return code_ == StatusCode::kIOError; }
+    bool IsInvalidArgument() const { return code_ == StatusCode::kInvalidArgument; }
 
     StatusCode code() const { return code_; }
     const std::string& message() const { return message_; }
@@ -127,11 +144,49 @@ private:
     std::string message_;
 };
 
+class WriteBufferManager;  // db/write_buffer_manager.h
+
 // Configuration for memtable behavior
 struct MemTableOptions {
     size_t max_size = 4 * 1024 * 1024;  // 4MB default
     int max_height = 12;
     int branching_factor = 4;
+
+    // Size of the memtable's bloom filter over user keys, which lets Get
+    // skip the skip list search for most absent keys (0 = no filter)
+    size_t bloom_bits = 0;
+
+    // Told of the memtable's memory as it grows and when it is freed
+    // (null = none); not owned
+    WriteBufferManager* write_buffer_manager = nullptr;
+};
+
+// Options controlling a single read or scan
+struct ReadOptions {
+    // Verify block checksums on every block read
+    bool verify_checksums = true;
+
+    // Readahead for iterators over SSTables. 0 = auto-tune: start readahead
+    // once sequential block reads are detected and double it up to a cap.
+    // Non-zero = always read this many bytes ahead on a buffer miss.
+    size_t readahead_size = 0;
+
+    // Read as of this sequence number (see DB::GetSnapshot); the default
+    // reads the latest committed data
+    SequenceNumber snapshot = kMaxSequenceNumber;
+
+    // Optional iterator bounds on user keys: [lower, upper). Files and
+    // blocks entirely outside the range are never read.
+    std::optional<std::string> iterate_lower_bound;
+    std::optional<std::string> iterate_upper_bound;
+
+    bool BelowLowerBound(Slice user_key) const {
+        return iterate_lower_bound && user_key < Slice(*iterate_lower_bound);
+    }
+
+    bool AtOrAboveUpperBound(Slice user_key) const {
+        return iterate_upper_bound && user_key >= Slice(*iterate_upper_bound);
+    }
 };
 
 // Statistics for monitoring
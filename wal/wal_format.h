@@ -19,7 +19,7 @@ namespace wal {
 // └─────────┴─────────┴──────────┴──────────┘
 
 constexpr size_t kHeaderSize = 4 + 2 + 1;  // CRC + Length + Type
-constexpr size_t kMaxRecordSize = 65535;   // Max payload size (16-bit length)
+constexpr size_t kMaxRecordSize = 65535;   // Max payload per record; larger ones are fragmented
 constexpr uint32_t kWALMagic = 0x574C4F47; // "WLOG"
 
 // Record types
@@ -35,6 +35,8 @@ enum class RecordType : uint8_t {
 enum class WALEntryType : uint8_t {
     kPut = 1,
     kDelete = 2,
+    kColumnFamilyPut = 3,     // Put into a non-default column family
+    kColumnFamilyDelete = 4,  // Delete from a non-default column family
 };
 
 // A single WAL entry representing a write operation
@@ -43,10 +45,21 @@ struct WALEntry {
     SequenceNumber sequence;
     std::string key;
     std::string value;  // Empty for deletes
+    uint32_t column_family = 0;
+
+    bool IsPut() const {
+        return type == WALEntryType::kPut || type == WALEntryType::kColumnFamilyPut;
+    }
+
+    bool IsDelete() const {
+        return type == WALEntryType::kDelete || type == WALEntryType::kColumnFamilyDelete;
+    }
 
     size_t EncodedSize() const {
-        // type(1) + sequence(8) + key_len(4) + key + value_len(4) + value
-        return 1 + 8 + 4 + key.size() + 4 + value.size();
+        // type(1) + [column_family(4)] + sequence(8) + key_len(4) + key
+        //   + value_len(4) + value
+        size_t cf_size = column_family != 0 ? 4 : 0;
+        return 1 + cf_size + 8 + 4 + key.size() + 4 + value.size();
     }
 };
 
@@ -219,11 +232,20 @@ private:
     size_t pos_;
 };
 
-// Encode a WAL entry to string
+// Encode a WAL entry to string. Entries for the default column family keep
+// the original layout; others use the column family types, which carry
+// the family id after the type byte.
 inline std::string EncodeWALEntry(const WALEntry& entry) {
     std::string result;
     Encoder enc(&result);
-    enc.PutByte(static_cast<uint8_t>(entry.type));
+    if (entry.column_family == 0) {
+        enc.PutByte(static_cast<uint8_t>(entry.IsPut() ? WALEntryType::kPut
+                                                       : WALEntryType::kDelete));
+    } else {
+        enc.PutByte(static_cast<uint8_t>(entry.IsPut() ? WALEntryType::kColumnFamilyPut
+                                                       : WALEntryType::kColumnFamilyDelete));
+        enc.PutFixed32(entry.column_family);
+    }
     enc.PutFixed64(entry.sequence);
     enc.PutLengthPrefixed(entry.key);
     enc.PutLengthPrefixed(entry.value);
@@ -236,6 +258,11 @@ inline bool DecodeWALEntry(Slice data, WALEntry* entry) {
     uint8_t type;
     if (!dec.GetByte(&type)) return false;
     entry->type = static_cast<WALEntryType>(type);
+    entry->column_family = 0;
+    if (entry->type == WALEntryType::kColumnFamilyPut ||
+        entry->type == WALEntryType::kColumnFamilyDelete) {
+        if (!dec.GetFixed32(&entry->column_family)) return false;
+    }
     if (!dec.GetFixed64(&entry->sequence)) return false;
     if (!dec.GetLengthPrefixed(&entry->key)) return false;
     if (!dec.GetLengthPrefixed(&entry->value)) return false;
@@ -9,11 +9,11 @@
 #include "wal/wal_reader.h"
 #include "db/memtable.h"
 
-#include <dirent.h>
-#include <sys/stat.h>
 #include <cstdio>
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -41,14 +41,12 @@ public:
         std::lock_guard<std::mutex> lock(mutex_);
 
         // Create WAL directory
-        std::string wal_dir = WalDir();
-        if (::mkdir(wal_dir.c_str(), 0755) != 0 && errno != EEXIST) {
-            return Status::IOError("Failed to create WAL directory");
-        }
+        Status s = options_.env->CreateDirIfMissing(WalDir());
+        if (!s.ok()) return s;
 
         // Find existing WAL files
         std::vector<uint64_t> log_numbers;
-        Status s = ListLogFiles(&log_numbers);
+        s = ListLogFiles(&log_numbers);
         if (!s.ok()) return s;
 
         // Set current log number
@@ -82,19 +80,44 @@ public:
             if (!s.ok()) return s;
         }
 
-        return current_writer_->Append(entry);
+        size_t before = current_writer_->FileSize();
+        Status s = current_writer_->Append(entry);
+        bytes_written_.fetch_add(current_writer_->FileSize() - before, std::memory_order_relaxed);
+        return s;
     }
 
-    Status AppendPut(SequenceNumber seq, Slice key, Slice value) {
-        WALEntry entry{WALEntryType::kPut, seq, std::string(key), std::string(value)};
+    Status AppendPut(SequenceNumber seq, Slice key, Slice value,
+                     uint32_t column_family = 0) {
+        WALEntry entry{WALEntryType::kPut, seq, std::string(key), std::string(value),
+                       column_family};
         return Append(entry);
     }
 
-    Status AppendDelete(SequenceNumber seq, Slice key) {
-        WALEntry entry{WALEntryType::kDelete, seq, std::string(key), {}};
+    Status AppendDelete(SequenceNumber seq, Slice key, uint32_t column_family = 0) {
+        WALEntry entry{WALEntryType::kDelete, seq, std::string(key), {}, column_family};
         return Append(entry);
     }
 
+    // Append entries with a single write and sync (group commit). The
+    // batch never straddles two log files.
+    Status AppendBatch(const std::vector<WALEntry>& entries) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!current_writer_) {
+            return Status::IOError("WAL not open");
+        }
+
+        if (current_writer_->ShouldRotate()) {
+            Status s = RotateLocked();
+            if (!s.ok()) return s;
+        }
+
+        size_t before = current_writer_->FileSize();
+        Status s = current_writer_->AppendBatch(entries);
+        bytes_written_.fetch_add(current_writer_->FileSize() - before, std::memory_order_relaxed);
+        return s;
+    }
+
     // Force sync
     Status Sync() {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -110,8 +133,28 @@ public:
         return RotateLocked();
     }
 
-    // Recover memtable from WAL files
-    Status Recover(MemTable* memtable, RecoveryStats* stats = nullptr) {
+    // Recover memtable from WAL files. Logs numbered below min_log_number
+    // hold only data that is already persisted elsewhere and are skipped.
+    // Entries of every column family are applied.
+    Status Recover(MemTable* memtable, RecoveryStats* stats = nullptr,
+                   uint64_t min_log_number = 0) {
+        return Recover(
+            [memtable](uint64_t /*log_number*/, const WALEntry& entry) {
+                if (entry.IsPut()) {
+                    memtable->Put(entry.sequence, entry.key, entry.value);
+                } else {
+                    memtable->Delete(entry.sequence, entry.key);
+                }
+            },
+            stats, min_log_number);
+    }
+
+    // Replay WAL entries in order, passing each with the number of the log
+    // holding it (so callers can skip entries already flushed)
+    using EntryHandler = std::function<void(uint64_t log_number, const WALEntry& entry)>;
+
+    Status Recover(const EntryHandler& handler, RecoveryStats* stats = nullptr,
+                   uint64_t min_log_number = 0) {
         std::lock_guard<std::mutex> lock(mutex_);
 
         auto start = std::chrono::high_resolution_clock::now();
@@ -124,8 +167,11 @@ public:
 
         // Replay each log in order
         for (uint64_t log_num : log_numbers) {
+            if (log_num < min_log_number) {
+                continue;
+            }
             std::string path = LogPath(log_num);
-            WALReader reader(path);
+            WALReader reader(path, options_.env);
 
             s = reader.Open();
             if (!s.ok()) {
@@ -138,11 +184,11 @@ public:
             while (reader.ReadEntry(&entry, &read_status)) {
                 local_stats.records_read++;
 
-                if (entry.type == WALEntryType::kPut) {
-                    memtable->Put(entry.sequence, entry.key, entry.value);
+                if (entry.IsPut()) {
+                    handler(log_num, entry);
                     local_stats.puts_recovered++;
-                } else if (entry.type == WALEntryType::kDelete) {
-                    memtable->Delete(entry.sequence, entry.key);
+                } else if (entry.IsDelete()) {
+                    handler(log_num, entry);
                     local_stats.deletes_recovered++;
                 }
 
@@ -181,15 +227,17 @@ public:
         for (uint64_t log_num : log_numbers) {
             if (log_num < flushed_log_number) {
                 std::string path = LogPath(log_num);
-                if (::unlink(path.c_str()) != 0 && errno != ENOENT) {
-                    return Status::IOError("Failed to delete old WAL: " + path);
-                }
+                s = options_.env->DeleteFile(path);
+                if (!s.ok() && !s.IsNotFound()) return s;
             }
         }
 
         return Status::OK();
     }
 
+    // Bytes appended to the logs since this manager was created
+    uint64_t BytesWritten() const { return bytes_written_.load(std::memory_order_relaxed); }
+
     // Get current log number
     uint64_t CurrentLogNumber() const {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -216,23 +264,20 @@ private:
     Status ListLogFiles(std::vector<uint64_t>* numbers) const {
         numbers->clear();
 
-        DIR* dir = ::opendir(WalDir().c_str());
-        if (dir == nullptr) {
-            if (errno == ENOENT) {
-                return Status::OK();  // No WAL dir yet
-            }
-            return Status::IOError("Failed to open WAL directory");
+        std::vector<std::string> children;
+        Status s = options_.env->GetChildren(WalDir(), &children);
+        if (s.IsNotFound()) {
+            return Status::OK();  // No WAL dir yet
         }
+        if (!s.ok()) return s;
 
         std::regex log_pattern("log\\.(\\d{6})");
-        struct dirent* entry;
-        while ((entry = ::readdir(dir)) != nullptr) {
-            std::cmatch match;
-            if (std::regex_match(entry->d_name, match, log_pattern)) {
+        for (const std::string& name : children) {
+            std::smatch match;
+            if (std::regex_match(name, match, log_pattern)) {
                 numbers->push_back(std::stoull(match[1].str()));
             }
         }
-        ::closedir(dir);
 
         std::sort(numbers->begin(), numbers->end());
         return Status::OK();
@@ -248,7 +293,10 @@ private:
 
     Status RotateLocked() {
         if (current_writer_) {
-            current_writer_->Sync();
+            // Later writes go to the new log, so the old one must be durable
+            // first: a crash must not keep those and lose these
+            Status s = current_writer_->Sync();
+            if (!s.ok()) return s;
             current_writer_->Close();
         }
         return OpenNewLog();
@@ -260,6 +308,7 @@ private:
     mutable std::mutex mutex_;
     uint64_t current_log_number_;
     std::unique_ptr<WALWriter> current_writer_;
+    std::atomic<uint64_t> bytes_written_{0};
 };
 
 }  // namespace wal
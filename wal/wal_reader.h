@@ -4,13 +4,9 @@
 #pragma once
 
 #include "util/types.h"
+#include "util/env.h"
 #include "wal/wal_format.h"
 
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/stat.h>
-#include <sys/mman.h>
-
 #include <string>
 #include <vector>
 #include <functional>
@@ -37,8 +33,8 @@ struct ReadResult {
 
 class WALReader {
 public:
-    explicit WALReader(const std::string& path)
-        : path_(path), fd_(-1), data_(nullptr), size_(0), pos_(0) {}
+    explicit WALReader(const std::string& path, Env* env = Env::Default())
+        : path_(path), env_(env), data_(nullptr), size_(0), pos_(0) {}
 
     ~WALReader() {
         Close();
@@ -47,99 +43,64 @@ public:
     WALReader(const WALReader&) = delete;
     WALReader& operator=(const WALReader&) = delete;
 
+    // Read the whole log; records are parsed from memory
     Status Open() {
-        fd_ = ::open(path_.c_str(), O_RDONLY);
-        if (fd_ < 0) {
-            return Status::IOError("Failed to open WAL for reading: " + path_);
-        }
-
-        struct stat st;
-        if (::fstat(fd_, &st) != 0) {
+        Status s = ReadFileToString(env_, path_, &contents_);
+        if (!s.ok()) {
             Close();
-            return Status::IOError("Failed to stat WAL file");
-        }
-        size_ = st.st_size;
-
-        if (size_ == 0) {
-            return Status::OK();  // Empty file is valid
+            return Status::IOError("Failed to read WAL: " + path_);
         }
-
-        // Memory map the file for efficient reading
-        data_ = static_cast<char*>(
-            ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0));
-        if (data_ == MAP_FAILED) {
-            data_ = nullptr;
-            Close();
-            return Status::IOError("Failed to mmap WAL file");
-        }
-
-        // Advise sequential access
-        ::madvise(data_, size_, MADV_SEQUENTIAL);
-
+        data_ = contents_.data();
+        size_ = contents_.size();
         return Status::OK();
     }
 
     void Close() {
-        if (data_ != nullptr) {
-            ::munmap(data_, size_);
-            data_ = nullptr;
-        }
-        if (fd_ >= 0) {
-            ::close(fd_);
-            fd_ = -1;
-        }
+        contents_.clear();
+        contents_.shrink_to_fit();
+        data_ = nullptr;
         size_ = 0;
         pos_ = 0;
     }
 
-    // Read next record
+    // Read next record, reassembling fragmented ones
     ReadResult ReadRecord() {
-        if (data_ == nullptr || pos_ >= size_) {
-            return ReadResult::Eof();
-        }
-
-        // Need at least header
-        if (pos_ + kHeaderSize > size_) {
-            return ReadResult::Error(Status::Corruption("Truncated record header"));
-        }
-
-        // Parse header
-        const char* header = data_ + pos_;
-
-        uint32_t stored_crc = static_cast<uint8_t>(header[0]) |
-                              (static_cast<uint8_t>(header[1]) << 8) |
-                              (static_cast<uint8_t>(header[2]) << 16) |
-                              (static_cast<uint8_t>(header[3]) << 24);
-
-        uint16_t length = static_cast<uint8_t>(header[4]) |
-                          (static_cast<uint8_t>(header[5]) << 8);
-
-        RecordType type = static_cast<RecordType>(header[6]);
-
-        // Validate length
-        if (pos_ + kHeaderSize + length > size_) {
-            return ReadResult::Error(Status::Corruption("Truncated record payload"));
-        }
-
-        // Verify CRC
-        uint32_t computed_crc = CRC32::Compute(header + 6, 1 + length);
-        computed_crc = CRC32::Update(computed_crc ^ 0xFFFFFFFF, header + 4, 2) ^ 0xFFFFFFFF;
-
-        if (stored_crc != computed_crc) {
-            return ReadResult::Error(Status::Corruption("CRC mismatch in WAL record"));
-        }
+        std::string payload;
+        bool in_fragmented_record = false;
+        while (true) {
+            if (data_ == nullptr || pos_ >= size_) {
+                if (in_fragmented_record) {
+                    return ReadResult::Error(Status::Corruption("Truncated fragmented record"));
+                }
+                return ReadResult::Eof();
+            }
 
-        // Validate type
-        if (type != RecordType::kFull) {
-            // For now, only support full records
-            return ReadResult::Error(Status::Corruption("Unsupported record type"));
+            RecordType type = RecordType::kZero;
+            const char* fragment = nullptr;
+            uint16_t length = 0;
+            Status s = ReadFragment(&type, &fragment, &length);
+            if (!s.ok()) return ReadResult::Error(s);
+
+            switch (type) {
+                case RecordType::kFull:
+                    if (in_fragmented_record) break;
+                    return ReadResult::OK(std::string(fragment, length));
+                case RecordType::kFirst:
+                    if (in_fragmented_record) break;
+                    payload.assign(fragment, length);
+                    in_fragmented_record = true;
+                    continue;
+                case RecordType::kMiddle:
+                case RecordType::kLast:
+                    if (!in_fragmented_record) break;
+                    payload.append(fragment, length);
+                    if (type == RecordType::kLast) return ReadResult::OK(std::move(payload));
+                    continue;
+                default:
+                    return ReadResult::Error(Status::Corruption("Unsupported record type"));
+            }
+            return ReadResult::Error(Status::Corruption("Fragment out of sequence"));
         }
-
-        // Extract payload
-        std::string payload(header + kHeaderSize, length);
-        pos_ += kHeaderSize + length;
-
-        return ReadResult::OK(std::move(payload));
     }
 
     // Read and decode next entry
@@ -196,9 +157,48 @@ public:
     bool AtEnd() const { return pos_ >= size_; }
 
 private:
+    // Read and verify the next physical record (one fragment)
+    Status ReadFragment(RecordType* type, const char** fragment, uint16_t* length) {
+        // Need at least header
+        if (pos_ + kHeaderSize > size_) {
+            return Status::Corruption("Truncated record header");
+        }
+
+        // Parse header
+        const char* header = data_ + pos_;
+
+        uint32_t stored_crc = static_cast<uint8_t>(header[0]) |
+                              (static_cast<uint8_t>(header[1]) << 8) |
+                              (static_cast<uint8_t>(header[2]) << 16) |
+                              (static_cast<uint8_t>(header[3]) << 24);
+
+        *length = static_cast<uint16_t>(static_cast<uint8_t>(header[4]) |
+                                        (static_cast<uint8_t>(header[5]) << 8));
+
+        *type = static_cast<RecordType>(header[6]);
+
+        // Validate length
+        if (pos_ + kHeaderSize + *length > size_) {
+            return Status::Corruption("Truncated record payload");
+        }
+
+        // Verify CRC
+        uint32_t computed_crc = CRC32::Compute(header + 6, 1 + *length);
+        computed_crc = CRC32::Update(computed_crc ^ 0xFFFFFFFF, header + 4, 2) ^ 0xFFFFFFFF;
+
+        if (stored_crc != computed_crc) {
+            return Status::Corruption("CRC mismatch in WAL record");
+        }
+
+        *fragment = header + kHeaderSize;
+        pos_ += kHeaderSize + *length;
+        return Status::OK();
+    }
+
     std::string path_;
-    int fd_;
-    char* data_;
+    Env* env_;
+    std::string contents_;
+    const char* data_;
     size_t size_;
     size_t pos_;
 };
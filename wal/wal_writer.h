@@ -4,12 +4,12 @@
 #pragma once
 
 #include "util/types.h"
+#include "util/env.h"
+#include "util/perf_context.h"
+#include "util/statistics.h"
 #include "wal/wal_format.h"
 
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/stat.h>
-
+#include <algorithm>
 #include <atomic>
 #include <mutex>
 #include <string>
@@ -34,6 +34,8 @@ struct WALOptions {
     size_t sync_batch_size = 1024 * 1024;       // 1MB batch for batched sync
     std::chrono::milliseconds sync_interval{100}; // For periodic sync
     size_t max_file_size = 64 * 1024 * 1024;    // 64MB max log file
+    Statistics* statistics = nullptr;           // Not owned; WAL bytes and fsyncs
+    Env* env = Env::Default();                  // Not owned
 };
 
 class WALWriter {
@@ -41,7 +43,6 @@ public:
     WALWriter(const std::string& path, const WALOptions& options = WALOptions())
         : path_(path),
           options_(options),
-          fd_(-1),
           file_size_(0),
           bytes_since_sync_(0),
           closed_(false),
@@ -57,16 +58,9 @@ public:
     Status Open() {
         std::lock_guard<std::mutex> lock(mutex_);
 
-        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
-        if (fd_ < 0) {
-            return Status::IOError("Failed to open WAL: " + path_);
-        }
-
-        // Get current file size
-        struct stat st;
-        if (::fstat(fd_, &st) == 0) {
-            file_size_ = st.st_size;
-        }
+        Status s = options_.env->NewAppendableFile(path_, &file_);
+        if (!s.ok()) return s;
+        file_size_ = file_->GetFileSize();
 
         // Start background sync thread if periodic
         if (options_.sync_policy == SyncPolicy::kSyncPeriodic) {
@@ -91,10 +85,11 @@ public:
         }
 
         // Final sync and close
-        if (fd_ >= 0) {
-            ::fsync(fd_);
-            ::close(fd_);
-            fd_ = -1;
+        if (file_) {
+            Status s = file_->Sync();
+            Status close_status = file_->Close();
+            file_.reset();
+            return s.ok() ? close_status : s;
         }
 
         return Status::OK();
@@ -106,6 +101,17 @@ public:
         return AppendRecord(payload);
     }
 
+    // Append several entries with one write() and at most one sync, as
+    // for a group of concurrent writers committed together
+    Status AppendBatch(const std::vector<WALEntry>& entries) {
+        std::string records;
+        for (const auto& entry : entries) {
+            AppendEncodedRecord(EncodeWALEntry(entry), &records);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        return WriteLocked(records);
+    }
+
     // Append a Put operation
     Status AppendPut(SequenceNumber seq, Slice key, Slice value) {
         WALEntry entry;
@@ -145,50 +151,75 @@ public:
 
 private:
     Status AppendRecord(const std::string& payload) {
+        std::string record;
+        AppendEncodedRecord(payload, &record);
         std::lock_guard<std::mutex> lock(mutex_);
+        return WriteLocked(record);
+    }
 
-        if (fd_ < 0) {
-            return Status::IOError("WAL not open");
+    // Append the records framing payload to *dst, each
+    // CRC32 | Length | Type | Payload. A payload over kMaxRecordSize is
+    // split into kFirst, kMiddle... and kLast fragments.
+    static void AppendEncodedRecord(const std::string& payload, std::string* dst) {
+        size_t num_fragments = payload.empty() ? 1
+                                               : (payload.size() + kMaxRecordSize - 1) / kMaxRecordSize;
+        dst->reserve(dst->size() + num_fragments * kHeaderSize + payload.size());
+
+        size_t offset = 0;
+        for (size_t i = 0; i < num_fragments; i++) {
+            size_t n = std::min(kMaxRecordSize, payload.size() - offset);
+            RecordType type = num_fragments == 1 ? RecordType::kFull
+                              : i == 0 ? RecordType::kFirst
+                              : i + 1 == num_fragments ? RecordType::kLast
+                              : RecordType::kMiddle;
+            AppendFragment(type, payload.data() + offset, n, dst);
+            offset += n;
         }
+    }
 
-        // Build record: CRC32 | Length | Type | Payload
-        std::string record;
-        record.reserve(kHeaderSize + payload.size());
+    static void AppendFragment(RecordType type, const char* data, size_t n, std::string* dst) {
+        size_t crc_pos = dst->size();
 
         // Placeholder for CRC (will fill in after)
-        size_t crc_pos = record.size();
-        record.append(4, '\0');
+        dst->append(4, '\0');
 
         // Length (16-bit)
-        uint16_t len = static_cast<uint16_t>(payload.size());
-        record.push_back(len & 0xff);
-        record.push_back((len >> 8) & 0xff);
+        uint16_t len = static_cast<uint16_t>(n);
+        dst->push_back(len & 0xff);
+        dst->push_back((len >> 8) & 0xff);
 
-        // Type (always full record for now)
-        record.push_back(static_cast<char>(RecordType::kFull));
+        dst->push_back(static_cast<char>(type));
 
         // Payload
-        record.append(payload);
+        dst->append(data, n);
 
         // Compute CRC over type + payload
-        uint32_t crc = CRC32::Compute(record.data() + crc_pos + 6,
-                                       record.size() - crc_pos - 6);
+        uint32_t crc = CRC32::Compute(dst->data() + crc_pos + 6,
+                                       dst->size() - crc_pos - 6);
         // Also include length in CRC
-        crc = CRC32::Update(crc ^ 0xFFFFFFFF, record.data() + crc_pos + 4, 2) ^ 0xFFFFFFFF;
+        crc = CRC32::Update(crc ^ 0xFFFFFFFF, dst->data() + crc_pos + 4, 2) ^ 0xFFFFFFFF;
 
-        record[crc_pos] = crc & 0xff;
-        record[crc_pos + 1] = (crc >> 8) & 0xff;
-        record[crc_pos + 2] = (crc >> 16) & 0xff;
-        record[crc_pos + 3] = (crc >> 24) & 0xff;
+        (*dst)[crc_pos] = crc & 0xff;
+        (*dst)[crc_pos + 1] = (crc >> 8) & 0xff;
+        (*dst)[crc_pos + 2] = (crc >> 16) & 0xff;
+        (*dst)[crc_pos + 3] = (crc >> 24) & 0xff;
+    }
+
+    // Write framed records and apply the sync policy once.
+    // REQUIRES: mutex_ held
+    Status WriteLocked(const std::string& records) {
+        if (!file_) {
+            return Status::IOError("WAL not open");
+        }
 
         // Write to file
-        ssize_t written = ::write(fd_, record.data(), record.size());
-        if (written != static_cast<ssize_t>(record.size())) {
+        if (!file_->Append(records).ok()) {
             return Status::IOError("Failed to write WAL record");
         }
 
-        file_size_.fetch_add(record.size(), std::memory_order_relaxed);
-        bytes_since_sync_ += record.size();
+        file_size_.fetch_add(records.size(), std::memory_order_relaxed);
+        bytes_since_sync_ += records.size();
+        RecordTick(options_.statistics, kWalBytes, records.size());
 
         // Handle sync based on policy
         return HandleSync();
@@ -217,8 +248,11 @@ private:
     }
 
     Status SyncLocked() {
-        if (fd_ >= 0 && bytes_since_sync_ > 0) {
-            if (::fsync(fd_) != 0) {
+        if (file_ && bytes_since_sync_ > 0) {
+            StopWatch sw(options_.statistics, kWalSync);
+            PerfTimer perf_timer(&PerfContext::wal_sync_nanos);
+            RecordTick(options_.statistics, kWalSyncs);
+            if (!file_->Sync().ok()) {
                 return Status::IOError("Failed to fsync WAL");
             }
             bytes_since_sync_ = 0;
@@ -246,7 +280,7 @@ private:
     WALOptions options_;
 
     std::mutex mutex_;
-    int fd_;
+    std::unique_ptr<WritableFile> file_;
     std::atomic<size_t> file_size_;
     size_t bytes_since_sync_;
 